@@ -0,0 +1,127 @@
+# Renders a small scene with several pbrt processes, each covering a range of
+# pixel samples or a set of pixels, and checks that "imgtool merge" of their
+# partial films matches a single-process rendering, or is rejected when the
+# integrator's splats can't be merged.
+#
+# Usage: cmake -DPBRT=<pbrt> -DIMGTOOL=<imgtool> -DWORK_DIR=<dir>
+#              -P PartialFilmTest.cmake
+
+foreach (var PBRT IMGTOOL WORK_DIR)
+  if (NOT DEFINED ${var})
+    message (FATAL_ERROR "${var} must be defined")
+  endif ()
+endforeach ()
+
+set (dir "${WORK_DIR}/partial_film_test")
+file (REMOVE_RECURSE "${dir}")
+file (MAKE_DIRECTORY "${dir}")
+
+function (write_scene integrator)
+  file (WRITE "${dir}/${integrator}.pbrt" "
+LookAt 0 2 -6  0 0 0  0 1 0
+Camera \"perspective\" \"float fov\" 40
+Sampler \"halton\" \"integer pixelsamples\" 16
+Film \"rgb\" \"integer xresolution\" 32 \"integer yresolution\" 32
+    \"string filename\" \"${integrator}.exr\"
+Integrator \"${integrator}\" \"integer maxdepth\" 3
+WorldBegin
+LightSource \"point\" \"point3 from\" [ 2 4 -2 ] \"blackbody I\" 3000
+    \"float power\" 100
+Material \"diffuse\" \"rgb reflectance\" [ .5 .4 .3 ]
+Shape \"sphere\" \"float radius\" 1
+Shape \"trianglemesh\" \"point3 P\" [ -10 -1 -10  10 -1 -10  10 -1 10  -10 -1 10 ]
+    \"integer indices\" [ 0 1 2  0 2 3 ]
+")
+endfunction ()
+
+# Starts all of the given pbrt invocations, separated by "--", as concurrent
+# processes and fails if any of them does.
+function (render_concurrently)
+  set (commands)
+  set (args)
+  foreach (arg ${ARGN} --)
+    if (arg STREQUAL "--")
+      list (APPEND commands COMMAND "${PBRT}" --quiet --nthreads 1 ${args})
+      set (args)
+    else ()
+      list (APPEND args "${arg}")
+    endif ()
+  endforeach ()
+  execute_process (${commands} WORKING_DIRECTORY "${dir}"
+                   RESULTS_VARIABLE results)
+  foreach (result ${results})
+    if (NOT result EQUAL 0)
+      message (FATAL_ERROR "pbrt failed: ${results}")
+    endif ()
+  endforeach ()
+endfunction ()
+
+function (imgtool out_result out_output)
+  execute_process (COMMAND "${IMGTOOL}" ${ARGN} WORKING_DIRECTORY "${dir}"
+                   RESULT_VARIABLE result OUTPUT_VARIABLE output
+                   ERROR_VARIABLE output)
+  set (${out_result} ${result} PARENT_SCOPE)
+  set (${out_output} "${output}" PARENT_SCOPE)
+endfunction ()
+
+# Fails unless _image_ matches _reference_ up to floating-point round-off in
+# the accumulation of pixel sums.
+function (check_matches image reference)
+  imgtool (result output diff --reference "${reference}" "${image}")
+  if (result EQUAL 0)
+    return ()
+  endif ()
+  if (NOT output MATCHES "([-0-9.]+)% delta")
+    message (FATAL_ERROR "imgtool diff failed: ${output}")
+  endif ()
+  if (CMAKE_MATCH_1 GREATER 0.01 OR CMAKE_MATCH_1 LESS -0.01)
+    message (FATAL_ERROR "${image} doesn't match ${reference}: ${output}")
+  endif ()
+endfunction ()
+
+# Pixel sample ranges may be merged for any integrator, including ones that
+# splat.
+foreach (integrator path bdpt)
+  write_scene (${integrator})
+  render_concurrently (${integrator}.pbrt --outfile ${integrator}-full.exr)
+  render_concurrently (
+    ${integrator}.pbrt --partial-film --sample-range 0,5
+        --outfile ${integrator}-a.exr --
+    ${integrator}.pbrt --partial-film --sample-range 5,12
+        --outfile ${integrator}-b.exr --
+    ${integrator}.pbrt --partial-film --sample-range 12,16
+        --outfile ${integrator}-c.exr)
+  imgtool (result output merge --outfile ${integrator}-merged.exr
+           ${integrator}-a.exr ${integrator}-b.exr ${integrator}-c.exr)
+  if (NOT result EQUAL 0)
+    message (FATAL_ERROR "merging ${integrator} sample ranges failed: ${output}")
+  endif ()
+  check_matches (${integrator}-merged.exr ${integrator}-full.exr)
+endforeach ()
+
+# Pixel bounds may be merged for integrators that only write to their own
+# pixels...
+render_concurrently (
+  path.pbrt --partial-film --pixelbounds 0,32,0,16 --outfile path-top.exr --
+  path.pbrt --partial-film --pixelbounds 0,32,16,32 --outfile path-bottom.exr)
+imgtool (result output merge --outfile path-tiles.exr path-top.exr path-bottom.exr)
+if (NOT result EQUAL 0)
+  message (FATAL_ERROR "merging path pixel bounds failed: ${output}")
+endif ()
+check_matches (path-tiles.exr path-full.exr)
+
+# ...but not for ones that splat, since each process drops the splats that land
+# outside of its own pixel bounds.
+render_concurrently (
+  bdpt.pbrt --partial-film --pixelbounds 0,32,0,16 --outfile bdpt-top.exr --
+  bdpt.pbrt --partial-film --pixelbounds 0,32,16,32 --outfile bdpt-bottom.exr)
+imgtool (result output merge --outfile bdpt-tiles.exr bdpt-top.exr bdpt-bottom.exr)
+if (result EQUAL 0)
+  message (FATAL_ERROR "merging bdpt pixel bounds should have failed")
+endif ()
+
+# Films from different integrators can't be merged either.
+imgtool (result output merge --outfile mixed.exr path-a.exr bdpt-b.exr)
+if (result EQUAL 0)
+  message (FATAL_ERROR "merging path and bdpt films should have failed")
+endif ()
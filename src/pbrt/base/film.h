@@ -46,6 +46,13 @@ class FilmHandle : public TaggedPointer<RGBFilm, GBufferFilm> {
     void WriteImage(ImageMetadata metadata, Float splatScale = 1);
     Image GetImage(ImageMetadata *metadata, Float splatScale = 1);
 
+    // Tile streaming: returns zero if the film keeps all pixels in memory
+    int StreamingTileSize() const;
+    void BeginStreaming(ImageMetadata metadata);
+    void StartTile(const Bounds2i &tileBounds);
+    void FinishTile(const Bounds2i &tileBounds);
+    void EndStreaming();
+
     using TaggedPointer::TaggedPointer;
 
     static FilmHandle Create(const std::string &name,
@@ -27,6 +27,7 @@ class DistantLight;
 class ProjectionLight;
 class GoniometricLight;
 class DiffuseAreaLight;
+class TriangleMeshLight;
 class UniformInfiniteLight;
 class ImageInfiniteLight;
 class PortalImageInfiniteLight;
@@ -40,8 +41,9 @@ struct LightLeSample;
 // LightHandle Definition
 class LightHandle
     : public TaggedPointer<PointLight, DistantLight, ProjectionLight, GoniometricLight,
-                           SpotLight, DiffuseAreaLight, UniformInfiniteLight,
-                           ImageInfiniteLight, PortalImageInfiniteLight> {
+                           SpotLight, DiffuseAreaLight, TriangleMeshLight,
+                           UniformInfiniteLight, ImageInfiniteLight,
+                           PortalImageInfiniteLight> {
   public:
     // Light Interface
     using TaggedPointer::TaggedPointer;
@@ -58,6 +60,14 @@ class LightHandle
                                   const MediumInterface &mediumInterface,
                                   const ShapeHandle shape, const FileLoc *loc,
                                   Allocator alloc);
+    // Returns a single light for all of _shapes_, or nullptr if the area
+    // light must instead be created separately for each shape.
+    static LightHandle CreateMeshArea(const std::string &name,
+                                      const ParameterDictionary &parameters,
+                                      const Transform &renderFromLight,
+                                      const MediumInterface &mediumInterface,
+                                      pstd::span<const ShapeHandle> shapes,
+                                      const FileLoc *loc, Allocator alloc);
 
     void Preprocess(const Bounds3f &sceneBounds);
 
@@ -47,10 +47,13 @@ template <typename DensityProvider>
 class GeneralMedium;
 class UniformGridMediumProvider;
 using UniformGridMedium = GeneralMedium<UniformGridMediumProvider>;
+class SparseGridMediumProvider;
+using SparseGridMedium = GeneralMedium<SparseGridMediumProvider>;
 struct MediumSample;
 
 // MediumHandle Definition
-class MediumHandle : public TaggedPointer<HomogeneousMedium, UniformGridMedium> {
+class MediumHandle : public TaggedPointer<HomogeneousMedium, UniformGridMedium,
+                                          SparseGridMedium> {
   public:
     // MediumHandle Interface
     using TaggedPointer::TaggedPointer;
@@ -7,6 +7,7 @@
 
 #include <pbrt/pbrt.h>
 
+#include <pbrt/base/texture.h>
 #include <pbrt/util/buffercache.h>
 #include <pbrt/util/float.h>
 #include <pbrt/util/taggedptr.h>
@@ -27,6 +28,7 @@ class Disk;
 struct ShapeSample;
 struct ShapeIntersection;
 class ShapeSampleContext;
+struct SubdivisionDicing;
 
 // ShapeHandle Definition
 class ShapeHandle
@@ -40,7 +42,9 @@ class ShapeHandle
                                             const Transform *objectFromRender,
                                             bool reverseOrientation,
                                             const ParameterDictionary &parameters,
-                                            const FileLoc *loc, Allocator alloc);
+                                            const FileLoc *loc, Allocator alloc,
+                                            const SubdivisionDicing *dicing = nullptr,
+                                            FloatTextureHandle displacement = nullptr);
     std::string ToString() const;
 
     PBRT_CPU_GPU inline Bounds3f Bounds() const;
@@ -13,6 +13,7 @@
 #include <pbrt/shapes.h>
 #include <pbrt/util/image.h>
 #include <pbrt/util/log.h>
+#include <pbrt/util/lowdiscrepancy.h>
 #include <pbrt/util/memory.h>
 #include <pbrt/util/parallel.h>
 #include <pbrt/util/print.h>
@@ -793,3 +794,86 @@ TEST(Hair, SamplingConsistency) {
             EXPECT_LT(err, 0.05);
         }
 }
+
+TEST(CoatedDiffuseBxDF, TabulatedMatchesStochastic) {
+    Allocator alloc;
+    LayeredBxDFConfig config;
+    config.nSamples = 16;
+    Float thickness = 0.1f;
+    for (int c = 0; c < 12; ++c) {
+        Float alpha = c / 4 == 0 ? 0.f : (c / 4 == 1 ? 0.1f : 0.5f);
+        Float eta = (c & 2) ? 1.5f : 1.33f, R = (c & 1) ? 0.9f : 0.2f;
+        DielectricInterfaceBxDF top(eta, TrowbridgeReitzDistribution(alpha, alpha));
+        IdealDiffuseBxDF bottom((SampledSpectrum(R)));
+        const CoatedDiffuseTable *table =
+            GetCoatedDiffuseTable(alpha, eta, thickness, alloc);
+        CoatedDiffuseBxDF stochastic(top, bottom, thickness, SampledSpectrum(0), 0,
+                                     config);
+        CoatedDiffuseBxDF tabulated(top, bottom, thickness, SampledSpectrum(0), 0, config,
+                                    table);
+
+        for (Float cosTheta_o : {0.2f, 0.6f, 0.95f}) {
+            Vector3f wo(SafeSqrt(1 - Sqr(cosTheta_o)), 0, cosTheta_o);
+            // Compare directional albedos of the non-specular components
+            Float rhoStochastic = 0, rhoTabulated = 0, pdfSum = 0;
+            int n = 4096;
+            for (int i = 0; i < n; ++i) {
+                Point2f u((i + 0.5f) / n, RadicalInverse(0, i));
+                Vector3f wi = SampleUniformHemisphere(u);
+                Float scale = AbsCosTheta(wi) / (UniformHemispherePDF() * n);
+                rhoStochastic += stochastic.f(wo, wi, TransportMode::Radiance)[0] * scale;
+                rhoTabulated += tabulated.f(wo, wi, TransportMode::Radiance)[0] * scale;
+                pdfSum += tabulated.PDF(wo, wi, TransportMode::Radiance) /
+                          (UniformHemispherePDF() * n);
+            }
+            EXPECT_NEAR(rhoStochastic, rhoTabulated, 0.02f + 0.03f * rhoStochastic)
+                << alpha << " " << eta << " " << R << " " << cosTheta_o;
+            // Some of the coating's reflection lobe may be below the horizon
+            if (alpha > 0) {
+                EXPECT_LT(pdfSum, 1.02f);
+                EXPECT_GT(pdfSum, 0.9f);
+            }
+
+            // Sampled values and densities should match _f()_ and _PDF()_
+            for (int i = 0; i < 64; ++i) {
+                Point2f u(RadicalInverse(0, i), RadicalInverse(1, i));
+                BSDFSample bs =
+                    tabulated.Sample_f(wo, (i + 0.5f) / 64, u, TransportMode::Radiance);
+                if (!bs || bs.IsSpecular())
+                    continue;
+                EXPECT_FLOAT_EQ(bs.f[0],
+                                tabulated.f(wo, bs.wi, TransportMode::Radiance)[0]);
+                EXPECT_FLOAT_EQ(bs.pdf,
+                                tabulated.PDF(wo, bs.wi, TransportMode::Radiance));
+            }
+        }
+    }
+}
+
+TEST(CoatedDiffuseBxDF, RegularizeDisablesTable) {
+    // Regularizing changes the coating's roughness, so a regularized tabulated BxDF
+    // should match a regularized stochastic one
+    Allocator alloc;
+    LayeredBxDFConfig config;
+    Float alpha = 0.05f, eta = 1.5f, thickness = 0.1f;
+    DielectricInterfaceBxDF top(eta, TrowbridgeReitzDistribution(alpha, alpha));
+    IdealDiffuseBxDF bottom((SampledSpectrum(0.5f)));
+    CoatedDiffuseBxDF stochastic(top, bottom, thickness, SampledSpectrum(0), 0, config);
+    CoatedDiffuseBxDF tabulated(top, bottom, thickness, SampledSpectrum(0), 0, config,
+                                GetCoatedDiffuseTable(alpha, eta, thickness, alloc));
+    EXPECT_FALSE(tabulated.SampledPDFIsProportional());
+    stochastic.Regularize();
+    tabulated.Regularize();
+    EXPECT_TRUE(tabulated.SampledPDFIsProportional());
+
+    RNG rng;
+    for (int i = 0; i < 100; ++i) {
+        Point2f uo(rng.Uniform<Float>(), rng.Uniform<Float>());
+        Point2f ui(rng.Uniform<Float>(), rng.Uniform<Float>());
+        Vector3f wo = SampleUniformHemisphere(uo), wi = SampleUniformHemisphere(ui);
+        EXPECT_EQ(stochastic.f(wo, wi, TransportMode::Radiance)[0],
+                  tabulated.f(wo, wi, TransportMode::Radiance)[0]);
+        EXPECT_EQ(stochastic.PDF(wo, wi, TransportMode::Radiance),
+                  tabulated.PDF(wo, wi, TransportMode::Radiance));
+    }
+}
@@ -5,17 +5,28 @@
 #include <pbrt/bssrdf.h>
 
 #include <pbrt/media.h>
+#include <pbrt/options.h>
 #include <pbrt/shapes.h>
+#include <pbrt/util/error.h>
+#include <pbrt/util/log.h>
 #include <pbrt/util/math.h>
 #include <pbrt/util/memory.h>
 #include <pbrt/util/parallel.h>
 #include <pbrt/util/print.h>
 #include <pbrt/util/sampling.h>
+#include <pbrt/util/stats.h>
 
 #include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
 
 namespace pbrt {
 
+STAT_COUNTER("Scene/BSSRDF tables shared", bssrdfTablesShared);
+
 std::string TabulatedBSSRDF::ToString() const {
     return StringPrintf("[ TabulatedBSSRDF po: %s eta: %f ns: %s ss: %s ts: %s "
                         "sigma_t: %s rho: %s table: %s ]",
@@ -97,6 +108,59 @@ Float BeamDiffusionSS(Float sigma_s, Float sigma_a, Float g, Float eta, Float r)
     return Ess / nSamples;
 }
 
+std::string BSSRDFTableCacheFilename(const std::string &directory, Float g, Float eta) {
+    // Identify the table by the exact bits of _g_ and _eta_, the size of _Float_,
+    // the table's dimensions, and the version of the file layout
+    constexpr int version = 1;
+    return directory + StringPrintf("/bssrdf-v%d-float%d-%dx%dx%d-g%a-eta%a.bin",
+                                    version, int(8 * sizeof(Float)),
+                                    BSSRDFTable::NRhoSamples, BSSRDFTable::NRadiusSamples,
+                                    BSSRDFTable::NInverseCDFSamples, g, eta);
+}
+
+bool ReadBSSRDFTable(const std::string &filename, BSSRDFTable *t) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        return false;
+    for (pstd::vector<Float> *v : {&t->rhoSamples, &t->radiusSamples, &t->profile,
+                                   &t->rhoEff, &t->profileCDF, &t->radiusInverseCDF}) {
+        uint64_t size;
+        if (!in.read((char *)&size, sizeof(size)) || size != v->size() ||
+            !in.read((char *)v->data(), size * sizeof(Float))) {
+            Warning("%s: ignoring invalid BSSRDF table cache file.", filename);
+            return false;
+        }
+    }
+    if (in.peek() != std::ifstream::traits_type::eof()) {
+        Warning("%s: ignoring invalid BSSRDF table cache file.", filename);
+        return false;
+    }
+    LOG_VERBOSE("Read BSSRDF table from %s", filename);
+    return true;
+}
+
+bool WriteBSSRDFTable(const std::string &filename, const BSSRDFTable &t) {
+    // Write to a temporary file that is then renamed so that concurrent pbrt
+    // processes never read a partially-written table
+    std::string tempFilename =
+        filename + StringPrintf(".%u.tmp", uint32_t(std::random_device()()));
+    std::ofstream out(tempFilename, std::ios::binary);
+    for (const pstd::vector<Float> *v :
+         {&t.rhoSamples, &t.radiusSamples, &t.profile, &t.rhoEff, &t.profileCDF,
+          &t.radiusInverseCDF}) {
+        uint64_t size = v->size();
+        out.write((const char *)&size, sizeof(size));
+        out.write((const char *)v->data(), size * sizeof(Float));
+    }
+    out.close();
+    if (!out.good() || std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tempFilename.c_str());
+        Warning("%s: unable to write BSSRDF table cache file.", filename);
+        return false;
+    }
+    return true;
+}
+
 void ComputeBeamDiffusionBSSRDF(Float g, Float eta, BSSRDFTable *t) {
     // Choose radius values of the diffusion profile discretization
     t->radiusSamples[0] = 0;
@@ -124,21 +188,66 @@ void ComputeBeamDiffusionBSSRDF(Float g, Float eta, BSSRDFTable *t) {
         t->rhoEff[i] =
             IntegrateCatmullRom(t->radiusSamples, {&t->profile[i * nSamples], nSamples},
                                 {&t->profileCDF[i * nSamples], nSamples});
+
+        // Tabulate inverse of the radial CDF for albedo sample _i_
+        constexpr int nInv = BSSRDFTable::NInverseCDFSamples;
+        Float *radii = &t->radiusInverseCDF[i * (nInv + 1)];
+        if (t->rhoEff[i] == 0) {
+            for (int k = 0; k <= nInv; ++k)
+                radii[k] = 0;
+            return;
+        }
+        radii[0] = t->radiusSamples[0];
+        radii[nInv] = t->radiusSamples.back();
+        for (int k = 1; k < nInv; ++k) {
+            Float r = SampleCatmullRom(
+                t->radiusSamples, {&t->profile[i * nSamples], nSamples},
+                {&t->profileCDF[i * nSamples], nSamples}, Float(k) / nInv);
+            radii[k] = Clamp(r, radii[k - 1], radii[nInv]);
+        }
     });
 }
 
+const BSSRDFTable *GetBeamDiffusionBSSRDFTable(Float g, Float eta, Allocator alloc) {
+    // Return previously computed table for _g_ and _eta_, if available
+    static std::mutex mutex;
+    static std::map<std::pair<Float, Float>, const BSSRDFTable *> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto iter = tables.find({g, eta}); iter != tables.end()) {
+        ++bssrdfTablesShared;
+        return iter->second;
+    }
+
+    // Read the table from the cache directory or compute it
+    BSSRDFTable *table = alloc.new_object<BSSRDFTable>(
+        BSSRDFTable::NRhoSamples, BSSRDFTable::NRadiusSamples, alloc);
+    std::string filename;
+    if (Options && !Options->cacheDirectory.empty())
+        filename = BSSRDFTableCacheFilename(Options->cacheDirectory, g, eta);
+    if (filename.empty() || !ReadBSSRDFTable(filename, table)) {
+        ComputeBeamDiffusionBSSRDF(g, eta, table);
+        if (!filename.empty())
+            WriteBSSRDFTable(filename, *table);
+    }
+
+    tables[{g, eta}] = table;
+    return table;
+}
+
 // BSSRDFTable Method Definitions
 BSSRDFTable::BSSRDFTable(int nRhoSamples, int nRadiusSamples, Allocator alloc)
     : rhoSamples(nRhoSamples, alloc),
       radiusSamples(nRadiusSamples, alloc),
       profile(nRadiusSamples * nRhoSamples, alloc),
       rhoEff(nRhoSamples, alloc),
-      profileCDF(nRadiusSamples * nRhoSamples, alloc) {}
+      profileCDF(nRadiusSamples * nRhoSamples, alloc),
+      radiusInverseCDF(nRhoSamples * (NInverseCDFSamples + 1), alloc) {}
 
 std::string BSSRDFTable::ToString() const {
     return StringPrintf("[ BSSRDFTable rhoSamples: %s radiusSamples: %s profile: %s "
-                        "rhoEff: %s profileCDF: %s ]",
-                        rhoSamples, radiusSamples, profile, rhoEff, profileCDF);
+                        "rhoEff: %s profileCDF: %s radiusInverseCDF: %s ]",
+                        rhoSamples, radiusSamples, profile, rhoEff, profileCDF,
+                        radiusInverseCDF);
 }
 
 }  // namespace pbrt
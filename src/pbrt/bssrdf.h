@@ -70,6 +70,12 @@ Float BeamDiffusionSS(Float sigma_s, Float sigma_a, Float g, Float eta, Float r)
 Float BeamDiffusionMS(Float sigma_s, Float sigma_a, Float g, Float eta, Float r);
 
 void ComputeBeamDiffusionBSSRDF(Float g, Float eta, BSSRDFTable *t);
+const BSSRDFTable *GetBeamDiffusionBSSRDFTable(Float g, Float eta, Allocator alloc);
+
+// Tables are cached on disk in files named by _BSSRDFTableCacheFilename()_
+std::string BSSRDFTableCacheFilename(const std::string &directory, Float g, Float eta);
+bool ReadBSSRDFTable(const std::string &filename, BSSRDFTable *t);
+bool WriteBSSRDFTable(const std::string &filename, const BSSRDFTable &t);
 
 // BSSRDFTable Definition
 struct BSSRDFTable {
@@ -78,6 +84,11 @@ struct BSSRDFTable {
     pstd::vector<Float> profile;
     pstd::vector<Float> rhoEff;
     pstd::vector<Float> profileCDF;
+    // Optical radii where each albedo's radial CDF reaches $k/N$ for $k=0,\ldots,N$
+    static constexpr int NInverseCDFSamples = 128;
+    // Dimensions of the tables computed by _GetBeamDiffusionBSSRDFTable()_
+    static constexpr int NRhoSamples = 100, NRadiusSamples = 64;
+    pstd::vector<Float> radiusInverseCDF;
 
     // BSSRDFTable Public Methods
     BSSRDFTable(int nRhoSamples, int nRadiusSamples, Allocator alloc);
@@ -90,6 +101,81 @@ struct BSSRDFTable {
         CHECK(radiusIndex >= 0 && radiusIndex < radiusSamples.size());
         return profile[rhoIndex * radiusSamples.size() + radiusIndex];
     }
+
+    // Radii are sampled from a mixture of the profiles of the two albedo samples
+    // around $\rho$, weighted by their effective albedos and distance to $\rho$
+    PBRT_CPU_GPU
+    bool RhoMixtureWeights(Float rho, int *rhoIndex, Float weights[2]) const {
+        int i = FindInterval(rhoSamples.size(),
+                             [&](int j) { return rhoSamples[j] <= rho; });
+        Float t =
+            Clamp((rho - rhoSamples[i]) / (rhoSamples[i + 1] - rhoSamples[i]), 0, 1);
+        weights[0] = (1 - t) * rhoEff[i];
+        weights[1] = t * rhoEff[i + 1];
+        Float sum = weights[0] + weights[1];
+        if (sum == 0)
+            return false;
+        weights[0] /= sum;
+        weights[1] /= sum;
+        *rhoIndex = i;
+        return true;
+    }
+
+    PBRT_CPU_GPU
+    Float InverseRadiusCDF(int rhoIndex, Float u) const {
+        const Float *radii = &radiusInverseCDF[rhoIndex * (NInverseCDFSamples + 1)];
+        Float k = std::min(u, OneMinusEpsilon) * NInverseCDFSamples;
+        int k0 = int(k);
+        return Lerp(k - k0, radii[k0], radii[k0 + 1]);
+    }
+
+    PBRT_CPU_GPU
+    Float SampleRadius(Float rho, Float u) const {
+        // Choose albedo sample using _u_ and remap _u_ to sample its radius
+        int i;
+        Float weights[2];
+        if (!RhoMixtureWeights(rho, &i, weights))
+            return -1;
+        if (u < weights[0])
+            u /= weights[0];
+        else {
+            u = (u - weights[0]) / weights[1];
+            ++i;
+        }
+        return InverseRadiusCDF(i, u);
+    }
+
+    PBRT_CPU_GPU
+    Float RadiusPDF(Float rho, Float r) const {
+        int i;
+        Float weights[2];
+        if (!RhoMixtureWeights(rho, &i, weights))
+            return 0;
+        Float pdf = 0;
+        for (int j = 0; j < 2; ++j) {
+            // Add density of the piecewise-uniform inverse CDF of albedo sample _i+j_
+            const Float *radii = &radiusInverseCDF[(i + j) * (NInverseCDFSamples + 1)];
+            if (weights[j] == 0 || r < radii[0] || r >= radii[NInverseCDFSamples])
+                continue;
+            int k = FindInterval(NInverseCDFSamples + 1,
+                                 [&](int k) { return radii[k] <= r; });
+            if (radii[k + 1] > radii[k])
+                pdf += weights[j] / (NInverseCDFSamples * (radii[k + 1] - radii[k]));
+        }
+        return pdf;
+    }
+
+    // Returns the larger radius at CDF value _u_ of the two mixture components
+    PBRT_CPU_GPU
+    Float MaxRadius(Float rho, Float u) const {
+        int i;
+        Float weights[2];
+        if (!RhoMixtureWeights(rho, &i, weights))
+            return -1;
+        Float r0 = weights[0] > 0 ? InverseRadiusCDF(i, u) : 0;
+        Float r1 = weights[1] > 0 ? InverseRadiusCDF(i + 1, u) : 0;
+        return std::max(r0, r1);
+    }
 };
 
 // BSSRDFProbeSegment Definition
@@ -221,7 +307,7 @@ class TabulatedBSSRDF {
         Float phi = 2 * Pi * u2[1];
 
         // Compute BSSRDF profile bounds and intersection height
-        Float rMax = Sample_Sr(ch, 0.999f);
+        Float rMax = table->MaxRadius(rho[ch], 0.999f) / sigma_t[ch];
         if (r >= rMax)
             return {};
         Float l = 2 * std::sqrt(rMax * rMax - r * r);
@@ -237,42 +323,20 @@ class TabulatedBSSRDF {
     Float Sample_Sr(int ch, Float u) const {
         if (sigma_t[ch] == 0)
             return -1;
-        return SampleCatmullRom2D(table->rhoSamples, table->radiusSamples, table->profile,
-                                  table->profileCDF, rho[ch], u) /
-               sigma_t[ch];
+        Float rOptical = table->SampleRadius(rho[ch], u);
+        return rOptical < 0 ? -1 : rOptical / sigma_t[ch];
     }
 
     PBRT_CPU_GPU
     Float PDF_Sr(int ch, Float r) const {
         // Convert $r$ into unitless optical radius $r_{\roman{optical}}$
         Float rOptical = r * sigma_t[ch];
+        if (rOptical == 0)
+            return 0;
 
-        // Compute spline weights to interpolate BSSRDF density on channel _ch_
-        int rhoOffset, radiusOffset;
-        Float rhoWeights[4], radiusWeights[4];
-        if (!CatmullRomWeights(table->rhoSamples, rho[ch], &rhoOffset, rhoWeights) ||
-            !CatmullRomWeights(table->radiusSamples, rOptical, &radiusOffset,
-                               radiusWeights))
-            return 0.f;
-
-        // Return BSSRDF profile density for channel _ch_
-        Float sr = 0, rhoEff = 0;
-        for (int i = 0; i < 4; ++i) {
-            if (rhoWeights[i] == 0)
-                continue;
-            rhoEff += table->rhoEff[rhoOffset + i] * rhoWeights[i];
-            for (int j = 0; j < 4; ++j) {
-                if (radiusWeights[j] == 0)
-                    continue;
-                sr += table->EvalProfile(rhoOffset + i, radiusOffset + j) *
-                      rhoWeights[i] * radiusWeights[j];
-            }
-        }
-        // Cancel marginal PDF factor from tabulated BSSRDF profile
-        if (rOptical != 0)
-            sr /= 2 * Pi * rOptical;
-
-        return std::max<Float>(0, sr * sigma_t[ch] * sigma_t[ch] / rhoEff);
+        // Convert radial density of optical radius to area density in world units
+        return table->RadiusPDF(rho[ch], rOptical) * sigma_t[ch] * sigma_t[ch] /
+               (2 * Pi * rOptical);
     }
 
     PBRT_CPU_GPU
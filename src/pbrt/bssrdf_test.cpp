@@ -0,0 +1,87 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include <gtest/gtest.h>
+
+#include <pbrt/pbrt.h>
+
+#include <pbrt/bssrdf.h>
+#include <pbrt/util/math.h>
+#include <pbrt/util/memory.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace pbrt;
+
+TEST(BSSRDFTable, SharedTables) {
+    Allocator alloc;
+    const BSSRDFTable *t0 = GetBeamDiffusionBSSRDFTable(0.25f, 1.33f, alloc);
+    EXPECT_EQ(t0, GetBeamDiffusionBSSRDFTable(0.25f, 1.33f, alloc));
+    EXPECT_NE(t0, GetBeamDiffusionBSSRDFTable(0.25f, 1.5f, alloc));
+}
+
+TEST(BSSRDFTable, DiskCache) {
+    // Filenames must distinguish parameters that differ in their last bit
+    Float g = 0.1f, eta = 1.33f;
+    std::string filename = BSSRDFTableCacheFilename(".", g, eta);
+    EXPECT_NE(filename, BSSRDFTableCacheFilename(".", NextFloatUp(g), eta));
+    EXPECT_NE(filename, BSSRDFTableCacheFilename(".", g, NextFloatDown(eta)));
+
+    // Tables read from disk should match the ones that were written
+    Allocator alloc;
+    BSSRDFTable table(BSSRDFTable::NRhoSamples, BSSRDFTable::NRadiusSamples, alloc);
+    ComputeBeamDiffusionBSSRDF(g, eta, &table);
+    ASSERT_TRUE(WriteBSSRDFTable(filename, table));
+    BSSRDFTable read(BSSRDFTable::NRhoSamples, BSSRDFTable::NRadiusSamples, alloc);
+    ASSERT_TRUE(ReadBSSRDFTable(filename, &read));
+    for (pstd::vector<Float> BSSRDFTable::*v :
+         {&BSSRDFTable::rhoSamples, &BSSRDFTable::radiusSamples, &BSSRDFTable::profile,
+          &BSSRDFTable::rhoEff, &BSSRDFTable::profileCDF,
+          &BSSRDFTable::radiusInverseCDF}) {
+        ASSERT_EQ((table.*v).size(), (read.*v).size());
+        for (size_t i = 0; i < (table.*v).size(); ++i)
+            EXPECT_EQ((table.*v)[i], (read.*v)[i]);
+    }
+
+    // Truncated files and ones with trailing data should be rejected
+    std::ofstream(filename, std::ios::app | std::ios::binary) << 'x';
+    EXPECT_FALSE(ReadBSSRDFTable(filename, &read));
+    std::ofstream(filename, std::ios::binary) << "short";
+    EXPECT_FALSE(ReadBSSRDFTable(filename, &read));
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
+
+TEST(BSSRDFTable, SampleRadiusPDF) {
+    Allocator alloc;
+    const BSSRDFTable *table = GetBeamDiffusionBSSRDFTable(0, 1.33f, alloc);
+
+    for (Float rho : {0.1f, 0.5f, 0.77f, 0.99f}) {
+        // Histogram sampled radii over the first few units of optical radius
+        const int nBuckets = 32, nSamples = 100000;
+        Float rMax = table->MaxRadius(rho, 0.99f);
+        ASSERT_GT(rMax, 0);
+        std::vector<Float> histogram(nBuckets, 0.f);
+        for (int i = 0; i < nSamples; ++i) {
+            Float r = table->SampleRadius(rho, (i + 0.5f) / nSamples);
+            ASSERT_GE(r, 0);
+            if (r < rMax)
+                histogram[std::min<int>(r / rMax * nBuckets, nBuckets - 1)] += 1;
+        }
+
+        // Compare the histogram to the integral of _RadiusPDF()_ over each bucket
+        for (int b = 0; b < nBuckets; ++b) {
+            Float integral = 0;
+            const int nSteps = 1000;
+            Float width = rMax / nBuckets;
+            for (int j = 0; j < nSteps; ++j)
+                integral += table->RadiusPDF(rho, (b + (j + 0.5f) / nSteps) * width) *
+                            width / nSteps;
+            EXPECT_NEAR(integral, histogram[b] / nSamples, 2e-3f)
+                << "rho " << rho << ", bucket " << b;
+        }
+    }
+}
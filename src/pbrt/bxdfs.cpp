@@ -15,12 +15,17 @@
 #include <pbrt/util/float.h>
 #include <pbrt/util/hash.h>
 #include <pbrt/util/log.h>
+#include <pbrt/util/lowdiscrepancy.h>
 #include <pbrt/util/math.h>
 #include <pbrt/util/memory.h>
+#include <pbrt/util/parallel.h>
 #include <pbrt/util/print.h>
 #include <pbrt/util/sampling.h>
 #include <pbrt/util/stats.h>
 
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <unordered_map>
 
 namespace pbrt {
@@ -65,6 +70,87 @@ std::string DiffuseBxDF::ToString() const {
     return StringPrintf("[ DiffuseBxDF R: %s T: %s A: %f B: %f ]", R, T, A, B);
 }
 
+// CoatedDiffuseTable Method Definitions
+std::string CoatedDiffuseTable::ToString() const {
+    return StringPrintf("[ CoatedDiffuseTable reflectance: %s transmittanceIn: %s "
+                        "transmittanceOut: %s internalReflectance: %f ]",
+                        reflectance, transmittanceIn, transmittanceOut,
+                        internalReflectance);
+}
+
+STAT_COUNTER("Scene/Coated diffuse tables shared", coatedDiffuseTablesShared);
+
+static void ComputeCoatedDiffuseTable(Float alpha, Float eta, Float thickness,
+                                      CoatedDiffuseTable *t) {
+    DielectricInterfaceBxDF top(eta, TrowbridgeReitzDistribution(alpha, alpha));
+    thickness = std::max(thickness, std::numeric_limits<Float>::min());
+    auto Tr = [&](const Vector3f &w) { return std::exp(-thickness / AbsCosTheta(w)); };
+
+    // Estimate coating reflectance and transmittance at each $\cos\theta$
+    constexpr int nSamples = 1 << 14;
+    ParallelFor(0, CoatedDiffuseTable::NCosThetaSamples, [&](int64_t i) {
+        Float cosTheta = Float(i) / (CoatedDiffuseTable::NCosThetaSamples - 1);
+        Vector3f wo(SafeSqrt(1 - Sqr(cosTheta)), 0, cosTheta);
+        double r = 0, tIn = 0, tOut = 0;
+        for (int j = 0; j < nSamples; ++j) {
+            Float uc = (j + 0.5f) / nSamples;
+            Point2f u(RadicalInverse(0, j), RadicalInverse(1, j));
+            // Light leaving the layer is transmitted from the base toward _wo_, and
+            // light arriving from _wo_ is found using the adjoint BSDF
+            BSDFSample bs = top.Sample_f(wo, uc, u, TransportMode::Radiance);
+            if (bs && bs.wi.z != 0) {
+                Float w = bs.f[0] * AbsCosTheta(bs.wi) / bs.pdf;
+                if (bs.IsReflection())
+                    r += w;
+                else
+                    tOut += w * Tr(bs.wi);
+            }
+            bs = top.Sample_f(wo, uc, u, TransportMode::Importance,
+                              BxDFReflTransFlags::Transmission);
+            if (bs && bs.wi.z != 0)
+                tIn += bs.f[0] * AbsCosTheta(bs.wi) / bs.pdf * Tr(bs.wi);
+        }
+        t->reflectance[i] = r / nSamples;
+        t->transmittanceIn[i] = tIn / nSamples;
+        t->transmittanceOut[i] = tOut / nSamples;
+    });
+
+    // Estimate fraction of light from the base that is reflected back to it
+    constexpr int nInternalSamples = 1 << 18;
+    double internal = 0;
+    for (int j = 0; j < nInternalSamples; ++j) {
+        Point2f u0(RadicalInverse(0, j), RadicalInverse(1, j));
+        Point2f u1(RadicalInverse(2, j), RadicalInverse(3, j));
+        Vector3f w = -SampleCosineHemisphere(u0);
+        BSDFSample bs = top.Sample_f(w, (j + 0.5f) / nInternalSamples, u1,
+                                     TransportMode::Radiance,
+                                     BxDFReflTransFlags::Reflection);
+        if (bs && bs.wi.z != 0)
+            internal += Tr(w) * bs.f[0] * AbsCosTheta(bs.wi) / bs.pdf * Tr(bs.wi);
+    }
+    t->internalReflectance = internal / nInternalSamples;
+}
+
+const CoatedDiffuseTable *GetCoatedDiffuseTable(Float alpha, Float eta, Float thickness,
+                                                Allocator alloc) {
+    // Return previously computed table for the coating's parameters, if available
+    static std::mutex mutex;
+    static std::map<std::tuple<Float, Float, Float>, const CoatedDiffuseTable *> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::tuple<Float, Float, Float> key(alpha, eta, thickness);
+    if (auto iter = tables.find(key); iter != tables.end()) {
+        ++coatedDiffuseTablesShared;
+        return iter->second;
+    }
+
+    CoatedDiffuseTable *table = alloc.new_object<CoatedDiffuseTable>(alloc);
+    ComputeCoatedDiffuseTable(alpha, eta, thickness, table);
+    LOG_VERBOSE("Computed coated diffuse table for alpha %f eta %f thickness %f: %s",
+                alpha, eta, thickness, *table);
+    tables[key] = table;
+    return table;
+}
+
 template <typename TopBxDF, typename BottomBxDF, bool SupportAttenuation>
 std::string LayeredBxDF<TopBxDF, BottomBxDF, SupportAttenuation>::ToString() const {
     return StringPrintf(
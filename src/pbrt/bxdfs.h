@@ -1164,16 +1164,153 @@ f /= AbsCosTheta(w);
     LayeredBxDFConfig config;
 };
 
+// CoatedDiffuseTable Definition
+// All light that enters the coating of a _CoatedDiffuseBxDF_ reaches the Lambertian
+// base, so for an isotropic coating the part of the BSDF beyond reflection at the
+// coating factors into terms that depend on $\cos\theta_\roman{o}$, on
+// $\cos\theta_\roman{i}$, and on the base reflectance.
+struct CoatedDiffuseTable {
+    // CoatedDiffuseTable Public Methods
+    CoatedDiffuseTable(Allocator alloc)
+        : reflectance(NCosThetaSamples, alloc),
+          transmittanceIn(NCosThetaSamples, alloc),
+          transmittanceOut(NCosThetaSamples, alloc) {}
+
+    PBRT_CPU_GPU
+    static Float Lookup(const pstd::vector<Float> &values, Float cosTheta) {
+        Float x = Clamp(cosTheta, 0, 1) * (NCosThetaSamples - 1);
+        int i = std::min<int>(x, NCosThetaSamples - 2);
+        return Lerp(x - i, values[i], values[i + 1]);
+    }
+
+    std::string ToString() const;
+
+    // CoatedDiffuseTable Public Members
+    static constexpr int NCosThetaSamples = 64;
+    // Reflectance of the coating and transmittance through it to and from the base,
+    // including attenuation in the layer, at evenly-spaced values of $\cos\theta$
+    pstd::vector<Float> reflectance, transmittanceIn, transmittanceOut;
+    // Fraction of the light scattered by the base that the coating reflects back
+    Float internalReflectance = 0;
+};
+
+const CoatedDiffuseTable *GetCoatedDiffuseTable(Float alpha, Float eta, Float thickness,
+                                                Allocator alloc);
+
 // CoatedDiffuseBxDF Definition
 class CoatedDiffuseBxDF
     : public LayeredBxDF<DielectricInterfaceBxDF, IdealDiffuseBxDF, false> {
   public:
     // CoatedDiffuseBxDF Public Methods
     using LayeredBxDF::LayeredBxDF;
+    CoatedDiffuseBxDF() = default;
+    PBRT_CPU_GPU
+    CoatedDiffuseBxDF(DielectricInterfaceBxDF top, IdealDiffuseBxDF bottom,
+                      Float thickness, const SampledSpectrum &albedo, Float g,
+                      LayeredBxDFConfig config, const CoatedDiffuseTable *table)
+        : LayeredBxDF(top, bottom, thickness, albedo, g, config), table(table) {
+        DCHECK(!table || config.twoSided);
+    }
+
     PBRT_CPU_GPU
     static constexpr const char *Name() { return "CoatedDiffuseBxDF"; }
 
+    PBRT_CPU_GPU
+    void Regularize() {
+        // The table was computed for the coating's unregularized roughness, so
+        // fall back to stochastic evaluation
+        LayeredBxDF::Regularize();
+        table = nullptr;
+    }
+
+    PBRT_CPU_GPU
+    bool SampledPDFIsProportional() const { return !table; }
+
+    PBRT_CPU_GPU
+    SampledSpectrum f(Vector3f wo, Vector3f wi, TransportMode mode) const {
+        if (!table)
+            return LayeredBxDF::f(wo, wi, mode);
+        // Evaluate tabulated coated diffuse BSDF
+        if (wo.z < 0) {
+            wo = -wo;
+            wi = -wi;
+        }
+        if (!SameHemisphere(wo, wi))
+            return SampledSpectrum(0.f);
+        SampledSpectrum fBase = bottom.f(wo, wi, mode);
+        SampledSpectrum multiple = 1 - Pi * table->internalReflectance * fBase;
+        return top.f(wo, wi, mode) +
+               fBase * CoatedDiffuseTable::Lookup(table->transmittanceOut, wo.z) *
+                   CoatedDiffuseTable::Lookup(table->transmittanceIn, wi.z) / multiple;
+    }
+
+    PBRT_CPU_GPU
+    BSDFSample Sample_f(Vector3f wo, Float uc, const Point2f &u, TransportMode mode,
+                        BxDFReflTransFlags sampleFlags = BxDFReflTransFlags::All) const {
+        if (!table)
+            return LayeredBxDF::Sample_f(wo, uc, u, mode, sampleFlags);
+        if (!(sampleFlags & BxDFReflTransFlags::Reflection))
+            return {};
+        // Sample either reflection at the coating or light scattered by the base
+        bool flipWi = wo.z < 0;
+        if (flipWi)
+            wo = -wo;
+        Float pTop = topSamplingProbability(wo, mode);
+        BSDFSample bs;
+        if (uc < pTop) {
+            bs = top.Sample_f(wo, std::min(uc / pTop, OneMinusEpsilon), u, mode,
+                              BxDFReflTransFlags::Reflection);
+            if (!bs)
+                return {};
+            if (bs.IsSpecular())
+                bs.pdf *= pTop;
+        } else {
+            bs.wi = SampleCosineHemisphere(u);
+            bs.flags = BxDFFlags::DiffuseReflection;
+        }
+        if (!bs.IsSpecular()) {
+            bs.f = f(wo, bs.wi, mode);
+            bs.pdf = PDF(wo, bs.wi, mode);
+        }
+        if (flipWi)
+            bs.wi = -bs.wi;
+        return bs;
+    }
+
+    PBRT_CPU_GPU
+    Float PDF(Vector3f wo, Vector3f wi, TransportMode mode,
+              BxDFReflTransFlags sampleFlags = BxDFReflTransFlags::All) const {
+        if (!table)
+            return LayeredBxDF::PDF(wo, wi, mode, sampleFlags);
+        if (!(sampleFlags & BxDFReflTransFlags::Reflection))
+            return 0;
+        // Return PDF of the mixture used in tabulated _Sample_f()_
+        if (wo.z < 0) {
+            wo = -wo;
+            wi = -wi;
+        }
+        if (!SameHemisphere(wo, wi))
+            return 0;
+        Float pTop = topSamplingProbability(wo, mode);
+        return pTop * top.PDF(wo, wi, mode, BxDFReflTransFlags::Reflection) +
+               (1 - pTop) * CosineHemispherePDF(wi.z);
+    }
+
     friend class SOA<CoatedDiffuseBxDF>;
+
+  private:
+    // CoatedDiffuseBxDF Private Methods
+    PBRT_CPU_GPU
+    Float topSamplingProbability(Vector3f wo, TransportMode mode) const {
+        // Weight coating reflection and the base by their approximate albedos
+        Float rTop = CoatedDiffuseTable::Lookup(table->reflectance, wo.z);
+        Float rBase = Pi * bottom.f(wo, wo, mode).Average() *
+                      CoatedDiffuseTable::Lookup(table->transmittanceOut, wo.z);
+        return rTop + rBase > 0 ? rTop / (rTop + rBase) : 1;
+    }
+
+    // CoatedDiffuseBxDF Private Members
+    const CoatedDiffuseTable *table = nullptr;
 };
 
 // CoatedConductorBxDF Definition
@@ -4,6 +4,7 @@
 
 #include <pbrt/pbrt.h>
 
+#include <pbrt/film.h>
 #include <pbrt/filters.h>
 #include <pbrt/options.h>
 #include <pbrt/util/args.h>
@@ -150,6 +151,13 @@ static std::map<std::string, CommandUsage> commandUsage = {
     {"makeemitters", {"makeemitters [options] <filename>", std::string(R"(
     --downsample <n>   Downsample the image by a factor of n in both dimensions
                        (using simple box filtering). Default: 1.
+)")}},
+    {"merge", {"merge [options] <filenames...>\nwhere the files were rendered with "
+               "\"pbrt --partial-film\". Partial films from integrators that splat\n"
+               "(\"bdpt\" and \"lightpath\") must all have the same pixel bounds.",
+               std::string(R"(
+    --float            Write 32-bit floating-point pixel values (Default: half).
+    --outfile <name>   Filename for merged image.
 )")}},
     {"makesky", {"makesky [options] <filename>", std::string(R"(
     --albedo <a>       Albedo of ground-plane (range 0-1). Default: 0.5
@@ -441,6 +449,177 @@ int assemble(int argc, char *argv[]) {
     return 0;
 }
 
+int merge(int argc, char *argv[]) {
+    if (argc == 0)
+        usage("merge", "no filenames provided to \"merge\"?");
+    std::string outfile;
+    bool writeFloat = false;
+    std::vector<std::string> infiles;
+
+    while (*argv != nullptr) {
+        auto onError = [](const std::string &err) {
+            usage("merge", "%s", err.c_str());
+        };
+        if (ParseArg(&argv, "outfile", &outfile, onError) ||
+            ParseArg(&argv, "float", &writeFloat, onError))
+            ;  // success
+        else if (argv[0][0] == '-')
+            usage("merge", "%s: unknown command flag", *argv);
+        else {
+            infiles.push_back(*argv);
+            ++argv;
+        }
+    }
+
+    if (outfile.empty())
+        usage("merge", "--outfile not provided for \"merge\"");
+
+    // Per-pixel sums over all of the partial films
+    struct PixelSums {
+        double rgbSum[3] = {0, 0, 0};
+        double weightSum = 0;
+        double splatSum[3] = {0, 0, 0};
+        int64_t samples = 0;
+    };
+    std::vector<std::string> channelNames = PartialFilmChannelNames();
+    Point2i fullResolution;
+    const RGBColorSpace *colorSpace = nullptr;
+    Bounds2i mergedBounds, firstPixelBounds;
+    std::vector<PixelSums> sums;
+    std::vector<std::pair<Bounds2i, Point2i>> sampleRanges;
+    std::string integrator;
+
+    for (const std::string &file : infiles) {
+        if (!HasExtension(file, "exr"))
+            usage("merge", "%s: partial films are always EXR images.", file.c_str());
+
+        ImageAndMetadata im = Image::Read(file);
+        const Image &image = im.image;
+        const ImageMetadata &metadata = im.metadata;
+
+        ImageChannelDesc desc = image.GetChannelDesc(channelNames);
+        if (!desc)
+            ErrorExit("%s: image doesn't have partial film channels. Was it rendered "
+                      "with --partial-film?",
+                      file);
+        if (!metadata.fullResolution || !metadata.pixelBounds ||
+            !metadata.samplesPerPixel)
+            ErrorExit("%s: full resolution, pixel bounds, and samples per pixel must "
+                      "be present in the image metadata.",
+                      file);
+        Bounds2i pixelBounds = *metadata.pixelBounds;
+        auto integratorIter = metadata.stringVectors.find("integrator");
+        std::string fileIntegrator = integratorIter != metadata.stringVectors.end() &&
+                                             integratorIter->second.size() == 1
+                                         ? integratorIter->second[0]
+                                         : "unknown";
+
+        if (sums.empty()) {
+            // First image read
+            integrator = fileIntegrator;
+            fullResolution = *metadata.fullResolution;
+            colorSpace = metadata.GetColorSpace();
+            sums.resize(size_t(fullResolution.x) * size_t(fullResolution.y));
+            mergedBounds = firstPixelBounds = pixelBounds;
+        } else {
+            // Make sure that this image is compatible with the first one
+            if (*metadata.fullResolution != fullResolution)
+                ErrorExit("%s: full resolution %s doesn't match the first image's "
+                          "full resolution %s.",
+                          file, *metadata.fullResolution, fullResolution);
+            if (*metadata.GetColorSpace() != *colorSpace)
+                ErrorExit("%s: color space (%s) doesn't match first image's color "
+                          "space (%s).",
+                          file, *metadata.GetColorSpace(), *colorSpace);
+            if (fileIntegrator != integrator)
+                ErrorExit("%s: rendered with the \"%s\" integrator but the first image "
+                          "was rendered with \"%s\".",
+                          file, fileIntegrator, integrator);
+            mergedBounds = Union(mergedBounds, pixelBounds);
+        }
+        if (!Inside(pixelBounds, Bounds2i(Point2i(0, 0), fullResolution)))
+            ErrorExit("%s: pixel bounds %s aren't inside the full image.", file,
+                      pixelBounds);
+
+        // Splatting integrators discard splats outside of the pixel bounds, so
+        // their partial films can only be divided by sample range
+        if (pixelBounds != firstPixelBounds) {
+            if (integrator == "bdpt" || integrator == "lightpath")
+                ErrorExit("%s: the \"%s\" integrator splats to pixels outside of the "
+                          "pixel bounds, so partial films with different pixel bounds "
+                          "(%s and %s) can't be merged. Use --sample-range to divide "
+                          "the rendering instead.",
+                          file, integrator, pixelBounds, firstPixelBounds);
+            else if (integrator == "unknown")
+                Warning("%s: integrator isn't recorded in the image metadata. The "
+                        "merged image will be incorrect if it splats (e.g. \"bdpt\").",
+                        file);
+        }
+
+        // Warn about partial films that rendered the same pixel samples
+        auto rangeIter = metadata.stringVectors.find("sampleRange");
+        if (rangeIter != metadata.stringVectors.end() && rangeIter->second.size() == 2) {
+            Point2i range(atoi(rangeIter->second[0].c_str()),
+                          atoi(rangeIter->second[1].c_str()));
+            for (const auto &prev : sampleRanges)
+                if (!Intersect(prev.first, pixelBounds).IsEmpty() &&
+                    range.x < prev.second.y && prev.second.x < range.y)
+                    Warning("%s: sample range [%d, %d) overlaps previously merged "
+                            "range [%d, %d).",
+                            file, range.x, range.y, prev.second.x, prev.second.y);
+            sampleRanges.push_back(std::make_pair(pixelBounds, range));
+        }
+
+        // Accumulate the image's sums
+        for (Point2i p : pixelBounds) {
+            Point2i pImage(p.x - pixelBounds.pMin.x, p.y - pixelBounds.pMin.y);
+            ImageChannelValues v = image.GetChannels(pImage, desc);
+            PixelSums &ps = sums[size_t(p.y) * fullResolution.x + p.x];
+            for (int c = 0; c < 3; ++c) {
+                ps.rgbSum[c] += v[c];
+                ps.splatSum[c] += v[4 + c];
+            }
+            ps.weightSum += v[3];
+            ps.samples += *metadata.samplesPerPixel;
+        }
+    }
+
+    // Compute final pixel values from the merged sums
+    Image merged(writeFloat ? PixelFormat::Float : PixelFormat::Half,
+                 Point2i(mergedBounds.Diagonal()), {"R", "G", "B"});
+    int64_t minSamples = std::numeric_limits<int64_t>::max(), maxSamples = 0;
+    for (Point2i p : mergedBounds) {
+        const PixelSums &ps = sums[size_t(p.y) * fullResolution.x + p.x];
+        minSamples = std::min(minSamples, ps.samples);
+        maxSamples = std::max(maxSamples, ps.samples);
+        Float rgb[3];
+        for (int c = 0; c < 3; ++c) {
+            double v = ps.weightSum != 0 ? ps.rgbSum[c] / ps.weightSum : 0;
+            if (ps.samples > 0)
+                v += ps.splatSum[c] / ps.samples;
+            rgb[c] = v;
+        }
+        Point2i pOut(p.x - mergedBounds.pMin.x, p.y - mergedBounds.pMin.y);
+        merged.SetChannels(pOut, {rgb[0], rgb[1], rgb[2]});
+    }
+    if (minSamples == 0)
+        Warning("%s: some pixels weren't present in any of the partial images.",
+                outfile);
+    else if (minSamples != maxSamples)
+        Warning("%s: pixels have between %d and %d samples.", outfile, minSamples,
+                maxSamples);
+
+    ImageMetadata metadata;
+    metadata.pixelBounds = mergedBounds;
+    metadata.fullResolution = fullResolution;
+    metadata.colorSpace = colorSpace;
+    metadata.samplesPerPixel = int(minSamples);
+    if (!merged.Write(outfile, metadata))
+        return 1;
+
+    return 0;
+}
+
 int cat(int argc, char *argv[]) {
     if (argc == 0)
         usage("cat", "no filenames provided to \"cat\"?");
@@ -2282,6 +2461,8 @@ int main(int argc, char *argv[]) {
         return makeemitters(argc - 2, argv + 2);
     else if (strcmp(argv[1], "makesky") == 0)
         return makesky(argc - 2, argv + 2);
+    else if (strcmp(argv[1], "merge") == 0)
+        return merge(argc - 2, argv + 2);
     else if (strcmp(argv[1], "whitebalance") == 0)
         return whitebalance(argc - 2, argv + 2);
     else if (strcmp(argv[1], "noisybit") == 0) {
@@ -45,6 +45,8 @@ static void usage(const std::string &msg = {}) {
             R"(usage: pbrt [<options>] <filename.pbrt...>
 
 Rendering options:
+  --cachedir <dir>             Directory for caching precomputed data such as BSSRDF
+                               tables between runs.
   --cropwindow <x0,x1,y0,y1>   Specify an image crop window w.r.t. [0,1]^2
   --debugstart <values>        Inform the Integrator where to start rendering for
                                faster debugging. (<values> are Integrator-specific
@@ -65,6 +67,9 @@ Rendering options:
   --mse-reference-out          File to write MSE error vs spp results.
   --nthreads <num>             Use specified number of threads for rendering.
   --outfile <filename>         Write the final image to the given filename.
+  --partial-film               Write unnormalized sample sums and weights instead of
+                               final pixel values so that partial renderings can be
+                               combined with "imgtool merge".
   --pixel <x,y>                Render just the specified pixel.
   --pixelbounds <x0,x1,y0,y1>  Specify an image crop window w.r.t. pixel coordinates.
   --pixelstats                 Record per-pixel statistics and write additional images
@@ -74,6 +79,7 @@ Rendering options:
   --quiet                      Suppress all text output other than error messages.
   --render-coord-sys <name>    Coordinate system to use for the scene when rendering,
                                where name is "camera", "cameraworld", or "world".
+  --sample-range <start,end>   Only render pixel samples with indices in [start,end).
   --seed <n>                   Set random number generator seed. Default: 0.
   --spp <n>                    Override number of pixel samples specified in scene
                                description file.
@@ -122,7 +128,7 @@ int main(int argc, char *argv[]) {
             exit(1);
         };
 
-        std::string cropWindow, pixelBounds, pixel;
+        std::string cropWindow, pixelBounds, pixel, sampleRange;
         if (ParseArg(&argv, "cropwindow", &cropWindow, onError)) {
             pstd::optional<std::vector<Float>> c = SplitStringToFloats(cropWindow, ',');
             if (!c || c->size() != 4) {
@@ -147,11 +153,24 @@ int main(int argc, char *argv[]) {
             }
             options.pixelBounds =
                 Bounds2i(Point2i((*p)[0], (*p)[2]), Point2i((*p)[1], (*p)[3]));
+        } else if (ParseArg(&argv, "sample-range", &sampleRange, onError)) {
+            pstd::optional<std::vector<int>> r = SplitStringToInts(sampleRange, ',');
+            if (!r || r->size() != 2) {
+                usage("Didn't find two integer values after --sample-range");
+                return 1;
+            }
+            if ((*r)[0] < 0 || (*r)[1] <= (*r)[0]) {
+                usage("--sample-range must be a non-empty range of non-negative "
+                      "sample indices");
+                return 1;
+            }
+            options.sampleRange = Point2i((*r)[0], (*r)[1]);
         } else if (
 #ifdef PBRT_BUILD_GPU_RENDERER
             ParseArg(&argv, "gpu", &options.useGPU, onError) ||
             ParseArg(&argv, "gpu-device", &options.gpuDevice, onError) ||
 #endif
+            ParseArg(&argv, "cachedir", &options.cacheDirectory, onError) ||
             ParseArg(&argv, "debugstart", &options.debugStart, onError) ||
             ParseArg(&argv, "disable-pixel-jitter", &options.disablePixelJitter,
                      onError) ||
@@ -165,6 +184,7 @@ int main(int argc, char *argv[]) {
             ParseArg(&argv, "mse-reference-out", &options.mseReferenceOutput, onError) ||
             ParseArg(&argv, "nthreads", &options.nThreads, onError) ||
             ParseArg(&argv, "outfile", &options.imageFile, onError) ||
+            ParseArg(&argv, "partial-film", &options.writePartialFilm, onError) ||
             ParseArg(&argv, "pixelstats", &options.recordPixelStatistics, onError) ||
             ParseArg(&argv, "quick", &options.quickRender, onError) ||
             ParseArg(&argv, "quiet", &options.quiet, onError) ||
@@ -23,6 +23,8 @@ void usage(const std::string &msg = "") {
                               is "verbose", "error", or "fatal". Default: "error".
   --nthreads <num>            Use specified number of threads for rendering.
   --test_filter <regexp>      Regular expression of test names to run.
+  --timing                    Also run the timing tests, whose names start with
+                              "DISABLED_" so that they are skipped by default.
   --vlog-level <n>            Set VLOG verbosity. (Default: 0, disabled.)
 )");
 
@@ -34,6 +36,7 @@ int main(int argc, char **argv) {
     opt.quiet = true;
     std::string logLevel = "error";
     std::string testFilter;
+    bool timing = false;
 
     char **origArgv = argv;
     // Process command-line arguments
@@ -47,6 +50,7 @@ int main(int argc, char **argv) {
         if (ParseArg(&argv, "log-level", &logLevel, onError) ||
             ParseArg(&argv, "nthreads", &opt.nThreads, onError) ||
             ParseArg(&argv, "test-filter", &testFilter, onError) ||
+            ParseArg(&argv, "timing", &timing, onError) ||
             ParseArg(&argv, "vlog-level", &opt.logConfig.vlogLevel, onError)) {
             // success
         } else if ((strcmp(*argv, "--help") == 0) || (strcmp(*argv, "-h") == 0)) {
@@ -68,9 +72,10 @@ int main(int argc, char **argv) {
     std::string filter;
     if (!testFilter.empty()) {
         filter = StringPrintf("--gtest_filter=%s", testFilter);
-        googleArgc += 1;
-        googleArgv[1] = filter.c_str();
+        googleArgv[googleArgc++] = filter.c_str();
     }
+    if (timing)
+        googleArgv[googleArgc++] = "--gtest_also_run_disabled_tests";
     testing::InitGoogleTest(&googleArgc, (char **)googleArgv);
 
     int ret = RUN_ALL_TESTS();
@@ -8,6 +8,7 @@
 #include <pbrt/pbrt.h>
 
 #include <pbrt/cpu/primitive.h>
+#include <pbrt/shapes.h>
 
 #include <atomic>
 #include <memory>
@@ -32,13 +33,17 @@ class BVHAccel {
 
     // BVHAccel Public Methods
     BVHAccel(std::vector<PrimitiveHandle> p, int maxPrimsInNode = 1,
-             SplitMethod splitMethod = SplitMethod::SAH);
+             SplitMethod splitMethod = SplitMethod::SAH, int maxMotionSegments = 4,
+             bool batchTriangles = false, bool batchCurves = false);
 
     static BVHAccel *Create(std::vector<PrimitiveHandle> prims,
                             const ParameterDictionary &parameters);
 
     Bounds3f Bounds() const;
+    Bounds3f Bounds(const Transform &renderFromBVH, int maxDepth = 3) const;
     pstd::optional<ShapeIntersection> Intersect(const Ray &ray, Float tMax) const;
+    pstd::optional<ShapeIntersection> Intersect(const Ray &ray, Float tMax,
+                                                bool deferInteractions) const;
     bool IntersectP(const Ray &ray, Float tMax) const;
 
   private:
@@ -61,12 +66,48 @@ class BVHAccel {
                                 std::vector<BVHBuildNode *> &treeletRoots, int start,
                                 int end, std::atomic<int> *totalNodes) const;
     int flattenBVHTree(BVHBuildNode *node, int *offset);
+    void computeMotionBounds(int nSegments);
+    void batchLeafTriangles();
+    void batchLeafCurves();
+
+    const Bounds3f *motionSegmentBounds(Float time) const {
+        // Return node bounds for the time segment containing _time_, if present
+        if (nMotionSegments == 0)
+            return nullptr;
+        Float t = (time - motionStartTime) / (motionEndTime - motionStartTime);
+        t = Clamp(t, 0, 1);
+        int segment = std::min<int>(t * nMotionSegments, nMotionSegments - 1);
+        return &motionBounds[segment * nNodes];
+    }
+
+    // BVHAccel Private Types
+    struct LeafTriangleBatch {
+        TriangleBatch triangles;
+        int primitivesOffset;
+        // Lanes whose interaction can be computed after traversal completes
+        int deferrable;
+    };
+    struct LeafCurveBatch {
+        CurveBatch curves;
+        int primitivesOffset;
+    };
 
     // BVHAccel Private Members
     int maxPrimsInNode;
     SplitMethod splitMethod;
     std::vector<PrimitiveHandle> primitives;
     LinearBVHNode *nodes = nullptr;
+    int nNodes = 0;
+    // Node bounds for each of _nMotionSegments_ equal subintervals of the
+    // animated primitives' time range, stored segment by segment
+    int nMotionSegments = 0;
+    Float motionStartTime = 0, motionEndTime = 1;
+    std::vector<Bounds3f> motionBounds;
+    // Vertices of the triangles in leaves whose primitives are all triangles;
+    // such leaves store the offset of their first batch in _primitivesOffset_
+    std::vector<LeafTriangleBatch> triangleBatches;
+    // Bounding capsules of the segments in leaves whose primitives are all curves
+    std::vector<LeafCurveBatch> curveBatches;
 };
 
 struct KdAccelNode;
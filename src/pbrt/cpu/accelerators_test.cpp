@@ -0,0 +1,345 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include <gtest/gtest.h>
+
+#include <pbrt/pbrt.h>
+
+#include <pbrt/cpu/accelerators.h>
+#include <pbrt/cpu/primitive.h>
+#include <pbrt/shapes.h>
+#include <pbrt/util/mesh.h>
+#include <pbrt/util/progressreporter.h>
+#include <pbrt/util/rng.h>
+#include <pbrt/util/sampling.h>
+
+#include <vector>
+
+using namespace pbrt;
+
+// Returns the vertices of a closed triangulated sphere with vertices randomly
+// offset by up to _bumpiness_ and fills in _indices_
+static std::vector<Point3f> BumpySphere(RNG &rng, int nTheta, int nPhi, Float bumpiness,
+                                       std::vector<int> *indices) {
+    std::vector<Point3f> p;
+    for (int t = 0; t < nTheta; ++t) {
+        Float theta = Pi * t / (nTheta - 1);
+        Float sinTheta = std::sin(theta), cosTheta = std::cos(theta);
+        for (int ph = 0; ph < nPhi; ++ph) {
+            Float phi = 2 * Pi * ph / (nPhi - 1);
+            if (t == 0 || t == nTheta - 1)
+                p.push_back(Point3f(0, 0, t == 0 ? 1 : -1));
+            else if (ph == nPhi - 1)
+                p.push_back(p[p.size() - (nPhi - 1)]);
+            else {
+                Float radius = 1 + bumpiness * rng.Uniform<Float>();
+                p.push_back(Point3f(0, 0, 0) +
+                            radius * SphericalDirection(sinTheta, cosTheta, phi));
+            }
+        }
+    }
+
+    auto offset = [nPhi](int t, int ph) { return t * nPhi + ph; };
+    for (int t = 0; t < nTheta - 1; ++t)
+        for (int ph = 0; ph < nPhi - 1; ++ph) {
+            for (int v : {offset(t, ph), offset(t + 1, ph), offset(t + 1, ph + 1)})
+                indices->push_back(v);
+            for (int v : {offset(t, ph), offset(t + 1, ph + 1), offset(t, ph + 1)})
+                indices->push_back(v);
+        }
+    return p;
+}
+
+// Creates a BVH over the triangles of _mesh_ that batches leaf triangles if
+// _batchTriangles_ is true
+static BVHAccel *MeshBVH(const TriangleMesh *mesh, bool batchTriangles) {
+    pstd::vector<ShapeHandle> tris = Triangle::CreateTriangles(mesh, Allocator());
+    std::vector<PrimitiveHandle> prims;
+    for (ShapeHandle tri : tris)
+        prims.push_back(new SimplePrimitive(tri, nullptr));
+    return new BVHAccel(std::move(prims), 4, BVHAccel::SplitMethod::SAH, 1,
+                        batchTriangles);
+}
+
+// Returns a random ray that either starts inside the sphere or starts
+// outside of it and is aimed at a random point inside of it
+static Ray RandomRay(RNG &rng) {
+    Point2f u(rng.Uniform<Float>(), rng.Uniform<Float>());
+    Point3f pInside = Point3f(0, 0, 0) + SampleUniformSphere(u);
+    Vector3f w = SampleUniformSphere({rng.Uniform<Float>(), rng.Uniform<Float>()});
+    if (rng.Uniform<Float>() < .5f)
+        return Ray(pInside, w);
+    Point3f o = Point3f(0, 0, 0) + 4 * w;
+    return Ray(o, pInside - o);
+}
+
+TEST(BVHAccel, DeferredInteractions) {
+    RNG rng(5);
+    std::vector<int> indices;
+    std::vector<Point3f> p = BumpySphere(rng, 32, 32, 1, &indices);
+    // Leaks...
+    TriangleMesh *mesh = new TriangleMesh(Transform(), false, indices, p, {}, {}, {}, {});
+
+    // Hits are deferred in both batched and unbatched leaves
+    for (bool batchTriangles : {true, false}) {
+        BVHAccel *bvh = MeshBVH(mesh, batchTriangles);
+        int nHits = 0;
+        for (int i = 0; i < 20000; ++i) {
+            Ray ray = RandomRay(rng);
+            Float tMax = (i & 1) ? Infinity : 2 * rng.Uniform<Float>();
+
+            // Deferring interactions shouldn't change which hit is found
+            pstd::optional<ShapeIntersection> si = bvh->Intersect(ray, tMax, true);
+            pstd::optional<ShapeIntersection> siFull = bvh->Intersect(ray, tMax, false);
+            EXPECT_EQ(siFull.has_value(), bvh->IntersectP(ray, tMax));
+            ASSERT_EQ(siFull.has_value(), si.has_value());
+            if (!si)
+                continue;
+
+            ++nHits;
+            EXPECT_EQ(siFull->tHit, si->tHit);
+            EXPECT_EQ(siFull->intr.p(), si->intr.p());
+            EXPECT_EQ(siFull->intr.pi.Error(), si->intr.pi.Error());
+            EXPECT_EQ(siFull->intr.n, si->intr.n);
+            EXPECT_EQ(siFull->intr.shading.n, si->intr.shading.n);
+            EXPECT_EQ(siFull->intr.uv, si->intr.uv);
+            EXPECT_EQ(siFull->intr.dpdu, si->intr.dpdu);
+            EXPECT_EQ(siFull->intr.wo, si->intr.wo);
+        }
+        EXPECT_GT(nHits, 10000);
+    }
+}
+
+TEST(BVHAccel, BatchedTriangles) {
+    RNG rng(11);
+    std::vector<int> indices;
+    std::vector<Point3f> p = BumpySphere(rng, 32, 32, 1, &indices);
+    // Leaks...
+    TriangleMesh *mesh = new TriangleMesh(Transform(), false, indices, p, {}, {}, {}, {});
+    BVHAccel *batched = MeshBVH(mesh, true), *scalar = MeshBVH(mesh, false);
+
+    for (int i = 0; i < 20000; ++i) {
+        // Trace random rays and rays from inside the sphere at shared vertices
+        // and edges, which must hit the closed mesh
+        Ray ray = RandomRay(rng);
+        bool mustHit = false;
+        if (i & 1) {
+            int tri = rng.Uniform<uint32_t>(indices.size() / 3);
+            Point3f p0 = p[indices[3 * tri]], p1 = p[indices[3 * tri + 1]];
+            Point3f pTarget = (i & 2) ? p0 : Lerp(rng.Uniform<Float>(), p0, p1);
+            Point2f u(rng.Uniform<Float>(), rng.Uniform<Float>());
+            ray.o = Point3f(0, 0, 0) + .5f * SampleUniformSphere(u);
+            ray.d = pTarget - ray.o;
+            mustHit = true;
+        }
+        Float tMax = (i % 3 == 0) ? 2 * rng.Uniform<Float>() : Infinity;
+
+        pstd::optional<ShapeIntersection> si = batched->Intersect(ray, tMax);
+        pstd::optional<ShapeIntersection> siScalar = scalar->Intersect(ray, tMax);
+        ASSERT_EQ(siScalar.has_value(), si.has_value());
+        EXPECT_EQ(siScalar.has_value(), batched->IntersectP(ray, tMax));
+        if (mustHit && tMax == Infinity)
+            EXPECT_TRUE(si.has_value());
+        if (si)
+            EXPECT_EQ(siScalar->tHit, si->tHit);
+    }
+}
+
+TEST(BVHAccel, DISABLED_BatchedTrianglesTiming) {
+    RNG rng(3);
+    std::vector<int> indices;
+    std::vector<Point3f> p = BumpySphere(rng, 128, 128, .02f, &indices);
+    // Leaks...
+    TriangleMesh *mesh = new TriangleMesh(Transform(), false, indices, p, {}, {}, {}, {});
+    std::vector<Ray> rays;
+    for (int i = 0; i < 200000; ++i)
+        rays.push_back(RandomRay(rng));
+
+    // Report the fastest of several interleaved closest-hit and shadow ray
+    // timings with and without batching
+    BVHAccel *bvh[2] = {MeshBVH(mesh, false), MeshBVH(mesh, true)};
+    double intersectSeconds[2] = {Infinity, Infinity};
+    double intersectPSeconds[2] = {Infinity, Infinity};
+    int nHits[2] = {0, 0};
+    for (int round = 0; round < 5; ++round)
+        for (int batched = 0; batched < 2; ++batched) {
+            Timer timer;
+            for (const Ray &ray : rays)
+                nHits[batched] += bvh[batched]->Intersect(ray, Infinity).has_value();
+            intersectSeconds[batched] =
+                std::min(intersectSeconds[batched], timer.ElapsedSeconds());
+            timer = Timer();
+            for (const Ray &ray : rays)
+                nHits[batched] -= bvh[batched]->IntersectP(ray, Infinity);
+            intersectPSeconds[batched] =
+                std::min(intersectPSeconds[batched], timer.ElapsedSeconds());
+        }
+    for (int batched = 0; batched < 2; ++batched) {
+        fprintf(stderr, "%s triangles: Intersect %.1f ns/ray, IntersectP %.1f ns/ray\n",
+                batched ? "Batched" : "Scalar",
+                1e9 * intersectSeconds[batched] / rays.size(),
+                1e9 * intersectPSeconds[batched] / rays.size());
+        EXPECT_EQ(0, nHits[batched]);
+    }
+}
+
+// Returns primitives for _n_ long, thin hair-like curves in $[-1,1] \times [0,3]
+// \times [-1,1]$, each split into 8 segments
+static std::vector<PrimitiveHandle> HairCurves(RNG &rng, int n) {
+    // Leaks...
+    Transform *identity = new Transform;
+    std::vector<PrimitiveHandle> prims;
+    for (int i = 0; i < n; ++i) {
+        Point3f root(2 * rng.Uniform<Float>() - 1, 0, 2 * rng.Uniform<Float>() - 1);
+        Point3f cp[4];
+        for (int j = 0; j < 4; ++j)
+            cp[j] = root + Vector3f(.1f * j * (rng.Uniform<Float>() - .5f), j,
+                                    .1f * j * (rng.Uniform<Float>() - .5f));
+        CurveCommon *common =
+            new CurveCommon(pstd::MakeConstSpan(cp), .01f, .002f, CurveType::Flat, {},
+                            identity, identity, false);
+        for (int seg = 0; seg < 8; ++seg)
+            prims.push_back(new SimplePrimitive(
+                new Curve(common, Float(seg) / 8, Float(seg + 1) / 8), nullptr));
+    }
+    return prims;
+}
+
+// Returns a ray from outside of the curves' bounds toward a point inside them
+static Ray HairRay(RNG &rng) {
+    Vector3f w = SampleUniformSphere({rng.Uniform<Float>(), rng.Uniform<Float>()});
+    Point3f pTarget(2 * rng.Uniform<Float>() - 1, 3 * rng.Uniform<Float>(),
+                    2 * rng.Uniform<Float>() - 1);
+    return Ray(Point3f(0, 1.5f, 0) + 4 * w, pTarget - (Point3f(0, 1.5f, 0) + 4 * w));
+}
+
+TEST(BVHAccel, BatchedCurves) {
+    RNG rng(13);
+    std::vector<PrimitiveHandle> prims = HairCurves(rng, 500);
+    BVHAccel batched(prims, 4, BVHAccel::SplitMethod::SAH, 1, false, true);
+    BVHAccel scalar(prims, 4, BVHAccel::SplitMethod::SAH, 1, false, false);
+
+    // Culling segments in batches shouldn't change which hits are found
+    int nHits = 0;
+    for (int i = 0; i < 20000; ++i) {
+        Ray ray = HairRay(rng);
+        Float tMax = (i & 1) ? Infinity : 8 * rng.Uniform<Float>();
+        pstd::optional<ShapeIntersection> si = batched.Intersect(ray, tMax);
+        pstd::optional<ShapeIntersection> siScalar = scalar.Intersect(ray, tMax);
+        ASSERT_EQ(siScalar.has_value(), si.has_value());
+        EXPECT_EQ(si.has_value(), batched.IntersectP(ray, tMax));
+        if (si) {
+            EXPECT_EQ(siScalar->tHit, si->tHit);
+            ++nHits;
+        }
+    }
+    EXPECT_GT(nHits, 1000);
+}
+
+TEST(BVHAccel, DISABLED_BatchedCurvesTiming) {
+    RNG rng(17);
+    std::vector<PrimitiveHandle> prims = HairCurves(rng, 20000);
+    std::vector<Ray> rays;
+    for (int i = 0; i < 200000; ++i)
+        rays.push_back(HairRay(rng));
+
+    // Report closest-hit and shadow ray timings with and without batching
+    for (bool batchCurves : {false, true}) {
+        BVHAccel bvh(prims, 4, BVHAccel::SplitMethod::SAH, 1, false, batchCurves);
+        Timer timer;
+        int nHits = 0;
+        for (const Ray &ray : rays)
+            nHits += bvh.Intersect(ray, Infinity).has_value();
+        double intersectSeconds = timer.ElapsedSeconds();
+        timer = Timer();
+        for (const Ray &ray : rays)
+            nHits -= bvh.IntersectP(ray, Infinity);
+        double intersectPSeconds = timer.ElapsedSeconds();
+        EXPECT_EQ(0, nHits);
+        fprintf(stderr, "%s curves: Intersect %.1f ns/ray, IntersectP %.1f ns/ray\n",
+                batchCurves ? "Batched" : "Scalar", 1e9 * intersectSeconds / rays.size(),
+                1e9 * intersectPSeconds / rays.size());
+    }
+}
+
+// Returns _n_ spheres of radius 1/2, each moving along a random segment of length
+// _distance_ in $[-10,10]^3$ over times $[0,1]$
+static std::vector<PrimitiveHandle> MovingSpheres(RNG &rng, int n, Float distance) {
+    std::vector<int> indices;
+    std::vector<Point3f> p = BumpySphere(rng, 8, 8, 0, &indices);
+    // Leaks...
+    TriangleMesh *mesh = new TriangleMesh(Transform(), false, indices, p, {}, {}, {}, {});
+    PrimitiveHandle sphere = MeshBVH(mesh, false);
+
+    std::vector<PrimitiveHandle> prims;
+    for (int i = 0; i < n; ++i) {
+        Vector3f p0(rng.Uniform<Float>(), rng.Uniform<Float>(), rng.Uniform<Float>());
+        Vector3f w = SampleUniformSphere({rng.Uniform<Float>(), rng.Uniform<Float>()});
+        p0 = 20 * p0 - Vector3f(10, 10, 10);
+        Transform t0 = Translate(p0) * Scale(.5f, .5f, .5f);
+        Transform t1 = Translate(p0 + distance * w) * Scale(.5f, .5f, .5f);
+        prims.push_back(new AnimatedPrimitive(sphere, AnimatedTransform(t0, 0, t1, 1)));
+    }
+    return prims;
+}
+
+// Returns a ray at a random time from a random point in $[-12,12]^3$
+static Ray RandomTimeRay(RNG &rng) {
+    Point3f o(rng.Uniform<Float>(), rng.Uniform<Float>(), rng.Uniform<Float>());
+    Vector3f d = SampleUniformSphere({rng.Uniform<Float>(), rng.Uniform<Float>()});
+    return Ray(Point3f(-12, -12, -12) + 24 * Vector3f(o), d, rng.Uniform<Float>());
+}
+
+TEST(BVHAccel, MotionSegments) {
+    RNG rng(7);
+    std::vector<PrimitiveHandle> prims = MovingSpheres(rng, 500, 4);
+    BVHAccel *single = new BVHAccel(prims, 4, BVHAccel::SplitMethod::SAH, 1);
+    BVHAccel *segmented = new BVHAccel(prims, 4, BVHAccel::SplitMethod::SAH, 8);
+
+    // Per-segment node bounds shouldn't change which hits are found
+    int nHits = 0;
+    for (int i = 0; i < 20000; ++i) {
+        Ray ray = RandomTimeRay(rng);
+        pstd::optional<ShapeIntersection> si = segmented->Intersect(ray, Infinity);
+        pstd::optional<ShapeIntersection> siSingle = single->Intersect(ray, Infinity);
+        ASSERT_EQ(siSingle.has_value(), si.has_value());
+        EXPECT_EQ(si.has_value(), segmented->IntersectP(ray, Infinity));
+        if (si) {
+            EXPECT_EQ(siSingle->tHit, si->tHit);
+            ++nHits;
+        }
+    }
+    EXPECT_GT(nHits, 1000);
+}
+
+TEST(BVHAccel, DISABLED_MotionSegmentsTiming) {
+    // Report timings for slowly and quickly moving spheres with varying
+    // numbers of time segments
+    for (Float distance : {.5f, 4.f}) {
+        RNG rng(9);
+        std::vector<PrimitiveHandle> prims = MovingSpheres(rng, 20000, distance);
+        std::vector<Ray> rays;
+        for (int i = 0; i < 200000; ++i)
+            rays.push_back(RandomTimeRay(rng));
+
+        for (int maxMotionSegments : {1, 2, 4, 8, 16}) {
+            BVHAccel bvh(prims, 4, BVHAccel::SplitMethod::SAH, maxMotionSegments);
+            Timer timer;
+            int n = 0;
+            for (const Ray &ray : rays)
+                n += bvh.Intersect(ray, Infinity).has_value();
+            double intersectSeconds = timer.ElapsedSeconds();
+            timer = Timer();
+            for (const Ray &ray : rays)
+                n -= bvh.IntersectP(ray, Infinity);
+            double intersectPSeconds = timer.ElapsedSeconds();
+            EXPECT_EQ(0, n);
+            fprintf(stderr,
+                    "Motion distance %.1f, %2d segments: Intersect %.1f ns/ray, "
+                    "IntersectP %.1f ns/ray\n",
+                    distance, maxMotionSegments, 1e9 * intersectSeconds / rays.size(),
+                    1e9 * intersectPSeconds / rays.size());
+        }
+    }
+}
@@ -0,0 +1,309 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include <pbrt/cpu/guiding.h>
+
+#include <pbrt/util/check.h>
+#include <pbrt/util/error.h>
+#include <pbrt/util/math.h>
+#include <pbrt/util/print.h>
+#include <pbrt/util/progressreporter.h>
+#include <pbrt/util/stats.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace pbrt {
+
+STAT_MEMORY_COUNTER("Memory/Path guiding", guidingBytes);
+STAT_INT_DISTRIBUTION("Integrator/Guiding spatial leaves per iteration",
+                      guidingSpatialLeaves);
+STAT_INT_DISTRIBUTION("Integrator/Guiding directional nodes per iteration",
+                      guidingDirectionalNodes);
+STAT_FLOAT_DISTRIBUTION("Integrator/Guiding training seconds per iteration",
+                        guidingTrainingSeconds);
+
+// GuidingDTree Method Definitions
+GuidingDTree::GuidingDTree()
+    : samplingNodes(1),
+      samplingSums(4, Float(0)),
+      buildingNodes(1),
+      buildingSums(new AtomicFloat[4]) {}
+
+GuidingDTree::GuidingDTree(const GuidingDTree &dTree)
+    : samplingNodes(dTree.samplingNodes),
+      samplingSums(dTree.samplingSums),
+      samplingTotal(dTree.samplingTotal),
+      buildingNodes(dTree.buildingNodes),
+      buildingSums(new AtomicFloat[4 * dTree.buildingNodes.size()]),
+      nSamples(dTree.NumSamples()) {
+    for (size_t i = 0; i < 4 * buildingNodes.size(); ++i)
+        buildingSums[i] = float(dTree.buildingSums[i]);
+}
+
+Float GuidingDTree::PDF(const Vector3f &w) const {
+    // Walk down the sampling tree, accumulating the density of each quadrant
+    Point2f u = GuidingDirectionToSquare(w);
+    Float pdf = 1;
+    int node = 0;
+    while (true) {
+        const Float *sums = &samplingSums[4 * node];
+        Float total = sums[0] + sums[1] + sums[2] + sums[3];
+        if (total <= 0)
+            return pdf;
+        int qx = u[0] >= 0.5f, qy = u[1] >= 0.5f, q = qx + 2 * qy;
+        pdf *= 4 * sums[q] / total;
+        u = Point2f(2 * u[0] - qx, 2 * u[1] - qy);
+        node = samplingNodes[node].children[q];
+        if (node == 0 || pdf == 0)
+            return pdf;
+    }
+}
+
+Vector3f GuidingDTree::Sample(Point2f u, Float *pdf) const {
+    Point2f origin(0, 0);
+    Float size = 1;
+    *pdf = 1;
+    int node = 0;
+    while (true) {
+        const Float *sums = &samplingSums[4 * node];
+        Float total = sums[0] + sums[1] + sums[2] + sums[3];
+        if (total <= 0)
+            break;
+        // Choose the quadrant's column and then its row, remapping _u_
+        Float pLeft = (sums[0] + sums[2]) / total;
+        int qx = u[0] < pLeft ? 0 : 1;
+        u[0] = qx == 0 ? u[0] / pLeft : (u[0] - pLeft) / (1 - pLeft);
+        Float pBottom = sums[qx] / (sums[qx] + sums[qx + 2]);
+        int qy = u[1] < pBottom ? 0 : 1;
+        u[1] = qy == 0 ? u[1] / pBottom : (u[1] - pBottom) / (1 - pBottom);
+        u = Point2f(std::min(u[0], OneMinusEpsilon), std::min(u[1], OneMinusEpsilon));
+
+        int q = qx + 2 * qy;
+        *pdf *= 4 * sums[q] / total;
+        size /= 2;
+        origin += Vector2f(qx * size, qy * size);
+        node = samplingNodes[node].children[q];
+        if (node == 0)
+            break;
+    }
+    return GuidingSquareToDirection(origin + size * Vector2f(u));
+}
+
+void GuidingDTree::Record(const Vector3f &w, Float radiance) {
+    nSamples.fetch_add(1, std::memory_order_relaxed);
+    if (!(radiance > 0) || std::isinf(radiance))
+        return;
+    // Add _radiance_ to the building tree's quadrants containing _w_
+    Point2f u = GuidingDirectionToSquare(w);
+    int node = 0;
+    do {
+        int qx = u[0] >= 0.5f, qy = u[1] >= 0.5f, q = qx + 2 * qy;
+        buildingSums[4 * node + q].Add(radiance);
+        u = Point2f(2 * u[0] - qx, 2 * u[1] - qy);
+        node = buildingNodes[node].children[q];
+    } while (node != 0);
+}
+
+void GuidingDTree::Refine(Float subdivisionThreshold, int maxDepth, size_t maxNodes) {
+    // Make the recorded statistics the new sampling distribution
+    std::vector<Float> sums(4 * buildingNodes.size());
+    for (size_t i = 0; i < sums.size(); ++i)
+        sums[i] = buildingSums[i];
+    Float total = sums[0] + sums[1] + sums[2] + sums[3];
+    if (total > 0) {
+        samplingNodes = buildingNodes;
+        samplingSums = std::move(sums);
+        samplingTotal = total;
+
+        // Subdivide quadrants that received more than the threshold's share
+        std::vector<GuidingQuadNode> newNodes(1);
+        subdivide(0, 0, &samplingSums[0], total, subdivisionThreshold, 1, maxDepth,
+                  maxNodes, &newNodes);
+        buildingNodes = std::move(newNodes);
+    }
+
+    // Reset the building tree for the next iteration
+    buildingSums.reset(new AtomicFloat[4 * buildingNodes.size()]);
+    nSamples = 0;
+}
+
+void GuidingDTree::subdivide(int node, int oldNode, const Float energy[4], Float total,
+                             Float subdivisionThreshold, int depth, int maxDepth,
+                             size_t maxNodes,
+                             std::vector<GuidingQuadNode> *newNodes) const {
+    for (int q = 0; q < 4; ++q) {
+        if (energy[q] <= subdivisionThreshold * total || depth >= maxDepth ||
+            newNodes->size() >= maxNodes)
+            continue;
+        // Find the energy of the new node's quadrants
+        // Quadrants that weren't subdivided before split their energy evenly.
+        int oldChild = oldNode >= 0 ? samplingNodes[oldNode].children[q] : 0;
+        Float childEnergy[4];
+        for (int c = 0; c < 4; ++c)
+            childEnergy[c] = oldChild ? samplingSums[4 * oldChild + c] : energy[q] / 4;
+
+        int child = newNodes->size();
+        newNodes->push_back(GuidingQuadNode());
+        (*newNodes)[node].children[q] = child;
+        subdivide(child, oldChild ? oldChild : -1, childEnergy, total,
+                  subdivisionThreshold, depth + 1, maxDepth, maxNodes, newNodes);
+    }
+}
+
+std::string GuidingDTree::ToString() const {
+    return StringPrintf("[ GuidingDTree samplingNodes: %d samplingTotal: %f "
+                        "buildingNodes: %d nSamples: %d ]",
+                        samplingNodes.size(), samplingTotal, buildingNodes.size(),
+                        NumSamples());
+}
+
+// GuidingField Method Definitions
+GuidingField::GuidingField(const Bounds3f &sceneBounds, Float bsdfSamplingFraction,
+                           size_t maxBytes, int trainingIterations)
+    : bsdfSamplingFraction(bsdfSamplingFraction),
+      maxBytes(maxBytes),
+      trainingIterations(trainingIterations) {
+    // Use a slightly enlarged cube around the scene so that spatial cells are cubes
+    Point3f center(0, 0, 0);
+    Float extent = 1;
+    if (!sceneBounds.IsDegenerate()) {
+        center = (sceneBounds.pMin + sceneBounds.pMax) / 2;
+        extent = std::max<Float>(MaxComponentValue(sceneBounds.Diagonal()), 1e-3f);
+    }
+    Vector3f halfSize = Vector3f(1, 1, 1) * (0.505f * extent);
+    bounds = Bounds3f(center - halfSize, center + halfSize);
+
+    nodes.push_back(GuidingSTreeNode());
+    nodes[0].dTree = 0;
+    dTrees.push_back(GuidingDTree());
+}
+
+const GuidingDTree *GuidingField::Lookup(const Point3f &p) const {
+    Vector3f u = bounds.Offset(p);
+    for (int c = 0; c < 3; ++c)
+        u[c] = Clamp(u[c], 0, OneMinusEpsilon);
+    int node = 0;
+    while (nodes[node].dTree < 0) {
+        // Descend into the half of the node's cell that contains _p_
+        int axis = nodes[node].axis;
+        int child = u[axis] >= 0.5f;
+        u[axis] = std::min(2 * u[axis] - child, OneMinusEpsilon);
+        node = nodes[node].children[child];
+    }
+    return &dTrees[nodes[node].dTree];
+}
+
+void GuidingField::FinishIteration() {
+    if (!IsTraining())
+        return;
+    Timer timer;
+    auto bytesUsed = [&]() {
+        size_t bytes = nodes.size() * sizeof(GuidingSTreeNode);
+        for (const GuidingDTree &dTree : dTrees)
+            bytes += dTree.BytesUsed();
+        return bytes;
+    };
+
+    // Split spatial cells that received many samples during this iteration
+    int64_t splitThreshold = 12000 * std::sqrt(std::pow(2., iteration));
+    if (bytesUsed() < maxBytes)
+        subdivideSpatially(0, splitThreshold, 0);
+
+    // Refine the directional trees within the remaining memory budget
+    size_t bytes = bytesUsed();
+    size_t nodeBytes = 2 * (sizeof(GuidingQuadNode) + 4 * sizeof(Float));
+    size_t spareNodes =
+        bytes < maxBytes ? (maxBytes - bytes) / (nodeBytes * dTrees.size()) : 0;
+    ParallelFor(0, dTrees.size(), [&](int64_t i) {
+        dTrees[i].Refine(0.01f, 20, dTrees[i].NumBuildingNodes() + spareNodes);
+    });
+
+    // Report statistics for the training iteration
+    size_t nDirectionalNodes = 0;
+    for (const GuidingDTree &dTree : dTrees)
+        nDirectionalNodes += dTree.NumNodes();
+    bytes = bytesUsed();
+    guidingBytes = std::max<int64_t>(guidingBytes, bytes);
+    ReportValue(guidingSpatialLeaves, dTrees.size());
+    ReportValue(guidingDirectionalNodes, nDirectionalNodes);
+    ReportValue(guidingTrainingSeconds, timer.ElapsedSeconds());
+    LOG_VERBOSE("Guiding iteration %d: %d spatial leaves, %d directional nodes, "
+                "%d bytes, %f s",
+                iteration, dTrees.size(), nDirectionalNodes, bytes,
+                timer.ElapsedSeconds());
+    ++iteration;
+}
+
+void GuidingField::subdivideSpatially(int node, int64_t splitThreshold, int depth) {
+    if (nodes[node].dTree < 0) {
+        for (int c = 0; c < 2; ++c)
+            subdivideSpatially(nodes[node].children[c], splitThreshold, depth + 1);
+        return;
+    }
+    int dTree = nodes[node].dTree;
+    if (dTrees[dTree].NumSamples() <= splitThreshold || depth >= 60)
+        return;
+
+    // Split the leaf in half, giving each child a copy of its directional tree
+    dTrees[dTree].ScaleNumSamples(0.5f);
+    GuidingDTree copy(dTrees[dTree]);
+    dTrees.push_back(copy);
+    int child = nodes.size();
+    for (int c = 0; c < 2; ++c) {
+        GuidingSTreeNode childNode;
+        childNode.axis = (nodes[node].axis + 1) % 3;
+        childNode.dTree = c == 0 ? dTree : int(dTrees.size() - 1);
+        nodes.push_back(childNode);
+    }
+    nodes[node].children[0] = child;
+    nodes[node].children[1] = child + 1;
+    nodes[node].dTree = -1;
+
+    for (int c = 0; c < 2; ++c)
+        subdivideSpatially(child + c, splitThreshold, depth + 1);
+}
+
+std::string GuidingField::ToString() const {
+    return StringPrintf("[ GuidingField bounds: %s bsdfSamplingFraction: %f "
+                        "maxBytes: %d trainingIterations: %d iteration: %d "
+                        "nodes: %d dTrees: %d ]",
+                        bounds, bsdfSamplingFraction, maxBytes, trainingIterations,
+                        iteration, nodes.size(), dTrees.size());
+}
+
+// GuidedBSDF Method Definitions
+BSDFSample GuidedBSDF::Sample_f(Vector3f wo, Float u, Point2f u2) const {
+    if (!dTree)
+        return bsdf->Sample_f(wo, u, u2);
+    if (u < bsdfSamplingFraction) {
+        // Sample the BSDF and compute the density of the mixture
+        BSDFSample bs =
+            bsdf->Sample_f(wo, std::min(u / bsdfSamplingFraction, OneMinusEpsilon), u2);
+        if (!bs)
+            return {};
+        if (bs.IsSpecular())
+            bs.pdf *= bsdfSamplingFraction;
+        else
+            bs.pdf = PDF(wo, bs.wi);
+        return bs;
+    }
+
+    // Sample the directional tree and evaluate the BSDF for the direction
+    Float dTreePDF;
+    Vector3f wi = dTree->Sample(u2, &dTreePDF);
+    SampledSpectrum f = bsdf->f(wo, wi);
+    Float pdf = PDF(wo, wi);
+    if (!f || pdf == 0)
+        return {};
+    // Report the BSDF's own lobe type so that transmitted samples pick up the
+    // BSDF's relative IOR _eta_ in the integrators' _etaScale_ updates
+    BxDFFlags flags = SameHemisphere(bsdf->RenderToLocal(wo), bsdf->RenderToLocal(wi))
+                          ? BxDFFlags::Reflection
+                          : BxDFFlags::Transmission;
+    flags |= bsdf->IsGlossy() ? BxDFFlags::Glossy : BxDFFlags::Diffuse;
+    return BSDFSample(f, wi, pdf, flags);
+}
+
+}  // namespace pbrt
@@ -0,0 +1,211 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#ifndef PBRT_CPU_GUIDING_H
+#define PBRT_CPU_GUIDING_H
+
+#include <pbrt/pbrt.h>
+
+#include <pbrt/bsdf.h>
+#include <pbrt/util/memory.h>
+#include <pbrt/util/parallel.h>
+#include <pbrt/util/vecmath.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pbrt {
+
+// Directions are parameterized over $[0,1]^2$ using the equal-area cylindrical
+// mapping $(\cos\theta, \phi)$, so densities differ from solid angle densities
+// by a constant factor of $4\pi$.
+inline Point2f GuidingDirectionToSquare(const Vector3f &w) {
+    return Point2f(Clamp((w.z + 1) / 2, 0, 1), Clamp(SphericalPhi(w) * Inv2Pi, 0, 1));
+}
+
+inline Vector3f GuidingSquareToDirection(const Point2f &u) {
+    Float cosTheta = 2 * u[0] - 1, sinTheta = SafeSqrt(1 - Sqr(cosTheta));
+    return SphericalDirection(sinTheta, cosTheta, 2 * Pi * u[1]);
+}
+
+// GuidingQuadNode Definition
+// Quadrant $q$ covers $[x, x+1/2] \times [y, y+1/2]$ with $q = x + 2y$; a zero
+// child index marks a quadrant without further subdivision.
+struct GuidingQuadNode {
+    int children[4] = {0, 0, 0, 0};
+};
+
+// GuidingDTree Definition
+// Directional quadtree that is sampled using the radiance recorded during the
+// previous training iteration while recording the current one.
+class GuidingDTree {
+  public:
+    // GuidingDTree Public Methods
+    GuidingDTree();
+    GuidingDTree(const GuidingDTree &dTree);
+    GuidingDTree &operator=(const GuidingDTree &dTree) = delete;
+
+    bool IsValid() const { return samplingTotal > 0; }
+
+    Float PDF(const Vector3f &w) const;
+    Vector3f Sample(Point2f u, Float *pdf) const;
+
+    void Record(const Vector3f &w, Float radiance);
+    int64_t NumSamples() const { return nSamples.load(std::memory_order_relaxed); }
+    void ScaleNumSamples(Float s) { nSamples = int64_t(NumSamples() * s); }
+
+    void Refine(Float subdivisionThreshold, int maxDepth, size_t maxNodes);
+
+    size_t NumNodes() const { return samplingNodes.size() + buildingNodes.size(); }
+    size_t NumBuildingNodes() const { return buildingNodes.size(); }
+    size_t BytesUsed() const {
+        return samplingNodes.size() * (sizeof(GuidingQuadNode) + 4 * sizeof(Float)) +
+               buildingNodes.size() * (sizeof(GuidingQuadNode) + 4 * sizeof(AtomicFloat));
+    }
+
+    std::string ToString() const;
+
+  private:
+    // GuidingDTree Private Methods
+    void subdivide(int node, int oldNode, const Float energy[4], Float total,
+                   Float subdivisionThreshold, int depth, int maxDepth, size_t maxNodes,
+                   std::vector<GuidingQuadNode> *newNodes) const;
+
+    // GuidingDTree Private Members
+    std::vector<GuidingQuadNode> samplingNodes;
+    std::vector<Float> samplingSums;
+    Float samplingTotal = 0;
+    std::vector<GuidingQuadNode> buildingNodes;
+    std::unique_ptr<AtomicFloat[]> buildingSums;
+    std::atomic<int64_t> nSamples{0};
+};
+
+// GuidingSTreeNode Definition
+struct GuidingSTreeNode {
+    int axis = 0;
+    int children[2] = {0, 0};
+    // Index of the node's directional tree, or -1 for interior nodes
+    int dTree = -1;
+};
+
+// GuidingField Definition
+// Spatial binary tree over the scene bounds with a directional quadtree in each
+// leaf, trained online from the radiance of the paths traced in each wave.
+class GuidingField {
+  public:
+    // GuidingField Public Methods
+    GuidingField(const Bounds3f &sceneBounds, Float bsdfSamplingFraction,
+                 size_t maxBytes, int trainingIterations);
+
+    const GuidingDTree *Lookup(const Point3f &p) const;
+    GuidingDTree *Lookup(const Point3f &p) {
+        return const_cast<GuidingDTree *>(
+            static_cast<const GuidingField *>(this)->Lookup(p));
+    }
+
+    bool IsTraining() const { return iteration < trainingIterations; }
+    Float BSDFSamplingFraction() const { return bsdfSamplingFraction; }
+
+    void FinishIteration();
+
+    std::string ToString() const;
+
+  private:
+    // GuidingField Private Methods
+    void subdivideSpatially(int node, int64_t splitThreshold, int depth);
+
+    // GuidingField Private Members
+    Bounds3f bounds;
+    Float bsdfSamplingFraction;
+    size_t maxBytes;
+    int trainingIterations, iteration = 0;
+    std::vector<GuidingSTreeNode> nodes;
+    std::vector<GuidingDTree> dTrees;
+};
+
+// GuidedBSDF Definition
+// Draws directions from a one-sample mixture of the BSDF and a directional
+// tree; behaves exactly like the wrapped BSDF when _dTree_ is null.
+class GuidedBSDF {
+  public:
+    // GuidedBSDF Public Methods
+    GuidedBSDF(const BSDF *bsdf, const GuidingDTree *dTree, Float bsdfSamplingFraction)
+        : bsdf(bsdf), bsdfSamplingFraction(bsdfSamplingFraction) {
+        // Only guide valid trees and BSDFs that can evaluate their sampling density
+        if (dTree && dTree->IsValid() && bsdf->IsNonSpecular() &&
+            !bsdf->SampledPDFIsProportional())
+            this->dTree = dTree;
+    }
+
+    bool IsGuided() const { return dTree != nullptr; }
+    const BSDF &GetBSDF() const { return *bsdf; }
+
+    SampledSpectrum f(Vector3f wo, Vector3f wi) const { return bsdf->f(wo, wi); }
+    bool SampledPDFIsProportional() const { return bsdf->SampledPDFIsProportional(); }
+
+    Float PDF(Vector3f wo, Vector3f wi) const {
+        if (!dTree)
+            return bsdf->PDF(wo, wi);
+        return bsdfSamplingFraction * bsdf->PDF(wo, wi) +
+               (1 - bsdfSamplingFraction) * dTree->PDF(wi) * Inv4Pi;
+    }
+
+    BSDFSample Sample_f(Vector3f wo, Float u, Point2f u2) const;
+
+  private:
+    // GuidedBSDF Private Members
+    const BSDF *bsdf;
+    const GuidingDTree *dTree = nullptr;
+    Float bsdfSamplingFraction;
+};
+
+// GuidingPathRecorder Definition
+// Collects the scattering vertices of one path; the radiance that reaches each
+// vertex is the part of the path's estimate that was added after it.
+class GuidingPathRecorder {
+  public:
+    // GuidingPathRecorder Public Methods
+    GuidingPathRecorder(GuidingField *field, int maxVertices,
+                        ScratchBuffer &scratchBuffer)
+        : field(field && field->IsTraining() ? field : nullptr),
+          maxVertices(maxVertices) {
+        if (this->field)
+            vertices = scratchBuffer.Alloc<PathVertex[]>(maxVertices);
+    }
+
+    // Add a vertex given the sampled direction and its density, the scalar path
+    // throughput after scattering there, and the path's estimate so far
+    void AddVertex(const Point3f &p, const Vector3f &wi, Float pdf, Float throughput,
+                   Float L) {
+        if (!field || nVertices == maxVertices || !(pdf > 0) || !(throughput > 0))
+            return;
+        vertices[nVertices++] = PathVertex{field->Lookup(p), wi, pdf, throughput, L};
+    }
+
+    // Record incident radiance at all vertices given the path's final estimate
+    void Commit(Float L) {
+        for (int i = 0; i < nVertices; ++i) {
+            const PathVertex &v = vertices[i];
+            v.dTree->Record(v.wi, (L - v.L) / (v.throughput * v.pdf));
+        }
+        nVertices = 0;
+    }
+
+  private:
+    // GuidingPathRecorder Private Members
+    struct PathVertex {
+        GuidingDTree *dTree;
+        Vector3f wi;
+        Float pdf, throughput, L;
+    };
+    GuidingField *field;
+    PathVertex *vertices = nullptr;
+    int nVertices = 0, maxVertices;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_CPU_GUIDING_H
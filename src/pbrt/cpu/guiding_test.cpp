@@ -0,0 +1,118 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include <gtest/gtest.h>
+
+#include <pbrt/bsdf.h>
+#include <pbrt/bxdfs.h>
+#include <pbrt/cpu/guiding.h>
+#include <pbrt/pbrt.h>
+#include <pbrt/util/lowdiscrepancy.h>
+#include <pbrt/util/rng.h>
+#include <pbrt/util/sampling.h>
+#include <pbrt/util/vecmath.h>
+
+using namespace pbrt;
+
+TEST(GuidingDTree, SamplePDF) {
+    // Record radiance arriving mostly from a narrow cone around +z
+    GuidingDTree dTree;
+    RNG rng;
+    for (int iter = 0; iter < 3; ++iter) {
+        for (int i = 0; i < 20000; ++i) {
+            Point2f u(rng.Uniform<Float>(), rng.Uniform<Float>());
+            Vector3f w = SampleUniformSphere(u);
+            dTree.Record(w, w.z > 0.9f ? 100 : 1);
+        }
+        dTree.Refine(0.01f, 20, 1 << 16);
+    }
+    ASSERT_TRUE(dTree.IsValid());
+
+    // Sampled densities should match _PDF()_ and favor the bright cone
+    int nInCone = 0, nMismatched = 0, n = 4096;
+    for (int i = 0; i < n; ++i) {
+        Point2f u(RadicalInverse(0, i), RadicalInverse(1, i));
+        Float pdf;
+        Vector3f w = dTree.Sample(u, &pdf);
+        EXPECT_NEAR(1, Length(w), 1e-4);
+        EXPECT_GT(pdf, 0);
+        // Directions on quadrant boundaries may round into a neighboring quadrant
+        if (std::abs(pdf - dTree.PDF(w)) > 1e-3f * pdf)
+            ++nMismatched;
+        if (w.z > 0.9f)
+            ++nInCone;
+    }
+    EXPECT_LT(nMismatched, n / 100);
+    EXPECT_GT(nInCone, n / 2);
+
+    // The density should integrate to one over the sphere
+    Float integral = 0;
+    n = 1 << 16;
+    for (int i = 0; i < n; ++i) {
+        Point2f u(RadicalInverse(0, i), RadicalInverse(1, i));
+        Vector3f w = SampleUniformSphere(u);
+        integral += dTree.PDF(w) * Inv4Pi / UniformSpherePDF();
+    }
+    EXPECT_NEAR(1, integral / n, 0.02);
+}
+
+TEST(GuidingField, SpatialSubdivision) {
+    GuidingField field(Bounds3f(Point3f(0, 0, 0), Point3f(1, 1, 1)), 0.5f, 64 << 20, 4);
+    Point3f p0(0.1, 0.1, 0.1), p1(0.9, 0.9, 0.9);
+    EXPECT_EQ(field.Lookup(p0), field.Lookup(p1));
+
+    // Enough samples in a single iteration split the root cell
+    for (int i = 0; i < 50000; ++i)
+        field.Lookup(i & 1 ? p0 : p1)->Record(Vector3f(0, 0, 1), 1);
+    field.FinishIteration();
+    EXPECT_NE(field.Lookup(p0), field.Lookup(p1));
+    EXPECT_TRUE(field.Lookup(p0)->IsValid());
+    EXPECT_TRUE(field.IsTraining());
+}
+
+TEST(GuidedBSDF, SampleFlags) {
+    // Record radiance arriving from cones around both +z and -z
+    GuidingDTree dTree;
+    RNG rng;
+    for (int iter = 0; iter < 3; ++iter) {
+        for (int i = 0; i < 20000; ++i) {
+            Point2f u(rng.Uniform<Float>(), rng.Uniform<Float>());
+            Vector3f w = SampleUniformSphere(u);
+            dTree.Record(w, std::abs(w.z) > 0.9f ? 100 : 1);
+        }
+        dTree.Refine(0.01f, 20, 1 << 16);
+    }
+    ASSERT_TRUE(dTree.IsValid());
+
+    Vector3f wo = Normalize(Vector3f(.2, -.1, 1));
+    Normal3f n(0, 0, 1);
+    DielectricInterfaceBxDF dielectric(1.5f, TrowbridgeReitzDistribution(.3, .3));
+    DiffuseBxDF diffuse(SampledSpectrum(.5f), SampledSpectrum(0.f), 0);
+    for (BxDFHandle bxdf : {BxDFHandle(&dielectric), BxDFHandle(&diffuse)}) {
+        BSDF bsdf(wo, n, n, Vector3f(1, 0, 0), bxdf, 1.5f);
+        GuidedBSDF guided(&bsdf, &dTree, 0.01f);
+        ASSERT_TRUE(guided.IsGuided());
+
+        // Guided samples should report the BSDF's lobe type and whether they
+        // are transmitted, which is what applies the BSDF's relative IOR
+        int nTransmitted = 0, nSamples = 4096;
+        for (int i = 0; i < nSamples; ++i) {
+            Point2f u(RadicalInverse(0, i), RadicalInverse(1, i));
+            BSDFSample bs = guided.Sample_f(wo, 0.5f, u);
+            if (!bs)
+                continue;
+            EXPECT_EQ(bs.wi.z < 0, bs.IsTransmission());
+            EXPECT_EQ(bs.IsReflection(), !bs.IsTransmission());
+            EXPECT_EQ(bsdf.IsGlossy(), bs.IsGlossy());
+            EXPECT_EQ(bsdf.IsDiffuse(), bs.IsDiffuse());
+            EXPECT_FALSE(bs.IsSpecular());
+            nTransmitted += bs.IsTransmission();
+        }
+        if (bsdf.HasTransmission()) {
+            EXPECT_GT(nTransmitted, nSamples / 10);
+            EXPECT_EQ(1.5f, bsdf.eta);
+        } else
+            EXPECT_EQ(0, nTransmitted);
+    }
+}
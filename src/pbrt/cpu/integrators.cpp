@@ -127,6 +127,7 @@ void ImageTileIntegrator::Render() {
         SamplerHandle tileSampler = samplerPrototype.Clone(1, Allocator())[0];
         tileSampler.StartPixelSample(pPixel, sampleIndex);
 
+        StartWave();
         EvaluatePixelSample(pPixel, sampleIndex, tileSampler, scratchBuffer);
 
         return;
@@ -144,7 +145,19 @@ void ImageTileIntegrator::Render() {
     // Declare common variables for rendering image in tiles
     Bounds2i pixelBounds = camera.GetFilm().PixelBounds();
     int spp = samplerPrototype.SamplesPerPixel();
-    int startWave = 0, endWave = 1, waveDelta = 1;
+    // Find the range of pixel sample indices to render
+    int firstSample = 0, endSample = spp;
+    if (Options->sampleRange) {
+        firstSample = Options->sampleRange->x;
+        endSample = Options->sampleRange->y;
+        if (endSample > spp)
+            ErrorExit("--sample-range end %d is greater than the %d pixel samples "
+                      "provided by the sampler.",
+                      endSample, spp);
+    }
+    int startWave = firstSample, endWave = firstSample + 1, waveDelta = 1;
+    // Waves may be shorter than the image writing schedule given by _writeWave_
+    int writeWave = endWave, maxWaveSamples = MaxWaveSamples();
 
     std::vector<ScratchBuffer> scratchBuffers;
     for (int i = 0; i < MaxThreadIndex(); ++i)
@@ -153,12 +166,61 @@ void ImageTileIntegrator::Render() {
     std::vector<SamplerHandle> samplers =
         samplerPrototype.Clone(MaxThreadIndex(), Allocator());
 
-    ProgressReporter progress(int64_t(spp) * pixelBounds.Area(), "Rendering",
-                              Options->quiet);
+    ProgressReporter progress(int64_t(endSample - firstSample) * pixelBounds.Area(),
+                              "Rendering", Options->quiet);
 
     if (Options->recordPixelStatistics)
         StatsEnablePixelStats(pixelBounds,
                               RemoveExtension(camera.GetFilm().GetFilename()));
+
+    // Render tiles to completion and stream them to disk, if requested
+    if (int streamTileSize = camera.GetFilm().StreamingTileSize();
+        streamTileSize > 0) {
+        if (!Options->mseReferenceImage.empty() || !Options->displayServer.empty())
+            Warning("MSE computation and the display server aren't supported when "
+                    "the film streams tiles to disk.");
+        // Each tile is rendered with all of its pixel samples at once
+        if (RequiresWaves())
+            ErrorExit("Path guiding and the BDPT light path cache update their state "
+                      "after each wave of pixel samples and can't be used with films "
+                      "that stream tiles to disk.");
+        FilmHandle film = camera.GetFilm();
+        ImageMetadata metadata;
+        metadata.samplesPerPixel = endSample - firstSample;
+        camera.InitMetadata(&metadata);
+        film.BeginStreaming(metadata);
+
+        std::vector<Point2i> tiles = TileSequence(pixelBounds, streamTileSize, tileOrder);
+        ParallelFor2D(pixelBounds, streamTileSize, tiles, [&](Bounds2i tileBounds) {
+            // Render all samples for the pixels in _tileBounds_
+            ScratchBuffer &scratchBuffer = scratchBuffers[ThreadIndex];
+            SamplerHandle &sampler = samplers[ThreadIndex];
+            VLOG(1, "Starting streamed image tile %s", tileBounds);
+            film.StartTile(tileBounds);
+            for (Point2i pPixel : tileBounds) {
+                StatsReportPixelStart(pPixel);
+                threadPixel = pPixel;
+                for (int sampleIndex = firstSample; sampleIndex < endSample;
+                     ++sampleIndex) {
+                    threadSampleIndex = sampleIndex;
+                    sampler.StartPixelSample(pPixel, sampleIndex);
+                    EvaluatePixelSample(pPixel, sampleIndex, sampler, scratchBuffer);
+                    scratchBuffer.Reset();
+                }
+                StatsReportPixelEnd(pPixel);
+            }
+            // Write the finished tile and release its pixels
+            film.FinishTile(tileBounds);
+            VLOG(1, "Finished streamed image tile %s", tileBounds);
+            progress.Update(int64_t(endSample - firstSample) * tileBounds.Area());
+        });
+
+        film.EndStreaming();
+        progress.Done();
+        LOG_VERBOSE("Rendering finished");
+        return;
+    }
+
     // Handle MSE referene image, if provided
     pstd::optional<Image> referenceImage;
     FILE *mseOutFile = nullptr;
@@ -206,9 +268,14 @@ void ImageTileIntegrator::Render() {
                        });
     }
 
-    while (startWave < spp) {
+    // Compute the order in which image tiles are rendered in each wave
+    int waveTileSize = tileSize > 0 ? tileSize : ParallelTileSize(pixelBounds);
+    std::vector<Point2i> waveTiles = TileSequence(pixelBounds, waveTileSize, tileOrder);
+
+    while (startWave < endSample) {
+        StartWave();
         // Render image tiles in parallel
-        ParallelFor2D(pixelBounds, [&](Bounds2i tileBounds) {
+        ParallelFor2D(pixelBounds, waveTileSize, waveTiles, [&](Bounds2i tileBounds) {
             // Render image tile given by _tileBounds_
             ScratchBuffer &scratchBuffer = scratchBuffers[ThreadIndex];
             SamplerHandle &sampler = samplers[ThreadIndex];
@@ -230,29 +297,43 @@ void ImageTileIntegrator::Render() {
             VLOG(1, "Finished image tile %s", tileBounds);
             progress.Update((endWave - startWave) * tileBounds.Area());
         });
+        FinishWave();
 
         // Update start and end wave
         startWave = endWave;
-        endWave = std::min(spp, endWave + waveDelta);
-        if (!referenceImage)
-            waveDelta = std::min(2 * waveDelta, 64);
+        bool writeImage = startWave == writeWave;
+        if (writeImage) {
+            writeWave = std::min(endSample, writeWave + waveDelta);
+            if (!referenceImage)
+                waveDelta = std::min(2 * waveDelta, 64);
+        }
+        endWave = std::min(writeWave, startWave + maxWaveSamples);
+        if (!writeImage)
+            continue;
 
         // Write current image to disk
-        LOG_VERBOSE("Writing image with spp = %d", startWave);
+        int samplesTaken = startWave - firstSample;
+        LOG_VERBOSE("Writing image with spp = %d", samplesTaken);
         ImageMetadata metadata;
         metadata.renderTimeSeconds = progress.ElapsedSeconds();
-        metadata.samplesPerPixel = startWave;
+        metadata.samplesPerPixel = samplesTaken;
+        if (Options->sampleRange)
+            metadata.stringVectors["sampleRange"] = {std::to_string(firstSample),
+                                                     std::to_string(startWave)};
+        if (Options->writePartialFilm && !name.empty())
+            metadata.stringVectors["integrator"] = {name};
         if (referenceImage) {
             ImageMetadata filmMetadata;
-            Image filmImage = camera.GetFilm().GetImage(&filmMetadata, 1.f / startWave);
+            Image filmImage =
+                camera.GetFilm().GetImage(&filmMetadata, 1.f / samplesTaken);
             ImageChannelValues mse =
                 filmImage.MSE(filmImage.AllChannelsDesc(), *referenceImage);
-            fprintf(mseOutFile, "%d, %.9g\n", startWave, mse.Average());
+            fprintf(mseOutFile, "%d, %.9g\n", samplesTaken, mse.Average());
             metadata.MSE = mse.Average();
             fflush(mseOutFile);
         }
         camera.InitMetadata(&metadata);
-        camera.GetFilm().WriteImage(metadata, 1.0f / startWave);
+        camera.GetFilm().WriteImage(metadata, 1.0f / samplesTaken);
     }
     if (mseOutFile)
         fclose(mseOutFile);
@@ -546,9 +627,41 @@ std::unique_ptr<SimplePathIntegrator> SimplePathIntegrator::Create(
 // LightPathIntegrator Method Definitions
 LightPathIntegrator::LightPathIntegrator(int maxDepth, CameraHandle camera,
                                          SamplerHandle sampler, PrimitiveHandle aggregate,
-                                         std::vector<LightHandle> lights)
-    : ImageTileIntegrator(camera, sampler, aggregate, lights), maxDepth(maxDepth) {
+                                         std::vector<LightHandle> lights,
+                                         int splatBatchSize)
+    : ImageTileIntegrator(camera, sampler, aggregate, lights),
+      maxDepth(maxDepth),
+      splatBatchSize(splatBatchSize),
+      threadSplats(MaxThreadIndex()) {
     lightSampler = std::make_unique<PowerLightSampler>(lights, Allocator());
+    for (std::vector<Splat> &splats : threadSplats)
+        splats.reserve(splatBatchSize);
+}
+
+void LightPathIntegrator::addSplat(const Point2f &pRaster, const SampledSpectrum &L,
+                                   const SampledWavelengths &lambda) {
+    std::vector<Splat> &splats = threadSplats[ThreadIndex];
+    splats.push_back(Splat{pRaster, L, lambda});
+    if (splats.size() >= splatBatchSize)
+        flushSplats(splats);
+}
+
+void LightPathIntegrator::flushSplats(std::vector<Splat> &splats) {
+    // Sort splats in scanline order so that film updates are coherent
+    std::sort(splats.begin(), splats.end(), [](const Splat &a, const Splat &b) {
+        int ay = std::floor(a.pRaster.y), by = std::floor(b.pRaster.y);
+        if (ay != by)
+            return ay < by;
+        return a.pRaster.x < b.pRaster.x;
+    });
+    FilmHandle film = camera.GetFilm();
+    for (const Splat &splat : splats)
+        film.AddSplat(splat.pRaster, splat.L, splat.lambda);
+    splats.clear();
+}
+
+void LightPathIntegrator::FinishWave() {
+    ParallelFor(0, threadSplats.size(), [&](int64_t i) { flushSplats(threadSplats[i]); });
 }
 
 void LightPathIntegrator::EvaluatePixelSample(const Point2i &pPixel, int sampleIndex,
@@ -593,7 +706,7 @@ void LightPathIntegrator::EvaluatePixelSample(const Point2i &pPixel, int sampleI
                 if (Le && Unoccluded(cs->pRef, cs->pLens)) {
                     SampledSpectrum L = Le * les.AbsCosTheta(cs->wi) * cs->Wi /
                                         (lightPDF * pdf * cs->pdf);
-                    camera.GetFilm().AddSplat(cs->pRaster, L, lambda);
+                    addSplat(cs->pRaster, L, lambda);
                 }
             }
         }
@@ -622,7 +735,7 @@ void LightPathIntegrator::EvaluatePixelSample(const Point2i &pPixel, int sampleI
             SampledSpectrum L = beta * bsdf.f(wo, cs->wi, TransportMode::Importance) *
                                 AbsDot(cs->wi, isect.shading.n) * cs->Wi / cs->pdf;
             if (L && Unoccluded(cs->pRef, cs->pLens))
-                camera.GetFilm().AddSplat(cs->pRaster, L, lambda);
+                addSplat(cs->pRaster, L, lambda);
         }
 
         // Sample the BSDF...
@@ -637,16 +750,20 @@ void LightPathIntegrator::EvaluatePixelSample(const Point2i &pPixel, int sampleI
 }
 
 std::string LightPathIntegrator::ToString() const {
-    return StringPrintf("[ LightPathIntegrator maxDepth: %d lightSampler: %s ]", maxDepth,
-                        lightSampler);
+    return StringPrintf("[ LightPathIntegrator maxDepth: %d lightSampler: %s "
+                        "splatBatchSize: %d ]",
+                        maxDepth, lightSampler, splatBatchSize);
 }
 
 std::unique_ptr<LightPathIntegrator> LightPathIntegrator::Create(
     const ParameterDictionary &parameters, CameraHandle camera, SamplerHandle sampler,
     PrimitiveHandle aggregate, std::vector<LightHandle> lights, const FileLoc *loc) {
     int maxDepth = parameters.GetOneInt("maxdepth", 5);
+    int splatBatchSize = parameters.GetOneInt("splatbatchsize", 4096);
+    if (splatBatchSize < 1)
+        ErrorExit(loc, "%d: \"splatbatchsize\" must be at least one.", splatBatchSize);
     return std::make_unique<LightPathIntegrator>(maxDepth, camera, sampler, aggregate,
-                                                 lights);
+                                                 lights, splatBatchSize);
 }
 
 STAT_PERCENT("Integrator/Zero-radiance paths", zeroRadiancePaths, totalPaths);
@@ -657,12 +774,14 @@ STAT_INT_DISTRIBUTION("Integrator/Path length", pathLength);
 PathIntegrator::PathIntegrator(int maxDepth, CameraHandle camera, SamplerHandle sampler,
                                PrimitiveHandle aggregate, std::vector<LightHandle> lights,
                                Float rrThreshold, const std::string &lightSampleStrategy,
-                               bool regularize)
+                               bool regularize,
+                               std::unique_ptr<GuidingField> guidingField)
     : RayIntegrator(camera, sampler, aggregate, lights),
       maxDepth(maxDepth),
       rrThreshold(rrThreshold),
       lightSampler(LightSamplerHandle::Create(lightSampleStrategy, lights, Allocator())),
-      regularize(regularize) {}
+      regularize(regularize),
+      guidingField(std::move(guidingField)) {}
 
 SampledSpectrum PathIntegrator::Li(RayDifferential ray, SampledWavelengths &lambda,
                                    SamplerHandle sampler, ScratchBuffer &scratchBuffer,
@@ -672,6 +791,7 @@ SampledSpectrum PathIntegrator::Li(RayDifferential ray, SampledWavelengths &lamb
     int depth = 0;
     Float etaScale = 1, bsdfPDF;
     SurfaceInteraction prevIntr;
+    GuidingPathRecorder guidingRecorder(guidingField.get(), maxDepth, scratchBuffer);
 
     while (true) {
         // Find next path vertex and accumulate contribution
@@ -754,10 +874,16 @@ SampledSpectrum PathIntegrator::Li(RayDifferential ray, SampledWavelengths &lamb
         }
 
         ++totalBSDFs;
+        // Mix in the guiding distribution at the intersection point, if available
+        const GuidingDTree *dTree =
+            guidingField ? guidingField->Lookup(isect.p()) : nullptr;
+        GuidedBSDF guidedBSDF(&bsdf, dTree,
+                              guidingField ? guidingField->BSDFSamplingFraction() : 1);
+
         // Sample direct illumination from the light sources
         if (bsdf.IsNonSpecular()) {
             ++totalPaths;
-            SampledSpectrum Ld = SampleLd(isect, bsdf, lambda, sampler);
+            SampledSpectrum Ld = SampleLd(isect, guidedBSDF, lambda, sampler);
             if (!Ld)
                 ++zeroRadiancePaths;
             L += beta * Ld;
@@ -766,12 +892,15 @@ SampledSpectrum PathIntegrator::Li(RayDifferential ray, SampledWavelengths &lamb
         // Sample BSDF to get new path direction
         Vector3f wo = -ray.d;
         Float u = sampler.Get1D();
-        BSDFSample bs = bsdf.Sample_f(wo, u, sampler.Get2D());
+        BSDFSample bs = guidedBSDF.Sample_f(wo, u, sampler.Get2D());
         if (!bs)
             break;
         // Update path state variables for after surface scattering
         beta *= bs.f * AbsDot(bs.wi, isect.shading.n) / bs.pdf;
         bsdfPDF = bsdf.SampledPDFIsProportional() ? bsdf.PDF(wo, bs.wi) : bs.pdf;
+        if (!bs.IsSpecular())
+            guidingRecorder.AddVertex(isect.p(), bs.wi, bsdfPDF, beta.Average(),
+                                      L.Average());
         DCHECK(!std::isinf(beta.y(lambda)));
         specularBounce = bs.IsSpecular();
         anyNonSpecularBounces |= !bs.IsSpecular();
@@ -791,11 +920,13 @@ SampledSpectrum PathIntegrator::Li(RayDifferential ray, SampledWavelengths &lamb
             DCHECK(!std::isinf(beta.y(lambda)));
         }
     }
+    guidingRecorder.Commit(L.Average());
     ReportValue(pathLength, depth);
     return L;
 }
 
-SampledSpectrum PathIntegrator::SampleLd(const SurfaceInteraction &intr, const BSDF &bsdf,
+SampledSpectrum PathIntegrator::SampleLd(const SurfaceInteraction &intr,
+                                         const GuidedBSDF &bsdf,
                                          SampledWavelengths &lambda,
                                          SamplerHandle sampler) const {
     // Choose a light source for the direct lighting calculation
@@ -830,10 +961,39 @@ SampledSpectrum PathIntegrator::SampleLd(const SurfaceInteraction &intr, const B
     }
 }
 
+void PathIntegrator::FinishWave() {
+    if (guidingField)
+        guidingField->FinishIteration();
+}
+
 std::string PathIntegrator::ToString() const {
     return StringPrintf("[ PathIntegrator maxDepth: %d rrThreshold: %f "
-                        "lightSampler: %s regularize: %s ]",
-                        maxDepth, rrThreshold, lightSampler, regularize);
+                        "lightSampler: %s regularize: %s guidingField: %s ]",
+                        maxDepth, rrThreshold, lightSampler, regularize,
+                        guidingField ? guidingField->ToString()
+                                     : std::string("(nullptr)"));
+}
+
+// Create the path guiding field shared by the path integrators, if enabled
+static std::unique_ptr<GuidingField> CreateGuidingField(
+    const ParameterDictionary &parameters, PrimitiveHandle aggregate,
+    const FileLoc *loc) {
+    if (!parameters.GetOneBool("guiding", false))
+        return nullptr;
+    Float bsdfFraction = parameters.GetOneFloat("guidingbsdffraction", 0.5f);
+    int memoryMB = parameters.GetOneInt("guidingmemory", 64);
+    int trainingWaves = parameters.GetOneInt("guidingtrainingwaves", 6);
+    if (bsdfFraction <= 0 || bsdfFraction > 1)
+        ErrorExit(loc, "%f: \"guidingbsdffraction\" must be in (0,1].", bsdfFraction);
+    if (memoryMB < 1)
+        ErrorExit(loc, "%d: \"guidingmemory\" must be at least one megabyte.",
+                  memoryMB);
+    if (trainingWaves < 1)
+        ErrorExit(loc, "%d: \"guidingtrainingwaves\" must be at least one.",
+                  trainingWaves);
+    Bounds3f bounds = aggregate ? aggregate.Bounds() : Bounds3f();
+    return std::make_unique<GuidingField>(bounds, bsdfFraction, size_t(memoryMB) << 20,
+                                          trainingWaves);
 }
 
 std::unique_ptr<PathIntegrator> PathIntegrator::Create(
@@ -843,8 +1003,11 @@ std::unique_ptr<PathIntegrator> PathIntegrator::Create(
     Float rrThreshold = parameters.GetOneFloat("rrthreshold", 1.);
     std::string lightStrategy = parameters.GetOneString("lightsampler", "bvh");
     bool regularize = parameters.GetOneBool("regularize", false);
+    std::unique_ptr<GuidingField> guidingField =
+        CreateGuidingField(parameters, aggregate, loc);
     return std::make_unique<PathIntegrator>(maxDepth, camera, sampler, aggregate, lights,
-                                            rrThreshold, lightStrategy, regularize);
+                                            rrThreshold, lightStrategy, regularize,
+                                            std::move(guidingField));
 }
 
 // SimpleVolPathIntegrator Method Definitions
@@ -969,6 +1132,7 @@ SampledSpectrum VolPathIntegrator::Li(RayDifferential ray, SampledWavelengths &l
     pstd::optional<SurfaceInteraction> prevSurfaceIntr;
     pstd::optional<MediumInteraction> prevMediumIntr;
     int depth = 0;
+    GuidingPathRecorder guidingRecorder(guidingField.get(), maxDepth, scratchBuffer);
 
     while (true) {
         // Sample segment of volumetric scattering path
@@ -1058,7 +1222,7 @@ SampledSpectrum VolPathIntegrator::Li(RayDifferential ray, SampledWavelengths &l
                 });
         }
         if (terminated)
-            return L;
+            break;
         if (scattered)
             continue;
         // Handle scattering at point on surface for volumetric path tracer
@@ -1124,7 +1288,7 @@ SampledSpectrum VolPathIntegrator::Li(RayDifferential ray, SampledWavelengths &l
         prevMediumIntr.reset();
         // Terminate path if maximum depth reached
         if (depth++ >= maxDepth)
-            return L;
+            break;
 
         // Possibly regularize BSDF
         if (regularize && anyNonSpecularBounces) {
@@ -1133,28 +1297,37 @@ SampledSpectrum VolPathIntegrator::Li(RayDifferential ray, SampledWavelengths &l
         }
         ++totalBSDFs;
 
+        // Mix in the guiding distribution at the intersection point, if available
+        const GuidingDTree *dTree =
+            guidingField ? guidingField->Lookup(isect.p()) : nullptr;
+        GuidedBSDF guidedBSDF(&bsdf, dTree,
+                              guidingField ? guidingField->BSDFSamplingFraction() : 1);
+
         // Sample illumination from lights to find attenuated path contribution
         if (bsdf.IsNonSpecular()) {
-            L += SampleLd(isect, &bsdf, lambda, sampler, beta, pdfUni);
+            L += SampleLd(isect, &guidedBSDF, lambda, sampler, beta, pdfUni);
             DCHECK(std::isinf(L.y(lambda)) == false);
         }
 
         // Sample BSDF to get new volumetric path direction
         Vector3f wo = -ray.d;
         Float u = sampler.Get1D();
-        BSDFSample bs = bsdf.Sample_f(wo, u, sampler.Get2D());
+        BSDFSample bs = guidedBSDF.Sample_f(wo, u, sampler.Get2D());
         if (!bs)
             break;
         // Update _beta_ and PDFs for BSDF scattering
         beta *= bs.f * AbsDot(bs.wi, isect.shading.n);
         pdfNEE = pdfUni;
+        Float bsdfPDF = bs.pdf;
         if (bsdf.SampledPDFIsProportional()) {
-            Float pdf = bsdf.PDF(wo, bs.wi);
-            beta *= pdf / bs.pdf;
-            pdfUni *= pdf;
-        } else
-            pdfUni *= bs.pdf;
+            bsdfPDF = bsdf.PDF(wo, bs.wi);
+            beta *= bsdfPDF / bs.pdf;
+        }
+        pdfUni *= bsdfPDF;
         rescale(beta, pdfUni, pdfNEE);
+        if (!bs.IsSpecular())
+            guidingRecorder.AddVertex(isect.p(), bs.wi, bsdfPDF,
+                                      beta.Average() / pdfUni.Average(), L.Average());
 
         VLOG(2, "Sampled BSDF, f = %s, pdf = %f -> beta = %s", bs.f, bs.pdf, beta);
         DCHECK(std::isinf(beta.y(lambda)) == false);
@@ -1216,7 +1389,8 @@ SampledSpectrum VolPathIntegrator::Li(RayDifferential ray, SampledWavelengths &l
             CHECK(!prevMediumIntr.has_value());
 
             // Account for attenuated direct subsurface scattering
-            L += SampleLd(pi, &bsdf, lambda, sampler, beta, pdfUni);
+            GuidedBSDF exitBSDF(&bsdf, nullptr, 1);
+            L += SampleLd(pi, &exitBSDF, lambda, sampler, beta, pdfUni);
 
             // Sample ray for indirect subsurface scattering
             Float u = sampler.Get1D();
@@ -1245,10 +1419,12 @@ SampledSpectrum VolPathIntegrator::Li(RayDifferential ray, SampledWavelengths &l
             pdfNEE *= 1 - q;
         }
     }
+    guidingRecorder.Commit(L.Average());
     return L;
 }
 
-SampledSpectrum VolPathIntegrator::SampleLd(const Interaction &intr, const BSDF *bsdf,
+SampledSpectrum VolPathIntegrator::SampleLd(const Interaction &intr,
+                                            const GuidedBSDF *bsdf,
                                             SampledWavelengths &lambda,
                                             SamplerHandle sampler,
                                             const SampledSpectrum &beta,
@@ -1345,10 +1521,17 @@ SampledSpectrum VolPathIntegrator::SampleLd(const Interaction &intr, const BSDF
         return betaLight * ls.L / (pdfLight + pdfUni).Average();
 }
 
+void VolPathIntegrator::FinishWave() {
+    if (guidingField)
+        guidingField->FinishIteration();
+}
+
 std::string VolPathIntegrator::ToString() const {
     return StringPrintf("[ VolPathIntegrator maxDepth: %d rrThreshold: %f "
-                        "lightSampler: %s regularize: %s ]",
-                        maxDepth, rrThreshold, lightSampler, regularize);
+                        "lightSampler: %s regularize: %s guidingField: %s ]",
+                        maxDepth, rrThreshold, lightSampler, regularize,
+                        guidingField ? guidingField->ToString()
+                                     : std::string("(nullptr)"));
 }
 
 std::unique_ptr<VolPathIntegrator> VolPathIntegrator::Create(
@@ -1358,9 +1541,11 @@ std::unique_ptr<VolPathIntegrator> VolPathIntegrator::Create(
     Float rrThreshold = parameters.GetOneFloat("rrthreshold", 1.);
     std::string lightStrategy = parameters.GetOneString("lightsampler", "bvh");
     bool regularize = parameters.GetOneBool("regularize", false);
+    std::unique_ptr<GuidingField> guidingField =
+        CreateGuidingField(parameters, aggregate, loc);
     return std::make_unique<VolPathIntegrator>(maxDepth, camera, sampler, aggregate,
                                                lights, rrThreshold, lightStrategy,
-                                               regularize);
+                                               regularize, std::move(guidingField));
 }
 
 // AOIntegrator Method Definitions
@@ -1444,7 +1629,7 @@ SampledSpectrum ConnectBDPT(const Integrator &integrator, SampledWavelengths &la
                             Vertex *lightVertices, Vertex *cameraVertices, int s, int t,
                             LightSamplerHandle lightSampler, CameraHandle camera,
                             SamplerHandle sampler, pstd::optional<Point2f> *pRaster,
-                            Float *misWeightPtr = nullptr);
+                            Float *misWeightPtr = nullptr, int nLightConnections = 1);
 
 Float InfiniteLightDensity(const std::vector<LightHandle> &infiniteLights,
                            LightSamplerHandle lightSampler, const Vector3f &w);
@@ -1750,8 +1935,8 @@ struct Vertex {
         } else if (IsOnSurface()) {
             // Compute sampling density at emissive surface
             if (type == VertexType::Light)
-                CHECK(ei.light.Is<DiffuseAreaLight>());  // since that's all we've
-                                                         // got currently...
+                CHECK(ei.light.Is<DiffuseAreaLight>() ||
+                      ei.light.Is<TriangleMeshLight>());
             LightHandle light = (type == VertexType::Light) ? ei.light : si.areaLight;
             Float pdfPos, pdfDir;
             light.PDF_Le(ei, w, &pdfPos, &pdfDir);
@@ -1786,8 +1971,8 @@ struct Vertex {
         } else if (IsOnSurface()) {
             // Return probability for emissive surface
             if (type == VertexType::Light)
-                CHECK(ei.light.Is<DiffuseAreaLight>());  // since that's all we've
-                                                         // got currently...
+                CHECK(ei.light.Is<DiffuseAreaLight>() ||
+                      ei.light.Is<TriangleMeshLight>());
             LightHandle light = (type == VertexType::Light) ? ei.light : si.areaLight;
             Float pdfChoice = lightSampler.PDF(light);
             Float pdfPos, pdfDir;
@@ -2085,13 +2270,21 @@ SampledSpectrum G(const Integrator &integrator, SamplerHandle sampler, const Ver
 
 Float MISWeight(const Integrator &integrator, Vertex *lightVertices,
                 Vertex *cameraVertices, Vertex &sampled, int s, int t,
-                LightSamplerHandle lightSampler) {
+                LightSamplerHandle lightSampler, int nLightConnections) {
     if (s + t == 2)
         return 1;
     Float sumRi = 0;
     // Define helper function _remap0_ that deals with Dirac delta functions
     auto remap0 = [](float f) -> Float { return f != 0 ? f : 1; };
 
+    // Define helper function _nSamples_ that gives each strategy's sample count
+    // Strategies that use light subpath vertices other than through the camera
+    // connection are evaluated once per light subpath the camera path connects to.
+    auto nSamples = [&](int si, int ti) -> Float {
+        return (si == 0 || ti == 1) ? 1 : nLightConnections;
+    };
+    Float nCurrent = nSamples(s, t);
+
     // Temporarily update vertex properties for current strategy
     // Look up connection vertices and their predecessors
     Vertex *qs = s > 0 ? &lightVertices[s - 1] : nullptr,
@@ -2139,7 +2332,7 @@ Float MISWeight(const Integrator &integrator, Vertex *lightVertices,
     for (int i = t - 1; i > 0; --i) {
         ri *= remap0(cameraVertices[i].pdfRev) / remap0(cameraVertices[i].pdfFwd);
         if (!cameraVertices[i].delta && !cameraVertices[i - 1].delta)
-            sumRi += ri;
+            sumRi += ri * nSamples(s + t - i, i) / nCurrent;
     }
 
     // Consider hypothetical connection strategies along the light subpath
@@ -2149,7 +2342,7 @@ Float MISWeight(const Integrator &integrator, Vertex *lightVertices,
         bool deltaLightvertex =
             i > 0 ? lightVertices[i - 1].delta : lightVertices[0].IsDeltaLight();
         if (!lightVertices[i].delta && !deltaLightvertex)
-            sumRi += ri;
+            sumRi += ri * nSamples(i, s + t - i) / nCurrent;
     }
 
     return 1 / (1 + sumRi);
@@ -2189,6 +2382,9 @@ void BDPTIntegrator::Render() {
         }
     }
 
+    // Seed each pass's light subpaths with its pixel sample index so that
+    // partial renders of different sample ranges don't share them
+    waveIndex = Options->sampleRange ? Options->sampleRange->x : 0;
     RayIntegrator::Render();
 
     // Write buffers for debug visualization
@@ -2203,47 +2399,142 @@ void BDPTIntegrator::Render() {
     }
 }
 
+void BDPTIntegrator::StartWave() {
+    if (lightPathCacheSize == 0)
+        return;
+    // Allocate storage for the light path cache, if needed
+    int nChunks = (lightPathCacheSize + LightPathCacheChunkSize - 1) /
+                  LightPathCacheChunkSize;
+    if (lightPathScratchBuffers.empty()) {
+        // Reserve a generous per-vertex budget for vertices and their BSDFs
+        int chunkBytes =
+            LightPathCacheChunkSize * (maxDepth + 1) * (sizeof(Vertex) + 1024);
+        for (int i = 0; i < nChunks; ++i)
+            lightPathScratchBuffers.push_back(ScratchBuffer(chunkBytes));
+        cachedLightPaths.resize(lightPathCacheSize);
+        cachedLightPathLengths.resize(lightPathCacheSize);
+        cachedLightPathLambdas.resize(lightPathCacheSize);
+    }
+
+    // Sample stratified wavelengths for each group of cached light subpaths
+    RNG rng(waveIndex);
+    for (int g = 0; g < LightPathCacheWavelengthGroups; ++g) {
+        Float lu = (g + rng.Uniform<Float>()) / LightPathCacheWavelengthGroups;
+        if (Options->disableWavelengthJitter)
+            lu = 0.5;
+        cachedWavelengths[g] = camera.GetFilm().SampleWavelengths(lu);
+    }
+
+    // Trace the pass's light subpaths in parallel
+    ParallelFor(0, nChunks, [&](int64_t chunk) {
+        ScratchBuffer &scratchBuffer = lightPathScratchBuffers[chunk];
+        scratchBuffer.Reset();
+        int end =
+            std::min<int>(lightPathCacheSize, (chunk + 1) * LightPathCacheChunkSize);
+        for (int i = chunk * LightPathCacheChunkSize; i < end; ++i) {
+            RandomSampler randomSampler(1, waveIndex);
+            SamplerHandle sampler = &randomSampler;
+            sampler.StartPixelSample(Point2i(i % 65536, i / 65536), 0);
+            int group = int64_t(i) * LightPathCacheWavelengthGroups / lightPathCacheSize;
+            cachedLightPathLambdas[i] = cachedWavelengths[group];
+            Float time = camera.SampleTime(sampler.Get1D());
+            cachedLightPaths[i] = scratchBuffer.Alloc<Vertex[]>(maxDepth + 1);
+            cachedLightPathLengths[i] = GenerateLightSubpath(
+                *this, cachedLightPathLambdas[i], sampler, camera, scratchBuffer,
+                maxDepth + 1, time, lightSampler, cachedLightPaths[i], regularize);
+        }
+    });
+    ++waveIndex;
+}
+
 SampledSpectrum BDPTIntegrator::Li(RayDifferential ray, SampledWavelengths &lambda,
                                    SamplerHandle sampler, ScratchBuffer &scratchBuffer,
                                    VisibleSurface *visibleSurface) const {
-    // Trace the camera and light subpaths
+    // Choose cached light subpaths for this camera subpath, if enabled
+    int nConnections = 1, cacheStart = 0, groupSize = 0;
+    if (lightPathCacheSize > 0) {
+        // Use the wavelengths of a randomly chosen group of cached light subpaths
+        int group = std::min<int>(sampler.Get1D() * LightPathCacheWavelengthGroups,
+                                  LightPathCacheWavelengthGroups - 1);
+        lambda = cachedWavelengths[group];
+        cacheStart = int64_t(group) * lightPathCacheSize / LightPathCacheWavelengthGroups;
+        groupSize = int64_t(group + 1) * lightPathCacheSize /
+                        LightPathCacheWavelengthGroups -
+                    cacheStart;
+        nConnections = lightPathConnections;
+    }
+
+    // Trace the camera subpath
     Vertex *cameraVertices = scratchBuffer.Alloc<Vertex[]>(maxDepth + 2);
     int nCamera = GenerateCameraSubpath(*this, ray, lambda, sampler, scratchBuffer,
                                         maxDepth + 2, camera, cameraVertices, regularize);
     Vertex *lightVertices = scratchBuffer.Alloc<Vertex[]>(maxDepth + 1);
-    int nLight = GenerateLightSubpath(*this, lambda, sampler, camera, scratchBuffer,
-                                      maxDepth + 1, cameraVertices[0].time(),
-                                      lightSampler, lightVertices, regularize);
+
+    // Choose the cached light subpaths, terminating secondary wavelengths for all
+    // connections where tracing a light subpath would
+    int *cachedPaths = nullptr;
+    if (lightPathCacheSize > 0) {
+        cachedPaths = scratchBuffer.Alloc<int[]>(nConnections);
+        for (int c = 0; c < nConnections; ++c) {
+            cachedPaths[c] =
+                cacheStart + std::min<int>(sampler.Get1D() * groupSize, groupSize - 1);
+            if (cachedLightPathLambdas[cachedPaths[c]].SecondaryTerminated())
+                lambda.TerminateSecondary();
+        }
+    }
 
     SampledSpectrum L(0.f);
-    // Execute all BDPT connection strategies
-    for (int t = 1; t <= nCamera; ++t) {
-        for (int s = 0; s <= nLight; ++s) {
-            int depth = t + s - 2;
-            if ((s == 1 && t == 1) || depth < 0 || depth > maxDepth)
-                continue;
-            // Execute the $(s, t)$ connection strategy and update _L_
-            pstd::optional<Point2f> pFilmNew;
-            Float misWeight = 0.f;
-            SampledSpectrum Lpath =
-                ConnectBDPT(*this, lambda, lightVertices, cameraVertices, s, t,
-                            lightSampler, camera, sampler, &pFilmNew, &misWeight);
-            VLOG(2, "Connect bdpt s: %d, t: %d, Lpath: %s, misWeight: %f", s, t, Lpath,
-                 misWeight);
-            if (visualizeStrategies || visualizeWeights) {
-                SampledSpectrum value;
-                if (visualizeStrategies)
-                    value = misWeight == 0 ? SampledSpectrum(0.) : Lpath / misWeight;
-                if (visualizeWeights)
-                    value = Lpath;
-                CHECK(pFilmNew.has_value());
-                weightFilms[BufferIndex(s, t)].AddSplat(*pFilmNew, value, lambda);
-            }
-            if (t != 1)
-                L += Lpath;
-            else if (Lpath) {
-                CHECK(pFilmNew.has_value());
-                camera.GetFilm().AddSplat(*pFilmNew, Lpath, lambda);
+    for (int c = 0; c < nConnections; ++c) {
+        // Trace or look up the light subpath for the _c_th connection
+        int nLight;
+        if (lightPathCacheSize == 0)
+            nLight = GenerateLightSubpath(*this, lambda, sampler, camera, scratchBuffer,
+                                          maxDepth + 1, cameraVertices[0].time(),
+                                          lightSampler, lightVertices, regularize);
+        else {
+            // Copy a cached light subpath; MIS weighting temporarily modifies vertices
+            int index = cachedPaths[c];
+            nLight = cachedLightPathLengths[index];
+            for (int i = 0; i < nLight; ++i)
+                lightVertices[i] = cachedLightPaths[index][i];
+        }
+
+        // Execute all BDPT connection strategies
+        for (int t = 1; t <= nCamera; ++t) {
+            for (int s = 0; s <= nLight; ++s) {
+                int depth = t + s - 2;
+                if ((s == 1 && t == 1) || depth < 0 || depth > maxDepth)
+                    continue;
+                // Strategies that don't use the light subpath beyond the camera
+                // connection are only evaluated for the first connection
+                bool perConnection = s > 0 && t > 1;
+                if (c > 0 && !perConnection)
+                    continue;
+                // Execute the $(s, t)$ connection strategy and update _L_
+                pstd::optional<Point2f> pFilmNew;
+                Float misWeight = 0.f;
+                SampledSpectrum Lpath = ConnectBDPT(
+                    *this, lambda, lightVertices, cameraVertices, s, t, lightSampler,
+                    camera, sampler, &pFilmNew, &misWeight, nConnections);
+                if (perConnection)
+                    Lpath /= nConnections;
+                VLOG(2, "Connect bdpt s: %d, t: %d, Lpath: %s, misWeight: %f", s, t,
+                     Lpath, misWeight);
+                if (visualizeStrategies || visualizeWeights) {
+                    SampledSpectrum value;
+                    if (visualizeStrategies)
+                        value = misWeight == 0 ? SampledSpectrum(0.) : Lpath / misWeight;
+                    if (visualizeWeights)
+                        value = Lpath;
+                    CHECK(pFilmNew.has_value());
+                    weightFilms[BufferIndex(s, t)].AddSplat(*pFilmNew, value, lambda);
+                }
+                if (t != 1)
+                    L += Lpath;
+                else if (Lpath) {
+                    CHECK(pFilmNew.has_value());
+                    camera.GetFilm().AddSplat(*pFilmNew, Lpath, lambda);
+                }
             }
         }
     }
@@ -2255,7 +2546,7 @@ SampledSpectrum ConnectBDPT(const Integrator &integrator, SampledWavelengths &la
                             Vertex *lightVertices, Vertex *cameraVertices, int s, int t,
                             LightSamplerHandle lightSampler, CameraHandle camera,
                             SamplerHandle sampler, pstd::optional<Point2f> *pRaster,
-                            Float *misWeightPtr) {
+                            Float *misWeightPtr, int nLightConnections) {
     SampledSpectrum L(0.f);
     // Ignore invalid connections related to infinite area lights
     if (t > 1 && s != 0 && cameraVertices[t - 1].type == VertexType::Light)
@@ -2352,7 +2643,7 @@ SampledSpectrum ConnectBDPT(const Integrator &integrator, SampledWavelengths &la
     ReportValue(pathLength, s + t - 2);
     // Compute MIS weight for connection strategy
     Float misWeight = L ? MISWeight(integrator, lightVertices, cameraVertices, sampled, s,
-                                    t, lightSampler)
+                                    t, lightSampler, nLightConnections)
                         : 0.f;
     VLOG(2, "MIS weight for (s,t) = (%d, %d) connection: %f", s, t, misWeight);
     DCHECK(!std::isnan(misWeight));
@@ -2366,9 +2657,11 @@ SampledSpectrum ConnectBDPT(const Integrator &integrator, SampledWavelengths &la
 std::string BDPTIntegrator::ToString() const {
     return StringPrintf("[ BDPTIntegrator maxDepth: %d visualizeStrategies: %s "
                         "visualizeWeights: %s lightSampleStrategy: %s regularize: %s "
-                        "lightSampler: %s ]",
+                        "lightSampler: %s lightPathCacheSize: %d "
+                        "lightPathConnections: %d ]",
                         maxDepth, visualizeStrategies, visualizeWeights,
-                        lightSampleStrategy, regularize, lightSampler);
+                        lightSampleStrategy, regularize, lightSampler,
+                        lightPathCacheSize, lightPathConnections);
 }
 
 std::unique_ptr<BDPTIntegrator> BDPTIntegrator::Create(
@@ -2386,12 +2679,39 @@ std::unique_ptr<BDPTIntegrator> BDPTIntegrator::Create(
 
     std::string lightStrategy = parameters.GetOneString("lightsampler", "power");
     bool regularize = parameters.GetOneBool("regularize", false);
-    return std::make_unique<BDPTIntegrator>(camera, sampler, aggregate, lights, maxDepth,
-                                            visualizeStrategies, visualizeWeights,
-                                            lightStrategy, regularize);
+    int lightPathCacheSize = parameters.GetOneInt("lightpathcache", 0);
+    int lightPathConnections = parameters.GetOneInt("lightpathconnections", 1);
+    if (lightPathCacheSize < 0)
+        ErrorExit(loc, "%d: \"lightpathcache\" must not be negative.",
+                  lightPathCacheSize);
+    if (lightPathConnections < 1)
+        ErrorExit(loc, "%d: \"lightpathconnections\" must be at least one.",
+                  lightPathConnections);
+    if (lightPathCacheSize == 0 && lightPathConnections > 1)
+        Warning(loc, "\"lightpathconnections\" is ignored without \"lightpathcache\".");
+    return std::make_unique<BDPTIntegrator>(
+        camera, sampler, aggregate, lights, maxDepth, visualizeStrategies,
+        visualizeWeights, lightStrategy, regularize, lightPathCacheSize,
+        lightPathConnections);
 }
 
 STAT_PERCENT("Integrator/Acceptance rate", acceptedMutations, totalMutations);
+STAT_PERCENT("Integrator/MLT replica exchange acceptance rate", acceptedReplicaSwaps,
+             totalReplicaSwaps);
+STAT_FLOAT_DISTRIBUTION("Integrator/MLT chain acceptance rate", mltChainAcceptance);
+STAT_FLOAT_DISTRIBUTION("Integrator/MLT chain microseconds per mutation",
+                        mltMutationMicroseconds);
+
+// MLTReplica Definition
+// State of one Markov chain; replicas at different temperatures are
+// periodically exchanged by swapping which temperature each one runs at.
+struct MLTReplica {
+    MLTSampler sampler;
+    int depth;
+    Point2f p;
+    SampledWavelengths lambda;
+    SampledSpectrum L;
+};
 
 // MLTIntegrator Method Definitions
 SampledSpectrum MLTIntegrator::L(ScratchBuffer &scratchBuffer, MLTSampler &sampler,
@@ -2524,7 +2844,18 @@ void MLTIntegrator::Render() {
         });
         progress.Done();
     }
-    AliasTable bootstrapTable(bootstrapWeights);
+    // Compute inverse temperatures and bootstrap distributions for replicas
+    // Each replica starts from a bootstrap sample chosen in proportion to its
+    // tempered target, $I^\beta$, so the bootstrap work is shared by all of them.
+    std::vector<Float> beta(nReplicas);
+    std::vector<AliasTable> bootstrapTables;
+    for (int k = 0; k < nReplicas; ++k) {
+        beta[k] = std::pow(temperatureRatio, -Float(k));
+        std::vector<Float> temperedWeights(bootstrapWeights.size());
+        for (size_t i = 0; i < bootstrapWeights.size(); ++i)
+            temperedWeights[i] = std::pow(bootstrapWeights[i], beta[k]);
+        bootstrapTables.push_back(AliasTable(temperedWeights));
+    }
     Float b = std::accumulate(bootstrapWeights.begin(), bootstrapWeights.end(), 0.) /
               bootstrapWeights.size() * (maxDepth + 1);
 
@@ -2562,57 +2893,111 @@ void MLTIntegrator::Render() {
                 i * nTotalMutations / nChains;
             // Follow {i}th Markov chain for _nChainMutations_
             ScratchBuffer &scratchBuffer = threadScratchBuffers[ThreadIndex];
-            // Select initial state from the set of bootstrap samples
+            // Select initial replica states from the set of bootstrap samples
             RNG rng(i);
-            int bootstrapIndex = bootstrapTable.Sample(rng.Uniform<Float>());
-            int depth = bootstrapIndex % (maxDepth + 1);
-            threadDepth = depth;
-
-            // Initialize local variables for selected state
-            MLTSampler sampler(mutationsPerPixel, bootstrapIndex, sigma,
-                               largeStepProbability, nSampleStreams);
-            threadSampler = &sampler;
-            Point2f pCurrent;
-            SampledWavelengths lambdaCurrent;
-            SampledSpectrum LCurrent =
-                L(scratchBuffer, sampler, depth, &pCurrent, &lambdaCurrent);
+            std::vector<MLTReplica> replicas;
+            replicas.reserve(nReplicas);
+            for (int k = 0; k < nReplicas; ++k) {
+                int bootstrapIndex = bootstrapTables[k].Sample(rng.Uniform<Float>());
+                int depth = bootstrapIndex % (maxDepth + 1);
+                threadDepth = depth;
+
+                // Initialize replica for selected state
+                replicas.push_back(MLTReplica{MLTSampler(mutationsPerPixel, bootstrapIndex,
+                                                         sigma, largeStepProbability,
+                                                         nSampleStreams),
+                                              depth});
+                MLTReplica &replica = replicas.back();
+                threadSampler = &replica.sampler;
+                replica.L = L(scratchBuffer, replica.sampler, depth, &replica.p,
+                              &replica.lambda);
+                scratchBuffer.Reset();
+            }
+            // _replicaIndex[k]_ gives the replica currently at temperature _k_
+            std::vector<int> replicaIndex(nReplicas);
+            std::iota(replicaIndex.begin(), replicaIndex.end(), 0);
 
             // Run the Markov chain for _nChainMutations_ steps
+            // Replica initialization isn't included in the per-mutation time.
+            Timer chainTimer;
+            int64_t nChainAccepted = 0;
             for (int64_t j = 0; j < nChainMutations; ++j) {
-                StatsReportPixelStart(Point2i(pCurrent));
-                sampler.StartIteration();
-                Point2f pProposed;
-                SampledWavelengths lambdaProposed;
-                SampledSpectrum LProposed =
-                    L(scratchBuffer, sampler, depth, &pProposed, &lambdaProposed);
-                // Compute acceptance probability for proposed sample
-                Float accept =
-                    std::min<Float>(1, LProposed.Average() / LCurrent.Average());
-
-                // Splat both current and proposed samples to _film_
-                if (accept > 0)
-                    film.AddSplat(pProposed, LProposed * accept / LProposed.Average(),
-                                  lambdaProposed);
-                film.AddSplat(pCurrent, LCurrent * (1 - accept) / LCurrent.Average(),
-                              lambdaCurrent);
-
-                // Accept or reject the proposal
-                if (rng.Uniform<Float>() < accept) {
-                    StatsReportPixelEnd(Point2i(pCurrent));
-                    StatsReportPixelStart(Point2i(pProposed));
-                    pCurrent = pProposed;
-                    LCurrent = LProposed;
-                    lambdaCurrent = lambdaProposed;
-                    sampler.Accept();
-                    ++acceptedMutations;
-                } else
-                    sampler.Reject();
-
-                ++totalMutations;
-                scratchBuffer.Reset();
-                StatsReportPixelEnd(Point2i(pCurrent));
+                for (int k = 0; k < nReplicas; ++k) {
+                    // Mutate the replica at temperature _k_
+                    MLTReplica &replica = replicas[replicaIndex[k]];
+                    MLTSampler &sampler = replica.sampler;
+                    threadSampler = &sampler;
+                    threadDepth = replica.depth;
+                    if (k == 0)
+                        StatsReportPixelStart(Point2i(replica.p));
+                    sampler.StartIteration();
+                    Point2f pProposed;
+                    SampledWavelengths lambdaProposed;
+                    SampledSpectrum LProposed = L(scratchBuffer, sampler, replica.depth,
+                                                  &pProposed, &lambdaProposed);
+                    // Compute acceptance probability for proposed sample
+                    Float ratio = LProposed.Average() / replica.L.Average();
+                    Float accept =
+                        std::min<Float>(1, k == 0 ? ratio : std::pow(ratio, beta[k]));
+
+                    // Splat both current and proposed samples to _film_
+                    if (k == 0) {
+                        if (accept > 0)
+                            film.AddSplat(pProposed,
+                                          LProposed * accept / LProposed.Average(),
+                                          lambdaProposed);
+                        film.AddSplat(replica.p,
+                                      replica.L * (1 - accept) / replica.L.Average(),
+                                      replica.lambda);
+                    }
+
+                    // Accept or reject the proposal
+                    if (rng.Uniform<Float>() < accept) {
+                        if (k == 0) {
+                            StatsReportPixelEnd(Point2i(replica.p));
+                            StatsReportPixelStart(Point2i(pProposed));
+                            ++acceptedMutations;
+                            ++nChainAccepted;
+                        }
+                        replica.p = pProposed;
+                        replica.L = LProposed;
+                        replica.lambda = lambdaProposed;
+                        sampler.Accept();
+                    } else
+                        sampler.Reject();
+
+                    scratchBuffer.Reset();
+                    if (k == 0) {
+                        ++totalMutations;
+                        StatsReportPixelEnd(Point2i(replica.p));
+                    }
+                }
+
+                // Periodically propose exchanges between adjacent temperatures
+                if (nReplicas > 1 && (j + 1) % swapInterval == 0) {
+                    // Alternate between even and odd pairs of temperatures
+                    for (int k = (j / swapInterval) & 1; k + 1 < nReplicas; k += 2) {
+                        const MLTReplica &r0 = replicas[replicaIndex[k]];
+                        const MLTReplica &r1 = replicas[replicaIndex[k + 1]];
+                        Float accept = std::min<Float>(
+                            1, std::pow(r1.L.Average() / r0.L.Average(),
+                                        beta[k] - beta[k + 1]));
+                        ++totalReplicaSwaps;
+                        if (rng.Uniform<Float>() < accept) {
+                            pstd::swap(replicaIndex[k], replicaIndex[k + 1]);
+                            ++acceptedReplicaSwaps;
+                        }
+                    }
+                }
             }
 
+            // Report statistics for the {i}th chain
+            if (nChainMutations > 0) {
+                ReportValue(mltChainAcceptance, double(nChainAccepted) / nChainMutations);
+                ReportValue(mltMutationMicroseconds,
+                            1e6 * chainTimer.ElapsedSeconds() /
+                                (nChainMutations * nReplicas));
+            }
             progress.Update(1);
         });
         progress.Done();
@@ -2628,9 +3013,11 @@ void MLTIntegrator::Render() {
 std::string MLTIntegrator::ToString() const {
     return StringPrintf("[ MLTIntegrator camera: %s maxDepth: %d nBootstrap: %d "
                         "nChains: %d mutationsPerPixel: %d sigma: %f "
-                        "largeStepProbability: %f lightSampler: %s regularize: %s ]",
+                        "largeStepProbability: %f lightSampler: %s regularize: %s "
+                        "nReplicas: %d temperatureRatio: %f swapInterval: %d ]",
                         camera, maxDepth, nBootstrap, nChains, mutationsPerPixel, sigma,
-                        largeStepProbability, lightSampler, regularize);
+                        largeStepProbability, lightSampler, regularize, nReplicas,
+                        temperatureRatio, swapInterval);
 }
 
 std::unique_ptr<MLTIntegrator> MLTIntegrator::Create(
@@ -2647,9 +3034,20 @@ std::unique_ptr<MLTIntegrator> MLTIntegrator::Create(
         nBootstrap = std::max(1, nBootstrap / 16);
     }
     bool regularize = parameters.GetOneBool("regularize", false);
+    int nReplicas = parameters.GetOneInt("replicas", 1);
+    Float temperatureRatio = parameters.GetOneFloat("temperatureratio", 2.f);
+    int swapInterval = parameters.GetOneInt("swapinterval", 16);
+    if (nReplicas < 1)
+        ErrorExit(loc, "%d: \"replicas\" must be at least one.", nReplicas);
+    if (temperatureRatio <= 1 && nReplicas > 1)
+        ErrorExit(loc, "%f: \"temperatureratio\" must be greater than one.",
+                  temperatureRatio);
+    if (swapInterval < 1)
+        ErrorExit(loc, "%d: \"swapinterval\" must be at least one.", swapInterval);
     return std::make_unique<MLTIntegrator>(camera, aggregate, lights, maxDepth,
                                            nBootstrap, nChains, mutationsPerPixel, sigma,
-                                           largeStepProbability, regularize);
+                                           largeStepProbability, regularize, nReplicas,
+                                           temperatureRatio, swapInterval);
 }
 
 STAT_RATIO("Stochastic Progressive Photon Mapping/Visible points checked per photon "
@@ -2661,6 +3059,10 @@ STAT_INT_DISTRIBUTION(
     gridCellsPerVisiblePoint);
 STAT_MEMORY_COUNTER("Memory/SPPM Pixels", pixelMemoryBytes);
 STAT_MEMORY_COUNTER("Memory/SPPM BSDF and Grid Memory", sppmMemoryArenaBytes);
+STAT_FLOAT_DISTRIBUTION("Stochastic Progressive Photon Mapping/Grid build seconds",
+                        sppmGridBuildSeconds);
+STAT_FLOAT_DISTRIBUTION("Stochastic Progressive Photon Mapping/Photon pass seconds",
+                        sppmPhotonPassSeconds);
 
 // SPPMPixel Definition
 struct SPPMPixel {
@@ -2684,10 +3086,23 @@ struct SPPMPixel {
     RGB tau;
 };
 
-// SPPMPixelListNode Definition
-struct SPPMPixelListNode {
+// SPPMGridEntry Definition
+// Visible points overlapping a grid cell are stored contiguously, with the
+// position and radius copied so that lookups only touch the pixel on a hit.
+struct SPPMGridEntry {
+    Point3f p;
+    Float radius;
     SPPMPixel *pixel;
-    SPPMPixelListNode *next;
+};
+
+// SPPMPhotonRecord Definition
+// Photon hit buffered during photon shooting; records are sorted by grid cell
+// before being deposited at visible points.
+struct SPPMPhotonRecord {
+    int cell;
+    Point3f p;
+    Vector3f wi;
+    SampledSpectrum beta;
 };
 
 // SPPM Utility Functions
@@ -2739,6 +3154,15 @@ void SPPMIntegrator::Render() {
     for (int i = 0; i < MaxThreadIndex(); ++i)
         // TODO: size this
         perThreadScratchBuffers.push_back(ScratchBuffer(nPixels * 1024));
+    // Allocate counting-sort grid arrays for SPPM visible points
+    const int hashSize = NextPrime(nPixels);
+    std::vector<std::atomic<int>> cellCounts(hashSize);
+    std::vector<int> cellOffsets(hashSize + 1);
+    std::vector<SPPMGridEntry> gridEntries;
+    std::vector<std::vector<SPPMPhotonRecord>> perThreadPhotonRecords(MaxThreadIndex());
+    for (std::vector<SPPMPhotonRecord> &records : perThreadPhotonRecords)
+        records.reserve(photonBatchSize);
+
     const Sensor *sensor = camera.GetFilm().GetSensor();
     auto ToSensorRGB = [&](const SampledSpectrum &L,
                            const SampledWavelengths &lambda) -> RGB {
@@ -2857,10 +3281,7 @@ void SPPMIntegrator::Render() {
         }
         progress.Update();
         // Create grid of all SPPM visible points
-        // Allocate grid for SPPM visible points
-        const int hashSize = NextPrime(nPixels);
-        std::vector<std::atomic<SPPMPixelListNode *>> grid(hashSize);
-
+        Timer gridTimer;
         // Compute grid bounds for SPPM visible points
         Bounds3f gridBounds;
         Float maxRadius = 0.;
@@ -2880,49 +3301,112 @@ void SPPMIntegrator::Render() {
         for (int i = 0; i < 3; ++i)
             gridRes[i] = std::max<int>(baseGridRes * diag[i] / maxDiag, 1);
 
-        // Add visible points to SPPM grid
+        // Define _forOverlappedCells_ lambda for SPPM visible points
+        auto forOverlappedCells = [&](const SPPMPixel &pixel, auto func) {
+            Float radius = pixel.radius;
+            Point3i pMin, pMax;
+            ToGrid(pixel.vp.p - Vector3f(radius, radius, radius), gridBounds, gridRes,
+                   &pMin);
+            ToGrid(pixel.vp.p + Vector3f(radius, radius, radius), gridBounds, gridRes,
+                   &pMax);
+            for (int z = pMin.z; z <= pMax.z; ++z)
+                for (int y = pMin.y; y <= pMax.y; ++y)
+                    for (int x = pMin.x; x <= pMax.x; ++x)
+                        func(hash(Point3i(x, y, z), hashSize));
+            return (1 + pMax.x - pMin.x) * (1 + pMax.y - pMin.y) * (1 + pMax.z - pMin.z);
+        };
+
+        // Count visible points overlapping each grid cell
+        for (std::atomic<int> &count : cellCounts)
+            count.store(0, std::memory_order_relaxed);
+        ParallelFor2D(pixelBounds, [&](Bounds2i tileBounds) {
+            for (Point2i pPixel : tileBounds) {
+                const SPPMPixel &pixel = pixels[pPixel];
+                if (!pixel.vp.beta)
+                    continue;
+                int nCells = forOverlappedCells(pixel, [&](int h) {
+                    cellCounts[h].fetch_add(1, std::memory_order_relaxed);
+                });
+                ReportValue(gridCellsPerVisiblePoint, nCells);
+            }
+        });
+
+        // Compute each cell's range in _gridEntries_ and reset counts for filling
+        cellOffsets[0] = 0;
+        for (int h = 0; h < hashSize; ++h) {
+            cellOffsets[h + 1] =
+                cellOffsets[h] + cellCounts[h].load(std::memory_order_relaxed);
+            cellCounts[h].store(0, std::memory_order_relaxed);
+        }
+        gridEntries.resize(cellOffsets[hashSize]);
+
+        // Add visible points to their cells' ranges of _gridEntries_
         ParallelFor2D(pixelBounds, [&](Bounds2i tileBounds) {
-            ScratchBuffer &scratchBuffer = perThreadScratchBuffers[ThreadIndex];
             for (Point2i pPixel : tileBounds) {
                 SPPMPixel &pixel = pixels[pPixel];
-                if (pixel.vp.beta) {
-                    // Add pixel's visible point to applicable grid cells
-                    Float radius = pixel.radius;
-                    Point3i pMin, pMax;
-                    ToGrid(pixel.vp.p - Vector3f(radius, radius, radius), gridBounds,
-                           gridRes, &pMin);
-                    ToGrid(pixel.vp.p + Vector3f(radius, radius, radius), gridBounds,
-                           gridRes, &pMax);
-                    for (int z = pMin.z; z <= pMax.z; ++z)
-                        for (int y = pMin.y; y <= pMax.y; ++y)
-                            for (int x = pMin.x; x <= pMax.x; ++x) {
-                                // Add visible point to grid cell $(x, y, z)$
-                                int h = hash(Point3i(x, y, z), hashSize);
-                                SPPMPixelListNode *node =
-                                    scratchBuffer.Alloc<SPPMPixelListNode>();
-                                node->pixel = &pixel;
-
-                                // Atomically add _node_ to the start of _grid[h]_'s
-                                // linked list
-                                node->next = grid[h];
-                                while (!grid[h].compare_exchange_weak(node->next, node))
-                                    ;
-                            }
-                    ReportValue(gridCellsPerVisiblePoint, (1 + pMax.x - pMin.x) *
-                                                              (1 + pMax.y - pMin.y) *
-                                                              (1 + pMax.z - pMin.z));
-                }
+                if (!pixel.vp.beta)
+                    continue;
+                forOverlappedCells(pixel, [&](int h) {
+                    int offset = cellOffsets[h] +
+                                 cellCounts[h].fetch_add(1, std::memory_order_relaxed);
+                    gridEntries[offset] = SPPMGridEntry{pixel.vp.p, pixel.radius, &pixel};
+                });
             }
         });
+        Float gridBuildSeconds = gridTimer.ElapsedSeconds();
+        ReportValue(sppmGridBuildSeconds, gridBuildSeconds);
 
         // Trace photons and accumulate contributions
+        Timer photonTimer;
         // Create per-thread scratch buffers for photon shooting
         std::vector<ScratchBuffer> photonShootScratchBuffers;
         for (int i = 0; i < MaxThreadIndex(); ++i)
             photonShootScratchBuffers.push_back(ScratchBuffer(65536));
 
+        // Define _depositPhotons_ lambda for buffered photon records
+        auto depositPhotons = [&](std::vector<SPPMPhotonRecord> &records) {
+            std::sort(records.begin(), records.end(),
+                      [](const SPPMPhotonRecord &a, const SPPMPhotonRecord &b) {
+                          return a.cell < b.cell;
+                      });
+            for (size_t runStart = 0; runStart < records.size();) {
+                // Find run of records _[runStart, runEnd)_ that share a grid cell
+                int h = records[runStart].cell;
+                size_t runEnd = runStart + 1;
+                while (runEnd < records.size() && records[runEnd].cell == h)
+                    ++runEnd;
+
+                // Add the run's photons to each visible point in cell _h_
+                for (int i = cellOffsets[h]; i < cellOffsets[h + 1]; ++i) {
+                    const SPPMGridEntry &entry = gridEntries[i];
+                    SampledSpectrum Phi(0.f);
+                    int M = 0;
+                    for (size_t r = runStart; r < runEnd; ++r) {
+                        ++visiblePointsChecked;
+                        const SPPMPhotonRecord &record = records[r];
+                        if (DistanceSquared(entry.p, record.p) > Sqr(entry.radius))
+                            continue;
+                        const SPPMPixel::VisiblePoint &vp = entry.pixel->vp;
+                        Phi += record.beta * vp.bsdf.f(vp.wo, record.wi);
+                        ++M;
+                    }
+                    // Update _pixel_ $\Phi$ and $M$ once for the whole run
+                    if (M > 0) {
+                        SPPMPixel &pixel = *entry.pixel;
+                        for (int j = 0; j < NSpectrumSamples; ++j)
+                            pixel.Phi[j].Add(Phi[j]);
+                        pixel.M += M;
+                    }
+                }
+                runStart = runEnd;
+            }
+            records.clear();
+        };
+
         ParallelFor(0, photonsPerIteration, [&](int64_t start, int64_t end) {
             ScratchBuffer &scratchBuffer = photonShootScratchBuffers[ThreadIndex];
+            std::vector<SPPMPhotonRecord> &photonRecords =
+                perThreadPhotonRecords[ThreadIndex];
             for (int64_t photonIndex = start; photonIndex < end; ++photonIndex) {
                 // Follow photon path for _photonIndex_
                 // Define sampling lambda functions for photon shooting
@@ -2980,24 +3464,13 @@ void SPPMIntegrator::Render() {
                         // Add photon contribution to nearby visible points
                         Point3i photonGridIndex;
                         if (ToGrid(isect.p(), gridBounds, gridRes, &photonGridIndex)) {
+                            // Buffer photon record for cell and deposit full batches
                             int h = hash(photonGridIndex, hashSize);
-                            // Add photon contribution to visible points in _grid[h]_
-                            for (SPPMPixelListNode *node =
-                                     grid[h].load(std::memory_order_relaxed);
-                                 node != nullptr; node = node->next) {
-                                ++visiblePointsChecked;
-                                SPPMPixel &pixel = *node->pixel;
-                                Float radius = pixel.radius;
-                                if (DistanceSquared(pixel.vp.p, isect.p()) >
-                                    radius * radius)
-                                    continue;
-                                // Update _pixel_ $\Phi$ and $M$ for nearby photon
-                                Vector3f wi = -photonRay.d;
-                                SampledSpectrum Phi =
-                                    beta * pixel.vp.bsdf.f(pixel.vp.wo, wi);
-                                for (int i = 0; i < NSpectrumSamples; ++i)
-                                    pixel.Phi[i].Add(Phi[i]);
-                                ++pixel.M;
+                            if (cellOffsets[h] < cellOffsets[h + 1]) {
+                                photonRecords.push_back(
+                                    SPPMPhotonRecord{h, isect.p(), -photonRay.d, beta});
+                                if (photonRecords.size() >= photonBatchSize)
+                                    depositPhotons(photonRecords);
                             }
                         }
                     }
@@ -3035,10 +3508,20 @@ void SPPMIntegrator::Render() {
                 scratchBuffer.Reset();
             }
         });
+        // Deposit remaining buffered photons
+        ParallelFor(0, perThreadPhotonRecords.size(), [&](int64_t i) {
+            depositPhotons(perThreadPhotonRecords[i]);
+        });
         // CAN CUT THIS??
         for (ScratchBuffer &scratchBuffer : perThreadScratchBuffers)
             scratchBuffer.Reset();
 
+        Float photonPassSeconds = photonTimer.ElapsedSeconds();
+        ReportValue(sppmPhotonPassSeconds, photonPassSeconds);
+        LOG_VERBOSE("SPPM iteration %d: grid with %d entries built in %.3fs, photon "
+                    "pass took %.3fs",
+                    iter, gridEntries.size(), gridBuildSeconds, photonPassSeconds);
+
         progress.Update();
         photonPaths += photonsPerIteration;
 
@@ -3218,9 +3701,10 @@ SampledSpectrum SPPMIntegrator::SampleLd(const SurfaceInteraction &intr, const B
 std::string SPPMIntegrator::ToString() const {
     return StringPrintf("[ SPPMIntegrator camera: %s initialSearchRadius: %f "
                         "nIterations: %d maxDepth: %d photonsPerIteration: %d "
-                        "regularize: %s colorSpace: %s digitPermutations:(elided) ]",
+                        "regularize: %s colorSpace: %s photonBatchSize: %d "
+                        "digitPermutations:(elided) ]",
                         camera, initialSearchRadius, nIterations, maxDepth,
-                        photonsPerIteration, regularize, *colorSpace);
+                        photonsPerIteration, regularize, *colorSpace, photonBatchSize);
 }
 
 std::unique_ptr<SPPMIntegrator> SPPMIntegrator::Create(
@@ -3235,9 +3719,13 @@ std::unique_ptr<SPPMIntegrator> SPPMIntegrator::Create(
         nIterations = std::max(1, nIterations / 16);
     bool regularize = parameters.GetOneBool("regularize", false);
     int seed = parameters.GetOneInt("seed", 0);
+    int photonBatchSize = parameters.GetOneInt("photonbatchsize", 4096);
+    if (photonBatchSize < 1)
+        ErrorExit(loc, "%d: \"photonbatchsize\" must be at least one.",
+                  photonBatchSize);
     return std::make_unique<SPPMIntegrator>(camera, aggregate, lights, nIterations,
                                             photonsPerIter, maxDepth, radius, regularize,
-                                            seed, colorSpace);
+                                            seed, colorSpace, photonBatchSize);
 }
 
 std::unique_ptr<Integrator> Integrator::Create(
@@ -3280,6 +3768,20 @@ std::unique_ptr<Integrator> Integrator::Create(
     if (!integrator)
         ErrorExit(loc, "%s: unable to create integrator.", name);
 
+    // Set up tile scheduling for integrators that render image tiles
+    if (ImageTileIntegrator *tileIntegrator =
+            dynamic_cast<ImageTileIntegrator *>(integrator.get())) {
+        std::string orderName = parameters.GetOneString("tileorder", "hilbert");
+        pstd::optional<TileOrder> order = ParseTileOrder(orderName);
+        if (!order)
+            ErrorExit(loc, "%s: unknown \"tileorder\".", orderName);
+        int tileSize = parameters.GetOneInt("tilesize", 0);
+        if (tileSize < 0)
+            ErrorExit(loc, "%d: \"tilesize\" must not be negative.", tileSize);
+        tileIntegrator->SetTileScheduling(*order, tileSize);
+        tileIntegrator->SetName(name);
+    }
+
     parameters.ReportUnused();
     return integrator;
 }
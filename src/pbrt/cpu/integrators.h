@@ -11,6 +11,7 @@
 #include <pbrt/base/sampler.h>
 #include <pbrt/bsdf.h>
 #include <pbrt/cameras.h>
+#include <pbrt/cpu/guiding.h>
 #include <pbrt/cpu/primitive.h>
 #include <pbrt/film.h>
 #include <pbrt/interaction.h>
@@ -98,10 +99,32 @@ class ImageTileIntegrator : public Integrator {
                                      SamplerHandle sampler,
                                      ScratchBuffer &scratchBuffer) = 0;
 
+    // Called before each wave of pixel samples is rendered
+    virtual void StartWave() {}
+    // Called after each wave of pixel samples, before the film is written
+    virtual void FinishWave() {}
+    // Returns whether the integrator has state that is updated from wave to
+    // wave, which requires rendering the image in waves of pixel samples
+    virtual bool RequiresWaves() const { return false; }
+    // Returns the maximum number of pixel samples rendered in a single wave
+    virtual int MaxWaveSamples() const { return 64; }
+
+    // A _tileSize_ of zero selects a size based on the image and thread count
+    void SetTileScheduling(TileOrder order, int size) {
+        tileOrder = order;
+        tileSize = size;
+    }
+    // Sets the scene file's name for the integrator, which is recorded in partial
+    // films so that "imgtool merge" can check how they may be combined
+    void SetName(const std::string &n) { name = n; }
+
   protected:
     // ImageTileIntegrator Protected Members
     CameraHandle camera;
     SamplerHandle samplerPrototype;
+    TileOrder tileOrder = TileOrder::Hilbert;
+    int tileSize = 0;
+    std::string name;
 };
 
 // RayIntegrator Definition
@@ -179,7 +202,8 @@ class PathIntegrator : public RayIntegrator {
     PathIntegrator(int maxDepth, CameraHandle camera, SamplerHandle sampler,
                    PrimitiveHandle aggregate, std::vector<LightHandle> lights,
                    Float rrThreshold = 1, const std::string &lightSampleStrategy = "bvh",
-                   bool regularize = false);
+                   bool regularize = false,
+                   std::unique_ptr<GuidingField> guidingField = nullptr);
 
     SampledSpectrum Li(RayDifferential ray, SampledWavelengths &lambda,
                        SamplerHandle sampler, ScratchBuffer &scratchBuffer,
@@ -191,9 +215,12 @@ class PathIntegrator : public RayIntegrator {
 
     std::string ToString() const;
 
+    void FinishWave();
+    bool RequiresWaves() const { return guidingField != nullptr; }
+
   private:
     // PathIntegrator Private Methods
-    SampledSpectrum SampleLd(const SurfaceInteraction &intr, const BSDF &bsdf,
+    SampledSpectrum SampleLd(const SurfaceInteraction &intr, const GuidedBSDF &bsdf,
                              SampledWavelengths &lambda, SamplerHandle sampler) const;
 
     // PathIntegrator Private Members
@@ -201,6 +228,8 @@ class PathIntegrator : public RayIntegrator {
     Float rrThreshold;
     LightSamplerHandle lightSampler;
     bool regularize;
+    // Path guiding is trained after each wave of samples when enabled
+    std::unique_ptr<GuidingField> guidingField;
 };
 
 // SimpleVolPathIntegrator Definition
@@ -233,13 +262,15 @@ class VolPathIntegrator : public RayIntegrator {
                       PrimitiveHandle aggregate, std::vector<LightHandle> lights,
                       Float rrThreshold = 1,
                       const std::string &lightSampleStrategy = "bvh",
-                      bool regularize = false)
+                      bool regularize = false,
+                      std::unique_ptr<GuidingField> guidingField = nullptr)
         : RayIntegrator(camera, sampler, aggregate, lights),
           maxDepth(maxDepth),
           rrThreshold(rrThreshold),
           lightSampler(
               LightSamplerHandle::Create(lightSampleStrategy, lights, Allocator())),
-          regularize(regularize) {}
+          regularize(regularize),
+          guidingField(std::move(guidingField)) {}
 
     SampledSpectrum Li(RayDifferential ray, SampledWavelengths &lambda,
                        SamplerHandle sampler, ScratchBuffer &scratchBuffer,
@@ -251,9 +282,12 @@ class VolPathIntegrator : public RayIntegrator {
 
     std::string ToString() const;
 
+    void FinishWave();
+    bool RequiresWaves() const { return guidingField != nullptr; }
+
   private:
     // VolPathIntegrator Private Methods
-    SampledSpectrum SampleLd(const Interaction &intr, const BSDF *bsdf,
+    SampledSpectrum SampleLd(const Interaction &intr, const GuidedBSDF *bsdf,
                              SampledWavelengths &lambda, SamplerHandle sampler,
                              const SampledSpectrum &beta,
                              const SampledSpectrum &pathPDF) const;
@@ -280,6 +314,8 @@ class VolPathIntegrator : public RayIntegrator {
     const Float rrThreshold;
     LightSamplerHandle lightSampler;
     bool regularize;
+    // Path guiding is trained after each wave of samples when enabled
+    std::unique_ptr<GuidingField> guidingField;
 };
 
 // AOIntegrator Definition
@@ -312,11 +348,14 @@ class LightPathIntegrator : public ImageTileIntegrator {
   public:
     // LightPathIntegrator Public Methods
     LightPathIntegrator(int maxDepth, CameraHandle camera, SamplerHandle sampler,
-                        PrimitiveHandle aggregate, std::vector<LightHandle> lights);
+                        PrimitiveHandle aggregate, std::vector<LightHandle> lights,
+                        int splatBatchSize = 4096);
 
     void EvaluatePixelSample(const Point2i &pPixel, int sampleIndex,
                              SamplerHandle sampler, ScratchBuffer &scratchBuffer);
 
+    void FinishWave();
+
     static std::unique_ptr<LightPathIntegrator> Create(
         const ParameterDictionary &parameters, CameraHandle camera, SamplerHandle sampler,
         PrimitiveHandle aggregate, std::vector<LightHandle> lights, const FileLoc *loc);
@@ -324,9 +363,24 @@ class LightPathIntegrator : public ImageTileIntegrator {
     std::string ToString() const;
 
   private:
+    // LightPathIntegrator Private Splat Definition
+    struct Splat {
+        Point2f pRaster;
+        SampledSpectrum L;
+        SampledWavelengths lambda;
+    };
+
+    // LightPathIntegrator Private Methods
+    void addSplat(const Point2f &pRaster, const SampledSpectrum &L,
+                  const SampledWavelengths &lambda);
+    void flushSplats(std::vector<Splat> &splats);
+
     // LightPathIntegrator Private Data
     int maxDepth;
     std::unique_ptr<PowerLightSampler> lightSampler;
+    // Film splats are buffered per thread and applied in pixel order
+    size_t splatBatchSize;
+    std::vector<std::vector<Splat>> threadSplats;
 };
 
 // BDPTIntegrator Definition
@@ -338,14 +392,17 @@ class BDPTIntegrator : public RayIntegrator {
                    std::vector<LightHandle> lights, int maxDepth,
                    bool visualizeStrategies, bool visualizeWeights,
                    const std::string &lightSampleStrategy = "power",
-                   bool regularize = false)
+                   bool regularize = false, int lightPathCacheSize = 0,
+                   int lightPathConnections = 1)
         : RayIntegrator(camera, sampler, aggregate, lights),
           maxDepth(maxDepth),
           visualizeStrategies(visualizeStrategies),
           visualizeWeights(visualizeWeights),
           lightSampleStrategy(lightSampleStrategy),
+          regularize(regularize),
           lightSampler(new PowerLightSampler(lights, Allocator())),
-          regularize(regularize) {}
+          lightPathCacheSize(lightPathCacheSize),
+          lightPathConnections(lightPathConnections) {}
 
     SampledSpectrum Li(RayDifferential ray, SampledWavelengths &lambda,
                        SamplerHandle sampler, ScratchBuffer &scratchBuffer,
@@ -358,6 +415,9 @@ class BDPTIntegrator : public RayIntegrator {
     std::string ToString() const;
 
     void Render();
+    void StartWave();
+    bool RequiresWaves() const { return lightPathCacheSize > 0; }
+    int MaxWaveSamples() const { return lightPathCacheSize > 0 ? 1 : 64; }
 
   private:
     // BDPTIntegrator Private Members
@@ -368,6 +428,18 @@ class BDPTIntegrator : public RayIntegrator {
     bool regularize;
     LightSamplerHandle lightSampler;
     mutable std::vector<FilmHandle> weightFilms;
+    // When _lightPathCacheSize_ is nonzero, light subpaths are traced once per
+    // pixel sample index and each camera subpath connects to
+    // _lightPathConnections_ of them.
+    static constexpr int LightPathCacheWavelengthGroups = 16;
+    static constexpr int LightPathCacheChunkSize = 64;
+    int lightPathCacheSize, lightPathConnections;
+    int waveIndex = 0;
+    std::vector<ScratchBuffer> lightPathScratchBuffers;
+    std::vector<Vertex *> cachedLightPaths;
+    std::vector<int> cachedLightPathLengths;
+    std::vector<SampledWavelengths> cachedLightPathLambdas;
+    SampledWavelengths cachedWavelengths[LightPathCacheWavelengthGroups];
 };
 
 // MLTIntegrator Definition
@@ -379,7 +451,8 @@ class MLTIntegrator : public Integrator {
     MLTIntegrator(CameraHandle camera, PrimitiveHandle aggregate,
                   std::vector<LightHandle> lights, int maxDepth, int nBootstrap,
                   int nChains, int mutationsPerPixel, Float sigma,
-                  Float largeStepProbability, bool regularize)
+                  Float largeStepProbability, bool regularize, int nReplicas = 1,
+                  Float temperatureRatio = 2, int swapInterval = 16)
         : Integrator(aggregate, lights),
           lightSampler(new PowerLightSampler(lights, Allocator())),
           camera(camera),
@@ -389,7 +462,10 @@ class MLTIntegrator : public Integrator {
           mutationsPerPixel(mutationsPerPixel),
           sigma(sigma),
           largeStepProbability(largeStepProbability),
-          regularize(regularize) {}
+          regularize(regularize),
+          nReplicas(nReplicas),
+          temperatureRatio(temperatureRatio),
+          swapInterval(swapInterval) {}
 
     void Render();
 
@@ -421,6 +497,11 @@ class MLTIntegrator : public Integrator {
     int mutationsPerPixel;
     Float sigma, largeStepProbability;
     int nChains;
+    // Each chain runs _nReplicas_ replicas at temperatures
+    // $1, r, r^2, \ldots$ for _temperatureRatio_ $r$; only the first one splats.
+    int nReplicas;
+    Float temperatureRatio;
+    int swapInterval;
 };
 
 // SPPMIntegrator Definition
@@ -430,7 +511,8 @@ class SPPMIntegrator : public Integrator {
     SPPMIntegrator(CameraHandle camera, PrimitiveHandle aggregate,
                    std::vector<LightHandle> lights, int nIterations,
                    int photonsPerIteration, int maxDepth, Float initialSearchRadius,
-                   bool regularize, int seed, const RGBColorSpace *colorSpace)
+                   bool regularize, int seed, const RGBColorSpace *colorSpace,
+                   int photonBatchSize = 4096)
         : Integrator(aggregate, lights),
           camera(camera),
           initialSearchRadius(initialSearchRadius),
@@ -441,7 +523,8 @@ class SPPMIntegrator : public Integrator {
                                   : camera.GetFilm().PixelBounds().Area()),
           regularize(regularize),
           colorSpace(colorSpace),
-          digitPermutationsSeed(seed) {}
+          digitPermutationsSeed(seed),
+          photonBatchSize(photonBatchSize) {}
 
     static std::unique_ptr<SPPMIntegrator> Create(const ParameterDictionary &parameters,
                                                   const RGBColorSpace *colorSpace,
@@ -469,6 +552,8 @@ class SPPMIntegrator : public Integrator {
     int maxDepth;
     int photonsPerIteration;
     const RGBColorSpace *colorSpace;
+    // Photon hits buffered per thread before they are sorted and deposited
+    size_t photonBatchSize;
 };
 
 }  // namespace pbrt
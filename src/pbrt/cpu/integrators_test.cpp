@@ -18,6 +18,7 @@
 #include <pbrt/util/color.h>
 #include <pbrt/util/colorspace.h>
 #include <pbrt/util/image.h>
+#include <pbrt/util/print.h>
 #include <pbrt/util/spectrum.h>
 #include <pbrt/util/vecmath.h>
 
@@ -385,9 +386,27 @@ std::vector<TestIntegrator> GetIntegrators() {
                                        ", " + scene.description,
                                    scene});
         }
+        for (auto &sampler : GetSamplers(resolution)) {
+            FilterHandle filter = new BoxFilter(Vector2f(0.5, 0.5));
+            RGBFilm *film = new RGBFilm(Sensor::CreateDefault(), resolution,
+                                        Bounds2i(Point2i(0, 0), resolution), filter, 1.,
+                                        inTestDir("test.exr"), 1., RGBColorSpace::sRGB);
+            PerspectiveCamera *camera = new PerspectiveCamera(
+                CameraTransform(identity), Bounds2f(Point2f(-1, -1), Point2f(1, 1)), 0.,
+                1., 0., 10., 45, film, nullptr);
+            const FilmHandle filmp = camera->GetFilm();
+
+            Integrator *integrator = new BDPTIntegrator(
+                camera, sampler.first, scene.aggregate, scene.lights, 6, false, false,
+                "power", false, 4096 /* light path cache */, 4 /* connections */);
+            integrators.push_back({integrator, filmp,
+                                   "BDPT light path cache, depth 8, Perspective, " +
+                                       sampler.second + ", " + scene.description,
+                                   scene});
+        }
 
         // MLT
-        {
+        for (int nReplicas : {1, 4}) {
             FilterHandle filter = new BoxFilter(Vector2f(0.5, 0.5));
             RGBFilm *film = new RGBFilm(Sensor::CreateDefault(), resolution,
                                         Bounds2i(Point2i(0, 0), resolution), filter, 1.,
@@ -401,10 +420,13 @@ std::vector<TestIntegrator> GetIntegrators() {
                 new MLTIntegrator(camera, scene.aggregate, scene.lights, 8 /* depth */,
                                   100000 /* n bootstrap */, 1000 /* nchains */,
                                   1024 /* mutations per pixel */, 0.01 /* sigma */,
-                                  0.3 /* large step prob */, false /* regularize */);
-            integrators.push_back({integrator, filmp,
-                                   "MLT, depth 8, Perspective, " + scene.description,
-                                   scene});
+                                  0.3 /* large step prob */, false /* regularize */,
+                                  nReplicas);
+            std::string replicas =
+                nReplicas > 1 ? StringPrintf("%d replicas, ", nReplicas) : "";
+            integrators.push_back(
+                {integrator, filmp,
+                 "MLT, depth 8, Perspective, " + replicas + scene.description, scene});
         }
     }
 
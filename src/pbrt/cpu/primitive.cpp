@@ -10,12 +10,21 @@
 #include <pbrt/shapes.h>
 #include <pbrt/textures.h>
 #include <pbrt/util/check.h>
+#include <pbrt/util/hash.h>
 #include <pbrt/util/log.h>
 #include <pbrt/util/taggedptr.h>
 #include <pbrt/util/vecmath.h>
 
+#include <atomic>
+
 namespace pbrt {
 
+STAT_PERCENT("Geometry/Interpolated transform cache hits", interpCacheHits,
+             interpCacheLookups);
+
+STAT_MEMORY_COUNTER("Memory/Instances", instanceMemory);
+STAT_COUNTER("Geometry/Instances", nInstances);
+
 Bounds3f PrimitiveHandle::Bounds() const {
     auto bounds = [&](auto ptr) { return ptr->Bounds(); };
     return DispatchCPU(bounds);
@@ -71,16 +80,20 @@ pstd::optional<ShapeIntersection> GeometricPrimitive::Intersect(const Ray &r,
         }
     }
 
+    InitializeInteraction(r, &si->intr);
+    return si;
+}
+
+void GeometricPrimitive::InitializeInteraction(const Ray &r,
+                                               SurfaceInteraction *intr) const {
     // Initialize _SurfaceInteraction_ after _Shape_ intersection
-    si->intr.areaLight = areaLight;
-    si->intr.material = material;
-    CHECK_GE(Dot(si->intr.n, si->intr.shading.n), 0.);
+    intr->areaLight = areaLight;
+    intr->material = material;
+    CHECK_GE(Dot(intr->n, intr->shading.n), 0.);
     if (mediumInterface.IsMediumTransition())
-        si->intr.mediumInterface = &mediumInterface;
+        intr->mediumInterface = &mediumInterface;
     else
-        si->intr.medium = r.medium;
-
-    return si;
+        intr->medium = r.medium;
 }
 
 bool GeometricPrimitive::IntersectP(const Ray &r, Float tMax) const {
@@ -121,14 +134,18 @@ pstd::optional<ShapeIntersection> SimplePrimitive::Intersect(const Ray &r,
         return {};
 
     CHECK_LT(si->tHit, 1.001 * tMax);
-    si->intr.areaLight = nullptr;
-    si->intr.material = material;
-
-    CHECK_GE(Dot(si->intr.n, si->intr.shading.n), 0.);
-    si->intr.medium = r.medium;
+    InitializeInteraction(r, &si->intr);
     return si;
 }
 
+void SimplePrimitive::InitializeInteraction(const Ray &r,
+                                            SurfaceInteraction *intr) const {
+    intr->areaLight = nullptr;
+    intr->material = material;
+    CHECK_GE(Dot(intr->n, intr->shading.n), 0.);
+    intr->medium = r.medium;
+}
+
 // TransformedPrimitive Method Definitions
 pstd::optional<ShapeIntersection> TransformedPrimitive::Intersect(const Ray &r,
                                                                   Float tMax) const {
@@ -151,17 +168,43 @@ bool TransformedPrimitive::IntersectP(const Ray &r, Float tMax) const {
 }
 
 // AnimatedPrimitive Method Definitions
+static std::atomic<uint64_t> nextAnimatedPrimitiveId{1};
+
 AnimatedPrimitive::AnimatedPrimitive(PrimitiveHandle p,
                                      const AnimatedTransform &renderFromPrimitive)
-    : primitive(p), renderFromPrimitive(renderFromPrimitive) {
+    : primitive(p), renderFromPrimitive(renderFromPrimitive),
+      id(nextAnimatedPrimitiveId++) {
     primitiveMemory += sizeof(*this);
     CHECK(renderFromPrimitive.IsAnimated());
 }
 
+Transform AnimatedPrimitive::Interpolate(Float time) const {
+    // Look up _time_ in the per-thread cache of interpolated transformations;
+    // rays along a path share their time, so most lookups hit.
+    struct CacheEntry {
+        uint64_t id = 0;
+        Float time;
+        Transform renderFromPrimitive;
+    };
+    static constexpr int CacheSize = 64;
+    static thread_local CacheEntry cache[CacheSize];
+    CacheEntry &entry = cache[Hash(id, time) % CacheSize];
+    ++interpCacheLookups;
+    if (entry.id == id && entry.time == time) {
+        ++interpCacheHits;
+        return entry.renderFromPrimitive;
+    }
+
+    entry.id = id;
+    entry.time = time;
+    entry.renderFromPrimitive = renderFromPrimitive.Interpolate(time);
+    return entry.renderFromPrimitive;
+}
+
 pstd::optional<ShapeIntersection> AnimatedPrimitive::Intersect(const Ray &r,
                                                                Float tMax) const {
     // Compute _ray_ after transformation by _renderFromPrimitive_
-    Transform interpRenderFromPrimitive = renderFromPrimitive.Interpolate(r.time);
+    Transform interpRenderFromPrimitive = Interpolate(r.time);
     Ray ray = interpRenderFromPrimitive.ApplyInverse(r, &tMax);
     pstd::optional<ShapeIntersection> si = primitive.Intersect(ray, tMax);
     if (!si)
@@ -174,8 +217,94 @@ pstd::optional<ShapeIntersection> AnimatedPrimitive::Intersect(const Ray &r,
 }
 
 bool AnimatedPrimitive::IntersectP(const Ray &r, Float tMax) const {
-    Ray ray = renderFromPrimitive.ApplyInverse(r, &tMax);
+    Ray ray = Interpolate(r.time).ApplyInverse(r, &tMax);
     return primitive.IntersectP(ray, tMax);
 }
 
+// InstancePrimitive Method Definitions
+InstancePrimitive::InstancePrimitive(PrimitiveHandle prototype,
+                                     const Transform &renderFromInstance)
+    : prototype(prototype) {
+    CHECK(IsSupported(renderFromInstance));
+    const SquareMatrix<4> &m = renderFromInstance.GetMatrix();
+    const SquareMatrix<4> &mInv = renderFromInstance.GetInverseMatrix();
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 4; ++j) {
+            this->renderFromInstance[i][j] = m[i][j];
+            instanceFromRender[i][j] = mInv[i][j];
+        }
+    instanceMemory += sizeof(*this);
+    ++nInstances;
+}
+
+bool InstancePrimitive::IsSupported(const Transform &renderFromInstance) {
+    return renderFromInstance.IsAffine();
+}
+
+Bounds3f InstancePrimitive::Bounds() const {
+    // Transform the prototype's child bounds individually for tighter bounds
+    Transform renderFromInstance = transform();
+    if (const BVHAccel *bvh = prototype.CastOrNullptr<BVHAccel>())
+        return bvh->Bounds(renderFromInstance);
+    return renderFromInstance(prototype.Bounds());
+}
+
+Ray InstancePrimitive::instanceRay(const Ray &r, Float *tMax) const {
+    // Apply affine instance-from-render transformation to ray origin
+    const Float(&m)[3][4] = instanceFromRender;
+    Float x = r.o.x, y = r.o.y, z = r.o.z;
+    Point3f p;
+    Vector3f pError, d;
+    for (int i = 0; i < 3; ++i) {
+        p[i] = (m[i][0] * x + m[i][1] * y) + (m[i][2] * z + m[i][3]);
+        pError[i] = gamma(3) * (std::abs(m[i][0] * x) + std::abs(m[i][1] * y) +
+                                std::abs(m[i][2] * z));
+        d[i] = m[i][0] * r.d.x + m[i][1] * r.d.y + m[i][2] * r.d.z;
+    }
+
+    // Offset ray origin to edge of error bounds and compute _tMax_ as
+    // _Transform::ApplyInverse()_ does
+    Point3fi o(p, pError);
+    Float lengthSquared = LengthSquared(d);
+    if (lengthSquared > 0) {
+        Vector3f oError(o.x.Width() / 2, o.y.Width() / 2, o.z.Width() / 2);
+        Float dt = Dot(Abs(d), oError) / lengthSquared;
+        o += d * dt;
+        *tMax -= dt;
+    }
+    return Ray(Point3f(o), d, r.time, r.medium);
+}
+
+Transform InstancePrimitive::transform() const {
+    // Rebuild the instance's _Transform_ from the stored matrix rows
+    const Float(&m)[3][4] = renderFromInstance;
+    const Float(&mInv)[3][4] = instanceFromRender;
+    return Transform(
+        SquareMatrix<4>(m[0][0], m[0][1], m[0][2], m[0][3], m[1][0], m[1][1], m[1][2],
+                        m[1][3], m[2][0], m[2][1], m[2][2], m[2][3], 0, 0, 0, 1),
+        SquareMatrix<4>(mInv[0][0], mInv[0][1], mInv[0][2], mInv[0][3], mInv[1][0],
+                        mInv[1][1], mInv[1][2], mInv[1][3], mInv[2][0], mInv[2][1],
+                        mInv[2][2], mInv[2][3], 0, 0, 0, 1));
+}
+
+pstd::optional<ShapeIntersection> InstancePrimitive::Intersect(const Ray &r,
+                                                               Float tMax) const {
+    // Transform ray to instance space and intersect with prototype
+    Ray ray = instanceRay(r, &tMax);
+    pstd::optional<ShapeIntersection> si = prototype.Intersect(ray, tMax);
+    if (!si)
+        return {};
+    CHECK_LT(si->tHit, 1.001 * tMax);
+
+    // Return transformed instance's intersection information
+    si->intr = transform()(si->intr);
+    CHECK_GE(Dot(si->intr.n, si->intr.shading.n), 0);
+    return si;
+}
+
+bool InstancePrimitive::IntersectP(const Ray &r, Float tMax) const {
+    Ray ray = instanceRay(r, &tMax);
+    return prototype.IntersectP(ray, tMax);
+}
+
 }  // namespace pbrt
@@ -26,13 +26,14 @@ class SimplePrimitive;
 class GeometricPrimitive;
 class TransformedPrimitive;
 class AnimatedPrimitive;
+class InstancePrimitive;
 class BVHAccel;
 class KdTreeAccel;
 
 // PrimitiveHandle Definition
 class PrimitiveHandle
     : public TaggedPointer<SimplePrimitive, GeometricPrimitive, TransformedPrimitive,
-                           AnimatedPrimitive, BVHAccel, KdTreeAccel> {
+                           AnimatedPrimitive, InstancePrimitive, BVHAccel, KdTreeAccel> {
   public:
     // Primitive Interface
     using TaggedPointer::TaggedPointer;
@@ -54,6 +55,9 @@ class GeometricPrimitive {
     Bounds3f Bounds() const;
     pstd::optional<ShapeIntersection> Intersect(const Ray &r, Float tMax) const;
     bool IntersectP(const Ray &r, Float tMax) const;
+    ShapeHandle GetShape() const { return shape; }
+    bool HasAlpha() const { return bool(alpha); }
+    void InitializeInteraction(const Ray &r, SurfaceInteraction *intr) const;
 
   private:
     // GeometricPrimitive Private Members
@@ -72,6 +76,8 @@ class SimplePrimitive {
     pstd::optional<ShapeIntersection> Intersect(const Ray &r, Float tMax) const;
     bool IntersectP(const Ray &r, Float tMax) const;
     SimplePrimitive(ShapeHandle shape, MaterialHandle material);
+    ShapeHandle GetShape() const { return shape; }
+    void InitializeInteraction(const Ray &r, SurfaceInteraction *intr) const;
 
   private:
     ShapeHandle shape;
@@ -110,11 +116,46 @@ class AnimatedPrimitive {
     Bounds3f Bounds() const {
         return renderFromPrimitive.MotionBounds(primitive.Bounds());
     }
+    Bounds3f Bounds(Float time0, Float time1) const {
+        return renderFromPrimitive.MotionBounds(primitive.Bounds(), time0, time1);
+    }
+
+    Float StartTime() const { return renderFromPrimitive.startTime; }
+    Float EndTime() const { return renderFromPrimitive.endTime; }
 
   private:
+    // AnimatedPrimitive Private Methods
+    Transform Interpolate(Float time) const;
+
     // AnimatedPrimitive Private Members
     PrimitiveHandle primitive;
     AnimatedTransform renderFromPrimitive;
+    uint64_t id;
+};
+
+// InstancePrimitive Definition
+// Compact record for an object instance with an affine transformation; only
+// the top three rows of the transformation's matrix and its inverse are
+// stored, without sharing them through the _TransformCache_.
+class InstancePrimitive {
+  public:
+    // InstancePrimitive Public Methods
+    InstancePrimitive(PrimitiveHandle prototype, const Transform &renderFromInstance);
+
+    static bool IsSupported(const Transform &renderFromInstance);
+
+    Bounds3f Bounds() const;
+    pstd::optional<ShapeIntersection> Intersect(const Ray &r, Float tMax) const;
+    bool IntersectP(const Ray &r, Float tMax) const;
+
+  private:
+    // InstancePrimitive Private Methods
+    Ray instanceRay(const Ray &r, Float *tMax) const;
+    Transform transform() const;
+
+    // InstancePrimitive Private Members
+    PrimitiveHandle prototype;
+    Float renderFromInstance[3][4], instanceFromRender[3][4];
 };
 
 }  // namespace pbrt
@@ -0,0 +1,119 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include <gtest/gtest.h>
+
+#include <pbrt/pbrt.h>
+
+#include <pbrt/cpu/accelerators.h>
+#include <pbrt/cpu/primitive.h>
+#include <pbrt/shapes.h>
+#include <pbrt/util/mesh.h>
+#include <pbrt/util/rng.h>
+#include <pbrt/util/sampling.h>
+#include <pbrt/util/transform.h>
+
+#include <vector>
+
+using namespace pbrt;
+
+// Affine instance transformations, including non-uniform scales and reflections
+static std::vector<Transform> InstanceTransforms() {
+    return {Transform(),
+            Translate(Vector3f(1.5, -2, 10)),
+            Translate(Vector3f(-3, 1, 2)) * Rotate(37, Vector3f(1, 2, -.5)) *
+                Scale(.25, 3, 1.5),
+            Scale(-1, 1, 1),
+            Rotate(-80, Vector3f(0, 1, 1)) * Scale(2, -.5, 3),
+            Translate(Vector3f(100, 0, -50)) * Scale(-2, -2, -2) *
+                Rotate(12, Vector3f(1, 0, 0))};
+}
+
+static void CheckInstanceMatchesTransformed(PrimitiveHandle prototype,
+                                            bool checkBoundsEqual) {
+    RNG rng;
+    for (const Transform &renderFromInstance : InstanceTransforms()) {
+        ASSERT_TRUE(InstancePrimitive::IsSupported(renderFromInstance));
+        TransformedPrimitive transformed(prototype, &renderFromInstance);
+        InstancePrimitive instance(prototype, renderFromInstance);
+
+        // Compare bounds
+        Bounds3f tb = transformed.Bounds(), ib = instance.Bounds();
+        if (checkBoundsEqual)
+            EXPECT_EQ(tb, ib);
+        else
+            EXPECT_EQ(tb, Union(tb, ib));
+
+        // Compare intersections for rays from around the bounds toward its interior
+        Point3f pCenter;
+        Float radius;
+        tb.BoundingSphere(&pCenter, &radius);
+        int nHits = 0;
+        for (int i = 0; i < 1000; ++i) {
+            Point2f u{rng.Uniform<Float>(), rng.Uniform<Float>()};
+            Point3f o = pCenter + 2 * radius * SampleUniformSphere(u);
+            Point3f pTarget(Lerp(rng.Uniform<Float>(), tb.pMin.x, tb.pMax.x),
+                            Lerp(rng.Uniform<Float>(), tb.pMin.y, tb.pMax.y),
+                            Lerp(rng.Uniform<Float>(), tb.pMin.z, tb.pMax.z));
+            Ray ray(o, pTarget - o);
+            Float tMax = (i & 1) ? Infinity : .75f;
+
+            pstd::optional<ShapeIntersection> ts = transformed.Intersect(ray, tMax);
+            pstd::optional<ShapeIntersection> is = instance.Intersect(ray, tMax);
+            EXPECT_EQ(transformed.IntersectP(ray, tMax), instance.IntersectP(ray, tMax));
+            ASSERT_EQ(ts.has_value(), is.has_value());
+            if (!ts)
+                continue;
+
+            ++nHits;
+            EXPECT_EQ(ts->tHit, is->tHit);
+            EXPECT_EQ(ts->intr.p(), is->intr.p());
+            EXPECT_EQ(ts->intr.pi.Error(), is->intr.pi.Error());
+            EXPECT_EQ(ts->intr.n, is->intr.n);
+            EXPECT_EQ(ts->intr.shading.n, is->intr.shading.n);
+            EXPECT_EQ(ts->intr.uv, is->intr.uv);
+            EXPECT_EQ(tb, Union(tb, Bounds3f(is->intr.p())));
+        }
+        EXPECT_GT(nHits, 100);
+    }
+}
+
+TEST(InstancePrimitive, SphereMatchesTransformed) {
+    Transform identity;
+    Sphere sphere(&identity, &identity, false, 1.5, -1.5, 1.5, 360);
+    SimplePrimitive prim(&sphere, nullptr);
+
+    CheckInstanceMatchesTransformed(&prim, true);
+}
+
+TEST(InstancePrimitive, MeshMatchesTransformed) {
+    // Create random triangle mesh under a BVH
+    RNG rng(17);
+    std::vector<Point3f> p;
+    std::vector<int> indices;
+    for (int i = 0; i < 256; ++i) {
+        Point3f c(Lerp(rng.Uniform<Float>(), -2, 2), Lerp(rng.Uniform<Float>(), -2, 2),
+                  Lerp(rng.Uniform<Float>(), -2, 2));
+        for (int j = 0; j < 3; ++j) {
+            indices.push_back(p.size());
+            p.push_back(c + Vector3f(Lerp(rng.Uniform<Float>(), -1, 1),
+                                     Lerp(rng.Uniform<Float>(), -1, 1),
+                                     Lerp(rng.Uniform<Float>(), -1, 1)));
+        }
+    }
+    Transform identity;
+    TriangleMesh mesh(identity, false, indices, p, {}, {}, {}, {});
+    pstd::vector<ShapeHandle> tris = Triangle::CreateTriangles(&mesh, Allocator());
+    std::vector<SimplePrimitive> simplePrims;
+    simplePrims.reserve(tris.size());
+    std::vector<PrimitiveHandle> prims;
+    for (ShapeHandle tri : tris) {
+        simplePrims.push_back(SimplePrimitive(tri, nullptr));
+        prims.push_back(&simplePrims.back());
+    }
+    BVHAccel bvh(std::move(prims));
+
+    // The BVH instance's bounds may be tighter than the transformed bounds
+    CheckInstanceMatchesTransformed(&bvh, false);
+}
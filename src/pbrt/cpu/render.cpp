@@ -17,6 +17,10 @@
 #include <pbrt/shapes.h>
 #include <pbrt/textures.h>
 #include <pbrt/util/colorspace.h>
+#include <pbrt/util/loopsubdiv.h>
+
+#include <algorithm>
+#include <functional>
 
 namespace pbrt {
 
@@ -109,14 +113,99 @@ void CPURender(ParsedScene &parsedScene) {
             return nullptr;
     };
 
+    // Returns whether the named float texture or any texture it uses is looked up
+    // using $(u,v)$ coordinates. Textures may only refer to ones defined before
+    // them, so the recursion terminates.
+    std::function<bool(const std::string &)> textureUsesUV =
+        [&](const std::string &name) {
+            auto iter = std::find_if(parsedScene.floatTextures.begin(),
+                                     parsedScene.floatTextures.end(),
+                                     [&](const auto &tex) { return tex.first == name; });
+            if (iter == parsedScene.floatTextures.end())
+                return false;
+            const TextureSceneEntity &tex = iter->second;
+            if (tex.texName == "ptex")
+                return true;
+            if (tex.texName == "bilerp" || tex.texName == "imagemap" ||
+                tex.texName == "dots" ||
+                (tex.texName == "checkerboard" &&
+                 tex.parameters.GetOneInt("dimension", 2) == 2))
+                return tex.parameters.GetOneString("mapping", "uv") == "uv";
+            for (const char *param : {"tex", "scale", "tex1", "tex2", "amount"})
+                if (std::string texName = tex.parameters.GetTexture(param);
+                    !texName.empty() && textureUsesUV(texName))
+                    return true;
+            return false;
+        };
+
+    // Subdivision surfaces are diced and displaced as they are created
+    auto getDisplacementTexture = [&](const SceneEntity &sh) -> FloatTextureHandle {
+        if (sh.name != "loopsubdiv")
+            return nullptr;
+        std::string displacementTexName = sh.parameters.GetTexture("displacement");
+        if (displacementTexName.empty())
+            return nullptr;
+        auto iter = floatTextures.find(displacementTexName);
+        if (iter == floatTextures.end())
+            ErrorExit(&sh.loc,
+                      "%s: couldn't find float texture for \"displacement\" parameter.",
+                      displacementTexName);
+        // Subdivision surfaces have no $(u,v)$ parameterization to look textures up with
+        if (textureUsesUV(displacementTexName))
+            Warning(&sh.loc,
+                    "%s: displacement texture is looked up using (u,v), which "
+                    "subdivision surfaces don't have. Its value at (0,0) will be used "
+                    "everywhere. Use a 3D or non-\"uv\" mapping instead.",
+                    displacementTexName);
+        return iter->second;
+    };
+
+    // Find pixel footprint at the image center for choosing dicing rates
+    SubdivisionDicing dicing;
+    CameraSample cameraSample;
+    cameraSample.pFilm = Point2f(camera.GetFilm().FullResolution()) / 2;
+    cameraSample.pLens = Point2f(0.5, 0.5);
+    cameraSample.time = 0.5;
+    SampledWavelengths lambda = SampledWavelengths::SampleXYZ(0.5);
+    if (pstd::optional<CameraRayDifferential> crd =
+            camera.GenerateRayDifferential(cameraSample, lambda);
+        crd && crd->ray.hasDifferentials) {
+        const RayDifferential &ray = crd->ray;
+        dicing.pCamera = ray.o;
+        dicing.pixelSpread = Distance(ray.o, ray.rxOrigin);
+        dicing.pixelAngle = AngleBetween(Normalize(ray.d), Normalize(ray.rxDirection));
+    }
+    // Bound the visible region by planes through the rays at the image corners
+    if (camera.Is<PerspectiveCamera>() || camera.Is<OrthographicCamera>()) {
+        Bounds2f filmBounds(camera.GetFilm().PixelBounds());
+        cameraSample.pFilm = filmBounds.Lerp(Point2f(0.5, 0.5));
+        Ray centerRay = camera.GenerateRay(cameraSample, lambda).ray;
+        Point3f pInside = centerRay.o + centerRay.d;
+        Ray cornerRays[4];
+        for (int i = 0; i < 4; ++i) {
+            // Visit corners in order around the image
+            cameraSample.pFilm = filmBounds.Corner(i < 2 ? i : 5 - i);
+            cornerRays[i] = camera.GenerateRay(cameraSample, lambda).ray;
+        }
+        for (int i = 0; i < 4; ++i) {
+            const Ray &r0 = cornerRays[i], &r1 = cornerRays[(i + 1) % 4];
+            Vector3f n = Cross(r0.d, (r1.o + r1.d) - r0.o);
+            if (LengthSquared(n) == 0)
+                continue;
+            if (Dot(pInside - r0.o, n) < 0)
+                n = -n;
+            dicing.frustum.push_back(std::make_pair(r0.o, n));
+        }
+    }
+
     // Non-animated shapes
     auto CreatePrimitivesForShapes =
         [&](const std::vector<ShapeSceneEntity> &shapes) -> std::vector<PrimitiveHandle> {
         std::vector<PrimitiveHandle> primitives;
         for (const auto &sh : shapes) {
-            pstd::vector<ShapeHandle> shapes =
-                ShapeHandle::Create(sh.name, sh.renderFromObject, sh.objectFromRender,
-                                    sh.reverseOrientation, sh.parameters, &sh.loc, alloc);
+            pstd::vector<ShapeHandle> shapes = ShapeHandle::Create(
+                sh.name, sh.renderFromObject, sh.objectFromRender, sh.reverseOrientation,
+                sh.parameters, &sh.loc, alloc, &dicing, getDisplacementTexture(sh));
             if (shapes.empty())
                 continue;
 
@@ -137,10 +226,22 @@ void CPURender(ParsedScene &parsedScene) {
             MediumInterface mi(findMedium(sh.insideMedium, &sh.loc),
                                findMedium(sh.outsideMedium, &sh.loc));
 
+            // Possibly create a single area light for an emissive mesh
+            LightHandle meshLight = nullptr;
+            if (sh.lightIndex != -1 && shapes.size() > 1) {
+                CHECK_LT(sh.lightIndex, parsedScene.areaLights.size());
+                const auto &areaLightEntity = parsedScene.areaLights[sh.lightIndex];
+                meshLight = LightHandle::CreateMeshArea(
+                    areaLightEntity.name, areaLightEntity.parameters,
+                    *sh.renderFromObject, mi, shapes, &areaLightEntity.loc, Allocator{});
+                if (meshLight)
+                    lights.push_back(meshLight);
+            }
+
             for (auto &s : shapes) {
                 // Possibly create area light for shape
-                LightHandle areaHandle = nullptr;
-                if (sh.lightIndex != -1) {
+                LightHandle areaHandle = meshLight;
+                if (sh.lightIndex != -1 && !meshLight) {
                     CHECK_LT(sh.lightIndex, parsedScene.areaLights.size());
                     const auto &areaLightEntity = parsedScene.areaLights[sh.lightIndex];
 
@@ -172,9 +273,10 @@ void CPURender(ParsedScene &parsedScene) {
         primitives.reserve(shapes.size());
 
         for (const auto &sh : shapes) {
-            pstd::vector<ShapeHandle> shapes =
-                ShapeHandle::Create(sh.name, sh.identity, sh.identity,
-                                    sh.reverseOrientation, sh.parameters, &sh.loc, alloc);
+            // Dicing rates can't be found from the camera for animated shapes
+            pstd::vector<ShapeHandle> shapes = ShapeHandle::Create(
+                sh.name, sh.identity, sh.identity, sh.reverseOrientation, sh.parameters,
+                &sh.loc, alloc, nullptr, getDisplacementTexture(sh));
             if (shapes.empty())
                 continue;
 
@@ -267,6 +369,7 @@ void CPURender(ParsedScene &parsedScene) {
     }
 
     // Instances
+    size_t nCompactInstances = 0;
     for (const auto &inst : parsedScene.instances) {
         auto iter = instanceDefinitions.find(inst.name);
         if (iter == instanceDefinitions.end())
@@ -276,13 +379,22 @@ void CPURender(ParsedScene &parsedScene) {
             // empty instance
             continue;
 
-        if (inst.renderFromInstance)
+        if (inst.affineRenderFromInstance) {
+            primitives.push_back(
+                new InstancePrimitive(iter->second, *inst.affineRenderFromInstance));
+            ++nCompactInstances;
+        } else if (inst.renderFromInstance)
             primitives.push_back(
                 new TransformedPrimitive(iter->second, inst.renderFromInstance));
         else
             primitives.push_back(
                 new AnimatedPrimitive(iter->second, inst.renderFromInstanceAnim));
     }
+    if (nCompactInstances > 0)
+        LOG_VERBOSE("Created %d compact instances (%d bytes each)", nCompactInstances,
+                    sizeof(InstancePrimitive));
+    // Free instance entities, including affine instance transformations
+    std::vector<InstanceSceneEntity>().swap(parsedScene.instances);
 
     // Accelerator
     PrimitiveHandle accel = nullptr;
@@ -319,6 +431,33 @@ void CPURender(ParsedScene &parsedScene) {
                 "other than R, G, B will be zero.",
                 parsedScene.integrator.name);
 
+    if (camera.GetFilm().StreamingTileSize() > 0 &&
+        (parsedScene.integrator.name == "bdpt" || parsedScene.integrator.name == "mlt" ||
+         parsedScene.integrator.name == "lightpath" ||
+         parsedScene.integrator.name == "sppm"))
+        ErrorExit(&parsedScene.film.loc,
+                  "The \"%s\" integrator doesn't support films that stream tiles to "
+                  "disk.",
+                  parsedScene.integrator.name);
+
+    if ((Options->sampleRange || Options->writePartialFilm) &&
+        (parsedScene.integrator.name == "mlt" || parsedScene.integrator.name == "sppm"))
+        ErrorExit(&parsedScene.integrator.loc,
+                  "The \"%s\" integrator doesn't support --sample-range or "
+                  "--partial-film.",
+                  parsedScene.integrator.name);
+    if (Options->writePartialFilm &&
+        (parsedScene.integrator.name == "bdpt" ||
+         parsedScene.integrator.name == "lightpath") &&
+        camera.GetFilm().PixelBounds() !=
+            Bounds2i(Point2i(0, 0), camera.GetFilm().FullResolution()))
+        Warning(&parsedScene.integrator.loc,
+                "The \"%s\" integrator splats to pixels outside the rendered pixel "
+                "bounds, which are discarded. \"imgtool merge\" won't merge partial "
+                "films with different pixel bounds; use --sample-range to divide the "
+                "rendering instead.",
+                parsedScene.integrator.name);
+
     if (haveSubsurface && parsedScene.integrator.name != "volpath")
         Warning("Some objects in the scene have subsurface scattering, which is "
                 "not supported by the %s integrator. Use the \"volpath\" integrator "
@@ -18,6 +18,7 @@
 #include <pbrt/util/color.h>
 #include <pbrt/util/colorspace.h>
 #include <pbrt/util/error.h>
+#include <pbrt/util/file.h>
 #include <pbrt/util/image.h>
 #include <pbrt/util/lowdiscrepancy.h>
 #include <pbrt/util/memory.h>
@@ -58,6 +59,31 @@ std::string FilmHandle::GetFilename() const {
     return DispatchCPU(get);
 }
 
+int FilmHandle::StreamingTileSize() const {
+    auto size = [&](auto ptr) { return ptr->StreamingTileSize(); };
+    return DispatchCPU(size);
+}
+
+void FilmHandle::BeginStreaming(ImageMetadata metadata) {
+    auto begin = [&](auto ptr) { return ptr->BeginStreaming(metadata); };
+    return DispatchCPU(begin);
+}
+
+void FilmHandle::StartTile(const Bounds2i &tileBounds) {
+    auto start = [&](auto ptr) { return ptr->StartTile(tileBounds); };
+    return DispatchCPU(start);
+}
+
+void FilmHandle::FinishTile(const Bounds2i &tileBounds) {
+    auto finish = [&](auto ptr) { return ptr->FinishTile(tileBounds); };
+    return DispatchCPU(finish);
+}
+
+void FilmHandle::EndStreaming() {
+    auto end = [&](auto ptr) { return ptr->EndStreaming(); };
+    return DispatchCPU(end);
+}
+
 // FilmBase Method Definitions
 std::string FilmBase::BaseToString() const {
     return StringPrintf("fullResolution: %s diagonal: %f filter: %s filename: %s "
@@ -521,6 +547,30 @@ Sensor::Sensor(SpectrumHandle r_bar, SpectrumHandle g_bar, SpectrumHandle b_bar,
     }
 }
 
+// Partial Film Function Definitions
+std::vector<std::string> PartialFilmChannelNames() {
+    return {"R.sum", "G.sum", "B.sum", "weightSum", "R.splat", "G.splat", "B.splat"};
+}
+
+// _getSums_ returns a pixel's weighted sample sum, weight sum, and splat sum,
+// transformed to the output color space.
+template <typename F>
+static Image MakePartialImage(const Bounds2i &bounds, F getSums) {
+    Image image(PixelFormat::Float, Point2i(bounds.Diagonal()),
+                PartialFilmChannelNames());
+    ParallelFor2D(bounds, [&](Point2i p) {
+        RGB rgbSum, splatSum;
+        Float weightSum;
+        getSums(p, &rgbSum, &weightSum, &splatSum);
+
+        Point2i pOffset(p.x - bounds.pMin.x, p.y - bounds.pMin.y);
+        Float values[7] = {rgbSum.r,   rgbSum.g,   rgbSum.b,  weightSum,
+                           splatSum.r, splatSum.g, splatSum.b};
+        image.SetChannels(pOffset, values);
+    });
+    return image;
+}
+
 STAT_MEMORY_COUNTER("Memory/Film pixels", filmPixelMemory);
 
 // RGBFilm Method Definitions
@@ -528,9 +578,9 @@ RGBFilm::RGBFilm(const Sensor *sensor, const Point2i &resolution,
                  const Bounds2i &pixelBounds, FilterHandle filter, Float diagonal,
                  const std::string &filename, Float scale,
                  const RGBColorSpace *colorSpace, Float maxComponentValue, bool writeFP16,
-                 Allocator allocator)
+                 int streamTileSize, Allocator allocator)
     : FilmBase(resolution, pixelBounds, filter, diagonal, sensor, filename),
-      pixels(pixelBounds, allocator),
+      pixels(streamTileSize > 0 ? Bounds2i() : pixelBounds, allocator),
       scale(scale),
       colorSpace(colorSpace),
       maxComponentValue(maxComponentValue),
@@ -538,7 +588,11 @@ RGBFilm::RGBFilm(const Sensor *sensor, const Point2i &resolution,
     filterIntegral = filter.Integral();
     CHECK(!pixelBounds.IsEmpty());
     CHECK(colorSpace != nullptr);
-    filmPixelMemory += pixelBounds.Area() * sizeof(Pixel);
+    if (streamTileSize > 0) {
+        tileStream = allocator.new_object<FilmTileStream<Pixel>>(streamTileSize);
+        filmPixelMemory += tileStream->BytesAllocated();
+    } else
+        filmPixelMemory += pixelBounds.Area() * sizeof(Pixel);
     outputRGBFromCameraRGB = colorSpace->RGBFromXYZ * sensor->XYZFromCameraRGB;
 }
 
@@ -549,6 +603,7 @@ SampledWavelengths RGBFilm::SampleWavelengths(Float u) const {
 void RGBFilm::AddSplat(const Point2f &p, SampledSpectrum v,
                        const SampledWavelengths &lambda) {
     CHECK(!v.HasNaNs());
+    CHECK(!tileStream);
     // First convert to sensor exposure, H, then to camera RGB
     SampledSpectrum H = v * sensor->ImagingRatio();
     RGB rgb = sensor->ToCameraRGB(H, lambda);
@@ -575,7 +630,12 @@ void RGBFilm::AddSplat(const Point2f &p, SampledSpectrum v,
 }
 
 void RGBFilm::WriteImage(ImageMetadata metadata, Float splatScale) {
-    Image image = GetImage(&metadata, splatScale);
+    if (tileStream)
+        ErrorExit("%s: film is streaming tiles to disk; the full image isn't "
+                  "available.",
+                  filename);
+    Image image = Options->writePartialFilm ? GetPartialImage(&metadata)
+                                            : GetImage(&metadata, splatScale);
     LOG_VERBOSE("Writing image %s with bounds %s", filename, pixelBounds);
     image.Write(filename, metadata);
 }
@@ -607,10 +667,71 @@ Image RGBFilm::GetImage(ImageMetadata *metadata, Float splatScale) {
     return image;
 }
 
+Image RGBFilm::GetPartialImage(ImageMetadata *metadata) {
+    LOG_VERBOSE("Converting image to unnormalized partial film sums");
+    Image image = MakePartialImage(pixelBounds, [&](Point2i p, RGB *rgbSum,
+                                                    Float *weightSum, RGB *splatSum) {
+        // Apply the linear steps of _GetPixelRGB()_ to the pixel's sums
+        const Pixel &pixel = pixels[p];
+        RGB rgb(pixel.rgbSum[0], pixel.rgbSum[1], pixel.rgbSum[2]);
+        RGB splat(pixel.splatRGB[0], pixel.splatRGB[1], pixel.splatRGB[2]);
+        *rgbSum = scale * Mul<RGB>(outputRGBFromCameraRGB, rgb);
+        *weightSum = pixel.weightSum;
+        *splatSum = scale * Mul<RGB>(outputRGBFromCameraRGB, splat / filterIntegral);
+    });
+
+    metadata->pixelBounds = pixelBounds;
+    metadata->fullResolution = fullResolution;
+    metadata->colorSpace = colorSpace;
+    return image;
+}
+
+void RGBFilm::BeginStreaming(ImageMetadata metadata) {
+    CHECK(tileStream && !tileStream->writer);
+    metadata.pixelBounds = pixelBounds;
+    metadata.fullResolution = fullResolution;
+    metadata.colorSpace = colorSpace;
+    PixelFormat format = writeFP16 ? PixelFormat::Half : PixelFormat::Float;
+    std::vector<std::string> channels = {"R", "G", "B"};
+    tileStream->writer = std::make_unique<TiledImageWriter>(
+        filename, metadata, channels, format, tileStream->TileSize());
+}
+
+void RGBFilm::StartTile(const Bounds2i &tileBounds) {
+    CHECK(tileStream);
+    tileStream->StartTile(tileBounds);
+}
+
+void RGBFilm::FinishTile(const Bounds2i &tileBounds) {
+    // Convert the tile's pixels to an image and hand it to the writer
+    PixelFormat format = writeFP16 ? PixelFormat::Half : PixelFormat::Float;
+    Image image(format, Point2i(tileBounds.Diagonal()), {"R", "G", "B"});
+    double varianceSum = 0;
+    for (Point2i p : tileBounds) {
+        RGB rgb = GetPixelRGB(p);
+        Point2i pOffset(p.x - tileBounds.pMin.x, p.y - tileBounds.pMin.y);
+        image.SetChannels(pOffset, {rgb[0], rgb[1], rgb[2]});
+        varianceSum += LookupPixel(p).varianceEstimator.Variance();
+    }
+    tileStream->writer->WriteTile(image, tileBounds);
+    tileStream->varianceSum.Add(varianceSum);
+
+    // Release the tile's pixel storage
+    tileStream->FinishTile();
+}
+
+void RGBFilm::EndStreaming() {
+    CHECK(tileStream);
+    LOG_VERBOSE("Finished streaming image %s with bounds %s", filename, pixelBounds);
+    tileStream->writer->Close(tileStream->varianceSum / pixelBounds.Area());
+    tileStream->writer.reset();
+}
+
 std::string RGBFilm::ToString() const {
     return StringPrintf("[ RGBFilm %s scale: %f colorSpace: %s maxComponentValue: %f "
-                        "writeFP16: %s ]",
-                        BaseToString(), scale, *colorSpace, maxComponentValue, writeFP16);
+                        "writeFP16: %s streamTileSize: %d ]",
+                        BaseToString(), scale, *colorSpace, maxComponentValue, writeFP16,
+                        StreamingTileSize());
 }
 
 RGBFilm *RGBFilm::Create(const ParameterDictionary &parameters, FilterHandle filter,
@@ -708,6 +829,22 @@ RGBFilm *RGBFilm::Create(const ParameterDictionary &parameters, FilterHandle fil
     Float diagonal = parameters.GetOneFloat("diagonal", 35.);
     Float maxComponentValue = parameters.GetOneFloat("maxcomponentvalue", Infinity);
     bool writeFP16 = parameters.GetOneBool("savefp16", true);
+    int streamTileSize = 0;
+    if (parameters.GetOneBool("streamtiles", false)) {
+        // Render in buckets and write each one to disk as soon as it's done
+        streamTileSize = parameters.GetOneInt("tilesize", 32);
+        if (streamTileSize <= 0)
+            ErrorExit(loc, "%d: \"tilesize\" must be positive.", streamTileSize);
+        if (!HasExtension(filename, "exr"))
+            ErrorExit(loc, "%s: \"streamtiles\" requires an EXR output file.",
+                      filename);
+    }
+    if (Options->writePartialFilm) {
+        if (streamTileSize > 0)
+            ErrorExit(loc, "\"streamtiles\" can't be used with --partial-film.");
+        if (!HasExtension(filename, "exr"))
+            ErrorExit(loc, "%s: --partial-film requires an EXR output file.", filename);
+    }
 
     // Imaging ratio parameters
     // The defaults here represent a "passthrough" setup such that the imaging
@@ -728,7 +865,7 @@ RGBFilm *RGBFilm::Create(const ParameterDictionary &parameters, FilterHandle fil
 
     return alloc.new_object<RGBFilm>(sensor, fullResolution, pixelBounds, filter,
                                      diagonal, filename, scale, colorSpace,
-                                     maxComponentValue, writeFP16, alloc);
+                                     maxComponentValue, writeFP16, streamTileSize, alloc);
 }
 
 // GBufferFilm Method Definitions
@@ -744,7 +881,7 @@ void GBufferFilm::AddSample(const Point2i &pFilm, SampledSpectrum L,
         rgb *= maxComponentValue / m;
     }
 
-    Pixel &p = pixels[pFilm];
+    Pixel &p = LookupPixel(pFilm);
     if (visibleSurface && *visibleSurface) {
         // Update variance estimates.
         // TODO: store channels independently?
@@ -774,16 +911,20 @@ GBufferFilm::GBufferFilm(const Sensor *sensor, const Point2i &resolution,
                          const Bounds2i &pixelBounds, FilterHandle filter, Float diagonal,
                          const std::string &filename, Float scale,
                          const RGBColorSpace *colorSpace, Float maxComponentValue,
-                         bool writeFP16, Allocator alloc)
+                         bool writeFP16, int streamTileSize, Allocator alloc)
     : FilmBase(resolution, pixelBounds, filter, diagonal, sensor, filename),
-      pixels(pixelBounds, alloc),
+      pixels(streamTileSize > 0 ? Bounds2i() : pixelBounds, alloc),
       scale(scale),
       colorSpace(colorSpace),
       maxComponentValue(maxComponentValue),
       writeFP16(writeFP16),
       filterIntegral(filter.Integral()) {
     CHECK(!pixelBounds.IsEmpty());
-    filmPixelMemory += pixelBounds.Area() * sizeof(Pixel);
+    if (streamTileSize > 0) {
+        tileStream = alloc.new_object<FilmTileStream<Pixel>>(streamTileSize);
+        filmPixelMemory += tileStream->BytesAllocated();
+    } else
+        filmPixelMemory += pixelBounds.Area() * sizeof(Pixel);
     outputRGBFromCameraRGB = colorSpace->RGBFromXYZ * sensor->XYZFromCameraRGB;
 }
 
@@ -795,6 +936,7 @@ void GBufferFilm::AddSplat(const Point2f &p, SampledSpectrum v,
                            const SampledWavelengths &lambda) {
     // NOTE: same code as RGBFilm::AddSplat()...
     CHECK(!v.HasNaNs());
+    CHECK(!tileStream);
     // First convert to sensor exposure, H, then to camera RGB
     SampledSpectrum H = v * sensor->ImagingRatio();
     RGB rgb = sensor->ToCameraRGB(H, lambda);
@@ -817,7 +959,12 @@ void GBufferFilm::AddSplat(const Point2f &p, SampledSpectrum v,
 }
 
 void GBufferFilm::WriteImage(ImageMetadata metadata, Float splatScale) {
-    Image image = GetImage(&metadata, splatScale);
+    if (tileStream)
+        ErrorExit("%s: film is streaming tiles to disk; the full image isn't "
+                  "available.",
+                  filename);
+    Image image = Options->writePartialFilm ? GetPartialImage(&metadata)
+                                            : GetImage(&metadata, splatScale);
     LOG_VERBOSE("Writing image %s with bounds %s", filename, pixelBounds);
     image.Write(filename, metadata);
 }
@@ -825,30 +972,54 @@ void GBufferFilm::WriteImage(ImageMetadata metadata, Float splatScale) {
 Image GBufferFilm::GetImage(ImageMetadata *metadata, Float splatScale) {
     // Convert image to RGB and compute final pixel values
     LOG_VERBOSE("Converting image to RGB and computing final weighted pixel values");
+    Image image = ConvertPixels(pixelBounds, splatScale);
+
+    metadata->pixelBounds = pixelBounds;
+    metadata->fullResolution = fullResolution;
+    metadata->colorSpace = colorSpace;
+
+    Float varianceSum = 0;
+    for (Point2i p : pixelBounds) {
+        const Pixel &pixel = pixels[p];
+        varianceSum += pixel.rgbVarianceEstimator.Variance();
+    }
+    metadata->estimatedVariance = varianceSum / pixelBounds.Area();
+
+    return image;
+}
+
+Image GBufferFilm::GetPartialImage(ImageMetadata *metadata) {
+    LOG_VERBOSE("Converting image to unnormalized partial film sums");
+    Image image = MakePartialImage(pixelBounds, [&](Point2i p, RGB *rgbSum,
+                                                    Float *weightSum, RGB *splatSum) {
+        const Pixel &pixel = pixels[p];
+        RGB rgb(pixel.rgbSum[0], pixel.rgbSum[1], pixel.rgbSum[2]);
+        RGB splat(pixel.splatRGB[0], pixel.splatRGB[1], pixel.splatRGB[2]);
+        *rgbSum = scale * rgb;
+        *weightSum = pixel.weightSum;
+        *splatSum = scale * splat / filterIntegral;
+    });
+
+    metadata->pixelBounds = pixelBounds;
+    metadata->fullResolution = fullResolution;
+    metadata->colorSpace = colorSpace;
+    return image;
+}
+
+static std::vector<std::string> GBufferChannelNames() {
+    return {"R",        "G",           "B",
+            "Albedo.R", "Albedo.G",    "Albedo.B",
+            "Px",       "Py",          "Pz",
+            "dzdx",     "dzdy",        "Nx",
+            "Ny",       "Nz",          "Nsx",
+            "Nsy",      "Nsz",         "materialId.R",
+            "materialId.G", "materialId.B", "rgbVariance",
+            "rgbRelativeVariance"};
+}
+
+Image GBufferFilm::ConvertPixels(const Bounds2i &bounds, Float splatScale) {
     PixelFormat format = writeFP16 ? PixelFormat::Half : PixelFormat::Float;
-    Image image(format, Point2i(pixelBounds.Diagonal()),
-                {"R",
-                 "G",
-                 "B",
-                 "Albedo.R",
-                 "Albedo.G",
-                 "Albedo.B",
-                 "Px",
-                 "Py",
-                 "Pz",
-                 "dzdx",
-                 "dzdy",
-                 "Nx",
-                 "Ny",
-                 "Nz",
-                 "Nsx",
-                 "Nsy",
-                 "Nsz",
-                 "materialId.R",
-                 "materialId.G",
-                 "materialId.B",
-                 "rgbVariance",
-                 "rgbRelativeVariance"});
+    Image image(format, Point2i(bounds.Diagonal()), GBufferChannelNames());
 
     ImageChannelDesc rgbDesc = image.GetChannelDesc({"R", "G", "B"});
     ImageChannelDesc pDesc = image.GetChannelDesc({"Px", "Py", "Pz"});
@@ -860,8 +1031,8 @@ Image GBufferFilm::GetImage(ImageMetadata *metadata, Float splatScale) {
     ImageChannelDesc varianceDesc =
         image.GetChannelDesc({"rgbVariance", "rgbRelativeVariance"});
 
-    ParallelFor2D(pixelBounds, [&](Point2i p) {
-        Pixel &pixel = pixels[p];
+    auto convertPixel = [&](Point2i p) {
+        const Pixel &pixel = LookupPixel(p);
         RGB rgb(pixel.rgbSum[0], pixel.rgbSum[1], pixel.rgbSum[2]);
         RGB albedoRgb(pixel.albedoSum[0], pixel.albedoSum[1], pixel.albedoSum[2]);
 
@@ -883,7 +1054,7 @@ Image GBufferFilm::GetImage(ImageMetadata *metadata, Float splatScale) {
 
         rgb *= scale;
 
-        Point2i pOffset(p.x - pixelBounds.pMin.x, p.y - pixelBounds.pMin.y);
+        Point2i pOffset(p.x - bounds.pMin.x, p.y - bounds.pMin.y);
         image.SetChannels(pOffset, rgbDesc, {rgb[0], rgb[1], rgb[2]});
         image.SetChannels(pOffset, albedoRgbDesc,
                           {albedoRgb[0], albedoRgb[1], albedoRgb[2]});
@@ -899,26 +1070,54 @@ Image GBufferFilm::GetImage(ImageMetadata *metadata, Float splatScale) {
         image.SetChannels(pOffset, varianceDesc,
                           {pixel.rgbVarianceEstimator.Variance(),
                            pixel.rgbVarianceEstimator.RelativeVariance()});
-    });
+    };
+    // A streamed tile is only visible to the thread that rendered it, so it
+    // must be converted serially.
+    if (tileStream)
+        for (Point2i p : bounds)
+            convertPixel(p);
+    else
+        ParallelFor2D(bounds, convertPixel);
 
-    metadata->pixelBounds = pixelBounds;
-    metadata->fullResolution = fullResolution;
-    metadata->colorSpace = colorSpace;
+    return image;
+}
 
-    Float varianceSum = 0;
-    for (Point2i p : pixelBounds) {
-        const Pixel &pixel = pixels[p];
-        varianceSum += pixel.rgbVarianceEstimator.Variance();
-    }
-    metadata->estimatedVariance = varianceSum / pixelBounds.Area();
+void GBufferFilm::BeginStreaming(ImageMetadata metadata) {
+    CHECK(tileStream && !tileStream->writer);
+    metadata.pixelBounds = pixelBounds;
+    metadata.fullResolution = fullResolution;
+    metadata.colorSpace = colorSpace;
+    PixelFormat format = writeFP16 ? PixelFormat::Half : PixelFormat::Float;
+    tileStream->writer = std::make_unique<TiledImageWriter>(
+        filename, metadata, GBufferChannelNames(), format, tileStream->TileSize());
+}
 
-    return image;
+void GBufferFilm::StartTile(const Bounds2i &tileBounds) {
+    CHECK(tileStream);
+    tileStream->StartTile(tileBounds);
+}
+
+void GBufferFilm::FinishTile(const Bounds2i &tileBounds) {
+    tileStream->writer->WriteTile(ConvertPixels(tileBounds, 1), tileBounds);
+    double varianceSum = 0;
+    for (Point2i p : tileBounds)
+        varianceSum += LookupPixel(p).rgbVarianceEstimator.Variance();
+    tileStream->varianceSum.Add(varianceSum);
+    tileStream->FinishTile();
+}
+
+void GBufferFilm::EndStreaming() {
+    CHECK(tileStream);
+    LOG_VERBOSE("Finished streaming image %s with bounds %s", filename, pixelBounds);
+    tileStream->writer->Close(tileStream->varianceSum / pixelBounds.Area());
+    tileStream->writer.reset();
 }
 
 std::string GBufferFilm::ToString() const {
     return StringPrintf("[ GBufferFilm %s colorSpace: %s maxComponentValue: %f "
-                        "writeFP16: %s ]",
-                        BaseToString(), *colorSpace, maxComponentValue, writeFP16);
+                        "writeFP16: %s streamTileSize: %d ]",
+                        BaseToString(), *colorSpace, maxComponentValue, writeFP16,
+                        StreamingTileSize());
 }
 
 GBufferFilm *GBufferFilm::Create(const ParameterDictionary &parameters,
@@ -1016,6 +1215,22 @@ GBufferFilm *GBufferFilm::Create(const ParameterDictionary &parameters,
     Float maxComponentValue = parameters.GetOneFloat("maxcomponentvalue", Infinity);
     Float scale = parameters.GetOneFloat("scale", 1.);
     bool writeFP16 = parameters.GetOneBool("savefp16", true);
+    int streamTileSize = 0;
+    if (parameters.GetOneBool("streamtiles", false)) {
+        // Render in buckets and write each one to disk as soon as it's done
+        streamTileSize = parameters.GetOneInt("tilesize", 32);
+        if (streamTileSize <= 0)
+            ErrorExit(loc, "%d: \"tilesize\" must be positive.", streamTileSize);
+        if (!HasExtension(filename, "exr"))
+            ErrorExit(loc, "%s: \"streamtiles\" requires an EXR output file.",
+                      filename);
+    }
+    if (Options->writePartialFilm) {
+        if (streamTileSize > 0)
+            ErrorExit(loc, "\"streamtiles\" can't be used with --partial-film.");
+        if (!HasExtension(filename, "exr"))
+            ErrorExit(loc, "%s: --partial-film requires an EXR output file.", filename);
+    }
 
     // Imaging ratio parameters
     // The defaults here represent a "passthrough" setup such that the imaging
@@ -1036,7 +1251,8 @@ GBufferFilm *GBufferFilm::Create(const ParameterDictionary &parameters,
 
     return alloc.new_object<GBufferFilm>(sensor, fullResolution, pixelBounds, filter,
                                          diagonal, filename, scale, colorSpace,
-                                         maxComponentValue, writeFP16, alloc);
+                                         maxComponentValue, writeFP16, streamTileSize,
+                                         alloc);
 }
 
 FilmHandle FilmHandle::Create(const std::string &name,
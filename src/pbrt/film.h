@@ -17,6 +17,8 @@
 #include <pbrt/bsdf.h>
 #include <pbrt/util/color.h>
 #include <pbrt/util/colorspace.h>
+#include <pbrt/util/containers.h>
+#include <pbrt/util/image.h>
 #include <pbrt/util/parallel.h>
 #include <pbrt/util/pstd.h>
 #include <pbrt/util/sampling.h>
@@ -26,6 +28,7 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -38,6 +41,11 @@ SquareMatrix<3> SolveCameraMatrix(SpectrumHandle r, SpectrumHandle g, SpectrumHa
                                   const DenselySampledSpectrum &dstw,
                                   Allocator alloc = {});
 
+// Partial Film Function Declarations
+// Partial film images store unnormalized sums that can be added together to
+// merge renderings of disjoint pixel sample ranges; see "imgtool merge".
+std::vector<std::string> PartialFilmChannelNames();
+
 // Sensor Definition
 class Sensor {
   public:
@@ -151,6 +159,41 @@ class FilmBase {
     const Sensor *sensor;
 };
 
+// FilmTileStream Definition
+template <typename Pixel>
+class FilmTileStream {
+  public:
+    // FilmTileStream Public Methods
+    explicit FilmTileStream(int tileSize) : tileSize(tileSize), tiles(MaxThreadIndex()) {}
+
+    int TileSize() const { return tileSize; }
+    size_t BytesAllocated() const {
+        return tiles.size() * size_t(tileSize) * size_t(tileSize) * sizeof(Pixel);
+    }
+
+    void StartTile(const Bounds2i &tileBounds) {
+        tiles[ThreadIndex] = std::make_unique<Array2D<Pixel>>(tileBounds);
+    }
+    void FinishTile() { tiles[ThreadIndex].reset(); }
+
+    Pixel &operator[](const Point2i &p) { return (*tiles[ThreadIndex])[p]; }
+    const Pixel &operator[](const Point2i &p) const {
+        return (*tiles[ThreadIndex])[p];
+    }
+
+    // FilmTileStream Public Members
+    std::unique_ptr<TiledImageWriter> writer;
+    // Sum of the variance estimates of the pixels in finished tiles
+    AtomicDouble varianceSum;
+
+  private:
+    // FilmTileStream Private Members
+    int tileSize;
+    // Each thread accumulates samples for the tile it is currently
+    // rendering; tiles are freed as soon as they have been written.
+    std::vector<std::unique_ptr<Array2D<Pixel>>> tiles;
+};
+
 // RGBFilm Definition
 class RGBFilm : public FilmBase {
   public:
@@ -170,12 +213,12 @@ class RGBFilm : public FilmBase {
         }
 
         DCHECK(InsideExclusive(pFilm, pixelBounds));
+        Pixel &pixel = LookupPixel(pFilm);
         // Update pixel variance estimate
-        // pixels[pFilm].varianceEstimator.Add(H.Average());
-        pixels[pFilm].varianceEstimator.Add(L.Average());
+        // pixel.varianceEstimator.Add(H.Average());
+        pixel.varianceEstimator.Add(L.Average());
 
         // Update pixel values with filtered sample contribution
-        Pixel &pixel = pixels[pFilm];
         for (int c = 0; c < 3; ++c)
             pixel.rgbSum[c] += weight * rgb[c];
         pixel.weightSum += weight;
@@ -186,7 +229,7 @@ class RGBFilm : public FilmBase {
 
     PBRT_CPU_GPU
     RGB GetPixelRGB(const Point2i &p, Float splatScale = 1) const {
-        const Pixel &pixel = pixels[p];
+        const Pixel &pixel = LookupPixel(p);
         RGB rgb(pixel.rgbSum[0], pixel.rgbSum[1], pixel.rgbSum[2]);
         // Normalize _rgb_ with weight sum
         Float weightSum = pixel.weightSum;
@@ -210,7 +253,7 @@ class RGBFilm : public FilmBase {
     RGBFilm(const Sensor *sensor, const Point2i &resolution, const Bounds2i &pixelBounds,
             FilterHandle filter, Float diagonal, const std::string &filename, Float scale,
             const RGBColorSpace *colorSpace, Float maxComponentValue = Infinity,
-            bool writeFP16 = true, Allocator allocator = {});
+            bool writeFP16 = true, int streamTileSize = 0, Allocator allocator = {});
 
     static RGBFilm *Create(const ParameterDictionary &parameters, FilterHandle filter,
                            const RGBColorSpace *colorSpace, const FileLoc *loc,
@@ -224,6 +267,13 @@ class RGBFilm : public FilmBase {
 
     void WriteImage(ImageMetadata metadata, Float splatScale = 1);
     Image GetImage(ImageMetadata *metadata, Float splatScale = 1);
+    Image GetPartialImage(ImageMetadata *metadata);
+
+    int StreamingTileSize() const { return tileStream ? tileStream->TileSize() : 0; }
+    void BeginStreaming(ImageMetadata metadata);
+    void StartTile(const Bounds2i &tileBounds);
+    void FinishTile(const Bounds2i &tileBounds);
+    void EndStreaming();
 
     std::string ToString() const;
 
@@ -237,8 +287,27 @@ class RGBFilm : public FilmBase {
         VarianceEstimator<Float> varianceEstimator;
     };
 
+    // RGBFilm Private Methods
+    PBRT_CPU_GPU
+    Pixel &LookupPixel(const Point2i &p) {
+#ifndef PBRT_IS_GPU_CODE
+        if (tileStream)
+            return (*tileStream)[p];
+#endif
+        return pixels[p];
+    }
+    PBRT_CPU_GPU
+    const Pixel &LookupPixel(const Point2i &p) const {
+#ifndef PBRT_IS_GPU_CODE
+        if (tileStream)
+            return (*tileStream)[p];
+#endif
+        return pixels[p];
+    }
+
     // RGBFilm Private Members
     Array2D<Pixel> pixels;
+    FilmTileStream<Pixel> *tileStream = nullptr;
     Float scale;
     const RGBColorSpace *colorSpace;
     Float maxComponentValue;
@@ -255,7 +324,7 @@ class GBufferFilm : public FilmBase {
                 const Bounds2i &pixelBounds, FilterHandle filter, Float diagonal,
                 const std::string &filename, Float scale, const RGBColorSpace *colorSpace,
                 Float maxComponentValue = Infinity, bool writeFP16 = true,
-                Allocator alloc = {});
+                int streamTileSize = 0, Allocator alloc = {});
 
     static GBufferFilm *Create(const ParameterDictionary &parameters, FilterHandle filter,
                                const RGBColorSpace *colorSpace, const FileLoc *loc,
@@ -277,7 +346,7 @@ class GBufferFilm : public FilmBase {
 
     PBRT_CPU_GPU
     RGB GetPixelRGB(const Point2i &p, Float splatScale = 1) const {
-        const Pixel &pixel = pixels[p];
+        const Pixel &pixel = LookupPixel(p);
         RGB rgb(pixel.rgbSum[0], pixel.rgbSum[1], pixel.rgbSum[2]);
 
         // Normalize pixel with weight sum
@@ -299,6 +368,13 @@ class GBufferFilm : public FilmBase {
 
     void WriteImage(ImageMetadata metadata, Float splatScale = 1);
     Image GetImage(ImageMetadata *metadata, Float splatScale = 1);
+    Image GetPartialImage(ImageMetadata *metadata);
+
+    int StreamingTileSize() const { return tileStream ? tileStream->TileSize() : 0; }
+    void BeginStreaming(ImageMetadata metadata);
+    void StartTile(const Bounds2i &tileBounds);
+    void FinishTile(const Bounds2i &tileBounds);
+    void EndStreaming();
 
     std::string ToString() const;
 
@@ -316,8 +392,29 @@ class GBufferFilm : public FilmBase {
         VarianceEstimator<Float> rgbVarianceEstimator;
     };
 
+    // GBufferFilm Private Methods
+    PBRT_CPU_GPU
+    Pixel &LookupPixel(const Point2i &p) {
+#ifndef PBRT_IS_GPU_CODE
+        if (tileStream)
+            return (*tileStream)[p];
+#endif
+        return pixels[p];
+    }
+    PBRT_CPU_GPU
+    const Pixel &LookupPixel(const Point2i &p) const {
+#ifndef PBRT_IS_GPU_CODE
+        if (tileStream)
+            return (*tileStream)[p];
+#endif
+        return pixels[p];
+    }
+
+    Image ConvertPixels(const Bounds2i &bounds, Float splatScale);
+
     // GBufferFilm Private Members
     Array2D<Pixel> pixels;
+    FilmTileStream<Pixel> *tileStream = nullptr;
     Float scale;
     const RGBColorSpace *colorSpace;
     Float maxComponentValue;
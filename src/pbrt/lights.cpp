@@ -77,6 +77,172 @@ LightBounds Union(const LightBounds &a, const LightBounds &b) {
                        std::max(a.theta_e, b.theta_e), a.twoSided | b.twoSided);
 }
 
+// CompactLightBounds Method Definitions
+std::string CompactLightBounds::ToString() const {
+    return StringPrintf("[ CompactLightBounds qb: [ [ %d %d %d ] [ %d %d %d ] ] w: %s "
+                        "phi: %f qCosTheta_o: %d (%f) qCosTheta_e: %d (%f) "
+                        "twoSided: %s ]",
+                        qb[0][0], qb[0][1], qb[0][2], qb[1][0], qb[1][1], qb[1][2], w,
+                        phi, qCosTheta_o, CosTheta_o(), qCosTheta_e, CosTheta_e(),
+                        twoSided != 0);
+}
+
+std::string CompactLightBounds::ToString(const Bounds3f &allBounds) const {
+    return StringPrintf("[ CompactLightBounds b: %s w: %s phi: %f cosTheta_o: %f "
+                        "cosTheta_e: %f twoSided: %s ]",
+                        Bounds(allBounds), w, phi, CosTheta_o(), CosTheta_e(),
+                        twoSided != 0);
+}
+
+// LightBVHNode Method Definitions
+std::string LightBVHNode::ToString() const {
+    return StringPrintf("[ LightBVHNode lightBounds: %s childOrLightIndex: %d "
+                        "isLeaf: %s ]",
+                        lightBounds, childOrLightIndex, isLeaf != 0);
+}
+
+// Light BVH Function Definitions
+LightBounds BuildLightBVH(std::vector<std::pair<int, LightBounds>> &bvhLights, int start,
+                          int end, int nodeIndex, uint64_t bitTrail, int depth,
+                          const Bounds3f &allLightBounds,
+                          pstd::vector<LightBVHNode> &nodes,
+                          std::vector<uint64_t> &bitTrails) {
+    CHECK_LT(start, end);
+    int nLights = end - start;
+    if (nLights == 1) {
+        // Initialize leaf node for the single light in _bvhLights_
+        const std::pair<int, LightBounds> &bvhLight = bvhLights[start];
+        nodes[nodeIndex] = LightBVHNode::MakeLeaf(
+            bvhLight.first, CompactLightBounds(bvhLight.second, allLightBounds));
+        bitTrails[bvhLight.first] = bitTrail;
+        return bvhLight.second;
+    }
+
+    Bounds3f bounds, centroidBounds;
+    for (int i = start; i < end; ++i) {
+        const LightBounds &lb = bvhLights[i].second;
+        bounds = Union(bounds, lb.b);
+        centroidBounds = Union(centroidBounds, lb.Centroid());
+    }
+
+    // Modified SAH
+    // Replace # of primitives with emitter power
+    // TODO: use the more efficient bounds/cost sweep calculation from v4
+
+    Float minCost = Infinity;
+    int minCostSplitBucket = -1, minCostSplitDim = -1;
+    constexpr int nBuckets = 12;
+
+    for (int dim = 0; dim < 3; ++dim) {
+        if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) {
+            continue;
+        }
+
+        LightBounds bucketLightBounds[nBuckets];
+
+        for (int i = start; i < end; ++i) {
+            Point3f pc = bvhLights[i].second.Centroid();
+            int b = nBuckets * centroidBounds.Offset(pc)[dim];
+            if (b == nBuckets)
+                b = nBuckets - 1;
+            CHECK_GE(b, 0);
+            CHECK_LT(b, nBuckets);
+            bucketLightBounds[b] = Union(bucketLightBounds[b], bvhLights[i].second);
+        }
+
+        // Compute costs for splitting after each bucket
+        Float cost[nBuckets - 1];
+        for (int i = 0; i < nBuckets - 1; ++i) {
+            LightBounds b0, b1;
+
+            for (int j = 0; j <= i; ++j)
+                b0 = Union(b0, bucketLightBounds[j]);
+            for (int j = i + 1; j < nBuckets; ++j)
+                b1 = Union(b1, bucketLightBounds[j]);
+
+            auto Momega = [](const LightBounds &b) {
+                Float theta_w = std::min(b.theta_o + b.theta_e, Pi);
+                return 2 * Pi * (1 - std::cos(b.theta_o)) +
+                       Pi / 2 *
+                           (2 * theta_w * std::sin(b.theta_o) -
+                            std::cos(b.theta_o - 2 * theta_w) -
+                            2 * b.theta_o * std::sin(b.theta_o) + std::cos(b.theta_o));
+            };
+
+            // Can simplify since we always split
+            Float Kr = MaxComponentValue(bounds.Diagonal()) / bounds.Diagonal()[dim];
+            cost[i] = Kr * (b0.phi * Momega(b0) * b0.b.SurfaceArea() +
+                            b1.phi * Momega(b1) * b1.b.SurfaceArea());
+        }
+
+        // Find bucket to split at that minimizes SAH metric
+        for (int i = 1; i < nBuckets - 1; ++i) {
+            if (cost[i] > 0 && cost[i] < minCost) {
+                minCost = cost[i];
+                minCostSplitBucket = i;
+                minCostSplitDim = dim;
+            }
+        }
+    }
+
+    int mid;
+    if (minCostSplitDim == -1) {
+        mid = (start + end) / 2;
+    } else {
+        const auto *pmid = std::partition(
+            &bvhLights[start], &bvhLights[end - 1] + 1,
+            [=](const std::pair<int, LightBounds> &l) {
+                int b = nBuckets *
+                        centroidBounds.Offset(l.second.Centroid())[minCostSplitDim];
+                if (b == nBuckets)
+                    b = nBuckets - 1;
+                CHECK_GE(b, 0);
+                CHECK_LT(b, nBuckets);
+                return b <= minCostSplitBucket;
+            });
+        mid = pmid - &bvhLights[0];
+
+        if (mid == start || mid == end) {
+            mid = (start + end) / 2;
+        }
+        CHECK(mid > start && mid < end);
+    }
+
+    // Split evenly if the children might not fit in the 64-bit trails otherwise;
+    // an even split of $n$ lights always fits in $\lceil\log_2 n\rceil$ levels
+    int maxChildLights = std::max(mid - start, end - mid);
+    if (depth + 1 + Log2Int(RoundUpPow2(maxChildLights)) > 64)
+        mid = (start + end) / 2;
+
+    // Build child subtrees; the second child follows the $2(mid-start)-1$ nodes of
+    // the first
+    CHECK_LT(depth, 64);
+    int child1Index = nodeIndex + 2 * (mid - start);
+    LightBounds childBounds[2];
+    auto buildChild = [&](int child) {
+        if (child == 0)
+            childBounds[0] =
+                BuildLightBVH(bvhLights, start, mid, nodeIndex + 1, bitTrail, depth + 1,
+                              allLightBounds, nodes, bitTrails);
+        else
+            childBounds[1] = BuildLightBVH(bvhLights, mid, end, child1Index,
+                                           bitTrail | (uint64_t(1) << depth),
+                                           depth + 1, allLightBounds, nodes, bitTrails);
+    };
+    if (nLights > 64 * 1024)
+        ParallelFor(0, 2, [&](int64_t child) { buildChild(child); });
+    else {
+        buildChild(0);
+        buildChild(1);
+    }
+
+    // Initialize interior node with the union of its children's bounds
+    LightBounds lb = Union(childBounds[0], childBounds[1]);
+    nodes[nodeIndex] =
+        LightBVHNode::MakeInterior(child1Index, CompactLightBounds(lb, allLightBounds));
+    return lb;
+}
+
 // PointLight Method Definitions
 SampledSpectrum PointLight::Phi(const SampledWavelengths &lambda) const {
     return 4 * Pi * scale * I.Sample(lambda);
@@ -720,20 +886,22 @@ std::string DiffuseAreaLight::ToString() const {
                         area, image);
 }
 
-DiffuseAreaLight *DiffuseAreaLight::Create(const Transform &renderFromLight,
-                                           MediumHandle medium,
-                                           const ParameterDictionary &parameters,
-                                           const RGBColorSpace *colorSpace,
-                                           const FileLoc *loc, Allocator alloc,
-                                           const ShapeHandle shape) {
-    SpectrumHandle L =
-        parameters.GetOneSpectrum("L", nullptr, SpectrumType::General, alloc);
-    Float scale = parameters.GetOneFloat("scale", 1);
-    bool twoSided = parameters.GetOneBool("twosided", false);
+// Diffuse Area Light Parameter Parsing
+// Shared by _DiffuseAreaLight_ and _TriangleMeshLight_; _area_ is the total
+// emitting area, used when the light's power is specified.
+static void GetDiffuseEmission(const ParameterDictionary &parameters,
+                               const RGBColorSpace *colorSpace, const FileLoc *loc,
+                               Allocator alloc, Float area, SpectrumHandle *Le,
+                               Float *lightScale, bool *twoSided, Image *image,
+                               const RGBColorSpace **imageColorSpace) {
+    SpectrumHandle &L = *Le;
+    L = parameters.GetOneSpectrum("L", nullptr, SpectrumType::General, alloc);
+    Float &scale = *lightScale;
+    scale = parameters.GetOneFloat("scale", 1);
+    *twoSided = parameters.GetOneBool("twosided", false);
 
     std::string filename = ResolveFilename(parameters.GetOneString("filename", ""));
-    Image image;
-    const RGBColorSpace *imageColorSpace = nullptr;
+    *imageColorSpace = nullptr;
     if (!filename.empty()) {
         if (L != nullptr)
             ErrorExit(loc, "Both \"L\" and \"filename\" specified for DiffuseAreaLight.");
@@ -745,9 +913,9 @@ DiffuseAreaLight *DiffuseAreaLight::Create(const Transform &renderFromLight,
                       "%s: Image provided to \"diffuse\" area light must have "
                       "R, G, and B channels.",
                       filename);
-        image = im.image.SelectChannels(channelDesc, alloc);
+        *image = im.image.SelectChannels(channelDesc, alloc);
 
-        imageColorSpace = im.metadata.GetColorSpace();
+        *imageColorSpace = im.metadata.GetColorSpace();
     } else if (L == nullptr)
         L = &colorSpace->illuminant;
 
@@ -762,33 +930,329 @@ DiffuseAreaLight *DiffuseAreaLight::Create(const Transform &renderFromLight,
         // emitted by the light.
         Float k_e;
         // Get the appropriate luminance vector from the image colour space
-        RGB lum = imageColorSpace->LuminanceVector();
+        RGB lum = (*imageColorSpace)->LuminanceVector();
         // we need to know which channels correspond to R, G and B
         // we know that the channelDesc is valid as we would have exited in the
         // block above otherwise
-        ImageChannelDesc channelDesc = image.GetChannelDesc({"R", "G", "B"});
-        if (image) {
+        ImageChannelDesc channelDesc = image->GetChannelDesc({"R", "G", "B"});
+        if (*image) {
             k_e = 0;
             // Assume no distortion in the mapping, FWIW...
-            for (int y = 0; y < image.Resolution().y; ++y)
-                for (int x = 0; x < image.Resolution().x; ++x) {
+            for (int y = 0; y < image->Resolution().y; ++y)
+                for (int x = 0; x < image->Resolution().x; ++x) {
                     for (int c = 0; c < 3; ++c)
-                        k_e += image.GetChannel({x, y}, c) * lum[c];
+                        k_e += image->GetChannel({x, y}, c) * lum[c];
                 }
-            k_e /= image.Resolution().x * image.Resolution().y;
+            k_e /= image->Resolution().x * image->Resolution().y;
         }
 
-        k_e *= (twoSided ? 2 : 1) * shape.Area() * Pi;
+        k_e *= (*twoSided ? 2 : 1) * area * Pi;
 
         // now multiply up scale to hit the target power
         scale *= phi_v / k_e;
     }
+}
+
+DiffuseAreaLight *DiffuseAreaLight::Create(const Transform &renderFromLight,
+                                           MediumHandle medium,
+                                           const ParameterDictionary &parameters,
+                                           const RGBColorSpace *colorSpace,
+                                           const FileLoc *loc, Allocator alloc,
+                                           const ShapeHandle shape) {
+    SpectrumHandle L;
+    Float scale;
+    bool twoSided;
+    Image image;
+    const RGBColorSpace *imageColorSpace;
+    GetDiffuseEmission(parameters, colorSpace, loc, alloc, shape.Area(), &L, &scale,
+                       &twoSided, &image, &imageColorSpace);
+    // "meshlight" has no effect for shapes that each get their own light,
+    // including all of them in the GPU renderer
+    parameters.GetOneBool("meshlight", false);
 
     return alloc.new_object<DiffuseAreaLight>(renderFromLight, medium, L, scale, shape,
                                               std::move(image), imageColorSpace, twoSided,
                                               alloc);
 }
 
+// TriangleMeshLight Method Definitions
+STAT_MEMORY_COUNTER("Memory/Triangle mesh lights", meshLightBytes);
+
+TriangleMeshLight::TriangleMeshLight(const Transform &renderFromLight,
+                                     const MediumInterface &mediumInterface,
+                                     SpectrumHandle Le, Float scale,
+                                     pstd::span<const ShapeHandle> tris, Image im,
+                                     const RGBColorSpace *imageColorSpace, bool twoSided,
+                                     Allocator alloc)
+    : LightBase(LightType::Area, renderFromLight, mediumInterface),
+      Lemit(Le, alloc),
+      scale(scale),
+      twoSided(twoSided),
+      area(0),
+      imageColorSpace(imageColorSpace),
+      image(std::move(im)),
+      triangles(alloc),
+      nodes(alloc),
+      triangleBitTrails(alloc),
+      areaDistrib(alloc) {
+    ++numAreaLights;
+
+    if (image) {
+        ImageChannelDesc desc = image.GetChannelDesc({"R", "G", "B"});
+        if (!desc)
+            ErrorExit("Image used for TriangleMeshLight doesn't have R, G, B "
+                      "channels.");
+        CHECK_EQ(3, desc.size());
+        CHECK(desc.IsIdentity());
+        CHECK(imageColorSpace != nullptr);
+    } else {
+        CHECK(Le);
+    }
+
+    // Compute emitted power per unit area, as in _DiffuseAreaLight::Bounds()_
+    Float phiPerArea = 0;
+    if (image) {
+        for (int y = 0; y < image.Resolution().y; ++y)
+            for (int x = 0; x < image.Resolution().x; ++x)
+                for (int c = 0; c < 3; ++c)
+                    phiPerArea += image.GetChannel({x, y}, c);
+        phiPerArea /= 3 * image.Resolution().x * image.Resolution().y;
+    } else
+        phiPerArea = Lemit.MaxValue();
+    phiPerArea *= scale * (twoSided ? 2 : 1) * Pi;
+
+    // Compute _LightBounds_ and area for each of the mesh's triangles
+    std::vector<std::pair<int, LightBounds>> bvhTriangles;
+    std::vector<Float> triAreas(tris.size());
+    triangles.reserve(tris.size());
+    for (size_t i = 0; i < tris.size(); ++i) {
+        CHECK(tris[i].Is<Triangle>());
+        const Triangle *tri = tris[i].Cast<Triangle>();
+        triangles.push_back(tri);
+        triAreas[i] = tri->Area();
+        area += triAreas[i];
+        allTriangleBounds = Union(allTriangleBounds, tri->Bounds());
+
+        Float phi = phiPerArea * triAreas[i];
+        if (phi > 0) {
+            DirectionCone nb = tri->NormalBounds();
+            bvhTriangles.push_back(std::make_pair(
+                i, LightBounds(tri->Bounds(), nb.w, phi, SafeACos(nb.cosTheta), Pi / 2,
+                               twoSided)));
+        }
+    }
+    if (area > 0)
+        areaDistrib = AliasTable(triAreas, alloc);
+
+    // Build importance tree over emitting triangles
+    // Triangles that don't emit are never sampled and are marked with an
+    // all-ones bit trail, which no tree of depth less than 64 can produce.
+    std::vector<uint64_t> bitTrails(triangles.size(), ~uint64_t(0));
+    if (bvhTriangles.empty())
+        lightBounds = LightBounds(allTriangleBounds, Vector3f(0, 0, 1), 0, Pi, Pi / 2,
+                                  twoSided);
+    else {
+        nodes.resize(2 * bvhTriangles.size() - 1);
+        lightBounds = BuildLightBVH(bvhTriangles, 0, bvhTriangles.size(), 0, 0, 0,
+                                    allTriangleBounds, nodes, bitTrails);
+    }
+    triangleBitTrails = pstd::vector<uint64_t>(bitTrails.begin(), bitTrails.end(), alloc);
+
+    meshLightBytes += nodes.size() * sizeof(LightBVHNode) +
+                      triangles.size() * (sizeof(const Triangle *) + sizeof(uint64_t));
+}
+
+int TriangleMeshLight::sampleTriangle(Point3f p, Normal3f n, Float u, Float *pmf,
+                                      Float *uRemapped) const {
+    if (nodes.empty())
+        return -1;
+    // Traverse the importance tree from the root to choose a triangle
+    int nodeIndex = 0;
+    *pmf = 1;
+    while (true) {
+        const LightBVHNode &node = nodes[nodeIndex];
+        if (node.isLeaf) {
+            if (node.lightBounds.Importance(p, n, allTriangleBounds) == 0)
+                return -1;
+            *uRemapped = u;
+            return node.childOrLightIndex;
+        }
+        pstd::array<Float, 2> ci = {
+            nodes[nodeIndex + 1].lightBounds.Importance(p, n, allTriangleBounds),
+            nodes[node.childOrLightIndex].lightBounds.Importance(p, n,
+                                                                 allTriangleBounds)};
+        if (ci[0] == 0 && ci[1] == 0)
+            return -1;
+        Float nodePMF;
+        int child = SampleDiscrete(ci, u, &nodePMF, &u);
+        *pmf *= nodePMF;
+        nodeIndex = (child == 0) ? (nodeIndex + 1) : node.childOrLightIndex;
+    }
+}
+
+Float TriangleMeshLight::trianglePMF(Point3f p, Normal3f n, int triIndex) const {
+    uint64_t bitTrail = triangleBitTrails[triIndex];
+    if (bitTrail == ~uint64_t(0))
+        return 0;
+    // Follow the triangle's bit trail from the root, accumulating its probability
+    int nodeIndex = 0;
+    Float pmf = 1;
+    while (true) {
+        const LightBVHNode &node = nodes[nodeIndex];
+        if (node.isLeaf) {
+            DCHECK_EQ(triIndex, node.childOrLightIndex);
+            if (node.lightBounds.Importance(p, n, allTriangleBounds) == 0)
+                return 0;
+            return pmf;
+        }
+        pstd::array<Float, 2> ci = {
+            nodes[nodeIndex + 1].lightBounds.Importance(p, n, allTriangleBounds),
+            nodes[node.childOrLightIndex].lightBounds.Importance(p, n,
+                                                                 allTriangleBounds)};
+        int childIndex = bitTrail & 1;
+        if (ci[childIndex] == 0)
+            return 0;
+        pmf *= ci[childIndex] / (ci[0] + ci[1]);
+        nodeIndex = (childIndex == 0) ? (nodeIndex + 1) : node.childOrLightIndex;
+        bitTrail >>= 1;
+    }
+}
+
+int TriangleMeshLight::intersectTriangle(const Ray &ray) const {
+    if (nodes.empty())
+        return -1;
+    // Find the closest triangle along _ray_ using the importance tree's bounds
+    Float tMax = Infinity;
+    int hitIndex = -1;
+    int toVisitOffset = 0, nodeIndex = 0;
+    int nodesToVisit[64];
+    while (true) {
+        const LightBVHNode &node = nodes[nodeIndex];
+        if (node.lightBounds.Bounds(allTriangleBounds).IntersectP(ray.o, ray.d, tMax)) {
+            if (node.isLeaf) {
+                pstd::optional<ShapeIntersection> si =
+                    triangles[node.childOrLightIndex]->Intersect(ray, tMax);
+                if (si) {
+                    tMax = si->tHit;
+                    hitIndex = node.childOrLightIndex;
+                }
+            } else {
+                // Visit the first child next and save the second for later
+                nodesToVisit[toVisitOffset++] = node.childOrLightIndex;
+                nodeIndex = nodeIndex + 1;
+                continue;
+            }
+        }
+        if (toVisitOffset == 0)
+            break;
+        nodeIndex = nodesToVisit[--toVisitOffset];
+    }
+    return hitIndex;
+}
+
+SampledSpectrum TriangleMeshLight::Phi(const SampledWavelengths &lambda) const {
+    SampledSpectrum phi(0.f);
+    if (image) {
+        // Compute average light image emission
+        for (int y = 0; y < image.Resolution().y; ++y)
+            for (int x = 0; x < image.Resolution().x; ++x) {
+                RGB rgb;
+                for (int c = 0; c < 3; ++c)
+                    rgb[c] = image.GetChannel({x, y}, c);
+                phi += RGBSpectrum(*imageColorSpace, rgb).Sample(lambda);
+            }
+        phi /= image.Resolution().x * image.Resolution().y;
+
+    } else
+        phi = Lemit.Sample(lambda);
+    return phi * (twoSided ? 2 : 1) * scale * area * Pi;
+}
+
+LightLeSample TriangleMeshLight::SampleLe(const Point2f &u1, const Point2f &u2,
+                                          SampledWavelengths &lambda, Float time) const {
+    if (areaDistrib.size() == 0)
+        return {};
+    // Choose a triangle with probability proportional to its area
+    Float triPMF, uRemapped;
+    int triIndex = areaDistrib.Sample(u1[0], &triPMF, &uRemapped);
+
+    // Sample a point on the chosen triangle
+    Float pdfDir;
+    pstd::optional<ShapeSample> ss =
+        triangles[triIndex]->Sample(Point2f(uRemapped, u1[1]));
+    if (!ss)
+        return {};
+    ss->intr.time = time;
+    ss->intr.mediumInterface = &mediumInterface;
+
+    // Sample a cosine-weighted outgoing direction _w_ for the mesh
+    Vector3f w;
+    if (twoSided) {
+        Point2f u = u2;
+        if (u[0] < .5) {
+            u[0] = std::min(u[0] * 2, OneMinusEpsilon);
+            w = SampleCosineHemisphere(u);
+        } else {
+            u[0] = std::min((u[0] - .5f) * 2, OneMinusEpsilon);
+            w = SampleCosineHemisphere(u);
+            w.z *= -1;
+        }
+        pdfDir = 0.5f * CosineHemispherePDF(std::abs(w.z));
+    } else {
+        w = SampleCosineHemisphere(u2);
+        pdfDir = CosineHemispherePDF(w.z);
+    }
+
+    if (pdfDir == 0)
+        return {};
+
+    // Return _LightLeSample_ for ray leaving the mesh
+    Frame nFrame = Frame::FromZ(ss->intr.n);
+    w = nFrame.FromLocal(w);
+    return LightLeSample(L(ss->intr.p(), ss->intr.n, ss->intr.uv, w, lambda),
+                         ss->intr.SpawnRay(w), ss->intr, triPMF * ss->pdf, pdfDir);
+}
+
+void TriangleMeshLight::PDF_Le(const Interaction &intr, Vector3f &w, Float *pdfPos,
+                               Float *pdfDir) const {
+    CHECK_NE(intr.n, Normal3f(0, 0, 0));
+    // Area-proportional triangle selection gives uniform sampling over the mesh
+    *pdfPos = area > 0 ? 1 / area : 0;
+    *pdfDir = twoSided ? (.5 * CosineHemispherePDF(AbsDot(intr.n, w)))
+                       : CosineHemispherePDF(Dot(intr.n, w));
+}
+
+std::string TriangleMeshLight::ToString() const {
+    return StringPrintf("[ TriangleMeshLight %s Lemit: %s scale: %f triangles: %d "
+                        "twoSided: %s area: %f image: %s nodes: %d lightBounds: %s ]",
+                        BaseToString(), Lemit, scale, triangles.size(),
+                        twoSided ? "true" : "false", area, image, nodes.size(),
+                        lightBounds);
+}
+
+TriangleMeshLight *TriangleMeshLight::Create(const Transform &renderFromLight,
+                                             MediumHandle medium,
+                                             const ParameterDictionary &parameters,
+                                             const RGBColorSpace *colorSpace,
+                                             const FileLoc *loc, Allocator alloc,
+                                             pstd::span<const ShapeHandle> triangles) {
+    Float area = 0;
+    for (ShapeHandle tri : triangles)
+        area += tri.Area();
+
+    SpectrumHandle L;
+    Float scale;
+    bool twoSided;
+    Image image;
+    const RGBColorSpace *imageColorSpace;
+    GetDiffuseEmission(parameters, colorSpace, loc, alloc, area, &L, &scale, &twoSided,
+                       &image, &imageColorSpace);
+
+    return alloc.new_object<TriangleMeshLight>(renderFromLight, medium, L, scale,
+                                               triangles, std::move(image),
+                                               imageColorSpace, twoSided, alloc);
+}
+
 // UniformInfiniteLight Method Definitions
 UniformInfiniteLight::UniformInfiniteLight(const Transform &renderFromLight,
                                            SpectrumHandle Lemit, Float scale,
@@ -1533,4 +1997,30 @@ LightHandle LightHandle::CreateArea(const std::string &name,
     return area;
 }
 
+LightHandle LightHandle::CreateMeshArea(const std::string &name,
+                                        const ParameterDictionary &parameters,
+                                        const Transform &renderFromLight,
+                                        const MediumInterface &mediumInterface,
+                                        pstd::span<const ShapeHandle> shapes,
+                                        const FileLoc *loc, Allocator alloc) {
+    // Only diffuse emission from triangle meshes is handled by a single light
+    // It is opt-in: the light's importance tree lowers the variance of light
+    // sampling for large meshes, but finding the PDF of each emissive hit then
+    // requires a traversal of the tree.
+    if (name != "diffuse" || !parameters.GetOneBool("meshlight", false))
+        return nullptr;
+    for (ShapeHandle shape : shapes)
+        if (!shape.Is<Triangle>())
+            return nullptr;
+
+    LightHandle area =
+        TriangleMeshLight::Create(renderFromLight, mediumInterface.outside, parameters,
+                                  parameters.ColorSpace(), loc, alloc, shapes);
+    if (!area)
+        ErrorExit(loc, "%s: unable to create area light.", name);
+
+    parameters.ReportUnused();
+    return area;
+}
+
 }  // namespace pbrt
@@ -24,6 +24,8 @@
 #include <pbrt/util/vecmath.h>
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace pbrt {
 
@@ -102,6 +104,89 @@ class LightSampleContext {
     Normal3f n, ns;
 };
 
+// Light Bounds Importance Function
+// Returns the importance of emitters with the given bounds at point _p_ with
+// normal _n_; shared by _LightBounds_ and the compact light BVH bounds.
+PBRT_CPU_GPU inline Float BoundedLightImportance(Point3f p, Normal3f n,
+                                                 const Bounds3f &b, Vector3f w,
+                                                 Float phi, Float cosTheta_o,
+                                                 Float cosTheta_e, bool twoSided) {
+    // Compute clamped squared distance to _intr_
+    Point3f pc = (b.pMin + b.pMax) / 2;
+    Float d2 = DistanceSquared(p, pc);
+    // Don't let d2 get too small if p is inside the bounds.
+    d2 = std::max(d2, Length(b.Diagonal()) / 2);
+
+    Vector3f wi = Normalize(p - pc);
+
+    Float cosTheta = Dot(w, wi);
+    if (twoSided)
+        cosTheta = std::abs(cosTheta);
+#if 0
+    else if (cosTheta < 0 && cosTheta_o == 1) {
+        // Catch the case where the point is outside the bounds and definitely
+        // not in the emitted cone even though the conservative theta_u test
+        // make suggest it could be.
+        // Doesn't seem to make much difference in practice.
+        if ((p.x < b.pMin.x || p.x > b.pMax.x) &&
+            (p.y < b.pMin.y || p.y > b.pMax.y) &&
+            (p.z < b.pMin.z || p.z > b.pMax.z))
+            return 0;
+    }
+#endif
+
+    // FIXME? unstable when cosTheta \approx 1
+    Float sinTheta = SafeSqrt(1 - cosTheta * cosTheta);
+
+    // Define sine and cosine clamped subtraction lambdas
+    // cos(max(0, a-b))
+    auto cosSubClamped = [](Float sinThetaA, Float cosThetaA, Float sinThetaB,
+                            Float cosThetaB) -> Float {
+        if (cosThetaA > cosThetaB)
+            // Handle the max(0, ...)
+            return 1;
+        return cosThetaA * cosThetaB + sinThetaA * sinThetaB;
+    };
+    // sin(max(0, a-b))
+    auto sinSubClamped = [](Float sinThetaA, Float cosThetaA, Float sinThetaB,
+                            Float cosThetaB) -> Float {
+        if (cosThetaA > cosThetaB)
+            // Handle the max(0, ...)
+            return 0;
+        return sinThetaA * cosThetaB - cosThetaA * sinThetaB;
+    };
+
+    // Compute $\cos \theta_\roman{u}$ for _intr_
+    Float cosTheta_u = BoundSubtendedDirections(b, p).cosTheta;
+    Float sinTheta_u = SafeSqrt(1 - cosTheta_u * cosTheta_u);
+
+    // Compute $\cos \theta_\roman{p}$ for _intr_ and test against $\cos
+    // \theta_\roman{e}$
+    // cos(theta_p). Compute in two steps
+    Float cosTheta_x = cosSubClamped(
+        sinTheta, cosTheta, SafeSqrt(1 - cosTheta_o * cosTheta_o), cosTheta_o);
+    Float sinTheta_x = sinSubClamped(
+        sinTheta, cosTheta, SafeSqrt(1 - cosTheta_o * cosTheta_o), cosTheta_o);
+    Float cosTheta_p = cosSubClamped(sinTheta_x, cosTheta_x, sinTheta_u, cosTheta_u);
+    if (cosTheta_p <= cosTheta_e)
+        return 0;
+
+    Float imp = phi * cosTheta_p / d2;
+    DCHECK_GE(imp, -1e-3);
+
+    // Account for $\cos \theta_\roman{i}$ in importance at surfaces
+    if (n != Normal3f(0, 0, 0)) {
+        // cos(thetap_i) = cos(max(0, theta_i - theta_u))
+        // cos (a-b) = cos a cos b + sin a sin b
+        Float cosTheta_i = AbsDot(wi, n);
+        Float sinTheta_i = SafeSqrt(1 - cosTheta_i * cosTheta_i);
+        Float cosThetap_i = cosSubClamped(sinTheta_i, cosTheta_i, sinTheta_u, cosTheta_u);
+        imp *= cosThetap_i;
+    }
+
+    return std::max<Float>(imp, 0);
+}
+
 // LightBounds Definition
 struct LightBounds {
     // LightBounds Public Methods
@@ -132,81 +217,7 @@ struct LightBounds {
 
     PBRT_CPU_GPU
     Float Importance(Point3f p, Normal3f n) const {
-        // Compute clamped squared distance to _intr_
-        Point3f pc = Centroid();
-        Float d2 = DistanceSquared(p, pc);
-        // Don't let d2 get too small if p is inside the bounds.
-        d2 = std::max(d2, Length(b.Diagonal()) / 2);
-
-        Vector3f wi = Normalize(p - pc);
-
-        Float cosTheta = Dot(w, wi);
-        if (twoSided)
-            cosTheta = std::abs(cosTheta);
-#if 0
-    else if (cosTheta < 0 && cosTheta_o == 1) {
-        // Catch the case where the point is outside the bounds and definitely
-        // not in the emitted cone even though the conservative theta_u test
-        // make suggest it could be.
-        // Doesn't seem to make much difference in practice.
-        if ((p.x < b.pMin.x || p.x > b.pMax.x) &&
-            (p.y < b.pMin.y || p.y > b.pMax.y) &&
-            (p.z < b.pMin.z || p.z > b.pMax.z))
-            return 0;
-    }
-#endif
-
-        // FIXME? unstable when cosTheta \approx 1
-        Float sinTheta = SafeSqrt(1 - cosTheta * cosTheta);
-
-        // Define sine and cosine clamped subtraction lambdas
-        // cos(max(0, a-b))
-        auto cosSubClamped = [](Float sinThetaA, Float cosThetaA, Float sinThetaB,
-                                Float cosThetaB) -> Float {
-            if (cosThetaA > cosThetaB)
-                // Handle the max(0, ...)
-                return 1;
-            return cosThetaA * cosThetaB + sinThetaA * sinThetaB;
-        };
-        // sin(max(0, a-b))
-        auto sinSubClamped = [](Float sinThetaA, Float cosThetaA, Float sinThetaB,
-                                Float cosThetaB) -> Float {
-            if (cosThetaA > cosThetaB)
-                // Handle the max(0, ...)
-                return 0;
-            return sinThetaA * cosThetaB - cosThetaA * sinThetaB;
-        };
-
-        // Compute $\cos \theta_\roman{u}$ for _intr_
-        Float cosTheta_u = BoundSubtendedDirections(b, p).cosTheta;
-        Float sinTheta_u = SafeSqrt(1 - cosTheta_u * cosTheta_u);
-
-        // Compute $\cos \theta_\roman{p}$ for _intr_ and test against $\cos
-        // \theta_\roman{e}$
-        // cos(theta_p). Compute in two steps
-        Float cosTheta_x = cosSubClamped(
-            sinTheta, cosTheta, SafeSqrt(1 - cosTheta_o * cosTheta_o), cosTheta_o);
-        Float sinTheta_x = sinSubClamped(
-            sinTheta, cosTheta, SafeSqrt(1 - cosTheta_o * cosTheta_o), cosTheta_o);
-        Float cosTheta_p = cosSubClamped(sinTheta_x, cosTheta_x, sinTheta_u, cosTheta_u);
-        if (cosTheta_p <= cosTheta_e)
-            return 0;
-
-        Float imp = phi * cosTheta_p / d2;
-        DCHECK_GE(imp, -1e-3);
-
-        // Account for $\cos \theta_\roman{i}$ in importance at surfaces
-        if (n != Normal3f(0, 0, 0)) {
-            // cos(thetap_i) = cos(max(0, theta_i - theta_u))
-            // cos (a-b) = cos a cos b + sin a sin b
-            Float cosTheta_i = AbsDot(wi, n);
-            Float sinTheta_i = SafeSqrt(1 - cosTheta_i * cosTheta_i);
-            Float cosThetap_i =
-                cosSubClamped(sinTheta_i, cosTheta_i, sinTheta_u, cosTheta_u);
-            imp *= cosThetap_i;
-        }
-
-        return std::max<Float>(imp, 0);
+        return BoundedLightImportance(p, n, b, w, phi, cosTheta_o, cosTheta_e, twoSided);
     }
 
     PBRT_CPU_GPU
@@ -225,6 +236,110 @@ struct LightBounds {
 
 LightBounds Union(const LightBounds &a, const LightBounds &b);
 
+// CompactLightBounds Definition
+class CompactLightBounds {
+  public:
+    // CompactLightBounds Public Methods
+    CompactLightBounds() = default;
+    PBRT_CPU_GPU
+    CompactLightBounds(const LightBounds &lb, const Bounds3f &allb)
+        : w(Normalize(lb.w)),
+          phi(lb.phi),
+          qCosTheta_o(QuantizeCos(lb.cosTheta_o)),
+          qCosTheta_e(QuantizeCos(lb.cosTheta_e)),
+          twoSided(lb.twoSided) {
+        // Quantize bounding box into _qb_, rounding outward
+        for (int c = 0; c < 3; ++c) {
+            qb[0][c] =
+                std::floor(QuantizeBounds(lb.b[0][c], allb.pMin[c], allb.pMax[c]));
+            qb[1][c] =
+                std::ceil(QuantizeBounds(lb.b[1][c], allb.pMin[c], allb.pMax[c]));
+        }
+    }
+
+    PBRT_CPU_GPU
+    Float CosTheta_o() const { return 2 * (qCosTheta_o / 32767.f) - 1; }
+    PBRT_CPU_GPU
+    Float CosTheta_e() const { return 2 * (qCosTheta_e / 32767.f) - 1; }
+    PBRT_CPU_GPU
+    bool TwoSided() const { return twoSided; }
+
+    PBRT_CPU_GPU
+    Bounds3f Bounds(const Bounds3f &allb) const {
+        return {Point3f(Lerp(qb[0][0] / 65535.f, allb.pMin.x, allb.pMax.x),
+                        Lerp(qb[0][1] / 65535.f, allb.pMin.y, allb.pMax.y),
+                        Lerp(qb[0][2] / 65535.f, allb.pMin.z, allb.pMax.z)),
+                Point3f(Lerp(qb[1][0] / 65535.f, allb.pMin.x, allb.pMax.x),
+                        Lerp(qb[1][1] / 65535.f, allb.pMin.y, allb.pMax.y),
+                        Lerp(qb[1][2] / 65535.f, allb.pMin.z, allb.pMax.z))};
+    }
+
+    PBRT_CPU_GPU
+    Float Importance(Point3f p, Normal3f n, const Bounds3f &allb) const {
+        return BoundedLightImportance(p, n, Bounds(allb), w, phi, CosTheta_o(),
+                                      CosTheta_e(), twoSided);
+    }
+
+    std::string ToString() const;
+    std::string ToString(const Bounds3f &allBounds) const;
+
+  private:
+    // CompactLightBounds Private Methods
+    PBRT_CPU_GPU
+    static unsigned int QuantizeCos(Float c) {
+        // Round down so that the quantized cone bounds the original one
+        CHECK(c >= -1 && c <= 1);
+        return std::floor(32767.f * ((c + 1) / 2));
+    }
+
+    PBRT_CPU_GPU
+    static Float QuantizeBounds(Float c, Float min, Float max) {
+        CHECK(c >= min && c <= max);
+        if (min == max)
+            return 0;
+        return 65535.f * Clamp((c - min) / (max - min), 0, 1);
+    }
+
+    // CompactLightBounds Private Members
+    Vector3f w;
+    Float phi = 0;
+    unsigned int qCosTheta_o : 15;
+    unsigned int qCosTheta_e : 15;
+    unsigned int twoSided : 1;
+    uint16_t qb[2][3];
+};
+
+// LightBVHNode Definition
+struct LightBVHNode {
+    // LightBVHNode Public Methods
+    PBRT_CPU_GPU
+    static LightBVHNode MakeLeaf(unsigned int lightIndex, const CompactLightBounds &cb) {
+        return LightBVHNode{cb, {lightIndex, 1}};
+    }
+
+    PBRT_CPU_GPU
+    static LightBVHNode MakeInterior(unsigned int child1Index,
+                                     const CompactLightBounds &cb) {
+        return LightBVHNode{cb, {child1Index, 0}};
+    }
+
+    std::string ToString() const;
+
+    // LightBVHNode Public Members
+    CompactLightBounds lightBounds;
+    struct {
+        unsigned int childOrLightIndex : 31;
+        unsigned int isLeaf : 1;
+    };
+};
+
+// Light BVH Function Declarations
+LightBounds BuildLightBVH(std::vector<std::pair<int, LightBounds>> &bvhLights, int start,
+                          int end, int nodeIndex, uint64_t bitTrail, int depth,
+                          const Bounds3f &allLightBounds,
+                          pstd::vector<LightBVHNode> &nodes,
+                          std::vector<uint64_t> &bitTrails);
+
 // LightBase Definition
 class LightBase {
   public:
@@ -551,6 +666,125 @@ class DiffuseAreaLight : public LightBase {
     Image image;
 };
 
+// TriangleMeshLight Definition
+class TriangleMeshLight : public LightBase {
+  public:
+    // TriangleMeshLight Public Methods
+    TriangleMeshLight(const Transform &renderFromLight,
+                      const MediumInterface &mediumInterface, SpectrumHandle Le,
+                      Float scale, pstd::span<const ShapeHandle> triangles, Image image,
+                      const RGBColorSpace *imageColorSpace, bool twoSided,
+                      Allocator alloc);
+
+    static TriangleMeshLight *Create(const Transform &renderFromLight,
+                                     MediumHandle medium,
+                                     const ParameterDictionary &parameters,
+                                     const RGBColorSpace *colorSpace, const FileLoc *loc,
+                                     Allocator alloc,
+                                     pstd::span<const ShapeHandle> triangles);
+
+    void Preprocess(const Bounds3f &sceneBounds) {}
+
+    SampledSpectrum Phi(const SampledWavelengths &lambda) const;
+
+    PBRT_CPU_GPU
+    LightLeSample SampleLe(const Point2f &u1, const Point2f &u2,
+                           SampledWavelengths &lambda, Float time) const;
+    PBRT_CPU_GPU
+    void PDF_Le(const Interaction &, Vector3f &w, Float *pdfPos, Float *pdfDir) const;
+
+    LightBounds Bounds() const { return lightBounds; }
+
+    PBRT_CPU_GPU
+    void PDF_Le(const Ray &, Float *pdfPos, Float *pdfDir) const {
+        LOG_FATAL("Shouldn't be called for area lights");
+    }
+
+    std::string ToString() const;
+
+    PBRT_CPU_GPU
+    SampledSpectrum L(const Point3f &p, const Normal3f &n, const Point2f &uv,
+                      const Vector3f &w, const SampledWavelengths &lambda) const {
+        if (!twoSided && Dot(n, w) < 0)
+            return SampledSpectrum(0.f);
+
+        if (image) {
+            RGB rgb;
+            for (int c = 0; c < 3; ++c)
+                rgb[c] = image.BilerpChannel(uv, c);
+            return scale * RGBSpectrum(*imageColorSpace, rgb).Sample(lambda);
+        } else
+            return scale * Lemit.Sample(lambda);
+    }
+
+    PBRT_CPU_GPU
+    LightLiSample SampleLi(LightSampleContext ctx, Point2f u, SampledWavelengths lambda,
+                           LightSamplingMode mode) const {
+        // Choose a triangle using the mesh's importance tree
+        Float triPMF;
+        int triIndex = sampleTriangle(ctx.p(), ctx.ns, u[0], &triPMF, &u[0]);
+        if (triIndex == -1)
+            return {};
+
+        // Sample point on the chosen triangle
+        ShapeSampleContext shapeCtx(ctx.pi, ctx.n, ctx.ns, 0 /* time */);
+        pstd::optional<ShapeSample> ss = triangles[triIndex]->Sample(shapeCtx, u);
+        if (!ss)
+            return {};
+        ss->intr.mediumInterface = &mediumInterface;
+        DCHECK(!std::isnan(ss->pdf));
+        if (ss->pdf == 0 || LengthSquared(ss->intr.p() - ctx.p()) == 0)
+            return {};
+
+        // Return _LightLiSample_ for sampled point on mesh
+        Vector3f wi = Normalize(ss->intr.p() - ctx.p());
+        SampledSpectrum Le = L(ss->intr.p(), ss->intr.n, ss->intr.uv, -wi, lambda);
+        if (!Le)
+            return {};
+        return LightLiSample(this, Le, wi, triPMF * ss->pdf, ss->intr);
+    }
+
+    PBRT_CPU_GPU
+    Float PDF_Li(LightSampleContext ctx, Vector3f wi, LightSamplingMode mode) const {
+        // Find the triangle that the ray from _ctx_ along _wi_ hits first
+        ShapeSampleContext shapeCtx(ctx.pi, ctx.n, ctx.ns, 0 /* time */);
+        int triIndex = intersectTriangle(shapeCtx.SpawnRay(wi));
+        if (triIndex == -1)
+            return 0;
+
+        Float triPMF = trianglePMF(ctx.p(), ctx.ns, triIndex);
+        if (triPMF == 0)
+            return 0;
+        return triPMF * triangles[triIndex]->PDF(shapeCtx, wi);
+    }
+
+  private:
+    // TriangleMeshLight Private Methods
+    PBRT_CPU_GPU
+    int sampleTriangle(Point3f p, Normal3f n, Float u, Float *pmf,
+                       Float *uRemapped) const;
+    PBRT_CPU_GPU
+    Float trianglePMF(Point3f p, Normal3f n, int triIndex) const;
+    PBRT_CPU_GPU
+    int intersectTriangle(const Ray &ray) const;
+
+    // TriangleMeshLight Private Members
+    DenselySampledSpectrum Lemit;
+    Float scale;
+    bool twoSided;
+    Float area;
+    const RGBColorSpace *imageColorSpace;
+    Image image;
+    pstd::vector<const Triangle *> triangles;
+    // Importance tree over the mesh's triangles, laid out like the light BVH
+    pstd::vector<LightBVHNode> nodes;
+    pstd::vector<uint64_t> triangleBitTrails;
+    Bounds3f allTriangleBounds;
+    LightBounds lightBounds;
+    // Area-proportional triangle distribution for emission sampling
+    AliasTable areaDistrib;
+};
+
 // UniformInfiniteLight Definition
 class UniformInfiniteLight : public LightBase {
   public:
@@ -206,3 +206,50 @@ TEST(LightBounds, Basics) {
         EXPECT_LT(impLow / impHigh, .2);
     }
 }
+
+TEST(TriangleMeshLight, Sampling) {
+    // Emissive grid of 16x16 quads in the z=0 plane
+    constexpr int n = 16;
+    std::vector<Point3f> p;
+    for (int y = 0; y <= n; ++y)
+        for (int x = 0; x <= n; ++x)
+            p.push_back(Point3f(Float(x) / n, Float(y) / n, 0));
+    std::vector<int> indices;
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            int v00 = y * (n + 1) + x, v10 = v00 + 1, v01 = v00 + n + 1,
+                v11 = v01 + 1;
+            indices.insert(indices.end(), {v00, v10, v11, v00, v11, v01});
+        }
+    Transform id;
+    // leaks...
+    TriangleMesh *mesh =
+        new TriangleMesh(id, false /* rev orientation */, indices, p, {}, {}, {}, {});
+    pstd::vector<ShapeHandle> tris = Triangle::CreateTriangles(mesh, Allocator());
+
+    static ConstantSpectrum Le(2.);
+    TriangleMeshLight light(id, MediumInterface(), &Le, 1.f /* scale */, tris, Image(),
+                            nullptr, true /* two sided */, Allocator());
+    SampledWavelengths lambda = SampledWavelengths::SampleUniform(0.5);
+    EXPECT_FLOAT_EQ(2 * 2 * Pi, light.Phi(lambda)[0]);
+
+    RNG rng;
+    auto r = [&rng]() { return rng.Uniform<Float>(); };
+    for (int i = 0; i < 200; ++i) {
+        // Light sampling densities should match the PDF_Li() method
+        Point3f pRef(Lerp(r(), -1, 2), Lerp(r(), -1, 2), Lerp(r(), -2, 2));
+        LightSampleContext ctx(Point3fi(pRef), Normal3f(0, 0, 0), Normal3f(0, 0, 0));
+        pstd::optional<LightLiSample> ls = light.SampleLi(
+            ctx, Point2f(r(), r()), lambda, LightSamplingMode::WithoutMIS);
+        if (!ls)
+            continue;
+        Float pdf = light.PDF_Li(ctx, ls->wi, LightSamplingMode::WithoutMIS);
+        EXPECT_NEAR(ls->pdf, pdf, 1e-3f * ls->pdf) << pRef;
+
+        // Uniform area sampling for emission
+        pstd::optional<LightLeSample> les =
+            light.SampleLe(Point2f(r(), r()), Point2f(r(), r()), lambda, 0 /* time */);
+        ASSERT_TRUE(les.has_value());
+        EXPECT_FLOAT_EQ(1, les->pdfPos);
+    }
+}
@@ -12,6 +12,7 @@
 #include <pbrt/util/lowdiscrepancy.h>
 #include <pbrt/util/math.h>
 #include <pbrt/util/memory.h>
+#include <pbrt/util/parallel.h>
 #include <pbrt/util/print.h>
 #include <pbrt/util/sampling.h>
 #include <pbrt/util/spectrum.h>
@@ -91,148 +92,37 @@ STAT_INT_DISTRIBUTION("Integrator/Lights sampled per lookup", nLightsSampled);
 BVHLightSampler::BVHLightSampler(pstd::span<const LightHandle> lights, Allocator alloc)
     : lights(lights.begin(), lights.end(), alloc),
       infiniteLights(alloc),
-      lightToNode(alloc) {
-    std::vector<std::pair<LightHandle, LightBounds>> bvhLights;
+      nodes(alloc),
+      lightToBitTrail(alloc) {
+    std::vector<std::pair<int, LightBounds>> bvhLights;
     // Partition lights into _infiniteLights_ and _bvhLights_
-    for (const auto &light : lights) {
+    for (size_t i = 0; i < lights.size(); ++i) {
+        LightHandle light = lights[i];
         LightBounds lightBounds = light.Bounds();
         if (!lightBounds)
             infiniteLights.push_back(light);
-        else if (lightBounds.phi > 0)
-            bvhLights.push_back(std::make_pair(light, lightBounds));
+        else if (lightBounds.phi > 0) {
+            bvhLights.push_back(std::make_pair(i, lightBounds));
+            allLightBounds = Union(allLightBounds, lightBounds.b);
+        }
     }
 
     if (bvhLights.empty())
         return;
-    int nNodes = 0;
-    root = buildBVH(bvhLights, 0, bvhLights.size(), alloc, &nNodes);
-    lightBVHBytes += nNodes * sizeof(LightBVHNode);
-}
-
-LightBVHNode *BVHLightSampler::buildBVH(
-    std::vector<std::pair<LightHandle, LightBounds>> &lights, int start, int end,
-    Allocator alloc, int *nNodes) {
-    CHECK_LT(start, end);
-    (*nNodes)++;
-    int nLights = end - start;
-    if (nLights == 1) {
-        LightBVHNode *node =
-            alloc.new_object<LightBVHNode>(lights[start].first, lights[start].second);
-        lightToNode.Insert(lights[start].first, node);
-        return node;
-    }
-
-    Bounds3f bounds, centroidBounds;
-    for (int i = start; i < end; ++i) {
-        const LightBounds &lb = lights[i].second;
-        bounds = Union(bounds, lb.b);
-        centroidBounds = Union(centroidBounds, lb.Centroid());
-    }
-
-    // Modified SAH
-    // Replace # of primitives with emitter power
-    // TODO: use the more efficient bounds/cost sweep calculation from v4
-
-    Float minCost = Infinity;
-    int minCostSplitBucket = -1, minCostSplitDim = -1;
-    constexpr int nBuckets = 12;
-
-    for (int dim = 0; dim < 3; ++dim) {
-        if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) {
-            continue;
-        }
-
-        LightBounds bucketLightBounds[nBuckets];
-
-        for (int i = start; i < end; ++i) {
-            Point3f pc = lights[i].second.Centroid();
-            int b = nBuckets * centroidBounds.Offset(pc)[dim];
-            if (b == nBuckets)
-                b = nBuckets - 1;
-            CHECK_GE(b, 0);
-            CHECK_LT(b, nBuckets);
-            bucketLightBounds[b] = Union(bucketLightBounds[b], lights[i].second);
-        }
-
-        // Compute costs for splitting after each bucket
-        Float cost[nBuckets - 1];
-        for (int i = 0; i < nBuckets - 1; ++i) {
-            LightBounds b0, b1;
-
-            for (int j = 0; j <= i; ++j)
-                b0 = Union(b0, bucketLightBounds[j]);
-            for (int j = i + 1; j < nBuckets; ++j)
-                b1 = Union(b1, bucketLightBounds[j]);
-
-            auto Momega = [](const LightBounds &b) {
-                Float theta_w = std::min(b.theta_o + b.theta_e, Pi);
-                return 2 * Pi * (1 - std::cos(b.theta_o)) +
-                       Pi / 2 *
-                           (2 * theta_w * std::sin(b.theta_o) -
-                            std::cos(b.theta_o - 2 * theta_w) -
-                            2 * b.theta_o * std::sin(b.theta_o) + std::cos(b.theta_o));
-            };
-
-            // Can simplify since we always split
-            Float Kr = MaxComponentValue(bounds.Diagonal()) / bounds.Diagonal()[dim];
-            cost[i] = Kr * (b0.phi * Momega(b0) * b0.b.SurfaceArea() +
-                            b1.phi * Momega(b1) * b1.b.SurfaceArea());
-        }
-
-        // Find bucket to split at that minimizes SAH metric
-        for (int i = 1; i < nBuckets - 1; ++i) {
-            if (cost[i] > 0 && cost[i] < minCost) {
-                minCost = cost[i];
-                minCostSplitBucket = i;
-                minCostSplitDim = dim;
-            }
-        }
-    }
-
-    int mid;
-    if (minCostSplitDim == -1) {
-        mid = (start + end) / 2;
-    } else {
-        const auto *pmid = std::partition(
-            &lights[start], &lights[end - 1] + 1,
-            [=](const std::pair<LightHandle, LightBounds> &l) {
-                int b = nBuckets *
-                        centroidBounds.Offset(l.second.Centroid())[minCostSplitDim];
-                if (b == nBuckets)
-                    b = nBuckets - 1;
-                CHECK_GE(b, 0);
-                CHECK_LT(b, nBuckets);
-                return b <= minCostSplitBucket;
-            });
-        mid = pmid - &lights[0];
-
-        if (mid == start || mid == end) {
-            mid = (start + end) / 2;
-        }
-        CHECK(mid > start && mid < end);
-    }
-
-    LightBVHNode *node =
-        alloc.new_object<LightBVHNode>(buildBVH(lights, start, mid, alloc, nNodes),
-                                       buildBVH(lights, mid, end, alloc, nNodes));
-    node->children[0]->parent = node->children[1]->parent = node;
-
-    return node;
+    // Build the flattened light BVH; a tree over $n$ lights has $2n-1$ nodes
+    nodes.resize(2 * bvhLights.size() - 1);
+    std::vector<uint64_t> lightBitTrails(lights.size(), 0);
+    BuildLightBVH(bvhLights, 0, bvhLights.size(), 0, 0, 0, allLightBounds, nodes,
+                  lightBitTrails);
+    for (const auto &bvhLight : bvhLights)
+        lightToBitTrail.Insert(this->lights[bvhLight.first],
+                               lightBitTrails[bvhLight.first]);
+    lightBVHBytes += nodes.size() * sizeof(LightBVHNode);
 }
 
 std::string BVHLightSampler::ToString() const {
-    return StringPrintf("[ BVHLightSampler root: %s ]",
-                        root ? root->ToString() : std::string("(nullptr)"));
-}
-
-std::string LightBVHNode::ToString() const {
-    std::string s =
-        StringPrintf("[ LightBVHNode lightBounds: %s isLeaf: %s ", lightBounds, isLeaf);
-    if (isLeaf)
-        s += StringPrintf("light: %s ", light);
-    else
-        s += StringPrintf("children[0]: %s children[1]: %s", *children[0], *children[1]);
-    return s + "]";
+    return StringPrintf("[ BVHLightSampler nodes: %d allLightBounds: %s ]", nodes.size(),
+                        allLightBounds);
 }
 
 // ExhaustiveLightSampler Method Definitions
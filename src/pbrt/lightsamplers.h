@@ -107,34 +107,6 @@ class PowerLightSampler {
     AliasTable aliasTable;
 };
 
-// LightBVHNode Definition
-class LightBVHNode {
-  public:
-    LightBVHNode(LightHandle light, const LightBounds &lightBounds)
-        : light(light), lightBounds(lightBounds) {
-        isLeaf = true;
-    }
-    LightBVHNode(LightBVHNode *c0, LightBVHNode *c1)
-        : lightBounds(Union(c0->lightBounds, c1->lightBounds)) {
-        isLeaf = false;
-        children[0] = c0;
-        children[1] = c1;
-    }
-
-    PBRT_CPU_GPU
-    pstd::optional<SampledLight> Sample(const LightSampleContext &ctx, Float u) const;
-
-    std::string ToString() const;
-
-    LightBounds lightBounds;
-    bool isLeaf;
-    union {
-        LightHandle light;
-        LightBVHNode *children[2];
-    };
-    LightBVHNode *parent = nullptr;
-};
-
 // BVHLightSampler Definition
 class BVHLightSampler {
   public:
@@ -147,7 +119,7 @@ class BVHLightSampler {
         Normal3f n = ctx.ns;
         // FIXME: handle no lights at all w/o a NaN...
         Float pInfinite = Float(infiniteLights.size()) /
-                          Float(infiniteLights.size() + (root != nullptr ? 1 : 0));
+                          Float(infiniteLights.size() + (nodes.empty() ? 0 : 1));
 
         if (u < pInfinite) {
             u = std::min<Float>(u * pInfinite, OneMinusEpsilon);
@@ -156,21 +128,25 @@ class BVHLightSampler {
             Float pdf = pInfinite * 1.f / infiniteLights.size();
             return SampledLight{infiniteLights[index], pdf};
         } else {
-            if (root == nullptr)
+            if (nodes.empty())
                 return {};
 
             u = std::min<Float>((u - pInfinite) / (1 - pInfinite), OneMinusEpsilon);
-            const LightBVHNode *node = root;
+            int nodeIndex = 0;
             Float pdf = (1 - pInfinite);
             while (true) {
-                if (node->isLeaf) {
-                    if (node->lightBounds.Importance(p, n) > 0)
-                        return SampledLight{node->light, pdf};
+                const LightBVHNode &node = nodes[nodeIndex];
+                if (node.isLeaf) {
+                    if (node.lightBounds.Importance(p, n, allLightBounds) > 0)
+                        return SampledLight{lights[node.childOrLightIndex], pdf};
                     return {};
                 } else {
+                    // Children are the next node and the one at _childOrLightIndex_
+                    const LightBVHNode *children[2] = {&nodes[nodeIndex + 1],
+                                                       &nodes[node.childOrLightIndex]};
                     pstd::array<Float, 2> ci = {
-                        node->children[0]->lightBounds.Importance(p, n),
-                        node->children[1]->lightBounds.Importance(p, n)};
+                        children[0]->lightBounds.Importance(p, n, allLightBounds),
+                        children[1]->lightBounds.Importance(p, n, allLightBounds)};
                     if (ci[0] == 0 && ci[1] == 0)
                         // It may happen that we follow a path down the tree and later
                         // find that there aren't any lights that illuminate our point;
@@ -181,7 +157,7 @@ class BVHLightSampler {
                     Float nodePDF;
                     int child = SampleDiscrete(ci, u, &nodePDF, &u);
                     pdf *= nodePDF;
-                    node = node->children[child];
+                    nodeIndex = (child == 0) ? (nodeIndex + 1) : node.childOrLightIndex;
                 }
             }
         }
@@ -189,28 +165,36 @@ class BVHLightSampler {
 
     PBRT_CPU_GPU
     Float PDF(const LightSampleContext &ctx, LightHandle light) const {
-        if (!lightToNode.HasKey(light))
-            return 1.f / (infiniteLights.size() + (root != nullptr ? 1 : 0));
-
-        LightBVHNode *node = lightToNode[light];
-        Float pdf = 1;
+        if (!lightToBitTrail.HasKey(light))
+            return 1.f / (infiniteLights.size() + (nodes.empty() ? 0 : 1));
 
+        // Follow _light_'s bit trail down from the root, accumulating the PDF
+        uint64_t bitTrail = lightToBitTrail[light];
         Point3f p = ctx.p();
         Normal3f n = ctx.ns;
-        if (node->lightBounds.Importance(p, n) == 0)
-            return 0;
-
-        for (; node->parent != nullptr; node = node->parent) {
+        Float pInfinite = Float(infiniteLights.size()) / Float(infiniteLights.size() + 1);
+        Float pdf = 1 - pInfinite;
+        int nodeIndex = 0;
+        while (true) {
+            const LightBVHNode &node = nodes[nodeIndex];
+            if (node.isLeaf) {
+                DCHECK(light == lights[node.childOrLightIndex]);
+                if (node.lightBounds.Importance(p, n, allLightBounds) == 0)
+                    return 0;
+                return pdf;
+            }
+            const LightBVHNode *child0 = &nodes[nodeIndex + 1];
+            const LightBVHNode *child1 = &nodes[node.childOrLightIndex];
             pstd::array<Float, 2> ci = {
-                node->parent->children[0]->lightBounds.Importance(p, n),
-                node->parent->children[1]->lightBounds.Importance(p, n)};
-            int childIndex = static_cast<int>(node == node->parent->children[1]);
-            DCHECK_GT(ci[childIndex], 0);
+                child0->lightBounds.Importance(p, n, allLightBounds),
+                child1->lightBounds.Importance(p, n, allLightBounds)};
+            int childIndex = bitTrail & 1;
+            if (ci[childIndex] == 0)
+                return 0;
             pdf *= ci[childIndex] / (ci[0] + ci[1]);
+            nodeIndex = (childIndex == 0) ? (nodeIndex + 1) : node.childOrLightIndex;
+            bitTrail >>= 1;
         }
-
-        Float pInfinite = Float(infiniteLights.size()) / Float(infiniteLights.size() + 1);
-        return pdf * (1.f - pInfinite);
     }
 
     PBRT_CPU_GPU
@@ -231,14 +215,13 @@ class BVHLightSampler {
     std::string ToString() const;
 
   private:
-    // BVHLightSampler Private Methods
-    LightBVHNode *buildBVH(std::vector<std::pair<LightHandle, LightBounds>> &lights,
-                           int start, int end, Allocator alloc, int *nNodes);
-
     // BVHLightSampler Private Members
-    LightBVHNode *root = nullptr;
     pstd::vector<LightHandle> lights, infiniteLights;
-    HashMap<LightHandle, LightBVHNode *, LightHandleHash> lightToNode;
+    // Depth-first light BVH; a node's first child directly follows it
+    pstd::vector<LightBVHNode> nodes;
+    Bounds3f allLightBounds;
+    // Path from the root to each light's leaf, one bit per level
+    HashMap<LightHandle, uint64_t, LightHandleHash> lightToBitTrail;
 };
 
 // ExhaustiveLightSampler Definition
@@ -289,6 +289,58 @@ TEST(BVHLightSampling, PdfMethod) {
     }
 }
 
+TEST(BVHLightSampling, PdfMethodManyLights) {
+    RNG rng(6502);
+    auto r = [&rng]() { return rng.Uniform<Float>(); };
+
+    std::vector<LightHandle> lights;
+    std::vector<ShapeHandle> tris;
+    std::tie(lights, tris) = randomLights(1000, Allocator());
+
+    BVHLightSampler distrib(lights, Allocator());
+    for (int i = 0; i < 1000; ++i) {
+        Point3f p(-1 + 3 * r(), -1 + 3 * r(), -1 + 3 * r());
+        Interaction intr(Point3fi(p), Normal3f(0, 0, 0), Point2f(0, 0));
+        pstd::optional<SampledLight> sampledLight =
+            distrib.Sample(intr, rng.Uniform<Float>());
+        if (sampledLight)
+            EXPECT_NEAR(sampledLight->pdf, distrib.PDF(intr, sampledLight->light),
+                        1e-5f * sampledLight->pdf);
+    }
+}
+
+TEST(BVHLightSampling, DeepTree) {
+    // Exponentially spaced and sized lights make SAH splits peel off one light
+    // at a time, which would give a tree deeper than 64-bit trails can encode
+    std::vector<std::pair<int, LightBounds>> bvhLights;
+    Bounds3f allLightBounds;
+    int nLights = 84;
+    for (int i = 0; i < nLights; ++i) {
+        Float scale = std::pow(Float(7), i / 3 - 14);
+        Point3f p(0, 0, 0);
+        p[i % 3] = scale;
+        Bounds3f b(p, p + Vector3f(.1f * scale, .1f * scale, .1f * scale));
+        bvhLights.push_back(std::make_pair(i, LightBounds(b, Vector3f(0, 0, 1), 1, Pi,
+                                                         Pi / 2, false)));
+        allLightBounds = Union(allLightBounds, b);
+    }
+    pstd::vector<LightBVHNode> nodes(2 * nLights - 1);
+    std::vector<uint64_t> bitTrails(nLights);
+    BuildLightBVH(bvhLights, 0, nLights, 0, 0, 0, allLightBounds, nodes, bitTrails);
+
+    // Each light's bit trail should lead to its leaf within 64 levels
+    for (int i = 0; i < nLights; ++i) {
+        int nodeIndex = 0, depth = 0;
+        uint64_t bitTrail = bitTrails[i];
+        while (!nodes[nodeIndex].isLeaf) {
+            ASSERT_LT(depth++, 64);
+            nodeIndex = (bitTrail & 1) ? nodes[nodeIndex].childOrLightIndex : nodeIndex + 1;
+            bitTrail >>= 1;
+        }
+        EXPECT_EQ(i, nodes[nodeIndex].childOrLightIndex);
+    }
+}
+
 TEST(ExhaustiveLightSampling, PdfMethod) {
     RNG rng(5251);
     auto r = [&rng]() { return rng.Uniform<Float>(); };
@@ -188,7 +188,7 @@ DiffuseMaterial *DiffuseMaterial::Create(const TextureParameterDictionary &param
     FloatTextureHandle sigma = parameters.GetFloatTexture("sigma", 0.f, alloc);
     FloatTextureHandle displacement =
         parameters.GetFloatTextureOrNull("displacement", alloc);
-    return alloc.new_object<DiffuseMaterial>(reflectance, sigma, displacement);
+    return alloc.new_object<DiffuseMaterial>(reflectance, sigma, displacement, alloc);
 }
 
 // ConductorMaterial Method Definitions
@@ -217,7 +217,7 @@ ConductorMaterial *ConductorMaterial::Create(const TextureParameterDictionary &p
         parameters.GetFloatTextureOrNull("displacement", alloc);
     bool remapRoughness = parameters.GetOneBool("remaproughness", true);
     return alloc.new_object<ConductorMaterial>(eta, k, uRoughness, vRoughness,
-                                               displacement, remapRoughness);
+                                               displacement, remapRoughness, alloc);
 }
 
 // CoatedDiffuseMaterial Method Definitions
@@ -255,9 +255,31 @@ CoatedDiffuseMaterial *CoatedDiffuseMaterial::Create(
     FloatTextureHandle displacement =
         parameters.GetFloatTextureOrNull("displacement", alloc);
     bool remapRoughness = parameters.GetOneBool("remaproughness", true);
+
+    // Use tabulated BSDF for constant isotropic coatings if requested
+    const CoatedDiffuseTable *table = nullptr;
+    if (parameters.GetOneBool("tabulated", false)) {
+        FloatConstantTexture *u = uRoughness.CastOrNullptr<FloatConstantTexture>();
+        FloatConstantTexture *v = vRoughness.CastOrNullptr<FloatConstantTexture>();
+        FloatConstantTexture *t = thickness.CastOrNullptr<FloatConstantTexture>();
+        FloatConstantTexture *e = eta.CastOrNullptr<FloatConstantTexture>();
+        if (!u || !v || !t || !e || !config.twoSided)
+            Warning(loc, "\"tabulated\" requires constant \"roughness\", "
+                         "\"thickness\", and \"eta\" and a two-sided material. "
+                         "Ignoring.");
+        else if (u->Evaluate({}) != v->Evaluate({}))
+            Warning(loc, "\"tabulated\" requires isotropic roughness. Ignoring.");
+        else {
+            Float alpha = u->Evaluate({});
+            if (remapRoughness)
+                alpha = TrowbridgeReitzDistribution::RoughnessToAlpha(alpha);
+            table = GetCoatedDiffuseTable(alpha, e->Evaluate({}), t->Evaluate({}), alloc);
+        }
+    }
+
     return alloc.new_object<CoatedDiffuseMaterial>(reflectance, uRoughness, vRoughness,
                                                    thickness, eta, displacement,
-                                                   remapRoughness, config);
+                                                   remapRoughness, config, table);
 }
 
 std::string CoatedConductorMaterial::ToString() const {
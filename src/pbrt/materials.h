@@ -429,20 +429,19 @@ class DiffuseMaterial {
     std::string ToString() const;
 
     DiffuseMaterial(SpectrumTextureHandle reflectance, FloatTextureHandle sigma,
-                    FloatTextureHandle displacement)
-        : displacement(displacement), reflectance(reflectance), sigma(sigma) {}
+                    FloatTextureHandle displacement, Allocator alloc = {})
+        : displacement(displacement), reflectance(reflectance, alloc), sigma(sigma) {}
 
     template <typename TextureEvaluator>
     PBRT_CPU_GPU bool CanEvaluateTextures(TextureEvaluator texEval) const {
-        return texEval.CanEvaluate({sigma}, {reflectance});
+        return texEval.CanEvaluate({}, {reflectance});
     }
 
     template <typename TextureEvaluator>
     PBRT_CPU_GPU BSDF GetBSDF(TextureEvaluator texEval, MaterialEvalContext ctx,
                               SampledWavelengths &lambda, IdealDiffuseBxDF *bxdf) const {
         // Evaluate textures for _DiffuseMaterial_ and allocate BSDF
-        SampledSpectrum r = Clamp(texEval(reflectance, ctx, lambda), 0, 1);
-        Float sig = Clamp(texEval(sigma, ctx), 0, 90);
+        SampledSpectrum r = Clamp(reflectance.Evaluate(texEval, ctx, lambda), 0, 1);
         *bxdf = IdealDiffuseBxDF(r);
         return BSDF(ctx.wo, ctx.n, ctx.ns, ctx.dpdus, bxdf);
     }
@@ -450,7 +449,7 @@ class DiffuseMaterial {
   private:
     // DiffuseMaterial Private Members
     FloatTextureHandle displacement;
-    SpectrumTextureHandle reflectance;
+    SpecializedSpectrumTexture reflectance;
     FloatTextureHandle sigma;
 };
 
@@ -470,28 +469,34 @@ class ConductorMaterial {
     PBRT_CPU_GPU BSDF GetBSDF(TextureEvaluator texEval, MaterialEvalContext ctx,
                               SampledWavelengths &lambda, ConductorBxDF *bxdf) const {
         // Return BSDF for _ConductorMaterial_
-        Float uRough = texEval(uRoughness, ctx), vRough = texEval(vRoughness, ctx);
-        if (remapRoughness) {
-            uRough = TrowbridgeReitzDistribution::RoughnessToAlpha(uRough);
-            vRough = TrowbridgeReitzDistribution::RoughnessToAlpha(vRough);
-        }
-        SampledSpectrum etas = texEval(eta, ctx, lambda);
-        SampledSpectrum ks = texEval(k, ctx, lambda);
+        TrowbridgeReitzDistribution distrib =
+            constantDistrib ? *constantDistrib
+                            : distribution(texEval(uRoughness, ctx),
+                                           texEval(vRoughness, ctx), remapRoughness);
+        SampledSpectrum etas = eta.Evaluate(texEval, ctx, lambda);
+        SampledSpectrum ks = k.Evaluate(texEval, ctx, lambda);
 
-        TrowbridgeReitzDistribution distrib(uRough, vRough);
         *bxdf = ConductorBxDF(distrib, etas, ks);
         return BSDF(ctx.wo, ctx.n, ctx.ns, ctx.dpdus, bxdf);
     }
 
     ConductorMaterial(SpectrumTextureHandle eta, SpectrumTextureHandle k,
                       FloatTextureHandle uRoughness, FloatTextureHandle vRoughness,
-                      FloatTextureHandle displacement, bool remapRoughness)
+                      FloatTextureHandle displacement, bool remapRoughness,
+                      Allocator alloc = {})
         : displacement(displacement),
-          eta(eta),
-          k(k),
+          eta(eta, alloc),
+          k(k, alloc),
           uRoughness(uRoughness),
           vRoughness(vRoughness),
-          remapRoughness(remapRoughness) {}
+          remapRoughness(remapRoughness) {
+        // Precompute the microfacet distribution for constant roughness
+        FloatConstantTexture *uc = uRoughness.CastOrNullptr<FloatConstantTexture>();
+        FloatConstantTexture *vc = vRoughness.CastOrNullptr<FloatConstantTexture>();
+        if (uc && vc)
+            constantDistrib = distribution(uc->Evaluate({}), vc->Evaluate({}),
+                                           remapRoughness);
+    }
 
     static const char *Name() { return "ConductorMaterial"; }
 
@@ -511,11 +516,23 @@ class ConductorMaterial {
     std::string ToString() const;
 
   private:
+    // ConductorMaterial Private Methods
+    PBRT_CPU_GPU
+    static TrowbridgeReitzDistribution distribution(Float uRough, Float vRough,
+                                                    bool remapRoughness) {
+        if (remapRoughness) {
+            uRough = TrowbridgeReitzDistribution::RoughnessToAlpha(uRough);
+            vRough = TrowbridgeReitzDistribution::RoughnessToAlpha(vRough);
+        }
+        return TrowbridgeReitzDistribution(uRough, vRough);
+    }
+
     // ConductorMaterial Private Data
     FloatTextureHandle displacement;
-    SpectrumTextureHandle eta, k;
+    SpecializedSpectrumTexture eta, k;
     FloatTextureHandle uRoughness, vRoughness;
     bool remapRoughness;
+    pstd::optional<TrowbridgeReitzDistribution> constantDistrib;
 };
 
 // CoatedDiffuseMaterial Definition
@@ -528,7 +545,8 @@ class CoatedDiffuseMaterial {
                           FloatTextureHandle uRoughness, FloatTextureHandle vRoughness,
                           FloatTextureHandle thickness, FloatTextureHandle eta,
                           FloatTextureHandle displacement, bool remapRoughness,
-                          LayeredBxDFConfig config)
+                          LayeredBxDFConfig config,
+                          const CoatedDiffuseTable *table = nullptr)
         : displacement(displacement),
           reflectance(reflectance),
           uRoughness(uRoughness),
@@ -536,7 +554,8 @@ class CoatedDiffuseMaterial {
           thickness(thickness),
           eta(eta),
           remapRoughness(remapRoughness),
-          config(config) {}
+          config(config),
+          table(table) {}
 
     static const char *Name() { return "CoatedDiffuseMaterial"; }
 
@@ -564,9 +583,10 @@ class CoatedDiffuseMaterial {
         Float thick = texEval(thickness, ctx);
         Float e = texEval(eta, ctx);
 
-        *bxdf =
-            CoatedDiffuseBxDF(DielectricInterfaceBxDF(e, distrib), IdealDiffuseBxDF(r),
-                              thick, SampledSpectrum(0) /* albedo */, 0 /* g */, config);
+        *bxdf = CoatedDiffuseBxDF(DielectricInterfaceBxDF(e, distrib),
+                                  IdealDiffuseBxDF(r), thick,
+                                  SampledSpectrum(0) /* albedo */, 0 /* g */, config,
+                                  table);
         return BSDF(ctx.wo, ctx.n, ctx.ns, ctx.dpdus, bxdf);
     }
 
@@ -592,6 +612,7 @@ class CoatedDiffuseMaterial {
     FloatTextureHandle uRoughness, vRoughness, thickness, eta;
     bool remapRoughness;
     LayeredBxDFConfig config;
+    const CoatedDiffuseTable *table;
 };
 
 // CoatedConductorMaterial Definition
@@ -708,9 +729,7 @@ class SubsurfaceMaterial {
           vRoughness(vRoughness),
           eta(eta),
           remapRoughness(remapRoughness),
-          table(100, 64, alloc) {
-        ComputeBeamDiffusionBSSRDF(g, eta, &table);
-    }
+          table(GetBeamDiffusionBSSRDFTable(g, eta, alloc)) {}
 
     static const char *Name() { return "SubsurfaceMaterial"; }
 
@@ -752,10 +771,10 @@ class SubsurfaceMaterial {
             DCHECK(reflectance && mfp);
             SampledSpectrum mfree = ClampZero(scale * texEval(mfp, ctx, lambda));
             SampledSpectrum r = Clamp(texEval(reflectance, ctx, lambda), 0, 1);
-            SubsurfaceFromDiffuse(table, r, mfree, &sig_a, &sig_s);
+            SubsurfaceFromDiffuse(*table, r, mfree, &sig_a, &sig_s);
         }
         *bssrdf = TabulatedBSSRDF(ctx.p, ctx.dpdus, ctx.ns, ctx.wo, 0 /* FIXME: si.time*/,
-                                  eta, sig_a, sig_s, &table);
+                                  eta, sig_a, sig_s, table);
     }
 
     PBRT_CPU_GPU
@@ -777,7 +796,7 @@ class SubsurfaceMaterial {
     FloatTextureHandle uRoughness, vRoughness;
     Float eta;
     bool remapRoughness;
-    BSSRDFTable table;
+    const BSSRDFTable *table;
 };
 
 // DiffuseTransmissionMaterial Definition
@@ -11,6 +11,7 @@
 #include <pbrt/util/color.h>
 #include <pbrt/util/colorspace.h>
 #include <pbrt/util/error.h>
+#include <pbrt/util/file.h>
 #include <pbrt/util/memory.h>
 #include <pbrt/util/print.h>
 #include <pbrt/util/sampling.h>
@@ -19,6 +20,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <tuple>
 
 namespace pbrt {
 
@@ -249,6 +253,449 @@ std::string UniformGridMediumProvider::ToString() const {
         Le_spec, *colorSpace);
 }
 
+// SparseGridMediumProvider Method Definitions
+SparseGridMediumProvider::SparseGridMediumProvider(SparseGrid<Float> dgrid,
+                                                   SpectrumHandle Le,
+                                                   SparseGrid<Float> Legrid,
+                                                   Allocator alloc)
+    : densityGrid(std::move(dgrid)), Le_spec(Le, alloc), LeScaleGrid(std::move(Legrid)) {
+    volumeGridBytes += densityGrid.BytesAllocated() + LeScaleGrid.BytesAllocated();
+}
+
+SparseGridMediumProvider *SparseGridMediumProvider::Create(
+    const ParameterDictionary &parameters, const FileLoc *loc, Allocator alloc) {
+    SpectrumHandle Le =
+        parameters.GetOneSpectrum("Le", nullptr, SpectrumType::General, alloc);
+    if (Le == nullptr)
+        Le = alloc.new_object<ConstantSpectrum>(0.f);
+    SparseGrid<Float> densityGrid(alloc), LeGrid(alloc);
+
+    std::string filename = ResolveFilename(parameters.GetOneString("filename", ""));
+    if (!filename.empty()) {
+        // Read the grid's leaves directly from the file
+        if (!parameters.GetIntArray("voxels").empty())
+            ErrorExit(loc, "Both \"filename\" and \"voxels\" were provided for "
+                           "sparse grid medium.");
+        if (HasExtension(filename, "nvdb")) {
+            std::string gridName = parameters.GetOneString("gridname", "density");
+            densityGrid = ReadNanoVDB(filename, gridName, loc, alloc);
+            LeGrid = SparseGrid<Float>({Point3i(0, 0, 0)}, {1.f}, 1, 1, 1, alloc);
+        } else if (!ReadGridFile(filename, &densityGrid, &LeGrid, loc, alloc))
+            LeGrid = SparseGrid<Float>({Point3i(0, 0, 0)}, {1.f}, 1, 1, 1, alloc);
+        return alloc.new_object<SparseGridMediumProvider>(std::move(densityGrid), Le,
+                                                          std::move(LeGrid), alloc);
+    }
+
+    // Get the coordinates and densities of the stored voxels
+    std::vector<int> voxelCoords = parameters.GetIntArray("voxels");
+    std::vector<Float> density = parameters.GetFloatArray("density");
+    if (voxelCoords.empty())
+        ErrorExit(loc, "No \"voxels\" or \"filename\" provided for sparse grid medium.");
+    if (voxelCoords.size() % 3 != 0)
+        ErrorExit(loc, "Number of \"voxels\" values %d isn't a multiple of 3.",
+                  voxelCoords.size());
+    size_t nVoxels = voxelCoords.size() / 3;
+    if (density.size() != nVoxels)
+        ErrorExit(loc, "Sparse grid medium has %d density values; expected %d.",
+                  density.size(), nVoxels);
+
+    int nx = parameters.GetOneInt("nx", 1);
+    int ny = parameters.GetOneInt("ny", 1);
+    int nz = parameters.GetOneInt("nz", 1);
+    std::vector<Point3i> voxels(nVoxels);
+    Bounds3i gridBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
+    for (size_t i = 0; i < nVoxels; ++i) {
+        voxels[i] = Point3i(voxelCoords[3 * i], voxelCoords[3 * i + 1],
+                            voxelCoords[3 * i + 2]);
+        if (!InsideExclusive(voxels[i], gridBounds))
+            ErrorExit(loc, "Voxel %s is outside the %d x %d x %d grid.", voxels[i], nx,
+                      ny, nz);
+    }
+    std::vector<int>().swap(voxelCoords);
+    densityGrid = SparseGrid<Float>(voxels, density, nx, ny, nz, alloc);
+
+    std::vector<Float> LeScale = parameters.GetFloatArray("Lescale");
+    if (LeScale.empty())
+        LeGrid = SparseGrid<Float>({Point3i(0, 0, 0)}, {1.f}, 1, 1, 1, alloc);
+    else {
+        if (LeScale.size() != nVoxels)
+            ErrorExit(loc, "Expected %d values for \"Lescale\" but were given %d.",
+                      nVoxels, LeScale.size());
+        LeGrid = SparseGrid<Float>(voxels, LeScale, nx, ny, nz, alloc);
+    }
+
+    return alloc.new_object<SparseGridMediumProvider>(std::move(densityGrid), Le,
+                                                      std::move(LeGrid), alloc);
+}
+
+// Sparse grid files are little-endian and start with the 8 bytes "PBRTSPGD",
+// followed by int32 values for the format version (1), the grid resolution
+// _nx_, _ny_, _nz_, and whether "Lescale" values are present, and an int64
+// leaf count _n_. Then come _n_ int32 $(x,y,z)$ leaf origins, which must be
+// distinct multiples of 8, and _n_ blocks of $8^3$ float32 densities, with
+// $x$ varying fastest, followed by the same for "Lescale" if present.
+static constexpr char SparseGridFileMagic[8] = {'P', 'B', 'R', 'T', 'S', 'P', 'G', 'D'};
+static constexpr int32_t SparseGridFileVersion = 1;
+
+// Checks that leaf origins read from a file are distinct multiples of the leaf
+// resolution inside the grid, as required by _SparseGrid_
+static void CheckLeafOrigins(std::vector<Point3i> origins, int nx, int ny, int nz,
+                             const std::string &filename, const FileLoc *loc) {
+    constexpr int LeafRes = SparseGrid<Float>::LeafRes;
+    Bounds3i gridBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
+    for (Point3i p : origins)
+        if (!InsideExclusive(p, gridBounds) || ((p.x | p.y | p.z) & (LeafRes - 1)))
+            ErrorExit(loc, "%s: leaf origin %s isn't a multiple of %d inside the "
+                      "%d x %d x %d grid.", filename, p, LeafRes, nx, ny, nz);
+
+    auto less = [](Point3i a, Point3i b) {
+        return std::make_tuple(a.x, a.y, a.z) < std::make_tuple(b.x, b.y, b.z);
+    };
+    std::sort(origins.begin(), origins.end(), less);
+    auto iter = std::adjacent_find(origins.begin(), origins.end());
+    if (iter != origins.end())
+        ErrorExit(loc, "%s: leaf origin %s appears more than once.", filename, *iter);
+}
+
+bool SparseGridMediumProvider::WriteGridFile(const std::string &filename,
+                                             const SparseGrid<Float> &densityGrid,
+                                             const SparseGrid<Float> *LeScaleGrid) {
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+        Error("%s: %s", filename, ErrorString());
+        return false;
+    }
+    int32_t header[5] = {SparseGridFileVersion, densityGrid.xSize(), densityGrid.ySize(),
+                         densityGrid.zSize(), LeScaleGrid != nullptr};
+    int64_t nLeaves = densityGrid.NumLeaves();
+    bool ok = fwrite(SparseGridFileMagic, 1, 8, fp) == 8 &&
+              fwrite(header, sizeof(int32_t), 5, fp) == 5 &&
+              fwrite(&nLeaves, sizeof(int64_t), 1, fp) == 1;
+    densityGrid.ForEachLeaf([&](Point3i origin, pstd::span<const Float> values) {
+        int32_t p[3] = {origin.x, origin.y, origin.z};
+        ok &= fwrite(p, sizeof(int32_t), 3, fp) == 3;
+    });
+
+    // Write the leaves' values, taking "Lescale" values at the same voxels
+    std::vector<float> leaf(SparseGrid<Float>::LeafSize);
+    densityGrid.ForEachLeaf([&](Point3i origin, pstd::span<const Float> values) {
+        std::copy(values.begin(), values.end(), leaf.begin());
+        ok &= fwrite(leaf.data(), sizeof(float), leaf.size(), fp) == leaf.size();
+    });
+    if (LeScaleGrid)
+        densityGrid.ForEachLeaf([&](Point3i origin, pstd::span<const Float> values) {
+            constexpr int LeafRes = SparseGrid<Float>::LeafRes;
+            for (int i = 0; i < LeafRes * LeafRes * LeafRes; ++i)
+                leaf[i] = LeScaleGrid->Lookup(
+                    origin + Vector3i(i % LeafRes, i / LeafRes % LeafRes,
+                                      i / (LeafRes * LeafRes)));
+            ok &= fwrite(leaf.data(), sizeof(float), leaf.size(), fp) == leaf.size();
+        });
+
+    if (fclose(fp) != 0 || !ok) {
+        Error("%s: error writing sparse grid file: %s", filename, ErrorString());
+        return false;
+    }
+    return true;
+}
+
+bool SparseGridMediumProvider::ReadGridFile(const std::string &filename,
+                                            SparseGrid<Float> *densityGrid,
+                                            SparseGrid<Float> *LeScaleGrid,
+                                            const FileLoc *loc, Allocator alloc) {
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp)
+        ErrorExit(loc, "%s: %s", filename, ErrorString());
+    auto read = [&](void *ptr, size_t size, size_t count) {
+        if (fread(ptr, size, count, fp) != count)
+            ErrorExit(loc, "%s: premature end of sparse grid file.", filename);
+    };
+
+    // Read and validate the header
+    char magic[8];
+    int32_t header[5];
+    int64_t nLeaves;
+    read(magic, 1, 8);
+    if (!std::equal(magic, magic + 8, SparseGridFileMagic))
+        ErrorExit(loc, "%s: not a sparse grid file.", filename);
+    read(header, sizeof(int32_t), 5);
+    if (header[0] != SparseGridFileVersion)
+        ErrorExit(loc, "%s: sparse grid file version %d is not supported.", filename,
+                  header[0]);
+    read(&nLeaves, sizeof(int64_t), 1);
+    int nx = header[1], ny = header[2], nz = header[3];
+    bool hasLeScale = header[4] != 0;
+    constexpr int LeafRes = SparseGrid<Float>::LeafRes;
+    constexpr int LeafSize = SparseGrid<Float>::LeafSize;
+    if (nx <= 0 || ny <= 0 || nz <= 0 || nLeaves < 0 ||
+        nLeaves > int64_t((nx + LeafRes - 1) / LeafRes) *
+                      int64_t((ny + LeafRes - 1) / LeafRes) *
+                      int64_t((nz + LeafRes - 1) / LeafRes))
+        ErrorExit(loc, "%s: invalid sparse grid file header.", filename);
+
+    // Check the file's size before allocating memory for its leaves
+    int64_t headerBytes = ftell(fp);
+    int64_t leafBytes = sizeof(int32_t) * 3 + sizeof(float) * LeafSize * (1 + hasLeScale);
+    if (fseek(fp, 0, SEEK_END) != 0 || ftell(fp) != headerBytes + nLeaves * leafBytes ||
+        fseek(fp, headerBytes, SEEK_SET) != 0)
+        ErrorExit(loc, "%s: file size doesn't match the %d leaves in its header.",
+                  filename, nLeaves);
+
+    // Read the leaf origins and check that they are distinct and inside the grid
+    std::vector<Point3i> origins(nLeaves);
+    for (Point3i &p : origins) {
+        int32_t v[3];
+        read(v, sizeof(int32_t), 3);
+        p = Point3i(v[0], v[1], v[2]);
+    }
+    CheckLeafOrigins(origins, nx, ny, nz, filename, loc);
+
+    // Read leaf values directly into the grids' leaf storage
+    auto readValues = [&]() {
+        pstd::vector<Float> values(nLeaves * LeafSize, alloc);
+        if constexpr (std::is_same_v<Float, float>)
+            read(values.data(), sizeof(float), values.size());
+        else {
+            std::vector<float> leaf(LeafSize);
+            for (int64_t i = 0; i < nLeaves; ++i) {
+                read(leaf.data(), sizeof(float), LeafSize);
+                std::copy(leaf.begin(), leaf.end(), &values[i * LeafSize]);
+            }
+        }
+        return SparseGrid<Float>(nx, ny, nz, origins, std::move(values), alloc);
+    };
+    *densityGrid = readValues();
+    if (hasLeScale)
+        *LeScaleGrid = readValues();
+    fclose(fp);
+    return hasLeScale;
+}
+
+// NanoVDB files start with a 16-byte header holding the magic number, the
+// format version, and the number of grids, followed by a 176-byte record and
+// the name of each grid, and then the grids themselves. A grid holds its
+// header and tree record, its root, and its upper internal, lower internal,
+// and leaf nodes, each stored contiguously; offsets below are into those
+// structures in NanoVDB's 32.x format. Only the nodes are needed here: leaves
+// hold $8^3$ voxel values with $z$ varying fastest, and each internal node
+// covers $32^3$ or $16^3$ children that are either nodes or constant tiles.
+static constexpr uint64_t NanoVDBMagic[2] = {0x304244566f6e614e /* "NanoVDB0" */,
+                                             0x324244566f6e614e /* "NanoVDB2" */};
+static constexpr int NanoVDBHeaderSize = 16, NanoVDBMetadataSize = 176;
+static constexpr int NanoVDBGridDataSize = 672, NanoVDBTreeDataSize = 64;
+static constexpr int64_t NanoVDBLeafSize = 2144, NanoVDBLowerSize = 33856,
+                         NanoVDBUpperSize = 270400;
+
+template <typename T>
+static T ReadNanoVDBValue(const std::vector<char> &buf, size_t offset) {
+    T value;
+    CHECK_LE(offset + sizeof(T), buf.size());
+    std::memcpy(&value, buf.data() + offset, sizeof(T));
+    return value;
+}
+
+SparseGrid<Float> SparseGridMediumProvider::ReadNanoVDB(const std::string &filename,
+                                                        const std::string &gridName,
+                                                        const FileLoc *loc,
+                                                        Allocator alloc) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        ErrorExit(loc, "%s: %s", filename, ErrorString());
+    auto read = [&](int64_t offset, int64_t size) {
+        std::vector<char> buf(size);
+        if (!in.seekg(offset) || !in.read(buf.data(), size))
+            ErrorExit(loc, "%s: premature end of NanoVDB file.", filename);
+        return buf;
+    };
+
+    // Read the file header and find the grid's metadata
+    std::vector<char> header = read(0, NanoVDBHeaderSize);
+    uint64_t magic = ReadNanoVDBValue<uint64_t>(header, 0);
+    if (magic != NanoVDBMagic[0] && magic != NanoVDBMagic[1])
+        ErrorExit(loc, "%s: not a NanoVDB file.", filename);
+    uint32_t version = ReadNanoVDBValue<uint32_t>(header, 8);
+    if ((version >> 21) != 32)
+        ErrorExit(loc, "%s: NanoVDB major version %d is not supported.", filename,
+                  version >> 21);
+    int gridCount = ReadNanoVDBValue<uint16_t>(header, 12);
+    std::vector<char> metadata;
+    int64_t offset = NanoVDBHeaderSize, gridOffset = 0;
+    std::string gridNames;
+    for (int i = 0; i < gridCount; ++i) {
+        std::vector<char> m = read(offset, NanoVDBMetadataSize);
+        uint32_t nameSize = ReadNanoVDBValue<uint32_t>(m, 136);
+        std::vector<char> name = read(offset + NanoVDBMetadataSize, nameSize);
+        std::string n(name.begin(), name.end());
+        n = n.substr(0, n.find('\0'));
+        gridNames += (gridNames.empty() ? "\"" : ", \"") + n + "\"";
+        offset += NanoVDBMetadataSize + nameSize;
+        if (metadata.empty() && n == gridName)
+            metadata = std::move(m);
+        else if (metadata.empty())
+            gridOffset += ReadNanoVDBValue<uint64_t>(m, 8);
+    }
+    if (metadata.empty())
+        ErrorExit(loc, "%s: no grid named \"%s\" in NanoVDB file. Grids: %s", filename,
+                  gridName, gridNames);
+    gridOffset += offset;
+
+    // Check that the grid is an uncompressed float grid
+    if (ReadNanoVDBValue<uint32_t>(metadata, 32) != 1)
+        ErrorExit(loc, "%s: NanoVDB grid \"%s\" doesn't store float values.", filename,
+                  gridName);
+    if (ReadNanoVDBValue<uint16_t>(metadata, 168) != 0)
+        ErrorExit(loc, "%s: compressed NanoVDB grids aren't supported.", filename);
+    int64_t gridSize = ReadNanoVDBValue<uint64_t>(metadata, 0);
+    if (!in.seekg(0, std::ios::end) || int64_t(in.tellg()) < gridOffset + gridSize)
+        ErrorExit(loc, "%s: premature end of NanoVDB file.", filename);
+    uint32_t nLeafNodes = ReadNanoVDBValue<uint32_t>(metadata, 140);
+    uint32_t nLowerNodes = ReadNanoVDBValue<uint32_t>(metadata, 144);
+    uint32_t nUpperNodes = ReadNanoVDBValue<uint32_t>(metadata, 148);
+    if (ReadNanoVDBValue<uint32_t>(metadata, 164) != 0)
+        ErrorExit(loc, "%s: NanoVDB grids with active root tiles aren't supported.",
+                  filename);
+
+    // Compute the sparse grid's resolution, with its origin at the lowest leaf
+    // boundary inside the grid's index-space bounds
+    constexpr int LeafRes = SparseGrid<Float>::LeafRes;
+    constexpr int LeafSize = SparseGrid<Float>::LeafSize;
+    Point3i pMin, pMax;
+    for (int c = 0; c < 3; ++c) {
+        pMin[c] = ReadNanoVDBValue<int32_t>(metadata, 88 + 4 * c) & ~(LeafRes - 1);
+        pMax[c] = ReadNanoVDBValue<int32_t>(metadata, 100 + 4 * c);
+    }
+    if (pMax.x < pMin.x || pMax.y < pMin.y || pMax.z < pMin.z)
+        ErrorExit(loc, "%s: NanoVDB grid \"%s\" is empty.", filename, gridName);
+    int nx = pMax.x - pMin.x + 1, ny = pMax.y - pMin.y + 1, nz = pMax.z - pMin.z + 1;
+
+    // Find the nodes from the offsets in the grid's tree
+    std::vector<char> tree =
+        read(gridOffset + NanoVDBGridDataSize, NanoVDBTreeDataSize);
+    int64_t nodeOffsets[3];
+    int64_t nodeSizes[3] = {NanoVDBLeafSize, NanoVDBLowerSize, NanoVDBUpperSize};
+    uint32_t nodeCounts[3] = {nLeafNodes, nLowerNodes, nUpperNodes};
+    for (int level = 0; level < 3; ++level) {
+        nodeOffsets[level] =
+            NanoVDBGridDataSize + ReadNanoVDBValue<int64_t>(tree, 8 * level);
+        if (ReadNanoVDBValue<uint32_t>(tree, 32 + 4 * level) != nodeCounts[level] ||
+            nodeOffsets[level] < NanoVDBGridDataSize + NanoVDBTreeDataSize ||
+            nodeOffsets[level] + nodeCounts[level] * nodeSizes[level] > gridSize)
+            ErrorExit(loc, "%s: invalid NanoVDB tree.", filename);
+    }
+    auto nodeOrigin = [&](const std::vector<char> &node, int mask) {
+        Point3i p(ReadNanoVDBValue<int32_t>(node, 0), ReadNanoVDBValue<int32_t>(node, 4),
+                  ReadNanoVDBValue<int32_t>(node, 8));
+        return Point3i(p.x & ~mask, p.y & ~mask, p.z & ~mask) - Vector3i(pMin);
+    };
+
+    // Gather the active nonzero tiles of the internal nodes as constant leaves
+    std::vector<Point3i> origins;
+    std::vector<Float> tileValues;
+    Bounds3i gridBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
+    for (int level = 1; level <= 2; ++level) {
+        int log2Res = level == 1 ? 4 : 5, childRes = level == 1 ? 8 : 128;
+        int nChildren = 1 << (3 * log2Res);
+        int64_t maskBytes = nChildren / 8, tableOffset = level == 1 ? 1088 : 8256;
+        for (uint32_t i = 0; i < nodeCounts[level]; ++i) {
+            std::vector<char> node =
+                read(gridOffset + nodeOffsets[level] + i * nodeSizes[level],
+                     nodeSizes[level]);
+            Point3i origin = nodeOrigin(node, (childRes << log2Res) - 1);
+            for (int n = 0; n < nChildren; ++n) {
+                // Skip child nodes and inactive tiles
+                auto maskBit = [&](int64_t maskOffset) {
+                    return (uint8_t(node[maskOffset + n / 8]) >> (n % 8)) & 1;
+                };
+                if (maskBit(32 + maskBytes) || !maskBit(32))
+                    continue;
+                Float value = ReadNanoVDBValue<float>(node, tableOffset + 8 * n);
+                if (value == 0)
+                    continue;
+
+                // Add the leaves that the tile covers
+                int mask = (1 << log2Res) - 1;
+                Point3i tileOrigin = origin + childRes * Vector3i(n >> (2 * log2Res),
+                                                                  (n >> log2Res) & mask,
+                                                                  n & mask);
+                for (int z = 0; z < childRes; z += LeafRes)
+                    for (int y = 0; y < childRes; y += LeafRes)
+                        for (int x = 0; x < childRes; x += LeafRes) {
+                            Point3i p = tileOrigin + Vector3i(x, y, z);
+                            if (InsideExclusive(p, gridBounds)) {
+                                origins.push_back(p);
+                                tileValues.push_back(value);
+                            }
+                        }
+            }
+        }
+    }
+
+    // Read the leaf nodes' values after the tiles' into the grid's storage
+    size_t nTileLeaves = origins.size();
+    pstd::vector<Float> values((nTileLeaves + nLeafNodes) * LeafSize, alloc);
+    for (size_t i = 0; i < nTileLeaves; ++i)
+        std::fill(&values[i * LeafSize], &values[i * LeafSize] + LeafSize,
+                  tileValues[i]);
+    for (uint32_t i = 0; i < nLeafNodes; ++i) {
+        std::vector<char> leaf =
+            read(gridOffset + nodeOffsets[0] + i * NanoVDBLeafSize, NanoVDBLeafSize);
+        origins.push_back(nodeOrigin(leaf, LeafRes - 1));
+        Float *leafValues = &values[(nTileLeaves + i) * LeafSize];
+        for (int z = 0; z < LeafRes; ++z)
+            for (int y = 0; y < LeafRes; ++y)
+                for (int x = 0; x < LeafRes; ++x)
+                    leafValues[(z * LeafRes + y) * LeafRes + x] = ReadNanoVDBValue<float>(
+                        leaf, 96 + 4 * ((x * LeafRes + y) * LeafRes + z));
+    }
+    CheckLeafOrigins(origins, nx, ny, nz, filename, loc);
+
+    LOG_VERBOSE("%s: read NanoVDB grid \"%s\" with %d leaves and %d tile leaves as a "
+                "%d x %d x %d sparse grid starting at index %s", filename, gridName,
+                nLeafNodes, nTileLeaves, nx, ny, nz, pMin);
+    return SparseGrid<Float>(nx, ny, nz, origins, std::move(values), alloc);
+}
+
+pstd::vector<Float> SparseGridMediumProvider::GetMaxDensityGrid(Allocator alloc,
+                                                                Point3i *res) const {
+    // Use up to one majorant cell for each leaf-sized block of voxels
+    int n[3] = {densityGrid.xSize(), densityGrid.ySize(), densityGrid.zSize()};
+    constexpr int LeafRes = SparseGrid<Float>::LeafRes;
+    for (int i = 0; i < 3; ++i)
+        (*res)[i] = std::min(64, (n[i] + LeafRes - 1) / LeafRes);
+    pstd::vector<Float> maxGrid(res->x * res->y * res->z, Float(0), alloc);
+
+    // Bound the majorant cells overlapping the lookups that each leaf affects
+    densityGrid.ForEachLeaf([&](Point3i origin, pstd::span<const Float> values) {
+        Float leafMax = 0;
+        for (Float v : values)
+            leafMax = std::max(leafMax, v);
+        if (leafMax == 0)
+            return;
+
+        // Trilinear lookups at $p$ use voxels within one voxel of $p n - 1/2$
+        int c0[3], c1[3];
+        for (int i = 0; i < 3; ++i) {
+            Float p0 = (origin[i] - .5f) / n[i], p1 = (origin[i] + LeafRes + .5f) / n[i];
+            c0[i] = std::max<int>(0, std::floor(p0 * (*res)[i]));
+            c1[i] = std::min<int>((*res)[i] - 1, std::floor(p1 * (*res)[i]));
+        }
+        for (int z = c0[2]; z <= c1[2]; ++z)
+            for (int y = c0[1]; y <= c1[1]; ++y)
+                for (int x = c0[0]; x <= c1[0]; ++x) {
+                    Float &cellMax = maxGrid[x + res->x * (y + res->y * z)];
+                    cellMax = std::max(cellMax, leafMax);
+                }
+    });
+
+    return maxGrid;
+}
+
+std::string SparseGridMediumProvider::ToString() const {
+    return StringPrintf("[ SparseGridMediumProvider densityGrid: %s Le_spec: %s "
+                        "LeScaleGrid: %s ]",
+                        densityGrid, Le_spec, LeScaleGrid);
+}
+
 MediumHandle MediumHandle::Create(const std::string &name,
                                   const ParameterDictionary &parameters,
                                   const Transform &renderFromMedium, const FileLoc *loc,
@@ -261,6 +708,11 @@ MediumHandle MediumHandle::Create(const std::string &name,
             UniformGridMediumProvider::Create(parameters, loc, alloc);
         m = GeneralMedium<UniformGridMediumProvider>::Create(
             provider, parameters, renderFromMedium, loc, alloc);
+    } else if (name == "sparsegrid") {
+        SparseGridMediumProvider *provider =
+            SparseGridMediumProvider::Create(parameters, loc, alloc);
+        m = GeneralMedium<SparseGridMediumProvider>::Create(
+            provider, parameters, renderFromMedium, loc, alloc);
     } else
         ErrorExit(loc, "%s: medium unknown.", name);
 
@@ -147,12 +147,26 @@ class GeneralMedium {
           phase(g),
           mediumFromRender(Inverse(renderFromMedium)),
           renderFromMedium(renderFromMedium),
-          maxDensityGrid(alloc) {
+          maxDensityGrid(alloc),
+          blockMaxDensity(alloc),
+          isEmissive(provider->IsEmissive()) {
         maxDensityGrid = provider->GetMaxDensityGrid(alloc, &maxDGridRes);
+
+        // Compute maximum densities over blocks of the maximum density grid
+        for (int i = 0; i < 3; ++i)
+            blockRes[i] = (maxDGridRes[i] + MajorantBlockSize - 1) / MajorantBlockSize;
+        blockMaxDensity.resize(blockRes.x * blockRes.y * blockRes.z);
+        for (int z = 0; z < maxDGridRes.z; ++z)
+            for (int y = 0; y < maxDGridRes.y; ++y)
+                for (int x = 0; x < maxDGridRes.x; ++x) {
+                    int offset = x + maxDGridRes.x * (y + maxDGridRes.y * z);
+                    Float &blockMax = blockMaxDensity[BlockOffset(x, y, z)];
+                    blockMax = std::max(blockMax, maxDensityGrid[offset]);
+                }
     }
 
     std::string ToString() const { return "GeneralMedium TODO"; }
-    bool IsEmissive() const { return provider->IsEmissive(); }
+    bool IsEmissive() const { return isEmissive; }
 
     template <typename F>
     PBRT_CPU_GPU void SampleTmaj(const Ray &rRender, Float raytMax, RNG &rng,
@@ -208,6 +222,48 @@ class GeneralMedium {
         // Walk ray through maximum density grid and sample scattering
         Float t0 = tMin, u = rng.Uniform<Float>();
         while (true) {
+            if (blockMaxDensity[BlockOffset(voxel[0], voxel[1], voxel[2])] == 0) {
+                // Skip to the first voxel past the current empty block
+                // Find _tExit_ where the ray leaves the block and steps to reach it
+                int nSteps[3], exitAxis = 0;
+                Float tExit = Infinity;
+                for (int axis = 0; axis < 3; ++axis) {
+                    int v0 = voxel[axis] / MajorantBlockSize * MajorantBlockSize;
+                    nSteps[axis] =
+                        step[axis] > 0
+                            ? std::min(v0 + MajorantBlockSize, maxDGridRes[axis]) -
+                                  voxel[axis]
+                            : voxel[axis] - v0 + 1;
+                    Float tAxis = nextCrossingT[axis];
+                    if (nSteps[axis] > 1)
+                        tAxis += (nSteps[axis] - 1) * deltaT[axis];
+                    if (tAxis < tExit) {
+                        tExit = tAxis;
+                        exitAxis = axis;
+                    }
+                }
+                if (tExit > tMax)
+                    return;
+
+                // Advance DDA past all voxel boundaries crossed before _tExit_
+                for (int axis = 0; axis < 3; ++axis) {
+                    int n = 0;
+                    if (axis == exitAxis)
+                        n = nSteps[axis];
+                    else if (nextCrossingT[axis] <= tExit)
+                        n = std::min(nSteps[axis], 1 + int((tExit - nextCrossingT[axis]) /
+                                                           deltaT[axis]));
+                    if (n == 0)
+                        continue;
+                    voxel[axis] += n * step[axis];
+                    if (voxel[axis] == voxelLimit[axis])
+                        return;
+                    nextCrossingT[axis] += n * deltaT[axis];
+                }
+                t0 = tExit;
+                continue;
+            }
+
             // Find _stepAxis_ for stepping to next voxel and exit point _t1_
             int bits = ((nextCrossingT[0] < nextCrossingT[1]) << 2) +
                        ((nextCrossingT[0] < nextCrossingT[2]) << 1) +
@@ -244,7 +300,8 @@ class GeneralMedium {
                     SampledSpectrum Tmaj = FastExp(-sigma_maj * (t - t0));
                     // Compute _density_ and _Le_ at sampled point in grid
                     SampledSpectrum density = provider->Density(p, lambda);
-                    SampledSpectrum Le = provider->Le(p, lambda);
+                    SampledSpectrum Le =
+                        isEmissive ? provider->Le(p, lambda) : SampledSpectrum(0.f);
 
                     MediumInteraction intr(renderFromMedium(p), -Normalize(rRender.d),
                                            rRender.time, sigma_a * density,
@@ -312,7 +369,16 @@ class GeneralMedium {
     }
 
   private:
+    // GeneralMedium Private Methods
+    PBRT_CPU_GPU
+    int BlockOffset(int x, int y, int z) const {
+        int bx = x / MajorantBlockSize, by = y / MajorantBlockSize;
+        int bz = z / MajorantBlockSize;
+        return bx + blockRes.x * (by + blockRes.y * bz);
+    }
+
     // GeneralMedium Private Members
+    static constexpr int MajorantBlockSize = 4;
     const DensityProvider *provider;
     DenselySampledSpectrum sigma_a_spec, sigma_s_spec;
     Float sigScale;
@@ -320,6 +386,11 @@ class GeneralMedium {
     Transform mediumFromRender, renderFromMedium;
     pstd::vector<Float> maxDensityGrid;
     Point3i maxDGridRes;
+    // Maximum of _maxDensityGrid_ over each block of voxels; the DDA in
+    // _SampleTmaj()_ skips blocks where it is zero without visiting their voxels
+    pstd::vector<Float> blockMaxDensity;
+    Point3i blockRes;
+    bool isEmissive;
 };
 
 // UniformGridMediumProvider Definition
@@ -426,6 +497,55 @@ class UniformGridMediumProvider {
     SampledGrid<Float> LeScaleGrid;
 };
 
+// SparseGridMediumProvider Definition
+class SparseGridMediumProvider {
+  public:
+    // SparseGridMediumProvider Public Methods
+    SparseGridMediumProvider(SparseGrid<Float> densityGrid, SpectrumHandle Le,
+                             SparseGrid<Float> LeScaleGrid, Allocator alloc);
+
+    static SparseGridMediumProvider *Create(const ParameterDictionary &parameters,
+                                            const FileLoc *loc, Allocator alloc);
+
+    // Sparse grid files store the $8^3$ voxel leaves of the density grid and,
+    // optionally, the "Lescale" values at the same voxels. _ReadGridFile()_
+    // returns whether "Lescale" values were present.
+    static bool WriteGridFile(const std::string &filename,
+                              const SparseGrid<Float> &densityGrid,
+                              const SparseGrid<Float> *LeScaleGrid);
+    static bool ReadGridFile(const std::string &filename, SparseGrid<Float> *densityGrid,
+                             SparseGrid<Float> *LeScaleGrid, const FileLoc *loc,
+                             Allocator alloc);
+    // Reads the named float grid from an uncompressed NanoVDB file. Voxel
+    // $(0,0,0)$ of the returned grid is at the grid's minimum index-space
+    // coordinates rounded down to a multiple of 8.
+    static SparseGrid<Float> ReadNanoVDB(const std::string &filename,
+                                         const std::string &gridName,
+                                         const FileLoc *loc, Allocator alloc);
+
+    std::string ToString() const;
+
+    bool IsEmissive() const { return Le_spec.MaxValue() > 0; }
+
+    PBRT_CPU_GPU
+    SampledSpectrum Le(const Point3f &p, const SampledWavelengths &lambda) const {
+        return Le_spec.Sample(lambda) * LeScaleGrid.Lookup(p);
+    }
+
+    PBRT_CPU_GPU
+    SampledSpectrum Density(const Point3f &p, const SampledWavelengths &lambda) const {
+        return SampledSpectrum(densityGrid.Lookup(p));
+    }
+
+    pstd::vector<Float> GetMaxDensityGrid(Allocator alloc, Point3i *res) const;
+
+  private:
+    // SparseGridMediumProvider Private Members
+    SparseGrid<Float> densityGrid;
+    DenselySampledSpectrum Le_spec;
+    SparseGrid<Float> LeScaleGrid;
+};
+
 inline Float PhaseFunctionHandle::p(const Vector3f &wo, const Vector3f &wi) const {
     auto p = [&](auto ptr) { return ptr->p(wo, wi); };
     return Dispatch(p);
@@ -10,6 +10,8 @@
 #include <pbrt/util/rng.h>
 #include <pbrt/util/sampling.h>
 
+#include <cstring>
+
 using namespace pbrt;
 
 TEST(HenyeyGreenstein, SamplingMatch) {
@@ -96,3 +98,310 @@ TEST(HenyeyGreenstein, g) {
         EXPECT_NEAR(g, gEst, .01);
     }
 }
+
+TEST(UniformGridMedium, EmptySpaceSkipping) {
+    // Create a grid medium with density only in a small box so that most blocks
+    // of its maximum density grid are empty
+    Allocator alloc;
+    int n = 32;
+    std::vector<Float> density(n * n * n, Float(0));
+    for (int z = 20; z < 26; ++z)
+        for (int y = 20; y < 26; ++y)
+            for (int x = 20; x < 26; ++x)
+                density[x + n * (y + n * z)] = 1;
+    SampledGrid<Float> densityGrid(density, n, n, n, alloc);
+    ConstantSpectrum zero(0.f), one(1.f);
+    UniformGridMediumProvider provider(densityGrid, {}, nullptr, &zero,
+                                       SampledGrid<Float>(alloc), alloc);
+    Float sigma_t = 40;
+    UniformGridMedium medium(&provider, &one, &zero, sigma_t, 0.f, Transform(), alloc);
+    EXPECT_FALSE(medium.IsEmissive());
+
+    RNG rng;
+    SampledWavelengths lambda = SampledWavelengths::SampleUniform(0.5f);
+    Float sumExpected = 0, sumEstimated = 0;
+    int nRays = 1000, nTrials = 16;
+    for (int i = 0; i < nRays; ++i) {
+        // Trace a ray from outside the medium through the dense region
+        Point3f o(rng.Uniform<Float>() * 3 - 1, rng.Uniform<Float>() * 3 - 1,
+                  rng.Uniform<Float>() * 3 - 1);
+        Point3f pTarget = Point3f(0.6f, 0.6f, 0.6f) +
+                          0.25f * Vector3f(rng.Uniform<Float>(), rng.Uniform<Float>(),
+                                           rng.Uniform<Float>());
+        Ray ray(o, 2 * (pTarget - o));
+
+        // Compute transmittance along the ray by numerical integration
+        Float tau = 0;
+        int nSteps = 2000;
+        for (int j = 0; j < nSteps; ++j) {
+            Point3f p = ray((j + 0.5f) / nSteps);
+            if (Inside(p, Bounds3f(Point3f(0, 0, 0), Point3f(1, 1, 1))))
+                tau += provider.Density(p, lambda)[0] * Length(ray.d) / nSteps;
+        }
+        sumExpected += std::exp(-sigma_t * tau);
+
+        // Estimate transmittance using ratio tracking
+        for (int trial = 0; trial < nTrials; ++trial) {
+            Float T = 1;
+            medium.SampleTmaj(ray, 1.f, rng, lambda, [&](const MediumSample &ms) {
+                if (!ms.intr)
+                    return false;
+                const MediumInteraction &intr = *ms.intr;
+                // Events must not be generated where there is no density
+                EXPECT_GT(intr.sigma_maj[0], 0);
+                EXPECT_EQ(0, intr.Le[0]);
+                T *= 1 - (intr.sigma_a[0] + intr.sigma_s[0]) / intr.sigma_maj[0];
+                return true;
+            });
+            sumEstimated += T / nTrials;
+        }
+    }
+    EXPECT_NEAR(sumExpected / nRays, sumEstimated / nRays, 0.01);
+}
+
+TEST(SparseGridMedium, MaxDensityGridBounds) {
+    // Create a sparse grid medium provider with a few small clusters of voxels
+    Allocator alloc;
+    int n = 100;
+    std::vector<Point3i> voxels;
+    std::vector<Float> density;
+    RNG rng;
+    for (int c = 0; c < 4; ++c) {
+        Point3i p0(rng.Uniform<uint32_t>() % (n - 3),
+                   rng.Uniform<uint32_t>() % (n - 3),
+                   rng.Uniform<uint32_t>() % (n - 3));
+        for (int z = 0; z < 3; ++z)
+            for (int y = 0; y < 3; ++y)
+                for (int x = 0; x < 3; ++x) {
+                    voxels.push_back(p0 + Vector3i(x, y, z));
+                    density.push_back(c + rng.Uniform<Float>());
+                }
+    }
+    ConstantSpectrum zero(0.f);
+    SparseGridMediumProvider provider(SparseGrid<Float>(voxels, density, n, n, n, alloc),
+                                      &zero, SparseGrid<Float>(alloc), alloc);
+
+    // The maximum density grid should bound the density and be mostly empty
+    Point3i res;
+    pstd::vector<Float> maxGrid = provider.GetMaxDensityGrid(alloc, &res);
+    int nEmpty = 0;
+    for (Float d : maxGrid)
+        nEmpty += d == 0;
+    EXPECT_GT(nEmpty, maxGrid.size() / 2);
+
+    SampledWavelengths lambda = SampledWavelengths::SampleUniform(0.5f);
+    for (int i = 0; i < 100000; ++i) {
+        // Check points around the stored voxels
+        Point3i v = voxels[rng.Uniform<uint32_t>() % voxels.size()];
+        Point3f p((v.x - 1 + 3 * rng.Uniform<Float>()) / n,
+                  (v.y - 1 + 3 * rng.Uniform<Float>()) / n,
+                  (v.z - 1 + 3 * rng.Uniform<Float>()) / n);
+        p = Min(Max(p, Point3f(0, 0, 0)), Point3f(1, 1, 1));
+        int x = std::min<int>(p.x * res.x, res.x - 1);
+        int y = std::min<int>(p.y * res.y, res.y - 1);
+        int z = std::min<int>(p.z * res.z, res.z - 1);
+        EXPECT_LE(provider.Density(p, lambda)[0], maxGrid[x + res.x * (y + res.y * z)]);
+    }
+}
+
+TEST(SparseGridMedium, GridFileRoundTrip) {
+    // Create density and emission scale grids with scattered voxels
+    Allocator alloc;
+    int nx = 70, ny = 150, nz = 33;
+    std::vector<Point3i> voxels;
+    std::vector<Float> density, LeScale;
+    RNG rng;
+    for (int i = 0; i < 5000; ++i) {
+        voxels.push_back(Point3i(rng.Uniform<uint32_t>() % nx,
+                                 rng.Uniform<uint32_t>() % ny,
+                                 rng.Uniform<uint32_t>() % nz));
+        density.push_back(1 + rng.Uniform<Float>());
+        LeScale.push_back(rng.Uniform<Float>());
+    }
+    SparseGrid<Float> densityGrid(voxels, density, nx, ny, nz, alloc);
+    SparseGrid<Float> LeScaleGrid(voxels, LeScale, nx, ny, nz, alloc);
+
+    // Write the grids and read them back, with and without "Lescale"
+    std::string filename = "test.pbrtsg";
+    for (bool writeLeScale : {false, true}) {
+        ASSERT_TRUE(SparseGridMediumProvider::WriteGridFile(
+            filename, densityGrid, writeLeScale ? &LeScaleGrid : nullptr));
+        SparseGrid<Float> readDensity(alloc), readLeScale(alloc);
+        bool readLeScaleGrid = SparseGridMediumProvider::ReadGridFile(
+            filename, &readDensity, &readLeScale, nullptr, alloc);
+        EXPECT_EQ(writeLeScale, readLeScaleGrid);
+        EXPECT_EQ(0, remove(filename.c_str()));
+
+        EXPECT_EQ(densityGrid.NumLeaves(), readDensity.NumLeaves());
+        EXPECT_EQ(densityGrid.BytesAllocated(), readDensity.BytesAllocated());
+        for (int z = -1; z <= nz; ++z)
+            for (int y = -1; y <= ny; ++y)
+                for (int x = -1; x <= nx; ++x) {
+                    Point3i p(x, y, z);
+                    EXPECT_EQ(densityGrid.Lookup(p), readDensity.Lookup(p));
+                    if (writeLeScale)
+                        EXPECT_EQ(LeScaleGrid.Lookup(p), readLeScale.Lookup(p));
+                }
+        for (int i = 0; i < 1000; ++i) {
+            Point3f p(rng.Uniform<Float>(), rng.Uniform<Float>(), rng.Uniform<Float>());
+            EXPECT_EQ(densityGrid.Lookup(p), readDensity.Lookup(p));
+        }
+    }
+}
+
+TEST(SparseGridMedium, GridFileValidation) {
+    // Write valid two-leaf files and then corrupt their headers and origins
+    Allocator alloc;
+    SparseGrid<Float> grid({Point3i(0, 0, 0), Point3i(9, 0, 0)}, {1.f, 2.f}, 16, 8, 8,
+                           alloc);
+    std::string filename = "validation.pbrtsg";
+    auto readWith = [&](std::vector<std::pair<int64_t, int32_t>> changes) {
+        ASSERT_TRUE(SparseGridMediumProvider::WriteGridFile(filename, grid, nullptr));
+        FILE *fp = fopen(filename.c_str(), "r+b");
+        for (auto [offset, value] : changes) {
+            fseek(fp, offset, SEEK_SET);
+            fwrite(&value, sizeof(int32_t), 1, fp);
+        }
+        fclose(fp);
+        SparseGrid<Float> density(alloc), LeScale(alloc);
+        SparseGridMediumProvider::ReadGridFile(filename, &density, &LeScale, nullptr,
+                                               alloc);
+    };
+
+    // Leaf counts that the grid can't hold or that the file is too short for, and
+    // leaf origins' $x$ coordinates set to duplicates and to non-multiples of 8
+    EXPECT_DEATH(readWith({{28, 5}}), "invalid sparse grid file header");
+    EXPECT_DEATH(readWith({{28, 1}}), "doesn't match the 1 leaves");
+    EXPECT_DEATH(readWith({{36, 8}, {48, 8}}), "appears more than once");
+    EXPECT_DEATH(readWith({{48, 4}}), "isn't a multiple of 8");
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
+
+// Appends the bytes of _value_ to _buf_ at _offset_, growing it as needed
+template <typename T>
+static void PutNanoVDBValue(std::vector<char> &buf, size_t offset, T value) {
+    buf.resize(std::max(buf.size(), offset + sizeof(T)));
+    memcpy(buf.data() + offset, &value, sizeof(T));
+}
+
+TEST(SparseGridMedium, ReadNanoVDB) {
+    // Leaves at $(0,0,0)$ and $(-8,0,16)$, an active lower-node tile covering
+    // $[16,24) \times [8,16) \times [0,8)$, and an upper-node tile covering
+    // $[128,256) \times [0,128)^2$
+    auto expected = [](Point3i p) -> Float {
+        if (p.x >= 0 && p.x < 8 && p.y >= 0 && p.y < 8 && p.z >= 0 && p.z < 8)
+            return 1 + p.x + 10 * p.y + 100 * p.z;
+        if (p.x >= -8 && p.x < 0 && p.y >= 0 && p.y < 8 && p.z >= 16 && p.z < 24)
+            return 1000 + (p.x + 8) + 8 * p.y + 64 * (p.z - 16);
+        if (p.x >= 16 && p.x < 24 && p.y >= 8 && p.y < 16 && p.z >= 0 && p.z < 8)
+            return 2;
+        if (p.x >= 128 && p.x < 256 && p.y >= 0 && p.y < 128 && p.z >= 0 && p.z < 128)
+            return 0.5;
+        return 0;
+    };
+
+    // Lay out the grid: header, tree, root, two upper, two lower, and two leaf nodes
+    const size_t treeStart = 672, upperStart = 800, upperSize = 270400;
+    const size_t lowerStart = upperStart + 2 * upperSize, lowerSize = 33856;
+    const size_t leafStart = lowerStart + 2 * lowerSize, leafSize = 2144;
+    std::vector<char> g(leafStart + 2 * leafSize);
+    PutNanoVDBValue<int64_t>(g, treeStart, leafStart - treeStart);
+    PutNanoVDBValue<int64_t>(g, treeStart + 8, lowerStart - treeStart);
+    PutNanoVDBValue<int64_t>(g, treeStart + 16, upperStart - treeStart);
+    PutNanoVDBValue<int64_t>(g, treeStart + 24, 64);
+    for (int level = 0; level < 3; ++level)
+        PutNanoVDBValue<uint32_t>(g, treeStart + 32 + 4 * level, 2);
+
+    // Internal nodes: bounding box minimum, value and child masks, and tile table
+    auto setNode = [&](size_t node, Point3i pMin, size_t childMask, size_t table,
+                       int child, int tile, float tileValue, bool active) {
+        for (int c = 0; c < 3; ++c)
+            PutNanoVDBValue<int32_t>(g, node + 4 * c, pMin[c]);
+        g[node + childMask + child / 8] |= 1 << (child % 8);
+        if (active)
+            g[node + 32 + tile / 8] |= 1 << (tile % 8);
+        PutNanoVDBValue<float>(g, node + table + 8 * tile, tileValue);
+    };
+    setNode(upperStart, Point3i(0, 0, 0), 4128, 8256, 0, 1 << 10, 0.5f, true);
+    setNode(upperStart + upperSize, Point3i(-8, 0, 16), 4128, 8256, 31 << 10, 0, 3.f,
+            false);
+    setNode(lowerStart, Point3i(0, 0, 0), 544, 1088, 0, (2 << 8) | (1 << 4), 2.f, true);
+    setNode(lowerStart, Point3i(0, 0, 0), 544, 1088, 0, 3 << 8, 7.f, false);
+    setNode(lowerStart + lowerSize, Point3i(-8, 0, 16), 544, 1088, (15 << 8) | 2, 0,
+            0.f, true);
+
+    // Leaves store values with $z$ varying fastest; the first one's bounding box
+    // doesn't start at its origin
+    Point3i leafMin[2] = {Point3i(1, 2, 3), Point3i(-8, 0, 16)};
+    for (int i = 0; i < 2; ++i) {
+        size_t leaf = leafStart + i * leafSize;
+        for (int c = 0; c < 3; ++c)
+            PutNanoVDBValue<int32_t>(g, leaf + 4 * c, leafMin[i][c]);
+        for (int x = 0; x < 8; ++x)
+            for (int y = 0; y < 8; ++y)
+                for (int z = 0; z < 8; ++z) {
+                    Point3i p = Point3i(leafMin[i].x & ~7, leafMin[i].y & ~7,
+                                        leafMin[i].z & ~7) +
+                                Vector3i(x, y, z);
+                    PutNanoVDBValue<float>(g, leaf + 96 + 4 * (64 * x + 8 * y + z),
+                                           expected(p));
+                }
+    }
+
+    // Write a file with an unrelated grid before this one
+    auto metadata = [](uint64_t gridSize, uint32_t gridType, const std::string &name) {
+        std::vector<char> m(176);
+        PutNanoVDBValue<uint64_t>(m, 0, gridSize);
+        PutNanoVDBValue<uint64_t>(m, 8, gridSize);
+        PutNanoVDBValue<uint32_t>(m, 32, gridType);
+        int32_t bounds[6] = {-3, 0, 0, 255, 127, 127};
+        for (int i = 0; i < 6; ++i)
+            PutNanoVDBValue<int32_t>(m, 88 + 4 * i, bounds[i]);
+        PutNanoVDBValue<uint32_t>(m, 136, name.size() + 1);
+        for (int i = 0; i < 3; ++i)
+            PutNanoVDBValue<uint32_t>(m, 140 + 4 * i, 2);
+        m.insert(m.end(), name.begin(), name.end());
+        m.push_back('\0');
+        return m;
+    };
+    std::vector<char> file(16);
+    PutNanoVDBValue<uint64_t>(file, 0, 0x304244566f6e614e);
+    PutNanoVDBValue<uint32_t>(file, 8, (32u << 21) | (3 << 10) | 3);
+    PutNanoVDBValue<uint16_t>(file, 12, 2);
+    for (const std::vector<char> &m : {metadata(64, 6, "temperature"),
+                                        metadata(g.size(), 1, "density")})
+        file.insert(file.end(), m.begin(), m.end());
+    file.insert(file.end(), 64, '\0');
+    file.insert(file.end(), g.begin(), g.end());
+    std::string filename = "test.nvdb";
+    FILE *fp = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(fp != nullptr);
+    ASSERT_EQ(file.size(), fwrite(file.data(), 1, file.size(), fp));
+    fclose(fp);
+
+    // Check every voxel of the sparse grid, which starts at $(-8,0,0)$
+    Allocator alloc;
+    SparseGrid<Float> grid =
+        SparseGridMediumProvider::ReadNanoVDB(filename, "density", nullptr, alloc);
+    EXPECT_EQ(264, grid.xSize());
+    EXPECT_EQ(128, grid.ySize());
+    EXPECT_EQ(128, grid.zSize());
+    EXPECT_EQ(2 + 1 + 16 * 16 * 16, grid.NumLeaves());
+    int nErrors = 0;
+    for (int z = 0; z < 128; ++z)
+        for (int y = 0; y < 128; ++y)
+            for (int x = 0; x < 264; ++x)
+                if (grid.Lookup(Point3i(x, y, z)) != expected(Point3i(x - 8, y, z)) &&
+                    ++nErrors < 10)
+                    ADD_FAILURE() << Point3i(x, y, z) << ": got "
+                                  << grid.Lookup(Point3i(x, y, z)) << ", expected "
+                                  << expected(Point3i(x - 8, y, z));
+
+    EXPECT_DEATH(
+        SparseGridMediumProvider::ReadNanoVDB(filename, "velocity", nullptr, alloc),
+        "no grid named \"velocity\".*\"temperature\", \"density\"");
+    EXPECT_DEATH(
+        SparseGridMediumProvider::ReadNanoVDB(filename, "temperature", nullptr, alloc),
+        "doesn't store float values");
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
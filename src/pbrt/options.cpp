@@ -20,11 +20,12 @@ std::string PBRTOptions::ToString() const {
         "recordPixelStatistics: %s upgrade: %s disablePixelJitter: %s "
         "disableWavelengthJitter: %s forceDiffuse: %s useGPU: %s "
         "imageFile: %s mseReferenceImage: %s mseReferenceOutput: %s "
-        "debugStart: %s displayServer: %s cropWindow: %s pixelBounds: %s ]",
+        "debugStart: %s displayServer: %s cacheDirectory: %s cropWindow: %s "
+        "pixelBounds: %s sampleRange: %s writePartialFilm: %s ]",
         nThreads, seed, quickRender, quiet, recordPixelStatistics, upgrade,
         disablePixelJitter, disableWavelengthJitter, forceDiffuse, useGPU, imageFile,
-        mseReferenceImage, mseReferenceOutput, debugStart, displayServer, cropWindow,
-        pixelBounds);
+        mseReferenceImage, mseReferenceOutput, debugStart, displayServer, cacheDirectory,
+        cropWindow, pixelBounds, sampleRange, writePartialFilm);
 }
 
 }  // namespace pbrt
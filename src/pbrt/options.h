@@ -40,8 +40,12 @@ struct PBRTOptions : BasicOptions {
     std::string mseReferenceImage, mseReferenceOutput;
     std::string debugStart;
     std::string displayServer;
+    std::string cacheDirectory;
     pstd::optional<Bounds2f> cropWindow;
     pstd::optional<Bounds2i> pixelBounds;
+    // Half-open range [x, y) of pixel sample indices to render
+    pstd::optional<Point2i> sampleRange;
+    bool writePartialFilm = false;
 
     std::string ToString() const;
 };
@@ -425,11 +425,15 @@ void ParsedScene::ObjectInstance(const std::string &name, FileLoc loc) {
         instances.push_back(
             InstanceSceneEntity(name, loc, animatedRenderFromInstance, nullptr));
     } else {
-        const class Transform *renderFromInstance =
-            transformCache.Lookup(GetCTM(0) * worldFromRender);
-
-        instances.push_back(
-            InstanceSceneEntity(name, loc, AnimatedTransform(), renderFromInstance));
+        class Transform renderFromInstance = GetCTM(0) * worldFromRender;
+        if (!Options->useGPU && renderFromInstance.IsAffine())
+            // Store affine transformation with the instance; the CPU renderer
+            // keeps a compact copy of it and the entity is freed afterward
+            instances.push_back(InstanceSceneEntity(name, loc, renderFromInstance));
+        else
+            instances.push_back(
+                InstanceSceneEntity(name, loc, AnimatedTransform(),
+                                    transformCache.Lookup(renderFromInstance)));
     }
 }
 
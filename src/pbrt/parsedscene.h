@@ -202,17 +202,26 @@ struct InstanceSceneEntity : public SceneEntity {
         : SceneEntity(name, {}, loc),
           renderFromInstanceAnim(renderFromInstanceAnim),
           renderFromInstance(renderFromInstance) {}
+    InstanceSceneEntity(const std::string &name, FileLoc loc,
+                        const Transform &affineRenderFromInstance)
+        : SceneEntity(name, {}, loc),
+          renderFromInstance(nullptr),
+          affineRenderFromInstance(affineRenderFromInstance) {}
 
     std::string ToString() const {
         return StringPrintf(
             "[ InstanceSeneEntity name: %s loc: %s "
-            "renderFromInstanceAnim: %s renderFromInstance: %s ]",
+            "renderFromInstanceAnim: %s renderFromInstance: %s "
+            "affineRenderFromInstance: %s ]",
             name, loc, renderFromInstanceAnim,
-            renderFromInstance ? renderFromInstance->ToString() : std::string("nullptr"));
+            renderFromInstance ? renderFromInstance->ToString() : std::string("nullptr"),
+            affineRenderFromInstance);
     }
 
     AnimatedTransform renderFromInstanceAnim;
     const Transform *renderFromInstance;
+    // Affine CPU instances aren't shared through the _TransformCache_
+    pstd::optional<Transform> affineRenderFromInstance;
 };
 
 // TransformHash Definition
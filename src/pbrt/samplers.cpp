@@ -81,18 +81,30 @@ std::vector<SamplerHandle> SobolSampler::Clone(int n, Allocator alloc) {
 }
 
 // PaddedSobolSampler Method Definitions
-PaddedSobolSampler::PaddedSobolSampler(int spp, RandomizeStrategy randomizer)
+PaddedSobolSampler::PaddedSobolSampler(int spp, RandomizeStrategy randomizer,
+                                       bool precomputeTables, Allocator alloc)
     : samplesPerPixel(RoundUpPow2(spp)), randomizeStrategy(randomizer) {
     if (!IsPowerOf2(spp))
         Warning("Pixel samples being rounded up to power of 2 (from %d to %d).", spp,
                 samplesPerPixel);
+    if (precomputeTables) {
+        // Compute generator matrix products for all pixel sample indices
+        uint32_t *table = alloc.allocate_object<uint32_t>(3 * samplesPerPixel);
+        for (int i = 0; i < samplesPerPixel; ++i) {
+            table[3 * i] = MultiplyGenerator(CVanDerCorput, i);
+            table[3 * i + 1] = MultiplyGenerator(CSobol[0], i);
+            table[3 * i + 2] = MultiplyGenerator(CSobol[1], i);
+        }
+        generatorTable = table;
+    }
 }
 
 std::string PaddedSobolSampler::ToString() const {
     return StringPrintf("[ PaddedSobolSampler pixel: %s sampleIndex: %d dimension: %d "
-                        "samplesPerPixel: %d randomizeStrategy: %s ]",
+                        "samplesPerPixel: %d randomizeStrategy: %s "
+                        "precomputedTables: %s ]",
                         pixel, sampleIndex, dimension, samplesPerPixel,
-                        randomizeStrategy);
+                        randomizeStrategy, generatorTable != nullptr);
 }
 
 std::vector<SamplerHandle> PaddedSobolSampler::Clone(int n, Allocator alloc) {
@@ -129,7 +141,10 @@ PaddedSobolSampler *PaddedSobolSampler::Create(const ParameterDictionary &parame
         ErrorExit(loc, "%s: unknown randomization strategy given to PaddedSobolSampler",
                   s);
 
-    return alloc.new_object<PaddedSobolSampler>(nsamp, randomizer);
+    bool precomputeTables = parameters.GetOneBool("precomputetables", false);
+
+    return alloc.new_object<PaddedSobolSampler>(nsamp, randomizer, precomputeTables,
+                                                alloc);
 }
 
 // PMJ02BNSampler Method Definitions
@@ -197,9 +212,9 @@ RandomSampler *RandomSampler::Create(const ParameterDictionary &parameters,
 std::string SobolSampler::ToString() const {
     return StringPrintf("[ SobolSampler pixel: %s dimension: %d "
                         "samplesPerPixel: %d resolution: %d sequenceIndex: %d "
-                        "randomizeStrategy: %s ]",
+                        "randomizeStrategy: %s byteTables: %s ]",
                         pixel, dimension, samplesPerPixel, resolution, sequenceIndex,
-                        randomizeStrategy);
+                        randomizeStrategy, byteTables ? byteTables->ToString() : "none");
 }
 
 SobolSampler *SobolSampler::Create(const ParameterDictionary &parameters,
@@ -224,7 +239,14 @@ SobolSampler *SobolSampler::Create(const ParameterDictionary &parameters,
     else
         ErrorExit(loc, "%s: unknown randomization strategy given to SobolSampler", s);
 
-    return alloc.new_object<SobolSampler>(nsamp, fullResolution, randomizer);
+    // Precomputed tables for the first dimensions take 7kB each
+    int tableDimensions = parameters.GetOneInt("tabledimensions", 0);
+    if (tableDimensions < 0 || tableDimensions > NSobolDimensions)
+        ErrorExit(loc, "%d: \"tabledimensions\" must be between 0 and %d.",
+                  tableDimensions, NSobolDimensions);
+
+    return alloc.new_object<SobolSampler>(nsamp, fullResolution, randomizer,
+                                          tableDimensions, alloc);
 }
 
 // StratifiedSampler Method Definitions
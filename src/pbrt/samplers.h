@@ -100,7 +100,8 @@ class HaltonSampler {
 class PaddedSobolSampler {
   public:
     // PaddedSobolSampler Public Methods
-    PaddedSobolSampler(int samplesPerPixel, RandomizeStrategy randomizeStrategy);
+    PaddedSobolSampler(int samplesPerPixel, RandomizeStrategy randomizeStrategy,
+                       bool precomputeTables = false, Allocator alloc = {});
 
     PBRT_CPU_GPU
     static constexpr const char *Name() { return "PaddedSobolSampler"; }
@@ -125,14 +126,14 @@ class PaddedSobolSampler {
         int index = PermutationElement(sampleIndex, samplesPerPixel, hash);
 
         int dim = dimension++;
+        uint32_t bits = generatorBits(0, index);
         if (randomizeStrategy == RandomizeStrategy::CranleyPatterson)
             // Return 1D sample randomized with Cranley-Patterson rotation
-            return SampleGeneratorMatrix(
-                CVanDerCorput, index,
-                CranleyPattersonRotator(BlueNoise(dim, pixel.x, pixel.y)));
+            return toFloat(bits,
+                           CranleyPattersonRotator(BlueNoise(dim, pixel.x, pixel.y)));
 
         else
-            return generateSample(CVanDerCorput, index, hash >> 32);
+            return generateSample(bits, hash >> 32);
     }
 
     PBRT_CPU_GPU
@@ -144,18 +145,16 @@ class PaddedSobolSampler {
 
         int dim = dimension;
         dimension += 2;
+        uint32_t bits0 = generatorBits(1, index), bits1 = generatorBits(2, index);
         if (randomizeStrategy == RandomizeStrategy::CranleyPatterson)
             // Return 2D sample randomized with Cranley-Patterson rotation
-            return {SampleGeneratorMatrix(
-                        CSobol[0], index,
-                        CranleyPattersonRotator(BlueNoise(dim, pixel.x, pixel.y))),
-                    SampleGeneratorMatrix(
-                        CSobol[1], index,
-                        CranleyPattersonRotator(BlueNoise(dim + 1, pixel.x, pixel.y)))};
+            return {toFloat(bits0,
+                            CranleyPattersonRotator(BlueNoise(dim, pixel.x, pixel.y))),
+                    toFloat(bits1, CranleyPattersonRotator(
+                                       BlueNoise(dim + 1, pixel.x, pixel.y)))};
 
         else
-            return {generateSample(CSobol[0], index, hash >> 8),
-                    generateSample(CSobol[1], index, hash >> 32)};
+            return {generateSample(bits0, hash >> 8), generateSample(bits1, hash >> 32)};
     }
 
     std::vector<SamplerHandle> Clone(int n, Allocator alloc);
@@ -164,14 +163,34 @@ class PaddedSobolSampler {
   private:
     // PaddedSobolSampler Private Methods
     PBRT_CPU_GPU
-    Float generateSample(pstd::span<const uint32_t> C, uint32_t a, uint32_t hash) const {
+    uint32_t generatorBits(int matrix, uint32_t a) const {
+        // Return the product of generator matrix _matrix_ with the sample index
+        if (generatorTable)
+            return generatorTable[3 * a + matrix];
+        switch (matrix) {
+        case 0:
+            return MultiplyGenerator(CVanDerCorput, a);
+        case 1:
+            return MultiplyGenerator(CSobol[0], a);
+        default:
+            return MultiplyGenerator(CSobol[1], a);
+        }
+    }
+
+    template <typename R>
+    PBRT_CPU_GPU static Float toFloat(uint32_t bits, R randomizer) {
+        return std::min(randomizer(bits) * Float(0x1p-32), OneMinusEpsilon);
+    }
+
+    PBRT_CPU_GPU
+    Float generateSample(uint32_t bits, uint32_t hash) const {
         switch (randomizeStrategy) {
         case RandomizeStrategy::None:
-            return SampleGeneratorMatrix(C, a, NoRandomizer());
+            return toFloat(bits, NoRandomizer());
         case RandomizeStrategy::Xor:
-            return SampleGeneratorMatrix(C, a, XORScrambler(hash));
+            return toFloat(bits, XORScrambler(hash));
         case RandomizeStrategy::Owen:
-            return SampleGeneratorMatrix(C, a, OwenScrambler(hash));
+            return toFloat(bits, OwenScrambler(hash));
         default:
             LOG_FATAL("Unhandled randomization strategy");
             return {};
@@ -181,6 +200,8 @@ class PaddedSobolSampler {
     // PaddedSobolSampler Private Members
     int samplesPerPixel;
     RandomizeStrategy randomizeStrategy;
+    // Generator matrix products for each pixel sample index, if precomputed
+    const uint32_t *generatorTable = nullptr;
     Point2i pixel;
     int sampleIndex = 0;
     int dimension = 0;
@@ -316,13 +337,19 @@ class SobolSampler {
   public:
     // SobolSampler Public Methods
     SobolSampler(int spp, const Point2i &fullResolution,
-                 RandomizeStrategy randomizeStrategy)
+                 RandomizeStrategy randomizeStrategy, int tableDimensions = 0,
+                 Allocator alloc = {})
         : samplesPerPixel(RoundUpPow2(spp)), randomizeStrategy(randomizeStrategy) {
         if (!IsPowerOf2(spp))
             Warning("Non power-of-two sample count rounded up to %d "
                     "for SobolSampler.",
                     samplesPerPixel);
         resolution = RoundUpPow2(std::max(fullResolution.x, fullResolution.y));
+#ifndef PBRT_FLOAT_AS_DOUBLE
+        if (tableDimensions > 0)
+            byteTables = alloc.new_object<SobolByteTables>(
+                std::min(tableDimensions, NSobolDimensions), alloc);
+#endif
     }
 
     PBRT_CPU_GPU
@@ -375,27 +402,36 @@ class SobolSampler {
     PBRT_CPU_GPU
     Float sampleDimension(int dimension) const {
         if (dimension < 2 || randomizeStrategy == RandomizeStrategy::None)
-            return SobolSample(sequenceIndex, dimension, NoRandomizer());
+            return sample(dimension, NoRandomizer());
 
         if (randomizeStrategy == RandomizeStrategy::CranleyPatterson) {
             uint32_t hash = MixBits(dimension);
-            return SobolSample(sequenceIndex, dimension, CranleyPattersonRotator(hash));
+            return sample(dimension, CranleyPattersonRotator(hash));
         } else if (randomizeStrategy == RandomizeStrategy::Xor) {
             // Only use the dimension! (Want the same scrambling over all
             // pixels).
             uint32_t hash = MixBits(dimension);
-            return SobolSample(sequenceIndex, dimension, XORScrambler(hash));
+            return sample(dimension, XORScrambler(hash));
         } else {
             DCHECK(randomizeStrategy == RandomizeStrategy::Owen);
             uint32_t seed = MixBits(dimension);  // Only dimension!
-            return SobolSample(sequenceIndex, dimension, OwenScrambler(seed));
+            return sample(dimension, OwenScrambler(seed));
         }
     }
 
+    template <typename R>
+    PBRT_CPU_GPU Float sample(int dimension, R randomizer) const {
+        // Use precomputed Sobol tables for _dimension_, if available
+        if (byteTables && dimension < byteTables->NDimensions())
+            return byteTables->SampleFloat(sequenceIndex, dimension, randomizer);
+        return SobolSample(sequenceIndex, dimension, randomizer);
+    }
+
     // SobolSampler Private Members
     int samplesPerPixel;
     int resolution;
     RandomizeStrategy randomizeStrategy;
+    const SobolByteTables *byteTables = nullptr;
     Point2i pixel;
     int dimension = 0;
     int64_t sequenceIndex;
@@ -7,6 +7,7 @@
 #include <pbrt/pbrt.h>
 
 #include <pbrt/samplers.h>
+#include <pbrt/util/progressreporter.h>
 
 using namespace pbrt;
 
@@ -145,3 +146,59 @@ TEST(PMJ02BNSampler, ElementaryIntervals) {
         checkElementarySampler("PMJ02BNSampler", new PMJ02BNSampler(1 << logSamples),
                                logSamples);
 }
+
+// Samplers using precomputed tables should match the ones that don't.
+TEST(Sampler, PrecomputedTables) {
+    constexpr int spp = 64;
+    Point2i resolution(300, 200);
+    for (auto rand : {RandomizeStrategy::None, RandomizeStrategy::CranleyPatterson,
+                      RandomizeStrategy::Xor, RandomizeStrategy::Owen}) {
+        std::vector<std::pair<SamplerHandle, SamplerHandle>> samplers;
+        samplers.push_back({new PaddedSobolSampler(spp, rand),
+                            new PaddedSobolSampler(spp, rand, true)});
+        samplers.push_back({new SobolSampler(spp, resolution, rand),
+                            new SobolSampler(spp, resolution, rand, 16)});
+
+        for (auto &s : samplers)
+            for (Point2i p : {Point2i(0, 0), Point2i(17, 3), Point2i(299, 199)})
+                for (int index = 0; index < spp; ++index) {
+                    s.first.StartPixelSample(p, index);
+                    s.second.StartPixelSample(p, index);
+                    // Go past the tabulated dimensions
+                    for (int i = 0; i < 12; ++i) {
+                        EXPECT_EQ(s.first.Get2D(), s.second.Get2D());
+                        EXPECT_EQ(s.first.Get1D(), s.second.Get1D());
+                    }
+                }
+    }
+}
+
+// Reports sample generation throughput with and without precomputed tables.
+TEST(Sampler, DISABLED_PrecomputedTablesTiming) {
+    constexpr int spp = 64, nDimensions = 24;
+    Point2i resolution(64, 64);
+    for (auto rand : {RandomizeStrategy::Xor, RandomizeStrategy::Owen}) {
+        std::vector<std::pair<const char *, SamplerHandle>> samplers = {
+            {"PaddedSobolSampler", new PaddedSobolSampler(spp, rand)},
+            {"PaddedSobolSampler tables", new PaddedSobolSampler(spp, rand, true)},
+            {"SobolSampler", new SobolSampler(spp, resolution, rand)},
+            {"SobolSampler tables",
+             new SobolSampler(spp, resolution, rand, nDimensions)}};
+        for (auto &s : samplers) {
+            SamplerHandle sampler = s.second;
+            Float sum = 0;
+            Timer timer;
+            for (Point2i p : Bounds2i(Point2i(0, 0), resolution))
+                for (int index = 0; index < spp; ++index) {
+                    sampler.StartPixelSample(p, index);
+                    for (int i = 0; i < nDimensions / 2; ++i)
+                        sum += sampler.Get2D().x;
+                }
+            double ns = 1e9 * timer.ElapsedSeconds() /
+                        (double(resolution.x * resolution.y) * spp * nDimensions);
+            EXPECT_GT(sum, 0);
+            fprintf(stderr, "%s (%s): %.2f ns/dimension\n", s.first,
+                    ToString(rand).c_str(), ns);
+        }
+    }
+}
@@ -7,6 +7,7 @@
 #include <pbrt/interaction.h>
 #include <pbrt/options.h>
 #include <pbrt/paramdict.h>
+#include <pbrt/textures.h>
 #include <pbrt/util/check.h>
 #include <pbrt/util/error.h>
 #include <pbrt/util/file.h>
@@ -129,6 +130,7 @@ Cylinder *Cylinder::Create(const Transform *renderFromObject,
 }
 
 STAT_PIXEL_RATIO("Intersections/Ray-Triangle intersection tests", nTriHits, nTriTests);
+STAT_PIXEL_COUNTER("Intersections/Batched ray-triangle tests", nBatchedTriTests);
 
 std::string TriangleIntersection::ToString() const {
     return StringPrintf("[ TriangleIntersection b0: %f b1: %f b2: %f t: %f ]", b0, b1, b2,
@@ -347,6 +349,121 @@ pstd::optional<TriangleIntersection> Triangle::Intersect(const Ray &ray, Float t
     return TriangleIntersection{b0, b1, b2, t};
 }
 
+int Triangle::IntersectBatch(
+    const Ray &ray, Float tMax, const TriangleBatch &batch,
+    pstd::array<TriangleIntersection, TriangleBatch::Width> *isect) {
+    // The tests below follow the single-triangle test but only reject
+    // triangles that it certainly misses, since rounding can differ between
+    // the two, so all of its hits are among the candidates returned
+    constexpr int Width = TriangleBatch::Width;
+    nBatchedTriTests += batch.nTriangles;
+
+    // Compute permutation and shear for ray once for all triangles
+    int kz = MaxComponentIndex(Abs(ray.d));
+    int kx = kz + 1;
+    if (kx == 3)
+        kx = 0;
+    int ky = kx + 1;
+    if (ky == 3)
+        ky = 0;
+    Vector3f d = Permute(ray.d, {kx, ky, kz});
+    Float Sx = -d.x / d.z;
+    Float Sy = -d.y / d.z;
+    Float Sz = 1.f / d.z;
+
+    // Transform triangle vertices to ray coordinate space
+    Float pxt[3][Width], pyt[3][Width], pzt[3][Width];
+    Float ox = ray.o[kx], oy = ray.o[ky], oz = ray.o[kz];
+    for (int v = 0; v < 3; ++v) {
+        const Float *px = batch.p[v][kx], *py = batch.p[v][ky], *pz = batch.p[v][kz];
+        for (int i = 0; i < Width; ++i) {
+            pzt[v][i] = pz[i] - oz;
+            pxt[v][i] = (px[i] - ox) + Sx * pzt[v][i];
+            pyt[v][i] = (py[i] - oy) + Sy * pzt[v][i];
+        }
+    }
+
+    // Compute edge function coefficients for all triangles
+    Float e[3][Width];
+    for (int i = 0; i < Width; ++i) {
+        e[0][i] = DifferenceOfProducts(pxt[1][i], pyt[2][i], pyt[1][i], pxt[2][i]);
+        e[1][i] = DifferenceOfProducts(pxt[2][i], pyt[0][i], pyt[2][i], pxt[0][i]);
+        e[2][i] = DifferenceOfProducts(pxt[0][i], pyt[1][i], pyt[0][i], pxt[1][i]);
+    }
+
+    // Fall back to double precision test at triangle edges
+    if (sizeof(Float) == sizeof(float))
+        for (int i = 0; i < Width; ++i) {
+            if (e[0][i] != 0 && e[1][i] != 0 && e[2][i] != 0)
+                continue;
+            for (int edge = 0; edge < 3; ++edge) {
+                int v0 = (edge + 1) % 3, v1 = (edge + 2) % 3;
+                double a = (double)pxt[v1][i] * (double)pyt[v0][i];
+                double b = (double)pyt[v1][i] * (double)pxt[v0][i];
+                e[edge][i] = (float)(b - a);
+            }
+        }
+
+    // Compute error bounds for edge functions and hit distances of all triangles
+    Float zt[3][Width], eError[Width], tError[Width];
+    for (int i = 0; i < Width; ++i) {
+        for (int v = 0; v < 3; ++v)
+            zt[v][i] = pzt[v][i] * Sz;
+        Float maxZt =
+            std::max({std::abs(zt[0][i]), std::abs(zt[1][i]), std::abs(zt[2][i])});
+        Float maxXt =
+            std::max({std::abs(pxt[0][i]), std::abs(pxt[1][i]), std::abs(pxt[2][i])});
+        Float maxYt =
+            std::max({std::abs(pyt[0][i]), std::abs(pyt[1][i]), std::abs(pyt[2][i])});
+        Float deltaZ = gamma(3) * maxZt;
+        Float deltaX = gamma(5) * (maxXt + maxZt);
+        Float deltaY = gamma(5) * (maxYt + maxZt);
+        Float deltaE = 2 * (gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
+        Float maxE = std::max({std::abs(e[0][i]), std::abs(e[1][i]), std::abs(e[2][i])});
+        // The scalar test's values differ from these by up to twice the
+        // error bounds of either; the factor of two more covers the bounds'
+        // own rounding and differently contracted operations
+        eError[i] = 4 * deltaE;
+        tError[i] = 4 * 3 * (gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE);
+    }
+
+    // Perform conservative triangle edge tests for all triangles
+    int candidates = 0;
+    for (int i = 0; i < Width; ++i) {
+        Float e0 = e[0][i], e1 = e[1][i], e2 = e[2][i], err = eError[i];
+        bool outside = (e0 < -err || e1 < -err || e2 < -err) &&
+                       (e0 > err || e1 > err || e2 > err);
+        candidates |= int(!outside) << i;
+    }
+    candidates &= (1 << batch.nTriangles) - 1;
+    if (!candidates)
+        return 0;
+
+    // Test conservative hit distances against ray $t$ range
+    int hits = 0;
+    for (int i = 0; i < Width; ++i) {
+        if (!(candidates & (1 << i)))
+            continue;
+        Float e0 = e[0][i], e1 = e[1][i], e2 = e[2][i];
+        Float det = e0 + e1 + e2;
+        if (std::abs(det) <= 3 * eError[i]) {
+            // Keep triangles whose determinant's sign is uncertain
+            (*isect)[i] = TriangleIntersection{1.f / 3.f, 1.f / 3.f, 1.f / 3.f, 0};
+            hits |= 1 << i;
+            continue;
+        }
+        Float invDet = 1 / det;
+        Float t = (e0 * zt[0][i] + e1 * zt[1][i] + e2 * zt[2][i]) * invDet;
+        Float tErr = tError[i] * std::abs(invDet) + gamma(4) * std::abs(t);
+        if (t + tErr <= 0 || t - tErr > tMax)
+            continue;
+        (*isect)[i] = TriangleIntersection{e0 * invDet, e1 * invDet, e2 * invDet,
+                                           std::max<Float>(0, t - tErr)};
+        hits |= 1 << i;
+    }
+    return hits;
+}
+
 std::string Triangle::ToString() const {
     // Get triangle vertices in _p0_, _p1_, and _p2_
     auto mesh = GetMesh();
@@ -435,6 +552,7 @@ STAT_MEMORY_COUNTER("Memory/Curves", curveBytes);
 STAT_PERCENT("Intersections/Ray-curve intersection tests", nCurveHits, nCurveTests);
 STAT_COUNTER("Geometry/Curves", nCurves);
 STAT_COUNTER("Geometry/Split curves", nSplitCurves);
+STAT_PIXEL_COUNTER("Intersections/Batched ray-curve tests", nBatchedCurveTests);
 
 std::string ToString(CurveType type) {
     switch (type) {
@@ -510,21 +628,55 @@ pstd::vector<ShapeHandle> CreateCurve(const Transform *renderFromObject,
 }
 
 // Curve Method Definitions
+Curve::Curve(const CurveCommon *common, Float uMin, Float uMax)
+    : common(common),
+      uMin(uMin),
+      uMax(uMax) {
+    pstd::array<Point3f, 4> cpObj = controlPoints();
+    // Bound distance of the segment's surface from its chord
+    // The curve lies in the convex hull of its control points, so the
+    // distance of the inner two from the chord bounds that of the curve.
+    Vector3f chord = cpObj[3] - cpObj[0];
+    auto distanceToChord = [&](const Point3f &p) {
+        Float t = 0;
+        if (LengthSquared(chord) > 0)
+            t = Clamp(Dot(p - cpObj[0], chord) / LengthSquared(chord), 0, 1);
+        return Distance(p, cpObj[0] + t * chord);
+    };
+    Float maxWidth = std::max(Lerp(uMin, common->width[0], common->width[1]),
+                              Lerp(uMax, common->width[0], common->width[1]));
+    // Pad the radius to account for round-off error in the culling test
+    Float maxDistance = std::max(distanceToChord(cpObj[1]), distanceToChord(cpObj[2]));
+    chordRadius = 1.01f * (maxDistance + 0.5f * maxWidth);
+
+    // Compute refinement depth for curve, _maxDepth_
+    // The length of each second difference bounds its largest component in
+    // any rotated coordinate system, including the ray coordinate system used
+    // for intersection.
+    Float L0 = 0;
+    for (int i = 0; i < 2; ++i)
+        L0 = std::max(L0,
+                      Length((cpObj[i] - cpObj[i + 1]) + (cpObj[i + 2] - cpObj[i + 1])));
+    Float eps = std::max(common->width[0], common->width[1]) * .05f;  // width / 20
+    // Compute log base 4 by dividing log2 in half.
+    int r0 = Log2Int(1.41421356237f * 6.f * L0 / (8.f * eps)) / 2;
+    maxDepth = Clamp(r0, 0, 10);
+}
+
 Bounds3f Curve::Bounds() const {
-    Bounds3f b =
-        BoundCubicBezier<Bounds3f>(pstd::MakeConstSpan(common->cpObj), uMin, uMax);
+    pstd::array<Point3f, 4> cpObj = controlPoints();
+    Bounds3f b = BoundCubicBezier<Bounds3f>(pstd::MakeConstSpan(cpObj));
     Float width[2] = {Lerp(uMin, common->width[0], common->width[1]),
                       Lerp(uMax, common->width[0], common->width[1])};
     return (*common->renderFromObject)(Expand(b, std::max(width[0], width[1]) * 0.5f));
 }
 
 Float Curve::Area() const {
-    pstd::array<Point3f, 4> cpObj =
-        CubicBezierControlPoints(pstd::MakeConstSpan(common->cpObj), uMin, uMax);
     Float width0 = Lerp(uMin, common->width[0], common->width[1]);
     Float width1 = Lerp(uMax, common->width[0], common->width[1]);
     Float avgWidth = (width0 + width1) * 0.5f;
     Float approxLength = 0.f;
+    pstd::array<Point3f, 4> cpObj = controlPoints();
     for (int i = 0; i < 3; ++i)
         approxLength += Distance(cpObj[i], cpObj[i + 1]);
     return approxLength * avgWidth;
@@ -540,6 +692,45 @@ bool Curve::IntersectP(const Ray &ray, Float tMax) const {
     return intersect(ray, tMax, nullptr);
 }
 
+void Curve::RenderChordBounds(Point3f *p0, Vector3f *chord, Float *radius) const {
+    pstd::span<const Point3f> cpCurve = pstd::MakeConstSpan(common->cpObj);
+    const Transform &renderFromObject = *common->renderFromObject;
+    *p0 = renderFromObject(EvaluateCubicBezier(cpCurve, uMin));
+    Point3f p1 = renderFromObject(EvaluateCubicBezier(cpCurve, uMax));
+    *chord = p1 - *p0;
+
+    // Scale _chordRadius_ by a bound on how much the transformation stretches
+    // distances, the Frobenius norm of its linear part
+    const SquareMatrix<4> &m = renderFromObject.GetMatrix();
+    Float normSquared = 0;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            normSquared += Sqr(m[i][j]);
+    // Pad the radius for round-off error in the endpoints and the culling test
+    Float maxCoordinate = MaxComponentValue(Max(Abs(*p0), Abs(p1)));
+    *radius = 1.01f * std::sqrt(normSquared) * chordRadius + gamma(8) * maxCoordinate;
+}
+
+int Curve::CullBatch(const Ray &ray, const CurveBatch &batch) {
+    // Find the closest points of the ray's line and all chords as in _intersect()_
+    constexpr int Width = CurveBatch::Width;
+    nBatchedCurveTests += batch.nCurves;
+    Float a = LengthSquared(ray.d);
+    int candidates = 0;
+    for (int i = 0; i < Width; ++i) {
+        Vector3f chord(batch.chord[0][i], batch.chord[1][i], batch.chord[2][i]);
+        Vector3f w = ray.o - Point3f(batch.p0[0][i], batch.p0[1][i], batch.p0[2][i]);
+        Float b = Dot(ray.d, chord), c = LengthSquared(chord);
+        Float dw = Dot(ray.d, w), cw = Dot(chord, w);
+        Float denom = a * c - b * b;
+        Float sc = denom > 0 ? Clamp((a * cw - b * dw) / denom, 0, 1) : 0;
+        Float tc = (sc * b - dw) / a;
+        Float distSquared = LengthSquared(w + tc * ray.d - sc * chord);
+        candidates |= int(distSquared <= Sqr(batch.radius[i])) << i;
+    }
+    return candidates & ((1 << batch.nCurves) - 1);
+}
+
 bool Curve::intersect(const Ray &r, Float tMax,
                       pstd::optional<ShapeIntersection> *si) const {
 #ifndef PBRT_IS_GPU_CODE
@@ -550,20 +741,31 @@ bool Curve::intersect(const Ray &r, Float tMax,
     Vector3fi di = (*common->objectFromRender)(Vector3fi(r.d));
     Ray ray(Point3f(oi), Vector3f(di), r.time, r.medium);
 
-    // Compute object-space control points for curve segment, _cpObj_
-    pstd::array<Point3f, 4> cpObj =
-        CubicBezierControlPoints(pstd::MakeConstSpan(common->cpObj), uMin, uMax);
+    // Cull rays that pass farther than _chordRadius_ from the segment's chord
+    // Only the segment's endpoints are needed for this test, so its inner
+    // control points are computed after it.
+    pstd::span<const Point3f> cpCurve = pstd::MakeConstSpan(common->cpObj);
+    Point3f p0 = EvaluateCubicBezier(cpCurve, uMin);
+    Vector3f chord = EvaluateCubicBezier(cpCurve, uMax) - p0, w = ray.o - p0;
+    Float a = LengthSquared(ray.d), b = Dot(ray.d, chord), c = LengthSquared(chord);
+    Float dw = Dot(ray.d, w), cw = Dot(chord, w);
+    Float denom = a * c - b * b;
+    Float sc = denom > 0 ? Clamp((a * cw - b * dw) / denom, 0, 1) : 0;
+    Float tc = (sc * b - dw) / a;
+    if (LengthSquared(w + tc * ray.d - sc * chord) > Sqr(chordRadius))
+        return false;
+    pstd::array<Point3f, 4> cpObj = controlPoints();
 
     // Project curve control points to plane perpendicular to ray
-    // Be careful to set the "up" direction passed to LookAt() to equal the
-    // vector from the first to the last control points.  In turn, this
-    // helps orient the curve to be roughly parallel to the x axis in the
-    // ray coordinate system.
+    // Be careful to set the "up" direction of the ray coordinate system to
+    // be perpendicular to the vector from the first to the last control
+    // points.  In turn, this helps orient the curve to be roughly parallel
+    // to the x axis in the ray coordinate system.
     //
     // In turn (especially for curves that are approaching stright lines),
     // we get curve bounds with minimal extent in y, which in turn lets us
     // early out more quickly in recursiveIntersect().
-    Vector3f dx = Cross(ray.d, cpObj[3] - cpObj[0]);
+    Vector3f dx = Cross(ray.d, chord);
     if (LengthSquared(dx) == 0) {
         // If the ray and the vector between the first and last control
         // points are parallel, dx will be zero.  Generate an arbitrary xy
@@ -573,9 +775,13 @@ bool Curve::intersect(const Ray &r, Float tMax,
         CoordinateSystem(ray.d, &dx, &dy);
     }
 
-    Transform RayFromObject = LookAt(ray.o, ray.o + ray.d, dx);
-    pstd::array<Point3f, 4> cp = {RayFromObject(cpObj[0]), RayFromObject(cpObj[1]),
-                                  RayFromObject(cpObj[2]), RayFromObject(cpObj[3])};
+    // The ray coordinate system is orthonormal, so control points can be
+    // projected without building a full _Transform_ and its inverse.
+    Vector3f dir = Normalize(ray.d);
+    Frame rayFrame = Frame::FromXZ(Normalize(Cross(Normalize(dx), dir)), dir);
+    pstd::array<Point3f, 4> cp;
+    for (int i = 0; i < 4; ++i)
+        cp[i] = Point3f(rayFrame.ToLocal(cpObj[i] - ray.o));
 
     // Test ray against bound of projected control points
     // Before going any further, see if the ray's bounding box intersects
@@ -600,26 +806,13 @@ bool Curve::intersect(const Ray &r, Float tMax,
         std::min({cp[0].z, cp[1].z, cp[2].z, cp[3].z}) - 0.5f * maxWidth > zMax)
         return false;
 
-    // Compute refinement depth for curve, _maxDepth_
-    Float L0 = 0;
-    for (int i = 0; i < 2; ++i)
-        L0 = std::max(
-            L0, std::max(std::max(std::abs(cp[i].x - 2 * cp[i + 1].x + cp[i + 2].x),
-                                  std::abs(cp[i].y - 2 * cp[i + 1].y + cp[i + 2].y)),
-                         std::abs(cp[i].z - 2 * cp[i + 1].z + cp[i + 2].z)));
-
-    Float eps = std::max(common->width[0], common->width[1]) * .05f;  // width / 20
-    // Compute log base 4 by dividing log2 in half.
-    int r0 = Log2Int(1.41421356237f * 6.f * L0 / (8.f * eps)) / 2;
-    int maxDepth = Clamp(r0, 0, 10);
-
-    return recursiveIntersect(ray, tMax, pstd::MakeConstSpan(cp), Inverse(RayFromObject),
-                              uMin, uMax, maxDepth, si);
+    return recursiveIntersect(ray, tMax, pstd::MakeConstSpan(cp), rayFrame, uMin, uMax,
+                              maxDepth, si);
 }
 
 bool Curve::recursiveIntersect(const Ray &ray, Float tMax, pstd::span<const Point3f> cp,
-                               const Transform &ObjectFromRay, Float u0, Float u1,
-                               int depth, pstd::optional<ShapeIntersection> *si) const {
+                               const Frame &rayFrame, Float u0, Float u1, int depth,
+                               pstd::optional<ShapeIntersection> *si) const {
     Float rayLength = Length(ray.d);
     if (depth > 0) {
         // Split curve segment into sub-segments and test for intersection
@@ -652,8 +845,8 @@ bool Curve::recursiveIntersect(const Ray &ray, Float tMax, pstd::span<const Poin
                 continue;
 
             // Recursively test ray-segment intersection
-            bool hit = recursiveIntersect(ray, tMax, cps, ObjectFromRay, u[seg],
-                                          u[seg + 1], depth - 1, si);
+            bool hit = recursiveIntersect(ray, tMax, cps, rayFrame, u[seg], u[seg + 1],
+                                          depth - 1, si);
             // If we found an intersection and this is a shadow ray,
             // we can exit out immediately.
             if (hit && si == nullptr)
@@ -700,7 +893,7 @@ bool Curve::recursiveIntersect(const Ray &ray, Float tMax, pstd::span<const Poin
         Float ptCurveDist2 = pc.x * pc.x + pc.y * pc.y;
         if (ptCurveDist2 > hitWidth * hitWidth * .25f)
             return false;
-        Float zMax = rayLength * tMax;
+        Float zMax = rayLength * ((si && *si) ? (*si)->tHit : tMax);
         if (pc.z < 0 || pc.z > zMax)
             return false;
 
@@ -728,7 +921,7 @@ bool Curve::recursiveIntersect(const Ray &ray, Float tMax, pstd::span<const Poin
                 dpdv = Normalize(Cross(nHit, dpdu)) * hitWidth;
             else {
                 // Compute curve $\dpdv$ for flat and cylinder curves
-                Vector3f dpduPlane = ObjectFromRay.ApplyInverse(dpdu);
+                Vector3f dpduPlane = rayFrame.ToLocal(dpdu);
                 Vector3f dpdvPlane =
                     Normalize(Vector3f(-dpduPlane.y, dpduPlane.x, 0)) * hitWidth;
                 if (common->type == CurveType::Cylinder) {
@@ -737,7 +930,7 @@ bool Curve::recursiveIntersect(const Ray &ray, Float tMax, pstd::span<const Poin
                     Transform rot = Rotate(-theta, dpduPlane);
                     dpdvPlane = rot(dpdvPlane);
                 }
-                dpdv = ObjectFromRay(dpdvPlane);
+                dpdv = rayFrame.FromLocal(dpdvPlane);
             }
 
             Point3f pHit = ray(tHit);
@@ -1383,7 +1576,9 @@ pstd::vector<ShapeHandle> ShapeHandle::Create(const std::string &name,
                                               const Transform *objectFromRender,
                                               bool reverseOrientation,
                                               const ParameterDictionary &parameters,
-                                              const FileLoc *loc, Allocator alloc) {
+                                              const FileLoc *loc, Allocator alloc,
+                                              const SubdivisionDicing *dicing,
+                                              FloatTextureHandle displacement) {
     pstd::vector<ShapeHandle> shapes(alloc);
     if (name == "sphere") {
         shapes = {Sphere::Create(renderFromObject, objectFromRender, reverseOrientation,
@@ -1445,8 +1640,25 @@ pstd::vector<ShapeHandle> ShapeHandle::Create(const std::string &name,
         // don't actually use this for now...
         std::string scheme = parameters.GetOneString("scheme", "loop");
 
-        TriangleMesh *mesh = LoopSubdivide(renderFromObject, reverseOrientation, nLevels,
-                                           vertexIndices, P, alloc);
+        // Dice the surface adaptively if requested or needed for displacement
+        Float edgeLength = parameters.GetOneFloat("edgelength", displacement ? 1 : 0);
+        TriangleMesh *mesh = nullptr;
+        if (edgeLength > 0) {
+            int maxEdgeRate = parameters.GetOneInt("maxedgerate", 64);
+            std::function<Float(Point3f, Normal3f)> displace;
+            if (displacement)
+                displace = [&](Point3f p, Normal3f n) {
+                    TextureEvalContext ctx(p, Vector3f(), Vector3f(), Point2f(), 0, 0, 0,
+                                           0, 0);
+                    return displacement.Evaluate(ctx);
+                };
+            mesh = DiceSubdivisionSurface(renderFromObject, reverseOrientation, nLevels,
+                                          vertexIndices, P, edgeLength, maxEdgeRate,
+                                          dicing ? *dicing : SubdivisionDicing(),
+                                          displace, alloc);
+        } else
+            mesh = LoopSubdivide(renderFromObject, reverseOrientation, nLevels,
+                                 vertexIndices, P, alloc);
 
         shapes = Triangle::CreateTriangles(mesh, alloc);
     } else
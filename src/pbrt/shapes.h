@@ -13,6 +13,7 @@
 #include <pbrt/util/mesh.h>
 #include <pbrt/util/pstd.h>
 #include <pbrt/util/sampling.h>
+#include <pbrt/util/splines.h>
 #include <pbrt/util/transform.h>
 #include <pbrt/util/vecmath.h>
 
@@ -870,6 +871,20 @@ struct TriangleIntersection {
     std::string ToString() const;
 };
 
+// TriangleBatch Definition
+// Vertices of up to _Width_ triangles stored by vertex, dimension, and then
+// triangle, so that the ray-triangle test runs across a batch in loops that
+// can be vectorized.
+struct TriangleBatch {
+    Point3f Vertex(int v, int lane) const {
+        return Point3f(p[v][0][lane], p[v][1][lane], p[v][2][lane]);
+    }
+
+    static constexpr int Width = 4;
+    Float p[3][3][Width];
+    int nTriangles = 0;
+};
+
 // Triangle Definition
 class Triangle {
   public:
@@ -923,6 +938,27 @@ class Triangle {
                                                           const Point3f &p1,
                                                           const Point3f &p2);
 
+    // Returns a mask of the batch's triangles that the ray may hit, which
+    // includes all that _Intersect()_ reports hits with; each candidate's
+    // _t_ in _isect_ is a lower bound on its hit distance
+    static int IntersectBatch(
+        const Ray &ray, Float tMax, const TriangleBatch &batch,
+        pstd::array<TriangleIntersection, TriangleBatch::Width> *isect);
+
+    PBRT_CPU_GPU
+    pstd::array<Point3f, 3> GetVertices() const {
+        auto mesh = GetMesh();
+        const int *v = &mesh->vertexIndices[3 * triIndex];
+        return {mesh->p[v[0]], mesh->p[v[1]], mesh->p[v[2]]};
+    }
+
+    PBRT_CPU_GPU
+    pstd::optional<SurfaceInteraction> InteractionFromIntersection(
+        const TriangleIntersection &isect, const Vector3f &wo, Float time) const {
+        return InteractionFromIntersection(GetMesh(), triIndex,
+                                           {isect.b0, isect.b1, isect.b2}, time, wo);
+    }
+
     PBRT_CPU_GPU
     static pstd::optional<SurfaceInteraction> InteractionFromIntersection(
         const TriangleMesh *mesh, int triIndex, pstd::array<Float, 3> b, Float time,
@@ -1299,6 +1335,16 @@ struct CurveCommon {
     bool reverseOrientation, transformSwapsHandedness;
 };
 
+// CurveBatch Definition
+// Bounding capsules of up to _Width_ curve segments in the space their rays
+// are given in, stored by dimension and then segment, so that rays can be
+// culled against a batch in loops that can be vectorized.
+struct CurveBatch {
+    static constexpr int Width = 4;
+    Float p0[3][Width], chord[3][Width], radius[Width];
+    int nCurves = 0;
+};
+
 // Curve Definition
 class Curve {
   public:
@@ -1334,22 +1380,38 @@ class Curve {
 
     std::string ToString() const;
 
-    Curve(const CurveCommon *common, Float uMin, Float uMax)
-        : common(common), uMin(uMin), uMax(uMax) {}
+    Curve(const CurveCommon *common, Float uMin, Float uMax);
 
     PBRT_CPU_GPU
     DirectionCone NormalBounds() const { return DirectionCone::EntireSphere(); }
 
+    // Returns the segment's chord in rendering space and the radius of a
+    // capsule around it that bounds the segment
+    void RenderChordBounds(Point3f *p0, Vector3f *chord, Float *radius) const;
+    // Returns a mask of the batch's segments whose capsules the ray's line
+    // passes through, which includes all segments that _Intersect()_ hits
+    static int CullBatch(const Ray &ray, const CurveBatch &batch);
+
   private:
     // Curve Private Methods
     bool intersect(const Ray &r, Float tMax, pstd::optional<ShapeIntersection> *si) const;
     bool recursiveIntersect(const Ray &r, Float tMax, pstd::span<const Point3f> cp,
-                            const Transform &ObjectFromRay, Float u0, Float u1, int depth,
+                            const Frame &rayFrame, Float u0, Float u1, int depth,
                             pstd::optional<ShapeIntersection> *si) const;
+    PBRT_CPU_GPU
+    pstd::array<Point3f, 4> controlPoints() const {
+        return CubicBezierControlPoints(pstd::MakeConstSpan(common->cpObj), uMin, uMax);
+    }
 
     // Curve Private Members
     const CurveCommon *common;
     Float uMin, uMax;
+    // The maximum distance of the segment's surface from the line between its
+    // endpoints and the depth of recursive subdivision used for ray
+    // intersection; the segment's control points are recomputed as needed
+    // to keep the many segments of hair and fur small.
+    Float chordRadius;
+    uint8_t maxDepth;
 };
 
 // BilinearPatch Declarations
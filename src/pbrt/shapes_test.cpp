@@ -8,14 +8,19 @@
 
 #include <pbrt/interaction.h>
 #include <pbrt/shapes.h>
+#include <pbrt/util/loopsubdiv.h>
 #include <pbrt/util/lowdiscrepancy.h>
 #include <pbrt/util/memory.h>
 #include <pbrt/util/parallel.h>
+#include <pbrt/util/progressreporter.h>
 #include <pbrt/util/rng.h>
 #include <pbrt/util/sampling.h>
+#include <pbrt/util/splines.h>
 
 #include <cmath>
 #include <functional>
+#include <map>
+#include <tuple>
 
 using namespace pbrt;
 
@@ -201,6 +206,96 @@ TEST(Triangle, Reintersect) {
     }
 }
 
+// Checks that the batched test's candidates include every hit that the
+// single-triangle test finds and returns the number of other candidates
+static int CheckBatchCandidates(const Ray &ray, Float tMax, const TriangleBatch &batch,
+                                const Point3f p[TriangleBatch::Width][3],
+                                int *nHits, int *nMismatches) {
+    pstd::array<TriangleIntersection, TriangleBatch::Width> isect;
+    int candidates = Triangle::IntersectBatch(ray, tMax, batch, &isect);
+    EXPECT_EQ(0, candidates >> batch.nTriangles);
+    int nFalseCandidates = 0;
+    for (int lane = 0; lane < batch.nTriangles; ++lane) {
+        pstd::optional<TriangleIntersection> ti =
+            Triangle::Intersect(ray, tMax, p[lane][0], p[lane][1], p[lane][2]);
+        bool candidate = candidates & (1 << lane);
+        if (ti) {
+            ++*nHits;
+            if (!candidate || isect[lane].t > ti->t)
+                ++*nMismatches;
+        } else if (candidate)
+            ++nFalseCandidates;
+    }
+    return nFalseCandidates;
+}
+
+TEST(Triangle, IntersectBatch) {
+    RNG rng(2024);
+    int nHits = 0, nMismatches = 0, nFalseCandidates = 0;
+    for (int i = 0; i < 20000; ++i) {
+        // Fill a batch with random triangles, leaving the last lane unused
+        TriangleBatch batch;
+        batch.nTriangles = TriangleBatch::Width - 1;
+        Point3f p[TriangleBatch::Width][3];
+        for (int lane = 0; lane < TriangleBatch::Width; ++lane)
+            for (int v = 0; v < 3; ++v) {
+                p[lane][v] = Point3f(pUnif(rng), pUnif(rng), pUnif(rng));
+                for (int c = 0; c < 3; ++c)
+                    batch.p[v][c][lane] = p[lane][v][c];
+            }
+
+        // Shoot a ray toward a point on the first triangle
+        Point3f o(pUnif(rng, 20), pUnif(rng, 20), pUnif(rng, 20));
+        pstd::array<Float, 3> b =
+            SampleUniformTriangle({rng.Uniform<Float>(), rng.Uniform<Float>()});
+        Point3f pt = b[0] * p[0][0] + b[1] * p[0][1] + b[2] * p[0][2];
+        Ray ray(o, pt - o);
+        Float tMax = rng.Uniform<Float>() < .5f ? Infinity : 1.5f * rng.Uniform<Float>();
+
+        nFalseCandidates += CheckBatchCandidates(ray, tMax, batch, p, &nHits,
+                                                 &nMismatches);
+    }
+    EXPECT_GT(nHits, 10000);
+    EXPECT_EQ(0, nMismatches);
+    // Candidates that the scalar test rejects should be rare
+    EXPECT_LT(nFalseCandidates, 200);
+}
+
+TEST(Triangle, IntersectBatchSharedEdges) {
+    RNG rng(7);
+    int nHits = 0, nMismatches = 0;
+    for (int i = 0; i < 20000; ++i) {
+        // Make a fan of triangles around a shared vertex, with each pair of
+        // neighbors sharing an edge
+        TriangleBatch batch;
+        batch.nTriangles = TriangleBatch::Width;
+        Point3f pc(pUnif(rng), pUnif(rng), pUnif(rng)), pRing[TriangleBatch::Width + 1];
+        for (int j = 0; j < TriangleBatch::Width; ++j)
+            pRing[j] = Point3f(pUnif(rng), pUnif(rng), pUnif(rng));
+        pRing[TriangleBatch::Width] = pRing[0];
+        Point3f p[TriangleBatch::Width][3];
+        for (int lane = 0; lane < TriangleBatch::Width; ++lane) {
+            p[lane][0] = pc;
+            p[lane][1] = pRing[lane];
+            p[lane][2] = pRing[lane + 1];
+            for (int v = 0; v < 3; ++v)
+                for (int c = 0; c < 3; ++c)
+                    batch.p[v][c][lane] = p[lane][v][c];
+        }
+
+        // Shoot rays at the shared vertex and at a point on a shared edge
+        Point3f o(pUnif(rng, 20), pUnif(rng, 20), pUnif(rng, 20));
+        Point3f pEdge = Lerp(rng.Uniform<Float>(), pc, pRing[rng.Uniform<int>(4)]);
+        for (Point3f pt : {pc, pEdge, pRing[rng.Uniform<int>(4)]}) {
+            Ray ray(o, pt - o);
+            for (Float tMax : {Float(Infinity), Float(1), Float(1.5)})
+                CheckBatchCandidates(ray, tMax, batch, p, &nHits, &nMismatches);
+        }
+    }
+    EXPECT_GT(nHits, 10000);
+    EXPECT_EQ(0, nMismatches);
+}
+
 // Checks the closed-form solid angle computation for triangles against a
 // Monte Carlo estimate of it.
 TEST(Triangle, SolidAngle) {
@@ -427,6 +522,153 @@ TEST(Cylinder, Reintersect) {
     });
 }
 
+TEST(Curve, CenterlineHits) {
+    RNG rng;
+    Transform identity;
+    int nTests = 0, nMisses = 0;
+    for (int i = 0; i < 100; ++i) {
+        Point3f cp[4];
+        for (int j = 0; j < 4; ++j)
+            cp[j] = Point3f(pUnif(rng, 1), pUnif(rng, 1), pUnif(rng, 1));
+        CurveCommon common(pstd::MakeConstSpan(cp), 0.05f, 0.02f, CurveType::Flat, {},
+                           &identity, &identity, false);
+        const int nSegments = 4;
+        for (int seg = 0; seg < nSegments; ++seg) {
+            Float uMin = Float(seg) / nSegments, uMax = Float(seg + 1) / nSegments;
+            Curve curve(&common, uMin, uMax);
+            for (int j = 0; j < 20; ++j) {
+                // Rays toward points on the curve's centerline away from the
+                // segment's endpoints should hit it.
+                Float u = Lerp(Lerp(rng.Uniform<Float>(), .05f, .95f), uMin, uMax);
+                Point3f pc = EvaluateCubicBezier(pstd::MakeConstSpan(cp), u);
+                Point3f o(pUnif(rng), pUnif(rng), pUnif(rng));
+                Ray ray(o, pc - o);
+                pstd::optional<ShapeIntersection> si = curve.Intersect(ray, Infinity);
+                ++nTests;
+                if (!si || !curve.IntersectP(ray, Infinity)) {
+                    ++nMisses;
+                    continue;
+                }
+                EXPECT_LE(si->tHit, 1.05f);
+                EXPECT_GE(si->intr.uv[0], uMin);
+                EXPECT_LE(si->intr.uv[0], uMax);
+                EXPECT_TRUE(Inside(si->intr.p(), Expand(curve.Bounds(), 1e-3f)));
+            }
+        }
+    }
+    // Allow for the occasional miss due to cracks between refined segments
+    EXPECT_LT(nMisses, nTests / 100);
+}
+
+TEST(Curve, CullBatch) {
+    RNG rng(3);
+    int nHits = 0, nCulled = 0;
+    for (int i = 0; i < 200; ++i) {
+        // Create a batch of segments of curves with differently scaled, rotated,
+        // and translated object spaces
+        CurveBatch batch;
+        batch.nCurves = CurveBatch::Width - (i & 1);
+        Transform renderFromObject[CurveBatch::Width];
+        Transform objectFromRender[CurveBatch::Width];
+        std::vector<CurveCommon> commons;
+        commons.reserve(CurveBatch::Width);
+        std::vector<Curve> curves;
+        for (int lane = 0; lane < batch.nCurves; ++lane) {
+            Vector3f axis(pUnif(rng, 1), pUnif(rng, 1), pUnif(rng, 1));
+            renderFromObject[lane] =
+                Translate(Vector3f(pUnif(rng), pUnif(rng), pUnif(rng))) *
+                Rotate(360 * rng.Uniform<Float>(), axis) *
+                Scale(.1f + rng.Uniform<Float>(), .1f + 3 * rng.Uniform<Float>(),
+                      .1f + rng.Uniform<Float>());
+            objectFromRender[lane] = Inverse(renderFromObject[lane]);
+            Point3f cp[4];
+            for (int j = 0; j < 4; ++j)
+                cp[j] = Point3f(pUnif(rng, 1), pUnif(rng, 1), pUnif(rng, 1));
+            commons.push_back(CurveCommon(
+                pstd::MakeConstSpan(cp), .1f * rng.Uniform<Float>(),
+                .1f * rng.Uniform<Float>(), CurveType::Flat, {}, &renderFromObject[lane],
+                &objectFromRender[lane], false));
+            Float uMin = .5f * rng.Uniform<Float>();
+            curves.push_back(Curve(&commons.back(), uMin, uMin + .5f));
+            Point3f p0;
+            Vector3f chord;
+            curves.back().RenderChordBounds(&p0, &chord, &batch.radius[lane]);
+            for (int c = 0; c < 3; ++c) {
+                batch.p0[c][lane] = p0[c];
+                batch.chord[c][lane] = chord[c];
+            }
+        }
+
+        for (int j = 0; j < 100; ++j) {
+            // Trace rays toward points on the curves and random rays
+            Point3f o(pUnif(rng, 20), pUnif(rng, 20), pUnif(rng, 20));
+            int target = rng.Uniform<uint32_t>(batch.nCurves);
+            Point3f pTarget = renderFromObject[target](EvaluateCubicBezier(
+                pstd::MakeConstSpan(commons[target].cpObj), rng.Uniform<Float>()));
+            Ray ray(o, (j & 1) ? pTarget - o : Vector3f(pUnif(rng), pUnif(rng), 1));
+
+            // Segments that are hit must not be culled
+            int candidates = Curve::CullBatch(ray, batch);
+            EXPECT_EQ(0, candidates >> batch.nCurves);
+            for (int lane = 0; lane < batch.nCurves; ++lane) {
+                bool hit = curves[lane].IntersectP(ray, Infinity);
+                nHits += hit;
+                nCulled += !(candidates & (1 << lane));
+                if (hit)
+                    EXPECT_TRUE(candidates & (1 << lane));
+            }
+        }
+    }
+    EXPECT_GT(nHits, 1000);
+    EXPECT_GT(nCulled, 20000);
+}
+
+TEST(Curve, DISABLED_IntersectTiming) {
+    // Long, thin hair-like curves that are split into segments
+    RNG rng(7);
+    Transform identity;
+    std::vector<CurveCommon> commons;
+    commons.reserve(256);
+    std::vector<Curve> curves;
+    const int nSegments = 8;
+    for (int i = 0; i < 256; ++i) {
+        Point3f root(pUnif(rng, 1), 0, pUnif(rng, 1));
+        Point3f cp[4];
+        for (int j = 0; j < 4; ++j)
+            cp[j] = root + Vector3f(.1f * pUnif(rng, j), j, .1f * pUnif(rng, j));
+        commons.push_back(CurveCommon(pstd::MakeConstSpan(cp), .01f, .002f,
+                                      CurveType::Flat, {}, &identity, &identity, false));
+        for (int seg = 0; seg < nSegments; ++seg)
+            curves.push_back(Curve(&commons.back(), Float(seg) / nSegments,
+                                   Float(seg + 1) / nSegments));
+    }
+    std::vector<Ray> rays;
+    for (int i = 0; i < 1000; ++i) {
+        Point3f o(pUnif(rng, 4), pUnif(rng, 4) + 1.5f, pUnif(rng, 4));
+        Point3f pTarget(pUnif(rng, 1), 3 * rng.Uniform<Float>(), pUnif(rng, 1));
+        rays.push_back(Ray(o, pTarget - o));
+    }
+
+    // Report the cost of testing each ray against every segment
+    int nHits = 0;
+    Timer timer;
+    for (const Ray &ray : rays)
+        for (const Curve &curve : curves)
+            nHits += curve.Intersect(ray, Infinity).has_value();
+    double intersectSeconds = timer.ElapsedSeconds();
+    timer = Timer();
+    for (const Ray &ray : rays)
+        for (const Curve &curve : curves)
+            nHits -= curve.IntersectP(ray, Infinity);
+    double intersectPSeconds = timer.ElapsedSeconds();
+    size_t nTests = rays.size() * curves.size();
+    fprintf(stderr,
+            "%d bytes/segment: Intersect %.1f ns/test, IntersectP %.1f ns/test\n",
+            int(sizeof(Curve)), 1e9 * intersectSeconds / nTests,
+            1e9 * intersectPSeconds / nTests);
+    EXPECT_EQ(0, nHits);
+}
+
 TEST(Triangle, BadCases) {
     Transform identity;
     std::vector<int> indices{0, 1, 2};
@@ -442,3 +684,70 @@ TEST(Triangle, BadCases) {
 
     EXPECT_FALSE(tris[0].Intersect(ray).has_value());
 }
+
+TEST(LoopSubdiv, DiceWatertight) {
+    // Tetrahedron seen from a camera far enough away for edge rates to vary
+    Transform identity;
+    std::vector<int> indices{0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2};
+    std::vector<Point3f> p{Point3f(0, 0, 0), Point3f(1, 0, 0), Point3f(0, 1, 0),
+                           Point3f(0, 0, 1)};
+    SubdivisionDicing dicing;
+    dicing.pCamera = Point3f(-2, -3, -4);
+    dicing.pixelSpread = 0;
+    dicing.pixelAngle = 0.001f;
+
+    size_t nPrevTriangles = 0;
+    for (Float edgeLength : {64.f, 16.f, 4.f}) {
+        for (int mode = 0; mode < 3; ++mode) {
+            // Dice plainly, with displacement, and with part of the surface
+            // outside of the view
+            bool displace = mode == 1, cull = mode == 2;
+            std::function<Float(Point3f, Normal3f)> displacement;
+            if (displace)
+                displacement = [](Point3f p, Normal3f) { return 0.1f * p.x; };
+            dicing.frustum.clear();
+            if (cull)
+                dicing.frustum.push_back(
+                    std::make_pair(Point3f(.5, 0, 0), Vector3f(1, 0, 0)));
+            TriangleMesh *mesh = DiceSubdivisionSurface(
+                &identity, false, 2, indices, p, edgeLength, 64, dicing, displacement,
+                Allocator());
+            if (mode == 0) {
+                EXPECT_GT(mesh->nTriangles, nPrevTriangles);
+                nPrevTriangles = mesh->nTriangles;
+            } else if (cull && edgeLength < 64)
+                EXPECT_LT(mesh->nTriangles, nPrevTriangles);
+
+            // Every edge of the closed diced mesh should be shared by exactly
+            // two triangles, with vertices matched by position
+            using Key = std::tuple<Float, Float, Float>;
+            auto key = [](Point3f p) { return Key(p.x, p.y, p.z); };
+            std::map<std::pair<Key, Key>, int> edges;
+            for (int t = 0; t < mesh->nTriangles; ++t)
+                for (int e = 0; e < 3; ++e) {
+                    auto k0 = key(mesh->p[mesh->vertexIndices[3 * t + e]]);
+                    auto k1 = key(mesh->p[mesh->vertexIndices[3 * t + (e + 1) % 3]]);
+                    ++edges[std::make_pair(std::min(k0, k1), std::max(k0, k1))];
+                }
+            int nUnshared = 0;
+            for (const auto &edge : edges)
+                nUnshared += edge.second != 2;
+            EXPECT_EQ(0, nUnshared) << edgeLength << " " << mode;
+        }
+    }
+}
+
+TEST(LoopSubdiv, DiceAtPinhole) {
+    // Edges through a pinhole camera's position have zero pixel footprint; they
+    // should get the maximum rate rather than an undefined one
+    Transform identity;
+    std::vector<int> indices{0, 1, 2};
+    std::vector<Point3f> p{Point3f(0, 0, 0), Point3f(1, 0, 0), Point3f(0, 1, 0)};
+    SubdivisionDicing dicing;
+    dicing.pCamera = Point3f(.4, .2, 0);
+    dicing.pixelSpread = 0;
+    dicing.pixelAngle = 0.001f;
+    TriangleMesh *mesh = DiceSubdivisionSurface(&identity, false, 0, indices, p, 1, 8,
+                                                dicing, {}, Allocator());
+    EXPECT_EQ(64, mesh->nTriangles);
+}
@@ -11,6 +11,8 @@
 #include <pbrt/util/error.h>
 #include <pbrt/util/file.h>
 #include <pbrt/util/float.h>
+#include <pbrt/util/log.h>
+#include <pbrt/util/parallel.h>
 #include <pbrt/util/stats.h>
 
 #include <mutex>
@@ -70,10 +72,16 @@ std::string SpectrumTextureHandle::ToString() const {
 PBRT_CPU_GPU
 inline Float Grad(int x, int y, int z, Float dx, Float dy, Float dz);
 PBRT_CPU_GPU
+inline Float Grad(int h, Float dx, Float dy, Float dz);
+PBRT_CPU_GPU
 inline Float NoiseWeight(Float t);
+PBRT_CPU_GPU
+static inline void NoiseBatch(const Float *x, const Float *y, const Float *z,
+                              Float *result);
 
 // Perlin Noise Data
 static constexpr int NoisePermSize = 256;
+static constexpr int NoiseBatchSize = 8;
 static PBRT_CONST int NoisePerm[2 * NoisePermSize] = {
     151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103,
     30, 69, 142,
@@ -165,11 +173,71 @@ Float Noise(const Point3f &p) {
     return Noise(p.x, p.y, p.z);
 }
 
+static inline void NoiseBatch(const Float *x, const Float *y, const Float *z,
+                              Float *result) {
+    // Compute noise cell coordinates and offsets for the batch
+    int ix[NoiseBatchSize], iy[NoiseBatchSize], iz[NoiseBatchSize];
+    Float dx[NoiseBatchSize], dy[NoiseBatchSize], dz[NoiseBatchSize];
+    for (int i = 0; i < NoiseBatchSize; ++i) {
+        Float fx = std::floor(x[i]), fy = std::floor(y[i]), fz = std::floor(z[i]);
+        ix[i] = fx;
+        iy[i] = fy;
+        iz[i] = fz;
+        dx[i] = x[i] - fx;
+        dy[i] = y[i] - fy;
+        dz[i] = z[i] - fz;
+        ix[i] &= NoisePermSize - 1;
+        iy[i] &= NoisePermSize - 1;
+        iz[i] &= NoisePermSize - 1;
+    }
+
+    // Hash cell corners, sharing permutation lookups between corners
+    int h[8][NoiseBatchSize];
+    for (int i = 0; i < NoiseBatchSize; ++i) {
+        int a = NoisePerm[ix[i]] + iy[i], b = NoisePerm[ix[i] + 1] + iy[i];
+        int aa = NoisePerm[a] + iz[i], ab = NoisePerm[a + 1] + iz[i];
+        int ba = NoisePerm[b] + iz[i], bb = NoisePerm[b + 1] + iz[i];
+        h[0][i] = NoisePerm[aa];
+        h[1][i] = NoisePerm[ba];
+        h[2][i] = NoisePerm[ab];
+        h[3][i] = NoisePerm[bb];
+        h[4][i] = NoisePerm[aa + 1];
+        h[5][i] = NoisePerm[ba + 1];
+        h[6][i] = NoisePerm[ab + 1];
+        h[7][i] = NoisePerm[bb + 1];
+    }
+
+    // Compute gradient weights and their trilinear interpolation
+    for (int i = 0; i < NoiseBatchSize; ++i) {
+        Float w000 = Grad(h[0][i], dx[i], dy[i], dz[i]);
+        Float w100 = Grad(h[1][i], dx[i] - 1, dy[i], dz[i]);
+        Float w010 = Grad(h[2][i], dx[i], dy[i] - 1, dz[i]);
+        Float w110 = Grad(h[3][i], dx[i] - 1, dy[i] - 1, dz[i]);
+        Float w001 = Grad(h[4][i], dx[i], dy[i], dz[i] - 1);
+        Float w101 = Grad(h[5][i], dx[i] - 1, dy[i], dz[i] - 1);
+        Float w011 = Grad(h[6][i], dx[i], dy[i] - 1, dz[i] - 1);
+        Float w111 = Grad(h[7][i], dx[i] - 1, dy[i] - 1, dz[i] - 1);
+
+        Float wx = NoiseWeight(dx[i]), wy = NoiseWeight(dy[i]), wz = NoiseWeight(dz[i]);
+        Float x00 = Lerp(wx, w000, w100);
+        Float x10 = Lerp(wx, w010, w110);
+        Float x01 = Lerp(wx, w001, w101);
+        Float x11 = Lerp(wx, w011, w111);
+        Float y0 = Lerp(wy, x00, x10);
+        Float y1 = Lerp(wy, x01, x11);
+        result[i] = Lerp(wz, y0, y1);
+    }
+}
+
 inline Float Grad(int x, int y, int z, Float dx, Float dy, Float dz) {
-    int h = NoisePerm[NoisePerm[NoisePerm[x] + y] + z];
+    return Grad(NoisePerm[NoisePerm[NoisePerm[x] + y] + z], dx, dy, dz);
+}
+
+inline Float Grad(int h, Float dx, Float dy, Float dz) {
+    // Select gradient components without branches so that batches vectorize
     h &= 15;
-    Float u = h < 8 || h == 12 || h == 13 ? dx : dy;
-    Float v = h < 4 || h == 12 || h == 13 ? dy : dz;
+    Float u = (h < 8) | (h == 12) | (h == 13) ? dx : dy;
+    Float v = (h < 4) | (h == 12) | (h == 13) ? dy : dz;
     return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
 }
 
@@ -188,13 +256,26 @@ Float FBm(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy, Float om
 
     // Compute sum of octaves of noise for FBm
     Float sum = 0, lambda = 1, o = 1;
-    for (int i = 0; i < nInt; ++i) {
-        sum += o * Noise(lambda * p);
-        lambda *= 1.99f;
-        o *= omega;
+    Float wPartial = SmoothStep(n - nInt, .3f, .7f);
+    int nEvaluated = nInt + (wPartial > 0);
+    for (int start = 0; start < nEvaluated; start += NoiseBatchSize) {
+        // Evaluate noise for a batch of octaves at once
+        int count = std::min(NoiseBatchSize, nEvaluated - start);
+        Float x[NoiseBatchSize] = {}, y[NoiseBatchSize] = {}, z[NoiseBatchSize] = {};
+        Float noise[NoiseBatchSize];
+        for (int i = 0; i < count; ++i) {
+            x[i] = lambda * p.x;
+            y[i] = lambda * p.y;
+            z[i] = lambda * p.z;
+            lambda *= 1.99f;
+        }
+        NoiseBatch(x, y, z, noise);
+
+        for (int i = 0; i < count; ++i) {
+            sum += o * (start + i < nInt ? 1 : wPartial) * noise[i];
+            o *= omega;
+        }
     }
-    Float nPartial = n - nInt;
-    sum += o * SmoothStep(nPartial, .3f, .7f) * Noise(lambda * p);
 
     return sum;
 }
@@ -208,15 +289,31 @@ Float Turbulence(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
 
     // Compute sum of octaves of noise for turbulence
     Float sum = 0, lambda = 1, o = 1;
-    for (int i = 0; i < nInt; ++i) {
-        sum += o * std::abs(Noise(lambda * p));
-        lambda *= 1.99f;
-        o *= omega;
+    Float wPartial = SmoothStep(n - nInt, .3f, .7f), noisePartial = 0;
+    int nEvaluated = nInt + (wPartial > 0);
+    for (int start = 0; start < nEvaluated; start += NoiseBatchSize) {
+        // Evaluate noise for a batch of octaves at once
+        int count = std::min(NoiseBatchSize, nEvaluated - start);
+        Float x[NoiseBatchSize] = {}, y[NoiseBatchSize] = {}, z[NoiseBatchSize] = {};
+        Float noise[NoiseBatchSize];
+        for (int i = 0; i < count; ++i) {
+            x[i] = lambda * p.x;
+            y[i] = lambda * p.y;
+            z[i] = lambda * p.z;
+            lambda *= 1.99f;
+        }
+        NoiseBatch(x, y, z, noise);
+
+        for (int i = 0; i < count && start + i < nInt; ++i) {
+            sum += o * std::abs(noise[i]);
+            o *= omega;
+        }
+        if (start + count > nInt)
+            noisePartial = noise[nInt - start];
     }
 
     // Account for contributions of clamped octaves in turbulence
-    Float nPartial = n - nInt;
-    sum += o * Lerp(SmoothStep(nPartial, .3f, .7f), 0.2, std::abs(Noise(lambda * p)));
+    sum += o * Lerp(wPartial, 0.2, std::abs(noisePartial));
     for (int i = nInt; i < maxOctaves; ++i) {
         sum += o * 0.2f;
         o *= omega;
@@ -507,6 +604,8 @@ std::string FBmTexture::ToString() const {
                         omega, octaves);
 }
 
+STAT_MEMORY_COUNTER("Memory/Image texture texel spectra", texelSpectraBytes);
+
 // ImageTextureBase Method Definitions
 ImageTextureBase::ImageTextureBase(TextureMapping2DHandle mapping,
                                    const std::string &filename, const std::string &filter,
@@ -553,6 +652,54 @@ MIPMap *ImageTextureBase::GetTexture(const std::string &filename,
         return nullptr;
 }
 
+const TexelSpectra *ImageTextureBase::GetTexelSpectra(const MIPMap *mipmap,
+                                                      Float scale, Allocator alloc) {
+    // Return _TexelSpectra_ from cache if present
+    std::pair<const MIPMap *, Float> key(mipmap, scale);
+    std::unique_lock<std::mutex> lock(textureCacheMutex);
+    if (auto iter = texelSpectraCache.find(key); iter != texelSpectraCache.end())
+        return iter->second.get();
+    lock.unlock();
+
+    // Compute sigmoid polynomial coefficients for all _mipmap_ texels
+    std::unique_ptr<TexelSpectra> ts = std::make_unique<TexelSpectra>(alloc);
+    const RGBColorSpace *cs = mipmap->GetRGBColorSpace();
+    for (int level = 0; level < mipmap->Levels(); ++level) {
+        ts->levelOffsets.push_back(ts->texels.size());
+        Point2i res = mipmap->LevelResolution(level);
+        ts->texels.resize(ts->texels.size() + size_t(res.x) * res.y);
+        ParallelFor(0, res.y, [&](int y) {
+            for (int x = 0; x < res.x; ++x) {
+                // Convert texel RGB as _SpectrumImageTexture::Evaluate()_ would
+                RGB rgb = scale * mipmap->Texel<RGB>(level, {x, y});
+                TexelSpectra::Texel &t =
+                    ts->texels[ts->levelOffsets[level] + y * res.x + x];
+                Float m = std::max({rgb.r, rgb.g, rgb.b});
+                if (m > 1) {
+                    t.scale = 2 * m;
+                    t.rsp = cs->ToRGBCoeffs(rgb / t.scale);
+                    t.illuminant = true;
+                } else {
+                    t.scale = 1;
+                    t.rsp = cs->ToRGBCoeffs(rgb);
+                    t.illuminant = false;
+                }
+            }
+        });
+    }
+    LOG_VERBOSE("Precomputed %d texel spectra", ts->texels.size());
+
+    // Add the texel spectra to the cache unless another thread already did
+    lock.lock();
+    std::unique_ptr<TexelSpectra> &entry = texelSpectraCache[key];
+    if (!entry) {
+        texelSpectraBytes += ts->texels.size() * sizeof(TexelSpectra::Texel) +
+                             ts->levelOffsets.size() * sizeof(size_t);
+        entry = std::move(ts);
+    }
+    return entry.get();
+}
+
 // SpectrumImageTexture Method Definitions
 SampledSpectrum SpectrumImageTexture::Evaluate(TextureEvalContext ctx,
                                                SampledWavelengths lambda) const {
@@ -567,8 +714,23 @@ SampledSpectrum SpectrumImageTexture::Evaluate(TextureEvalContext ctx,
     // Texture coordinates are (0,0) in the lower left corner, but
     // image coordinates are (0,0) in the upper left.
     st[1] = 1 - st[1];
-    RGB rgb = scale * mipmap->Lookup<RGB>(st, dstdx, dstdy);
     const RGBColorSpace *cs = mipmap->GetRGBColorSpace();
+    if (texelSpectra) {
+        // Evaluate precomputed spectrum of point-filtered texel
+        int level;
+        Point2i p;
+        if (!mipmap->PointTexel(st, dstdx, dstdy, &level, &p))
+            return SampledSpectrum(0);
+        const TexelSpectra::Texel &ts =
+            texelSpectra->texels[texelSpectra->levelOffsets[level] +
+                                 p.y * mipmap->LevelResolution(level).x + p.x];
+        SampledSpectrum s;
+        for (int i = 0; i < NSpectrumSamples; ++i)
+            s[i] = ts.scale * ts.rsp(lambda[i]);
+        return ts.illuminant ? s * cs->illuminant.Sample(lambda) : s;
+    }
+
+    RGB rgb = scale * mipmap->Lookup<RGB>(st, dstdx, dstdy);
     if (cs != nullptr) {
         if (std::max({rgb.r, rgb.g, rgb.b}) > 1)
             return RGBSpectrum(*cs, rgb).Sample(lambda);
@@ -580,9 +742,22 @@ SampledSpectrum SpectrumImageTexture::Evaluate(TextureEvalContext ctx,
 #endif
 }
 
+SpectrumImageTexture::SpectrumImageTexture(TextureMapping2DHandle m,
+                                           const std::string &filename,
+                                           const std::string &filter, Float maxAniso,
+                                           WrapMode wm, Float scale,
+                                           ColorEncodingHandle encoding, Allocator alloc,
+                                           bool precomputeCoefficients)
+    : ImageTextureBase(m, filename, filter, maxAniso, wm, scale, encoding, alloc) {
+    if (mipmap && precomputeCoefficients)
+        texelSpectra = GetTexelSpectra(mipmap, scale, alloc);
+}
+
 std::string SpectrumImageTexture::ToString() const {
-    return StringPrintf("[ SpectrumImageTexture mapping: %s scale: %f mipmap: %s ]",
-                        mapping, scale, *mipmap);
+    return StringPrintf("[ SpectrumImageTexture mapping: %s scale: %f mipmap: %s "
+                        "texelSpectra: %d ]",
+                        mapping, scale, *mipmap,
+                        texelSpectra ? texelSpectra->texels.size() : 0);
 }
 
 std::string FloatImageTexture::ToString() const {
@@ -598,6 +773,8 @@ std::string TexInfo::ToString() const {
 
 std::mutex ImageTextureBase::textureCacheMutex;
 std::map<TexInfo, std::unique_ptr<MIPMap>> ImageTextureBase::textureCache;
+std::map<std::pair<const MIPMap *, Float>, std::unique_ptr<TexelSpectra>>
+    ImageTextureBase::texelSpectraCache;
 
 FloatImageTexture *FloatImageTexture::Create(const Transform &renderFromTexture,
                                              const TextureParameterDictionary &parameters,
@@ -645,8 +822,16 @@ SpectrumImageTexture *SpectrumImageTexture::Create(
     std::string encodingString = parameters.GetOneString("encoding", defaultEncoding);
     ColorEncodingHandle encoding = ColorEncodingHandle::Get(encodingString);
 
-    return alloc.new_object<SpectrumImageTexture>(map, filename, filter, maxAniso,
-                                                  *wrapMode, scale, encoding, alloc);
+    // Precomputing texel spectra is only equivalent to RGB lookups without filtering
+    bool precompute = parameters.GetOneBool("precomputecoefficients", false);
+    if (precompute && filter != "point") {
+        Warning(loc, "\"precomputecoefficients\" is only supported with \"point\" "
+                     "filtering. Ignoring.");
+        precompute = false;
+    }
+
+    return alloc.new_object<SpectrumImageTexture>(
+        map, filename, filter, maxAniso, *wrapMode, scale, encoding, alloc, precompute);
 }
 
 // MarbleTexture Method Definitions
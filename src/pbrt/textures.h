@@ -331,6 +331,9 @@ class SpectrumConstantTexture {
         return value.Sample(lambda);
     }
 
+    PBRT_CPU_GPU
+    SpectrumHandle GetValue() const { return value; }
+
     static SpectrumConstantTexture *Create(const Transform &renderFromTexture,
                                            const TextureParameterDictionary &parameters,
                                            const FileLoc *loc, Allocator alloc);
@@ -582,6 +585,24 @@ struct TexInfo {
     std::string ToString() const;
 };
 
+// TexelSpectra Definition
+// Sigmoid polynomial coefficients for every texel of every level of an RGB
+// _MIPMap_ with a given scale. Each texel takes 20 bytes with 32-bit _Float_s,
+// in addition to the 3 to 12 bytes of RGB that the _MIPMap_ stores for it.
+struct TexelSpectra {
+    TexelSpectra(Allocator alloc) : texels(alloc), levelOffsets(alloc) {}
+
+    // TexelSpectra::Texel Definition
+    struct Texel {
+        RGBSigmoidPolynomial rsp;
+        Float scale;
+        bool illuminant;
+    };
+
+    pstd::vector<Texel> texels;
+    pstd::vector<size_t> levelOffsets;
+};
+
 // ImageTextureBase Definition
 class ImageTextureBase {
   public:
@@ -589,12 +610,19 @@ class ImageTextureBase {
                      const std::string &filter, Float maxAniso, WrapMode wm, Float scale,
                      ColorEncodingHandle encoding, Allocator alloc);
 
-    static void ClearCache() { textureCache.clear(); }
+    static void ClearCache() {
+        textureCache.clear();
+        texelSpectraCache.clear();
+    }
 
     TextureMapping2DHandle mapping;
     Float scale;
     MIPMap *mipmap;
 
+  protected:
+    static const TexelSpectra *GetTexelSpectra(const MIPMap *mipmap, Float scale,
+                                               Allocator alloc);
+
   private:
     static MIPMap *GetTexture(const std::string &filename, const std::string &filter,
                               Float maxAniso, WrapMode wm, ColorEncodingHandle encoding,
@@ -603,6 +631,8 @@ class ImageTextureBase {
     // ImageTextureBase Private Data
     static std::mutex textureCacheMutex;
     static std::map<TexInfo, std::unique_ptr<MIPMap>> textureCache;
+    static std::map<std::pair<const MIPMap *, Float>, std::unique_ptr<TexelSpectra>>
+        texelSpectraCache;
 };
 
 // FloatImageTexture Definition
@@ -641,8 +671,8 @@ class SpectrumImageTexture : public ImageTextureBase {
   public:
     SpectrumImageTexture(TextureMapping2DHandle m, const std::string &filename,
                          const std::string &filter, Float maxAniso, WrapMode wm,
-                         Float scale, ColorEncodingHandle encoding, Allocator alloc)
-        : ImageTextureBase(m, filename, filter, maxAniso, wm, scale, encoding, alloc) {}
+                         Float scale, ColorEncodingHandle encoding, Allocator alloc,
+                         bool precomputeCoefficients = false);
 
     PBRT_CPU_GPU
     SampledSpectrum Evaluate(TextureEvalContext ctx, SampledWavelengths lambda) const;
@@ -652,6 +682,12 @@ class SpectrumImageTexture : public ImageTextureBase {
                                         const FileLoc *loc, Allocator alloc);
 
     std::string ToString() const;
+
+  private:
+    // SpectrumImageTexture Private Members
+    // Texel coefficients, shared by all textures with the same _mipmap_ and
+    // _scale_, if they were precomputed
+    const TexelSpectra *texelSpectra = nullptr;
 };
 
 #if defined(PBRT_BUILD_GPU_RENDERER) && defined(__NVCC__)
@@ -1065,6 +1101,86 @@ class BasicTextureEvaluator {
     }
 };
 
+// SpecializedSpectrumTexture Definition
+// Records how to evaluate the spectrum textures that materials most commonly use
+// when the material is created: constant spectra become a stored value and
+// piecewise-linear spectra get a table of the segment at each whole wavelength,
+// which replaces a binary search per wavelength. All other textures are evaluated
+// using the provided _TextureEvaluator_.
+class SpecializedSpectrumTexture {
+  public:
+    // SpecializedSpectrumTexture Public Methods
+    SpecializedSpectrumTexture() = default;
+    SpecializedSpectrumTexture(SpectrumTextureHandle tex, Allocator alloc = {})
+        : tex(tex) {
+        SpectrumConstantTexture *sc = tex.CastOrNullptr<SpectrumConstantTexture>();
+        if (!sc)
+            return;
+        SpectrumHandle spectrum = sc->GetValue();
+        if (ConstantSpectrum *cs = spectrum.CastOrNullptr<ConstantSpectrum>()) {
+            type = Type::Constant;
+            constant = cs->MaxValue();
+        } else if (PiecewiseLinearSpectrum *pls =
+                       spectrum.CastOrNullptr<PiecewiseLinearSpectrum>();
+                   pls && pls->Lambdas().size() >= 2) {
+            // Find the segment that contains each whole wavelength
+            type = Type::PiecewiseLinear;
+            lambdas = pls->Lambdas();
+            values = pls->Values();
+            lambdaMin = int(std::floor(lambdas.front()));
+            int nSegments = int(std::floor(lambdas.back())) - lambdaMin + 1;
+            int *seg = alloc.allocate_object<int>(nSegments);
+            for (int i = 0; i < nSegments; ++i)
+                seg[i] = FindInterval(lambdas.size(), [&](int index) {
+                    return lambdas[index] <= lambdaMin + i;
+                });
+            segments = seg;
+        }
+    }
+
+    template <typename TextureEvaluator>
+    PBRT_CPU_GPU SampledSpectrum Evaluate(TextureEvaluator texEval,
+                                          TextureEvalContext ctx,
+                                          const SampledWavelengths &lambda) const {
+        switch (type) {
+        case Type::Constant:
+            return SampledSpectrum(constant);
+        case Type::PiecewiseLinear: {
+            // Interpolate in the segment found as _PiecewiseLinearSpectrum_ would
+            SampledSpectrum s(0.f);
+            for (int i = 0; i < NSpectrumSamples; ++i) {
+                Float l = lambda[i];
+                if (!(l >= lambdas.front() && l <= lambdas.back()))
+                    continue;
+                int offset = segments[int(std::floor(l)) - lambdaMin];
+                while (offset + 2 < int(lambdas.size()) && lambdas[offset + 1] <= l)
+                    ++offset;
+                Float t = (l - lambdas[offset]) / (lambdas[offset + 1] - lambdas[offset]);
+                s[i] = Lerp(t, values[offset], values[offset + 1]);
+            }
+            return s;
+        }
+        default:
+            return texEval(tex, ctx, lambda);
+        }
+    }
+
+    PBRT_CPU_GPU
+    operator SpectrumTextureHandle() const { return tex; }
+
+    std::string ToString() const { return tex.ToString(); }
+
+  private:
+    // SpecializedSpectrumTexture Private Members
+    enum class Type { Other, Constant, PiecewiseLinear };
+    SpectrumTextureHandle tex;
+    Type type = Type::Other;
+    Float constant = 0;
+    pstd::span<const Float> lambdas, values;
+    int lambdaMin = 0;
+    const int *segments = nullptr;
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_TEXTURES_H
@@ -0,0 +1,355 @@
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include <gtest/gtest.h>
+
+#include <pbrt/pbrt.h>
+
+#include <pbrt/bsdf.h>
+#include <pbrt/bxdfs.h>
+#include <pbrt/materials.h>
+#include <pbrt/textures.h>
+#include <pbrt/util/colorspace.h>
+#include <pbrt/util/image.h>
+#include <pbrt/util/memory.h>
+#include <pbrt/util/progressreporter.h>
+#include <pbrt/util/rng.h>
+#include <pbrt/util/sampling.h>
+#include <pbrt/util/spectrum.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace pbrt;
+
+// Returns textures of each type that _SpecializedSpectrumTexture_ handles, as well
+// as ones it leaves to the texture evaluator
+static std::vector<SpectrumTextureHandle> SpecializationTextures(
+    const std::string &imageFilename, Allocator alloc) {
+    // Piecewise-linear spectrum with breakpoints between and within whole
+    // wavelengths and a range narrower than the visible one
+    std::vector<Float> lambdas = {400.5f, 450,  500,   500.25f, 500.5f,
+                                  500.75f, 600, 633.3f, 700.25f};
+    std::vector<Float> values = {.2f, .7f, .4f, .9f, .1f, .5f, .3f, .8f, .6f};
+    PiecewiseLinearSpectrum *pls =
+        alloc.new_object<PiecewiseLinearSpectrum>(lambdas, values, alloc);
+
+    // Image texture
+    Image image(PixelFormat::Float, {8, 8}, {"R", "G", "B"});
+    RNG rng;
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            for (int c = 0; c < 3; ++c)
+                image.SetChannel({x, y}, c, rng.Uniform<Float>());
+    EXPECT_TRUE(image.Write(imageFilename));
+    UVMapping2D *mapping = alloc.new_object<UVMapping2D>();
+
+    return {alloc.new_object<SpectrumConstantTexture>(
+                alloc.new_object<ConstantSpectrum>(0.5f)),
+            alloc.new_object<SpectrumConstantTexture>(GetNamedSpectrum("metal-Cu-eta")),
+            alloc.new_object<SpectrumConstantTexture>(pls),
+            alloc.new_object<RGBReflectanceConstantTexture>(*RGBColorSpace::sRGB,
+                                                            RGB(0.2, 0.5, 0.7)),
+            alloc.new_object<RGBConstantTexture>(*RGBColorSpace::sRGB, RGB(2, 0.5, 1)),
+            alloc.new_object<SpectrumImageTexture>(mapping, imageFilename, "bilinear",
+                                                   8.f, WrapMode::Repeat, 1.f,
+                                                   ColorEncodingHandle::Linear, alloc)};
+}
+
+TEST(SpecializedSpectrumTexture, MatchesTextureEvaluation) {
+    std::string filename = "specialized_texture_test.pfm";
+    std::vector<SpectrumTextureHandle> textures =
+        SpecializationTextures(filename, Allocator());
+
+    // Specialized evaluation should give exactly the same values as dispatch
+    RNG rng;
+    for (SpectrumTextureHandle tex : textures) {
+        SpecializedSpectrumTexture specialized(tex);
+        EXPECT_EQ(tex, SpectrumTextureHandle(specialized));
+        for (int i = 0; i < 1000; ++i) {
+            SampledWavelengths lambda =
+                SampledWavelengths::SampleUniform(rng.Uniform<Float>());
+            TextureEvalContext ctx;
+            ctx.uv = Point2f(rng.Uniform<Float>(), rng.Uniform<Float>());
+            SampledSpectrum s = tex.Evaluate(ctx, lambda);
+            SampledSpectrum ss =
+                specialized.Evaluate(UniversalTextureEvaluator(), ctx, lambda);
+            for (int j = 0; j < NSpectrumSamples; ++j)
+                EXPECT_EQ(s[j], ss[j]) << tex.ToString() << " lambda " << lambda[j];
+        }
+    }
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
+
+TEST(SpecializedSpectrumTexture, DISABLED_Timing) {
+    std::string filename = "specialized_texture_timing.pfm";
+    std::vector<SpectrumTextureHandle> textures =
+        SpecializationTextures(filename, Allocator());
+    RNG rng;
+    std::vector<SampledWavelengths> lambdas;
+    std::vector<TextureEvalContext> contexts(1024);
+    for (TextureEvalContext &ctx : contexts) {
+        lambdas.push_back(SampledWavelengths::SampleUniform(rng.Uniform<Float>()));
+        ctx.uv = Point2f(rng.Uniform<Float>(), rng.Uniform<Float>());
+    }
+
+    // Report evaluation times through the texture evaluator and specialized
+    int nEvals = 1000000;
+    for (SpectrumTextureHandle tex : textures) {
+        SpecializedSpectrumTexture specialized(tex);
+        double seconds[2];
+        Float sum[2] = {0, 0};
+        for (int special = 0; special < 2; ++special) {
+            Timer timer;
+            for (int i = 0; i < nEvals; ++i) {
+                const TextureEvalContext &ctx = contexts[i % contexts.size()];
+                const SampledWavelengths &lambda = lambdas[i % lambdas.size()];
+                UniversalTextureEvaluator texEval;
+                SampledSpectrum s = special ? specialized.Evaluate(texEval, ctx, lambda)
+                                            : texEval(tex, ctx, lambda);
+                sum[special] += s.Average();
+            }
+            seconds[special] = timer.ElapsedSeconds();
+        }
+        EXPECT_EQ(sum[0], sum[1]);
+        std::string name = tex.ToString();
+        fprintf(stderr, "%s: evaluator %.1f ns, specialized %.1f ns\n",
+                name.substr(2, name.find(' ', 2) - 2).c_str(), 1e9 * seconds[0] / nEvals,
+                1e9 * seconds[1] / nEvals);
+    }
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
+
+TEST(SpecializedSpectrumTexture, DISABLED_MaterialTiming) {
+    std::string filename = "specialized_material_timing.pfm";
+    std::vector<SpectrumTextureHandle> textures =
+        SpecializationTextures(filename, Allocator());
+    RNG rng;
+    std::vector<SampledWavelengths> lambdas;
+    std::vector<MaterialEvalContext> contexts(1024);
+    for (MaterialEvalContext &ctx : contexts) {
+        lambdas.push_back(SampledWavelengths::SampleUniform(rng.Uniform<Float>()));
+        ctx.uv = Point2f(rng.Uniform<Float>(), rng.Uniform<Float>());
+        ctx.wo = Normalize(
+            Vector3f(-1 + 2 * rng.Uniform<Float>(), -1 + 2 * rng.Uniform<Float>(), 1));
+        ctx.n = ctx.ns = Normal3f(0, 0, 1);
+        ctx.dpdus = Vector3f(1, 0, 0);
+    }
+    Vector3f wi = Normalize(Vector3f(.3f, -.2f, 1));
+    FloatConstantTexture roughness(.3f);
+    Float alpha = TrowbridgeReitzDistribution::RoughnessToAlpha(.3f);
+    TrowbridgeReitzDistribution distrib(alpha, alpha);
+    ScratchBuffer scratchBuffer(1024);
+
+    // Report times to get and evaluate BSDFs through the materials, which use
+    // _SpecializedSpectrumTexture_, and with texture evaluator calls instead
+    int nEvals = 200000;
+    for (SpectrumTextureHandle tex : textures) {
+        DiffuseMaterial diffuse(tex, nullptr, nullptr);
+        ConductorMaterial conductor(tex, tex, &roughness, &roughness, nullptr, true);
+        for (MaterialHandle material :
+             {MaterialHandle(&diffuse), MaterialHandle(&conductor)}) {
+            // Interleave rounds and keep the fastest of each to reduce noise
+            double seconds[2] = {Infinity, Infinity};
+            Float sum[2] = {0, 0};
+            for (int round = 0; round < 5; ++round)
+                for (int special = 0; special < 2; ++special) {
+                    Timer timer;
+                    sum[special] = 0;
+                    for (int i = 0; i < nEvals; ++i) {
+                        const MaterialEvalContext &ctx = contexts[i % contexts.size()];
+                        SampledWavelengths lambda = lambdas[i % lambdas.size()];
+                        UniversalTextureEvaluator texEval;
+                        BSDF bsdf;
+                        if (special)
+                            bsdf = material.GetBSDF(texEval, ctx, lambda, scratchBuffer);
+                        else if (material.Is<DiffuseMaterial>()) {
+                            SampledSpectrum r = Clamp(texEval(tex, ctx, lambda), 0, 1);
+                            bsdf = BSDF(ctx.wo, ctx.n, ctx.ns, ctx.dpdus,
+                                        scratchBuffer.Alloc<IdealDiffuseBxDF>(r));
+                        } else {
+                            SampledSpectrum eta = texEval(tex, ctx, lambda);
+                            SampledSpectrum k = texEval(tex, ctx, lambda);
+                            ConductorBxDF *bxdf =
+                                scratchBuffer.Alloc<ConductorBxDF>(distrib, eta, k);
+                            bsdf = BSDF(ctx.wo, ctx.n, ctx.ns, ctx.dpdus, bxdf);
+                        }
+                        sum[special] += bsdf.f(ctx.wo, wi).Average();
+                        scratchBuffer.Reset();
+                    }
+                    seconds[special] = std::min(seconds[special], timer.ElapsedSeconds());
+                }
+            EXPECT_EQ(sum[0], sum[1]);
+            std::string name = tex.ToString();
+            fprintf(stderr, "%s, %s: evaluator %.1f ns, specialized %.1f ns\n",
+                    material.Is<DiffuseMaterial>() ? "diffuse" : "conductor",
+                    name.substr(2, name.find(' ', 2) - 2).c_str(),
+                    1e9 * seconds[0] / nEvals, 1e9 * seconds[1] / nEvals);
+        }
+    }
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
+
+TEST(ConductorMaterial, ConstantRoughness) {
+    for (Float roughness : {0.f, .05f, .3f}) {
+        for (bool remap : {false, true}) {
+            // The precomputed distribution should match evaluating roughness
+            // textures at each lookup
+            FloatConstantTexture rough(roughness), one(1.f);
+            FloatScaledTexture scaledRough(&rough, &one);
+            SpectrumConstantTexture eta(GetNamedSpectrum("metal-Au-eta"));
+            SpectrumConstantTexture k(GetNamedSpectrum("metal-Au-k"));
+            ConductorMaterial constant(&eta, &k, &rough, &rough, nullptr, remap);
+            ConductorMaterial varying(&eta, &k, &scaledRough, &scaledRough, nullptr,
+                                      remap);
+
+            RNG rng;
+            for (int i = 0; i < 100; ++i) {
+                MaterialEvalContext ctx;
+                ctx.n = ctx.ns = Normal3f(0, 0, 1);
+                ctx.dpdus = Vector3f(1, 0, 0);
+                ctx.wo = SampleUniformHemisphere({rng.Uniform<Float>(),
+                                                  rng.Uniform<Float>()});
+                Vector3f wi =
+                    SampleUniformHemisphere({rng.Uniform<Float>(), rng.Uniform<Float>()});
+                SampledWavelengths lambda =
+                    SampledWavelengths::SampleUniform(rng.Uniform<Float>());
+                ConductorBxDF constantBxDF, varyingBxDF;
+                BSDF bsdf = constant.GetBSDF(UniversalTextureEvaluator(), ctx, lambda,
+                                             &constantBxDF);
+                BSDF varyingBSDF = varying.GetBSDF(UniversalTextureEvaluator(), ctx,
+                                                   lambda, &varyingBxDF);
+                SampledSpectrum f = bsdf.f(ctx.wo, wi);
+                SampledSpectrum fVarying = varyingBSDF.f(ctx.wo, wi);
+                for (int j = 0; j < NSpectrumSamples; ++j)
+                    EXPECT_EQ(fVarying[j], f[j]);
+            }
+        }
+    }
+}
+
+// Computes FBm() and Turbulence() one octave at a time with scalar Noise()
+static void PerOctaveFBmTurbulence(const Point3f &p, const Vector3f &dpdx,
+                                   const Vector3f &dpdy, Float omega, int maxOctaves,
+                                   Float *fbm, Float *turb) {
+    Float len2 = std::max(LengthSquared(dpdx), LengthSquared(dpdy));
+    Float nOctaves = Clamp(-1 - .5f * Log2(len2), 0, maxOctaves);
+    int nInt = std::floor(nOctaves);
+    Float lambda = 1, o = 1;
+    *fbm = *turb = 0;
+    for (int j = 0; j < nInt; ++j) {
+        Float n = Noise(lambda * p);
+        *fbm += o * n;
+        *turb += o * std::abs(n);
+        lambda *= 1.99f;
+        o *= omega;
+    }
+    Float w = SmoothStep(nOctaves - nInt, .3f, .7f);
+    *fbm += o * w * Noise(lambda * p);
+    *turb += o * Lerp(w, 0.2, std::abs(Noise(lambda * p)));
+    for (int j = nInt; j < maxOctaves; ++j) {
+        *turb += o * 0.2f;
+        o *= omega;
+    }
+}
+
+TEST(Noise, FBmTurbulenceOctaves) {
+    RNG rng;
+    for (int i = 0; i < 1000; ++i) {
+        Point3f p(-10 + 20 * rng.Uniform<Float>(), -10 + 20 * rng.Uniform<Float>(),
+                  -10 + 20 * rng.Uniform<Float>());
+        // Include points on noise cell boundaries
+        if (i == 0)
+            p = Point3f(0, 0, 0);
+        else if (i == 1)
+            p = Point3f(-1, 255, 256);
+        Vector3f dpdx(std::pow(2.f, -14 * rng.Uniform<Float>()), 0, 0);
+        Vector3f dpdy(0, 1e-3f, 0);
+        Float omega = .25f + .5f * rng.Uniform<Float>();
+        int maxOctaves = 1 + rng.Uniform<uint32_t>() % 12;
+
+        Float fbm, turb;
+        PerOctaveFBmTurbulence(p, dpdx, dpdy, omega, maxOctaves, &fbm, &turb);
+        EXPECT_FLOAT_EQ(fbm, FBm(p, dpdx, dpdy, omega, maxOctaves));
+        EXPECT_FLOAT_EQ(turb, Turbulence(p, dpdx, dpdy, omega, maxOctaves));
+    }
+}
+
+TEST(Noise, DISABLED_FBmTiming) {
+    RNG rng;
+    std::vector<Point3f> points(100000);
+    for (Point3f &p : points)
+        p = Point3f(-10 + 20 * rng.Uniform<Float>(), -10 + 20 * rng.Uniform<Float>(),
+                    -10 + 20 * rng.Uniform<Float>());
+    // Small differentials, so that all eight octaves are evaluated
+    Vector3f dpdx(1e-4f, 0, 0), dpdy(0, 1e-4f, 0);
+    const int octaves = 8;
+
+    // Report per-octave and batched times for eight-octave FBm and turbulence
+    Float sum[2] = {0, 0};
+    double seconds[2];
+    for (int batched = 0; batched < 2; ++batched) {
+        Timer timer;
+        for (const Point3f &p : points) {
+            Float fbm, turb;
+            if (batched) {
+                fbm = FBm(p, dpdx, dpdy, .5f, octaves);
+                turb = Turbulence(p, dpdx, dpdy, .5f, octaves);
+            } else
+                PerOctaveFBmTurbulence(p, dpdx, dpdy, .5f, octaves, &fbm, &turb);
+            sum[batched] += fbm + turb;
+        }
+        seconds[batched] = timer.ElapsedSeconds();
+    }
+    EXPECT_NEAR(sum[0], sum[1], 1e-3f * std::abs(sum[0]));
+    fprintf(stderr, "FBm + Turbulence: per-octave %.1f ns, batched %.1f ns\n",
+            1e9 * seconds[0] / points.size(), 1e9 * seconds[1] / points.size());
+}
+
+TEST(SpectrumImageTexture, PrecomputedCoefficients) {
+    // Write an image with some values outside the reflectance range
+    Point2i res(16, 8);
+    Image image(PixelFormat::Float, res, {"R", "G", "B"});
+    RNG rng;
+    for (int y = 0; y < res.y; ++y)
+        for (int x = 0; x < res.x; ++x)
+            for (int c = 0; c < 3; ++c)
+                image.SetChannel({x, y}, c, 1.5f * rng.Uniform<Float>());
+    std::string filename = "precomputed_coefficients_test.pfm";
+    ASSERT_TRUE(image.Write(filename));
+
+    // Precomputed texel spectra should match converting point-filtered RGB
+    Allocator alloc;
+    UVMapping2D mapping;
+    for (WrapMode wrap : {WrapMode::Repeat, WrapMode::Black}) {
+        SpectrumImageTexture tex(&mapping, filename, "point", 8.f, wrap, 0.75f,
+                                 ColorEncodingHandle::Linear, alloc);
+        SpectrumImageTexture precomputed(&mapping, filename, "point", 8.f, wrap, 0.75f,
+                                         ColorEncodingHandle::Linear, alloc, true);
+        for (int i = 0; i < 1000; ++i) {
+            TextureEvalContext ctx;
+            ctx.uv = Point2f(-0.5f + 2 * rng.Uniform<Float>(),
+                             -0.5f + 2 * rng.Uniform<Float>());
+            ctx.dudx = ctx.dvdy = std::pow(2.f, -8 * rng.Uniform<Float>());
+            SampledWavelengths lambda =
+                SampledWavelengths::SampleUniform(rng.Uniform<Float>());
+            SampledSpectrum s = tex.Evaluate(ctx, lambda);
+            SampledSpectrum sp = precomputed.Evaluate(ctx, lambda);
+            for (int j = 0; j < NSpectrumSamples; ++j)
+                EXPECT_EQ(s[j], sp[j]) << ctx.uv;
+        }
+
+        // Texel spectra should be shared by textures with the same MIP map and
+        // scale
+        struct TexelSpectraCache : public ImageTextureBase {
+            using ImageTextureBase::GetTexelSpectra;
+        };
+        const TexelSpectra *ts =
+            TexelSpectraCache::GetTexelSpectra(precomputed.mipmap, 0.75f, alloc);
+        EXPECT_EQ(ts, TexelSpectraCache::GetTexelSpectra(tex.mipmap, 0.75f, alloc));
+        EXPECT_NE(ts, TexelSpectraCache::GetTexelSpectra(tex.mipmap, 0.5f, alloc));
+    }
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
@@ -19,6 +19,7 @@
 #include <string>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 namespace pbrt {
 
@@ -798,6 +799,187 @@ class SampledGrid {
     int nx, ny, nz;
 };
 
+// SparseGrid Definition
+// Sparse voxel grid organized like the upper levels of a VDB tree: a dense root
+// table over blocks of 128^3 voxels indexes interior nodes that hold the indices
+// of 8^3 voxel leaves. Voxels that are not stored have the value _T{}_.
+template <typename T>
+class SparseGrid {
+  public:
+    // SparseGrid Public Methods
+    SparseGrid() = default;
+    SparseGrid(Allocator alloc)
+        : rootNodes(alloc), nodeLeaves(alloc), leafOrigins(alloc), leafValues(alloc) {}
+    SparseGrid(pstd::span<const Point3i> voxels, pstd::span<const T> values, int nx,
+               int ny, int nz, Allocator alloc)
+        : SparseGrid(alloc) {
+        CHECK_EQ(voxels.size(), values.size());
+        this->nx = nx;
+        this->ny = ny;
+        this->nz = nz;
+        int nodeVoxels = NodeRes * LeafRes;
+        rootRes = Point3i((nx + nodeVoxels - 1) / nodeVoxels,
+                          (ny + nodeVoxels - 1) / nodeVoxels,
+                          (nz + nodeVoxels - 1) / nodeVoxels);
+
+        // Build the tree's index tables, allocating nodes and leaves on demand
+        std::vector<int> root(rootRes.x * rootRes.y * rootRes.z, -1), nodes;
+        std::vector<Point3i> origins;
+        Bounds3i sampleBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
+        for (Point3i p : voxels) {
+            CHECK(InsideExclusive(p, sampleBounds));
+            findLeaf(p, root, nodes, origins, true);
+        }
+        setIndex(root, nodes, origins);
+
+        // Store the voxel values in place in the leaves
+        leafValues = pstd::vector<T>(leafOrigins.size() * LeafSize, alloc);
+        for (size_t i = 0; i < voxels.size(); ++i) {
+            Point3i p = voxels[i];
+            int leaf = findLeaf(p, root, nodes, origins, false);
+            leafValues[leaf * LeafSize + leafOffset(p)] = values[i];
+        }
+    }
+    // Takes ownership of the $8^3$ values of each leaf, stored in the order of
+    // the leaves' _origins_ with $x$ varying fastest; leaves must be distinct
+    SparseGrid(int nx, int ny, int nz, pstd::span<const Point3i> origins,
+               pstd::vector<T> values, Allocator alloc)
+        : SparseGrid(alloc) {
+        CHECK_EQ(origins.size() * LeafSize, values.size());
+        this->nx = nx;
+        this->ny = ny;
+        this->nz = nz;
+        int nodeVoxels = NodeRes * LeafRes;
+        rootRes = Point3i((nx + nodeVoxels - 1) / nodeVoxels,
+                          (ny + nodeVoxels - 1) / nodeVoxels,
+                          (nz + nodeVoxels - 1) / nodeVoxels);
+
+        // Index the given leaves in order, keeping their values where they are
+        std::vector<int> root(rootRes.x * rootRes.y * rootRes.z, -1), nodes;
+        std::vector<Point3i> leaves;
+        Bounds3i sampleBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
+        for (Point3i p : origins) {
+            CHECK(InsideExclusive(p, sampleBounds));
+            CHECK_EQ(0, (p.x | p.y | p.z) & (LeafRes - 1));
+            int nLeaves = leaves.size();
+            CHECK_EQ(nLeaves, findLeaf(p, root, nodes, leaves, true));
+        }
+        setIndex(root, nodes, leaves);
+        leafValues = std::move(values);
+    }
+
+    size_t BytesAllocated() const {
+        return (rootNodes.size() + nodeLeaves.size()) * sizeof(int) +
+               leafOrigins.size() * sizeof(Point3i) + leafValues.size() * sizeof(T);
+    }
+
+    int xSize() const { return nx; }
+    int ySize() const { return ny; }
+    int zSize() const { return nz; }
+    size_t NumLeaves() const { return leafOrigins.size(); }
+
+    PBRT_CPU_GPU
+    T Lookup(const Point3f &p) const {
+        // Compute voxel coordinates and offsets for _p_
+        Point3f pSamples(p.x * nx - .5f, p.y * ny - .5f, p.z * nz - .5f);
+        Point3i pi = (Point3i)Floor(pSamples);
+        Vector3f d = pSamples - (Point3f)pi;
+
+        // Trilinearly interpolate voxel values
+        T d00 = Lerp(d.x, Lookup(pi), Lookup(pi + Vector3i(1, 0, 0)));
+        T d10 = Lerp(d.x, Lookup(pi + Vector3i(0, 1, 0)), Lookup(pi + Vector3i(1, 1, 0)));
+        T d01 = Lerp(d.x, Lookup(pi + Vector3i(0, 0, 1)), Lookup(pi + Vector3i(1, 0, 1)));
+        T d11 = Lerp(d.x, Lookup(pi + Vector3i(0, 1, 1)), Lookup(pi + Vector3i(1, 1, 1)));
+        T d0 = Lerp(d.y, d00, d10);
+        T d1 = Lerp(d.y, d01, d11);
+        return Lerp(d.z, d0, d1);
+    }
+
+    PBRT_CPU_GPU
+    T Lookup(const Point3i &p) const {
+        Bounds3i sampleBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
+        if (!InsideExclusive(p, sampleBounds))
+            return {};
+        int node = rootNodes[rootOffset(p)];
+        if (node == -1)
+            return {};
+        int leaf = nodeLeaves[node * NodeSize + nodeOffset(p)];
+        if (leaf == -1)
+            return {};
+        return leafValues[leaf * LeafSize + leafOffset(p)];
+    }
+
+    // Calls _func_ with the origin and the $8^3$ values of each leaf; values are
+    // ordered with $x$ varying fastest
+    template <typename F>
+    void ForEachLeaf(F func) const {
+        for (size_t i = 0; i < leafOrigins.size(); ++i) {
+            const T *values = &leafValues[i * LeafSize];
+            func(leafOrigins[i], pstd::span<const T>(values, LeafSize));
+        }
+    }
+
+    std::string ToString() const {
+        return StringPrintf("[ SparseGrid nx: %d ny: %d nz: %d leaves: %d ]", nx, ny, nz,
+                            leafOrigins.size());
+    }
+
+    static constexpr int LeafRes = 8, LeafSize = LeafRes * LeafRes * LeafRes;
+
+  private:
+    // SparseGrid Private Methods
+    // Returns the index of the leaf that holds _p_ in the given tables; missing
+    // leaves and their interior nodes are added if _allocate_ is true
+    int findLeaf(const Point3i &p, std::vector<int> &root, std::vector<int> &nodes,
+                 std::vector<Point3i> &origins, bool allocate) const {
+        int &node = root[rootOffset(p)];
+        if (node == -1) {
+            CHECK(allocate);
+            node = nodes.size() / NodeSize;
+            nodes.resize(nodes.size() + NodeSize, -1);
+        }
+        int &leaf = nodes[node * NodeSize + nodeOffset(p)];
+        if (leaf == -1) {
+            CHECK(allocate);
+            leaf = origins.size();
+            origins.push_back(Point3i(p.x & ~(LeafRes - 1), p.y & ~(LeafRes - 1),
+                                      p.z & ~(LeafRes - 1)));
+        }
+        return leaf;
+    }
+    void setIndex(const std::vector<int> &root, const std::vector<int> &nodes,
+                  const std::vector<Point3i> &origins) {
+        Allocator alloc = rootNodes.get_allocator();
+        rootNodes = pstd::vector<int>(root.begin(), root.end(), alloc);
+        nodeLeaves = pstd::vector<int>(nodes.begin(), nodes.end(), alloc);
+        leafOrigins = pstd::vector<Point3i>(origins.begin(), origins.end(), alloc);
+    }
+
+    PBRT_CPU_GPU
+    int rootOffset(const Point3i &p) const {
+        int nodeVoxels = NodeRes * LeafRes;
+        return (p.z / nodeVoxels * rootRes.y + p.y / nodeVoxels) * rootRes.x +
+               p.x / nodeVoxels;
+    }
+    PBRT_CPU_GPU
+    static int nodeOffset(const Point3i &p) {
+        return ((p.z / LeafRes % NodeRes) * NodeRes + p.y / LeafRes % NodeRes) * NodeRes +
+               p.x / LeafRes % NodeRes;
+    }
+    PBRT_CPU_GPU
+    static int leafOffset(const Point3i &p) {
+        return ((p.z % LeafRes) * LeafRes + p.y % LeafRes) * LeafRes + p.x % LeafRes;
+    }
+
+    // SparseGrid Private Members
+    static constexpr int NodeRes = 16, NodeSize = NodeRes * NodeRes * NodeRes;
+    pstd::vector<int> rootNodes, nodeLeaves;
+    pstd::vector<Point3i> leafOrigins;
+    pstd::vector<T> leafValues;
+    Point3i rootRes;
+    int nx = 0, ny = 0, nz = 0;
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_UTIL_CONTAINERS_H
@@ -107,3 +107,48 @@ TEST(HashMap, Randoms) {
     EXPECT_EQ(nVisited, 10000);
     EXPECT_EQ(0, values.size());
 }
+
+TEST(SparseGrid, MatchesSampledGrid) {
+    // Fill a few scattered clusters of voxels in a grid spanning several root nodes
+    int nx = 300, ny = 20, nz = 140;
+    std::vector<Float> dense(nx * ny * nz, Float(0));
+    std::vector<Point3i> voxels;
+    std::vector<Float> values;
+    RNG rng;
+    for (int i = 0; i < 2000; ++i) {
+        Point3i p(rng.Uniform<uint32_t>() % 20, rng.Uniform<uint32_t>() % ny,
+                  rng.Uniform<uint32_t>() % 20);
+        if (i & 1)
+            p += Vector3i(250, 0, 120);
+        Float v = 1 + rng.Uniform<Float>();
+        if (dense[(p.z * ny + p.y) * nx + p.x] == 0) {
+            voxels.push_back(p);
+            values.push_back(v);
+            dense[(p.z * ny + p.y) * nx + p.x] = v;
+        }
+    }
+
+    Allocator alloc;
+    SampledGrid<Float> sampledGrid(dense, nx, ny, nz, alloc);
+    SparseGrid<Float> sparseGrid(voxels, values, nx, ny, nz, alloc);
+    EXPECT_LT(sparseGrid.BytesAllocated(), sampledGrid.BytesAllocated() / 10);
+
+    for (int z = 0; z < nz; ++z)
+        for (int y = 0; y < ny; ++y)
+            for (int x = 0; x < nx; ++x) {
+                Point3i p(x, y, z);
+                ASSERT_EQ(sampledGrid.Lookup(p), sparseGrid.Lookup(p));
+            }
+    for (int i = 0; i < 10000; ++i) {
+        Point3f p(rng.Uniform<Float>(), rng.Uniform<Float>(), rng.Uniform<Float>());
+        EXPECT_EQ(sampledGrid.Lookup(p), sparseGrid.Lookup(p));
+    }
+
+    // Every stored voxel belongs to exactly one leaf
+    int nStored = 0;
+    sparseGrid.ForEachLeaf([&](Point3i origin, pstd::span<const Float> leafValues) {
+        for (Float v : leafValues)
+            nStored += v > 0;
+    });
+    EXPECT_EQ(int(voxels.size()), nStored);
+}
@@ -27,10 +27,15 @@
 #include <ImfMatrixAttribute.h>
 #include <ImfOutputFile.h>
 #include <ImfStringVectorAttribute.h>
+#include <ImfTileDescription.h>
+#include <ImfTiledInputFile.h>
+#include <ImfTiledOutputFile.h>
 #endif
 
 #include <cmath>
+#include <cstdio>
 #include <numeric>
+#include <random>
 
 // use lodepng and get 16-bit.
 #define STBI_NO_PNG
@@ -1150,80 +1155,82 @@ static ImageAndMetadata ReadEXR(const std::string &name, Allocator alloc) {
     return {};
 }
 
+static Imf::Header makeEXRHeader(const ImageMetadata &metadata, Point2i resolution) {
+    Imath::Box2i displayWindow, dataWindow;
+    if (metadata.fullResolution)
+        // Agan, -1 offsets to handle inclusive indexing in OpenEXR...
+        displayWindow = {Imath::V2i(0, 0), Imath::V2i(metadata.fullResolution->x - 1,
+                                                      metadata.fullResolution->y - 1)};
+    else
+        displayWindow = {Imath::V2i(0, 0),
+                         Imath::V2i(resolution.x - 1, resolution.y - 1)};
+
+    if (metadata.pixelBounds)
+        dataWindow = {
+            Imath::V2i(metadata.pixelBounds->pMin.x, metadata.pixelBounds->pMin.y),
+            Imath::V2i(metadata.pixelBounds->pMax.x - 1, metadata.pixelBounds->pMax.y - 1)};
+    else
+        dataWindow = {Imath::V2i(0, 0), Imath::V2i(resolution.x - 1, resolution.y - 1)};
+
+    Imf::Header header(displayWindow, dataWindow);
+
+    if (metadata.renderTimeSeconds)
+        header.insert("renderTimeSeconds",
+                      Imf::FloatAttribute(*metadata.renderTimeSeconds));
+    if (metadata.cameraFromWorld) {
+        float m[4][4];
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                m[i][j] = (*metadata.cameraFromWorld)[i][j];
+        header.insert("worldToCamera", Imf::M44fAttribute(m));
+    }
+    if (metadata.NDCFromWorld) {
+        float m[4][4];
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                m[i][j] = (*metadata.NDCFromWorld)[i][j];
+        header.insert("worldToNDC", Imf::M44fAttribute(m));
+    }
+    if (metadata.samplesPerPixel)
+        header.insert("samplesPerPixel", Imf::IntAttribute(*metadata.samplesPerPixel));
+    if (metadata.estimatedVariance)
+        header.insert("estimatedVariance",
+                      Imf::FloatAttribute(*metadata.estimatedVariance));
+    if (metadata.MSE)
+        header.insert("MSE", Imf::FloatAttribute(*metadata.MSE));
+    for (const auto &iter : metadata.stringVectors)
+        header.insert(iter.first, Imf::StringVectorAttribute(iter.second));
+
+    // The OpenEXR spec says that the default is sRGB if no
+    // chromaticities are provided.  It should be innocuous to write
+    // the sRGB primaries anyway, but for completely indecipherable
+    // reasons, OSX's Preview.app decides to gamma correct the pixels
+    // in EXR files if it finds primaries.  So, we don't write them in
+    // that case in the interests of nicer looking images on the
+    // screen.
+    if (*metadata.GetColorSpace() != *RGBColorSpace::sRGB) {
+        const RGBColorSpace &cs = *metadata.GetColorSpace();
+        Imf::Chromaticities chromaticities(
+            Imath::V2f(cs.r.x, cs.r.y), Imath::V2f(cs.g.x, cs.g.y),
+            Imath::V2f(cs.b.x, cs.b.y), Imath::V2f(cs.w.x, cs.w.y));
+        header.insert("chromaticities", Imf::ChromaticitiesAttribute(chromaticities));
+    }
+
+    return header;
+}
+
 bool Image::WriteEXR(const std::string &name, const ImageMetadata &metadata) const {
     if (Is8Bit(format))
         return ConvertToFormat(PixelFormat::Half).WriteEXR(name, metadata);
     CHECK(Is16Bit(format) || Is32Bit(format));
 
     try {
-        Imath::Box2i displayWindow, dataWindow;
-        if (metadata.fullResolution)
-            // Agan, -1 offsets to handle inclusive indexing in OpenEXR...
-            displayWindow = {Imath::V2i(0, 0),
-                             Imath::V2i(metadata.fullResolution->x - 1,
-                                        metadata.fullResolution->y - 1)};
-        else
-            displayWindow = {Imath::V2i(0, 0),
-                             Imath::V2i(resolution.x - 1, resolution.y - 1)};
-
-        if (metadata.pixelBounds)
-            dataWindow = {
-                Imath::V2i(metadata.pixelBounds->pMin.x, metadata.pixelBounds->pMin.y),
-                Imath::V2i(metadata.pixelBounds->pMax.x - 1,
-                           metadata.pixelBounds->pMax.y - 1)};
-        else
-            dataWindow = {Imath::V2i(0, 0),
-                          Imath::V2i(resolution.x - 1, resolution.y - 1)};
-
-        Imf::FrameBuffer fb = imageToFrameBuffer(*this, AllChannelsDesc(), dataWindow);
-
-        Imf::Header header(displayWindow, dataWindow);
+        Imf::Header header = makeEXRHeader(metadata, resolution);
+        Imf::FrameBuffer fb =
+            imageToFrameBuffer(*this, AllChannelsDesc(), header.dataWindow());
         for (auto iter = fb.begin(); iter != fb.end(); ++iter)
             header.channels().insert(iter.name(), iter.slice().type);
 
-        if (metadata.renderTimeSeconds)
-            header.insert("renderTimeSeconds",
-                          Imf::FloatAttribute(*metadata.renderTimeSeconds));
-        if (metadata.cameraFromWorld) {
-            float m[4][4];
-            for (int i = 0; i < 4; ++i)
-                for (int j = 0; j < 4; ++j)
-                    m[i][j] = (*metadata.cameraFromWorld)[i][j];
-            header.insert("worldToCamera", Imf::M44fAttribute(m));
-        }
-        if (metadata.NDCFromWorld) {
-            float m[4][4];
-            for (int i = 0; i < 4; ++i)
-                for (int j = 0; j < 4; ++j)
-                    m[i][j] = (*metadata.NDCFromWorld)[i][j];
-            header.insert("worldToNDC", Imf::M44fAttribute(m));
-        }
-        if (metadata.samplesPerPixel)
-            header.insert("samplesPerPixel",
-                          Imf::IntAttribute(*metadata.samplesPerPixel));
-        if (metadata.estimatedVariance)
-            header.insert("estimatedVariance",
-                          Imf::FloatAttribute(*metadata.estimatedVariance));
-        if (metadata.MSE)
-            header.insert("MSE", Imf::FloatAttribute(*metadata.MSE));
-        for (const auto &iter : metadata.stringVectors)
-            header.insert(iter.first, Imf::StringVectorAttribute(iter.second));
-
-        // The OpenEXR spec says that the default is sRGB if no
-        // chromaticities are provided.  It should be innocuous to write
-        // the sRGB primaries anyway, but for completely indecipherable
-        // reasons, OSX's Preview.app decides to gamma correct the pixels
-        // in EXR files if it finds primaries.  So, we don't write them in
-        // that case in the interests of nicer looking images on the
-        // screen.
-        if (*metadata.GetColorSpace() != *RGBColorSpace::sRGB) {
-            const RGBColorSpace &cs = *metadata.GetColorSpace();
-            Imf::Chromaticities chromaticities(
-                Imath::V2f(cs.r.x, cs.r.y), Imath::V2f(cs.g.x, cs.g.y),
-                Imath::V2f(cs.b.x, cs.b.y), Imath::V2f(cs.w.x, cs.w.y));
-            header.insert("chromaticities", Imf::ChromaticitiesAttribute(chromaticities));
-        }
-
         Imf::OutputFile file(name.c_str(), header);
         file.setFrameBuffer(fb);
         file.writePixels(resolution.y);
@@ -1235,6 +1242,106 @@ bool Image::WriteEXR(const std::string &name, const ImageMetadata &metadata) con
     return true;
 }
 
+// TiledEXRFile Definition
+struct TiledEXRFile {
+    TiledEXRFile(const std::string &name, const Imf::Header &header)
+        : file(name.c_str(), header) {}
+    Imf::TiledOutputFile file;
+};
+
+// TiledImageWriter Method Definitions
+TiledImageWriter::TiledImageWriter(const std::string &name,
+                                   const ImageMetadata &metadata,
+                                   pstd::span<const std::string> channelNames,
+                                   PixelFormat format, int tileSize)
+    : filename(name),
+      tempFilename(name + StringPrintf(".%u.tmp", uint32_t(std::random_device()()))),
+      tileSize(tileSize) {
+    CHECK(metadata.pixelBounds.has_value());
+    CHECK_GT(tileSize, 0);
+    pixelBounds = *metadata.pixelBounds;
+    if (!HasExtension(name, "exr"))
+        ErrorExit("%s: only EXR files can be written tile by tile.", name);
+    if (Is8Bit(format))
+        ErrorExit("%s: 8-bit images can't be written tile by tile.", name);
+
+    try {
+        Imf::Header header = makeEXRHeader(metadata, Point2i(pixelBounds.Diagonal()));
+        Imf::PixelType pixelType = Is16Bit(format) ? Imf::HALF : Imf::FLOAT;
+        for (const std::string &channel : channelNames)
+            header.channels().insert(channel, Imf::Channel(pixelType));
+        header.setTileDescription(Imf::TileDescription(tileSize, tileSize, Imf::ONE_LEVEL));
+        // Tiles are finished in whatever order the threads get to them.
+        header.lineOrder() = Imf::RANDOM_Y;
+
+        file = std::make_unique<TiledEXRFile>(tempFilename, header);
+    } catch (const std::exception &exc) {
+        ErrorExit("%s: error opening EXR for writing: %s", tempFilename, exc.what());
+    }
+    LOG_VERBOSE("Opened tiled EXR %s with bounds %s, tile size %d", name, pixelBounds,
+                tileSize);
+}
+
+TiledImageWriter::~TiledImageWriter() {
+    if (file) {
+        // Discard the tiles of a file that was never finished
+        file.reset();
+        std::remove(tempFilename.c_str());
+    }
+}
+
+void TiledImageWriter::Close(pstd::optional<Float> estimatedVariance) {
+    CHECK(file);
+    // Destroying the _Imf::TiledOutputFile_ flushes and closes the file.
+    file.reset();
+
+    if (!estimatedVariance) {
+        if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+            ErrorExit("%s: %s", filename, ErrorString());
+    } else {
+        // OpenEXR writes the header when the file is opened, so copy the
+        // compressed tiles to a new file whose header includes the variance
+        try {
+            Imf::TiledInputFile in(tempFilename.c_str());
+            Imf::Header header = in.header();
+            header.insert("estimatedVariance", Imf::FloatAttribute(*estimatedVariance));
+            Imf::TiledOutputFile out(filename.c_str(), header);
+            out.copyPixels(in);
+        } catch (const std::exception &exc) {
+            std::remove(tempFilename.c_str());
+            ErrorExit("%s: error writing EXR: %s", filename, exc.what());
+        }
+        std::remove(tempFilename.c_str());
+    }
+    LOG_VERBOSE("Closed tiled EXR %s", filename);
+}
+
+void TiledImageWriter::WriteTile(const Image &image, const Bounds2i &tileBounds) {
+    if (Is8Bit(image.Format())) {
+        WriteTile(image.ConvertToFormat(PixelFormat::Half), tileBounds);
+        return;
+    }
+    CHECK_EQ(image.Resolution(), Point2i(tileBounds.Diagonal()));
+    Vector2i tileOffset = tileBounds.pMin - pixelBounds.pMin;
+    CHECK(tileOffset.x % tileSize == 0 && tileOffset.y % tileSize == 0);
+
+    Imath::Box2i tileWindow(Imath::V2i(tileBounds.pMin.x, tileBounds.pMin.y),
+                            Imath::V2i(tileBounds.pMax.x - 1, tileBounds.pMax.y - 1));
+    Imf::FrameBuffer fb = imageToFrameBuffer(image, image.AllChannelsDesc(), tileWindow);
+    std::lock_guard<std::mutex> lock(mutex);
+    try {
+        file->file.setFrameBuffer(fb);
+        file->file.writeTile(tileOffset.x / tileSize, tileOffset.y / tileSize);
+    } catch (const std::exception &exc) {
+        ErrorExit("%s: error writing EXR tile %s: %s", filename, tileBounds, exc.what());
+    }
+}
+
+std::string TiledImageWriter::ToString() const {
+    return StringPrintf("[ TiledImageWriter filename: %s pixelBounds: %s tileSize: %d ]",
+                        filename, pixelBounds, tileSize);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // PNG Function Definitions
 
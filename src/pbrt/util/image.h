@@ -19,6 +19,8 @@
 #include <cstring>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace pbrt {
@@ -426,6 +428,41 @@ struct ImageAndMetadata {
     ImageMetadata metadata;
 };
 
+struct TiledEXRFile;
+
+// TiledImageWriter Definition
+class TiledImageWriter {
+  public:
+    // TiledImageWriter Public Methods
+    TiledImageWriter(const std::string &filename, const ImageMetadata &metadata,
+                     pstd::span<const std::string> channelNames, PixelFormat format,
+                     int tileSize);
+    ~TiledImageWriter();
+
+    TiledImageWriter(const TiledImageWriter &) = delete;
+    TiledImageWriter &operator=(const TiledImageWriter &) = delete;
+
+    // Writes the pixels of _image_ as the tile of the output file that covers
+    // _tileBounds_. Tiles may be written in any order and from any thread.
+    void WriteTile(const Image &image, const Bounds2i &tileBounds);
+
+    // Finishes the file once all of its tiles have been written, setting its
+    // "estimatedVariance" attribute if _estimatedVariance_ is provided. Tiles
+    // are written to a temporary file until then; it is removed without
+    // creating the output file if the writer is destroyed before Close().
+    void Close(pstd::optional<Float> estimatedVariance = {});
+
+    std::string ToString() const;
+
+  private:
+    // TiledImageWriter Private Members
+    std::string filename, tempFilename;
+    Bounds2i pixelBounds;
+    int tileSize;
+    std::mutex mutex;
+    std::unique_ptr<TiledEXRFile> file;
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_UTIL_IMAGE_H
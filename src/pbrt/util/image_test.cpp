@@ -457,6 +457,66 @@ TEST(Image, ExrMetadata) {
     EXPECT_EQ(0, remove(filename.c_str()));
 }
 
+TEST(Image, ExrTiledWriter) {
+    Point2i res(37, 22);
+    pstd::vector<float> rgbPixels = GetFloatPixels(res, 3);
+    Image image(rgbPixels, res, {"R", "G", "B"});
+
+    std::string filename = "tiled.exr";
+    Bounds2i pb(Point2i(3, 5), Point2i(3 + res.x, 5 + res.y));
+    ImageMetadata metadata;
+    metadata.pixelBounds = pb;
+    metadata.fullResolution = Point2i(64, 64);
+    int tileSize = 8;
+    std::vector<std::string> channels = {"R", "G", "B"};
+
+    {
+        TiledImageWriter writer(filename, metadata, channels, PixelFormat::Float,
+                                tileSize);
+        // Write the tiles in reverse order to exercise random tile order.
+        std::vector<Bounds2i> tiles;
+        for (int y = pb.pMin.y; y < pb.pMax.y; y += tileSize)
+            for (int x = pb.pMin.x; x < pb.pMax.x; x += tileSize)
+                tiles.push_back(Intersect(
+                    Bounds2i(Point2i(x, y), Point2i(x + tileSize, y + tileSize)), pb));
+        for (auto iter = tiles.rbegin(); iter != tiles.rend(); ++iter) {
+            Bounds2i crop(Point2i(iter->pMin - pb.pMin), Point2i(iter->pMax - pb.pMin));
+            writer.WriteTile(image.Crop(crop), *iter);
+        }
+        // The variance is only known once all tiles have been written
+        writer.Close(0.375f);
+    }
+
+    ImageAndMetadata read = Image::Read(filename);
+    EXPECT_EQ(res, read.image.Resolution());
+    EXPECT_EQ(pb, *read.metadata.pixelBounds);
+    EXPECT_EQ(Point2i(64, 64), *read.metadata.fullResolution);
+    ASSERT_TRUE(read.metadata.estimatedVariance.has_value());
+    EXPECT_EQ(0.375f, *read.metadata.estimatedVariance);
+
+    ImageChannelDesc rgbDesc = read.image.GetChannelDesc({"R", "G", "B"});
+    ASSERT_TRUE(bool(rgbDesc));
+    for (int y = 0; y < res.y; ++y)
+        for (int x = 0; x < res.x; ++x) {
+            ImageChannelValues v = read.image.GetChannels({x, y}, rgbDesc);
+            for (int c = 0; c < 3; ++c)
+                EXPECT_EQ(image.GetChannel({x, y}, c), v[c])
+                    << " @ (" << x << ", " << y << ", ch " << c << ")";
+        }
+
+    EXPECT_EQ(0, remove(filename.c_str()));
+
+    // A writer that isn't closed leaves neither the file nor its temporary
+    // file behind
+    {
+        TiledImageWriter writer(filename, metadata, channels, PixelFormat::Float,
+                                tileSize);
+        writer.WriteTile(image.Crop(Bounds2i(Point2i(0, 0), Point2i(tileSize, tileSize))),
+                         Bounds2i(pb.pMin, pb.pMin + Vector2i(tileSize, tileSize)));
+    }
+    EXPECT_TRUE(MatchingFilenames(filename).empty());
+}
+
 TEST(Image, PngRgbIO) {
     Point2i res(11, 50);
     pstd::vector<float> rgbPixels = GetFloatPixels(res, 3);
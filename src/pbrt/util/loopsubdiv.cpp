@@ -8,15 +8,24 @@
 #include <pbrt/util/error.h>
 #include <pbrt/util/memory.h>
 #include <pbrt/util/mesh.h>
+#include <pbrt/util/parallel.h>
+#include <pbrt/util/progressreporter.h>
 #include <pbrt/util/pstd.h>
+#include <pbrt/util/stats.h>
 #include <pbrt/util/transform.h>
 #include <pbrt/util/vecmath.h>
 
+#include <algorithm>
+#include <initializer_list>
 #include <map>
 #include <set>
 
 namespace pbrt {
 
+STAT_COUNTER("Geometry/Diced subdivision surface triangles", nDicedTriangles);
+STAT_INT_DISTRIBUTION("Geometry/Subdivision surface edge dicing rate", edgeDicingRate);
+STAT_FLOAT_DISTRIBUTION("Geometry/Subdivision surface dicing seconds", dicingSeconds);
+
 struct SDFace;
 struct SDVertex;
 
@@ -96,6 +105,10 @@ struct SDEdge {
 // LoopSubdiv Local Declarations
 static Point3f weightOneRing(SDVertex *vert, Float beta);
 static Point3f weightBoundary(SDVertex *vert, Float beta);
+static void refineToLimitSurface(int nLevels, pstd::span<const int> vertexIndices,
+                                 pstd::span<const Point3f> p, std::vector<int> *indices,
+                                 std::vector<Point3f> *pLimit,
+                                 std::vector<Normal3f> *nLimit);
 
 // LoopSubdiv Inline Functions
 inline int SDVertex::valence() {
@@ -133,6 +146,19 @@ inline Float loopGamma(int valence) {
 TriangleMesh *LoopSubdivide(const Transform *renderFromObject, bool reverseOrientation,
                             int nLevels, pstd::span<const int> vertexIndices,
                             pstd::span<const Point3f> p, Allocator alloc) {
+    std::vector<int> indices;
+    std::vector<Point3f> pLimit;
+    std::vector<Normal3f> nLimit;
+    refineToLimitSurface(nLevels, vertexIndices, p, &indices, &pLimit, &nLimit);
+    return alloc.new_object<TriangleMesh>(*renderFromObject, reverseOrientation, indices,
+                                          pLimit, std::vector<Vector3f>(), nLimit,
+                                          std::vector<Point2f>(), std::vector<int>());
+}
+
+static void refineToLimitSurface(int nLevels, pstd::span<const int> vertexIndices,
+                                 pstd::span<const Point3f> p, std::vector<int> *indices,
+                                 std::vector<Point3f> *pLimitOut,
+                                 std::vector<Normal3f> *nLimitOut) {
     std::vector<SDVertex *> vertices;
     std::vector<SDFace *> faces;
     // Allocate _LoopSubdiv_ vertices and faces
@@ -377,10 +403,177 @@ TriangleMesh *LoopSubdivide(const Transform *renderFromObject, bool reverseOrien
                 ++vp;
             }
         }
-        return alloc.new_object<TriangleMesh>(*renderFromObject, reverseOrientation,
-                                              verts, pLimit, std::vector<Vector3f>(), Ns,
-                                              std::vector<Point2f>(), std::vector<int>());
+        *indices = std::move(verts);
+        *pLimitOut = std::move(pLimit);
+        *nLimitOut = std::move(Ns);
+    }
+}
+
+TriangleMesh *DiceSubdivisionSurface(
+    const Transform *renderFromObject, bool reverseOrientation, int nLevels,
+    pstd::span<const int> vertexIndices, pstd::span<const Point3f> p, Float edgeLength,
+    int maxEdgeRate, const SubdivisionDicing &dicing,
+    std::function<Float(Point3f, Normal3f)> displacement, Allocator alloc) {
+    Timer timer;
+    std::vector<int> indices;
+    std::vector<Point3f> pLimit;
+    std::vector<Normal3f> nLimit;
+    refineToLimitSurface(nLevels, vertexIndices, p, &indices, &pLimit, &nLimit);
+    for (Normal3f &n : nLimit)
+        if (LengthSquared(n) > 0)
+            n = Normalize(n);
+    Transform objectFromRender = Inverse(*renderFromObject);
+
+    // Choose the number of segments for each edge from its length in pixels
+    auto outsideFrustum = [&](std::initializer_list<Point3f> pts) {
+        for (const auto &plane : dicing.frustum)
+            if (std::all_of(pts.begin(), pts.end(), [&](Point3f p) {
+                    return Dot(p - plane.first, plane.second) < 0;
+                }))
+                return true;
+        return false;
+    };
+    auto edgeRate = [&](int v0, int v1, bool cull) {
+        Point3f p0 = (*renderFromObject)(pLimit[v0]);
+        Point3f p1 = (*renderFromObject)(pLimit[v1]);
+        if (cull && outsideFrustum({p0, p1}))
+            return 1;
+        // Edges at a pinhole camera's position have no finite pixel length
+        Float z = Distance(dicing.pCamera, (p0 + p1) / 2);
+        Float footprint = dicing.pixelSpread + z * dicing.pixelAngle;
+        if (footprint == 0)
+            return p0 == p1 ? 1 : maxEdgeRate;
+        Float pixels = Distance(p0, p1) / footprint;
+        return int(Clamp(std::ceil(pixels / edgeLength), 1, maxEdgeRate));
+    };
+
+    // Dice each limit surface triangle independently
+    struct DicedPatch {
+        std::vector<Point3f> p;
+        std::vector<Normal3f> n;
+        std::vector<int> indices;
+    };
+    size_t nPatches = indices.size() / 3;
+    std::vector<DicedPatch> patches(nPatches);
+    ParallelFor(0, nPatches, [&](int64_t patchIndex) {
+        // Find edge rates and the interior rate $n$; edges outside the view get a
+        // single segment, though the interior may still be seen between them
+        const int *v = &indices[3 * patchIndex];
+        bool visible =
+            !outsideFrustum({(*renderFromObject)(pLimit[v[0]]),
+                             (*renderFromObject)(pLimit[v[1]]),
+                             (*renderFromObject)(pLimit[v[2]])});
+        int edgeRates[3], n = 1;
+        for (int e = 0; e < 3; ++e) {
+            edgeRates[e] = edgeRate(v[e], v[(e + 1) % 3], true);
+            if (visible)
+                n = std::max(n, edgeRate(v[e], v[(e + 1) % 3], false));
+        }
+        DicedPatch &patch = patches[patchIndex];
+
+        // Add patch vertex given its barycentric coordinates
+        auto addVertex = [&](Float b1, Float b2) {
+            Float b0 = 1 - b1 - b2;
+            patch.p.push_back(b0 * pLimit[v[0]] + b1 * pLimit[v[1]] + b2 * pLimit[v[2]]);
+            patch.n.push_back(b0 * nLimit[v[0]] + b1 * nLimit[v[1]] + b2 * nLimit[v[2]]);
+            return int(patch.p.size()) - 1;
+        };
+        // Add vertex _q_ of _rate_ on the edge from _v0_ to _v1_, computing it
+        // from the lower-indexed end so that neighboring patches agree exactly
+        auto addEdgeVertex = [&](int v0, int v1, int q, int rate) {
+            if (v0 > v1) {
+                std::swap(v0, v1);
+                q = rate - q;
+            }
+            Float t = Float(q) / rate;
+            patch.p.push_back(Lerp(t, pLimit[v0], pLimit[v1]));
+            patch.n.push_back(Lerp(t, nLimit[v0], nLimit[v1]));
+            return int(patch.p.size()) - 1;
+        };
+
+        // Create vertices at patch corners and along its edges
+        int corners[3] = {addVertex(0, 0), addVertex(1, 0), addVertex(0, 1)};
+        std::vector<int> edgeVertices[3];
+        for (int e = 0; e < 3; ++e) {
+            edgeVertices[e].push_back(corners[e]);
+            for (int q = 1; q < edgeRates[e]; ++q)
+                edgeVertices[e].push_back(
+                    addEdgeVertex(v[e], v[(e + 1) % 3], q, edgeRates[e]));
+            edgeVertices[e].push_back(corners[(e + 1) % 3]);
+        }
+
+        // Create interior vertices of the $n \times n$ triangular grid
+        std::vector<int> grid((n + 1) * (n + 1), -1);
+        auto gridIndex = [&](int i, int j) { return j * (n + 1) + i; };
+        for (int j = 1; j < n; ++j)
+            for (int i = 1; i + j < n; ++i)
+                grid[gridIndex(i, j)] = addVertex(Float(i) / n, Float(j) / n);
+
+        // Snap grid points on the boundary to the nearest vertex of their edge.
+        // This stitches edges to the interior without cracks, but each vertex of an
+        // edge with rate $r$ well below $n$ is left with a fan of about $n/r$ thin
+        // triangles, which cost intersection time though they render correctly.
+        auto snap = [&](int e, int k) {
+            int rate = edgeRates[e];
+            return edgeVertices[e][(2 * k * rate + n) / (2 * n)];
+        };
+        for (int k = 0; k <= n; ++k) {
+            grid[gridIndex(k, 0)] = snap(0, k);
+            grid[gridIndex(n - k, k)] = snap(1, k);
+            grid[gridIndex(0, n - k)] = snap(2, k);
+        }
+
+        // Emit grid triangles, skipping those collapsed by snapping
+        auto emit = [&](int a, int b, int c) {
+            if (a != b && b != c && c != a)
+                patch.indices.insert(patch.indices.end(), {a, b, c});
+        };
+        for (int j = 0; j < n; ++j)
+            for (int i = 0; i + j < n; ++i) {
+                emit(grid[gridIndex(i, j)], grid[gridIndex(i + 1, j)],
+                     grid[gridIndex(i, j + 1)]);
+                if (i + j + 2 <= n)
+                    emit(grid[gridIndex(i + 1, j)], grid[gridIndex(i + 1, j + 1)],
+                         grid[gridIndex(i, j + 1)]);
+            }
+
+        // Displace patch vertices along the surface normal
+        if (displacement)
+            for (size_t i = 0; i < patch.p.size(); ++i) {
+                Point3f pRender = (*renderFromObject)(patch.p[i]);
+                Normal3f nRender = Normalize((*renderFromObject)(patch.n[i]));
+                Float d = displacement(pRender, nRender);
+                patch.p[i] = objectFromRender(pRender + d * Vector3f(nRender));
+            }
+
+        for (int e = 0; e < 3; ++e)
+            ReportValue(edgeDicingRate, edgeRates[e]);
+    });
+
+    // Gather diced patches into a single mesh
+    std::vector<Point3f> P;
+    std::vector<Normal3f> N;
+    std::vector<int> dicedIndices;
+    for (const DicedPatch &patch : patches) {
+        int offset = P.size();
+        P.insert(P.end(), patch.p.begin(), patch.p.end());
+        N.insert(N.end(), patch.n.begin(), patch.n.end());
+        for (int index : patch.indices)
+            dicedIndices.push_back(offset + index);
     }
+    // Interpolated normals don't account for displacement, so leave them out in
+    // that case; diced triangles are small enough for faceting to be invisible
+    if (displacement)
+        N.clear();
+
+    nDicedTriangles += dicedIndices.size() / 3;
+    ReportValue(dicingSeconds, timer.ElapsedSeconds());
+    LOG_VERBOSE("Diced %d subdivision surface patches into %d triangles (%f s)", nPatches,
+                dicedIndices.size() / 3, timer.ElapsedSeconds());
+    return alloc.new_object<TriangleMesh>(*renderFromObject, reverseOrientation,
+                                          std::move(dicedIndices), std::move(P),
+                                          std::vector<Vector3f>(), std::move(N),
+                                          std::vector<Point2f>(), std::vector<int>());
 }
 
 static Point3f weightOneRing(SDVertex *vert, Float beta) {
@@ -8,14 +8,39 @@
 #include <pbrt/pbrt.h>
 
 #include <pbrt/util/pstd.h>
+#include <pbrt/util/vecmath.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
 
 namespace pbrt {
 
+// SubdivisionDicing Definition
+// Describes how large pixels are at a point in the scene: a pixel at distance
+// $z$ from _pCamera_ covers _pixelSpread_ + $z$ _pixelAngle_ in render space.
+// Edges outside of the optional _frustum_ planes, given as a point on each
+// plane and its inward-facing normal, are not subdivided.
+struct SubdivisionDicing {
+    Point3f pCamera;
+    Float pixelSpread = 1, pixelAngle = 0;
+    std::vector<std::pair<Point3f, Vector3f>> frustum;
+};
+
 // LoopSubdiv Declarations
 TriangleMesh *LoopSubdivide(const Transform *renderFromObject, bool reverseOrientation,
                             int nLevels, pstd::span<const int> vertexIndices,
                             pstd::span<const Point3f> p, Allocator alloc);
 
+// Subdivide _nLevels_ times, then split each resulting triangle so that its edges
+// are about _edgeLength_ pixels long and offset the new vertices along the surface
+// normal by _displacement_, which is given render-space points and unit normals.
+TriangleMesh *DiceSubdivisionSurface(
+    const Transform *renderFromObject, bool reverseOrientation, int nLevels,
+    pstd::span<const int> vertexIndices, pstd::span<const Point3f> p, Float edgeLength,
+    int maxEdgeRate, const SubdivisionDicing &dicing,
+    std::function<Float(Point3f, Normal3f)> displacement, Allocator alloc);
+
 }  // namespace pbrt
 
 #endif  // PBRT_UTIL_LOOPSUBDIV_H
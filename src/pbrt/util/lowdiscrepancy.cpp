@@ -29,6 +29,31 @@ std::string DigitPermutation::ToString() const {
     return s + " ]";
 }
 
+// SobolByteTables Method Definitions
+SobolByteTables::SobolByteTables(int nDimensions, Allocator alloc)
+    : nDimensions(nDimensions), tables(size_t(nDimensions) * NIndexBytes * 256, alloc) {
+    CHECK_GT(nDimensions, 0);
+    CHECK_LE(nDimensions, NSobolDimensions);
+    for (int dim = 0; dim < nDimensions; ++dim)
+        for (int byte = 0; byte < NIndexBytes; ++byte) {
+            uint32_t *t = &tables[(size_t(dim) * NIndexBytes + byte) * 256];
+            for (int value = 0; value < 256; ++value) {
+                // Compute table entry for index bits _value_ at byte _byte_
+                uint32_t v = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    int column = 8 * byte + bit;
+                    if ((value & (1 << bit)) && column < SobolMatrixSize)
+                        v ^= SobolMatrices32[dim * SobolMatrixSize + column];
+                }
+                t[value] = v;
+            }
+        }
+}
+
+std::string SobolByteTables::ToString() const {
+    return StringPrintf("[ SobolByteTables nDimensions: %d ]", nDimensions);
+}
+
 // HaltonIndexer Local Constants
 constexpr int HaltonPixelIndexer::MaxHaltonResolution;
 
@@ -197,6 +197,42 @@ inline uint32_t SobolSampleBits32(int64_t a, int dimension) {
     return v;
 }
 
+// SobolByteTables Definition
+class SobolByteTables {
+  public:
+    // SobolByteTables Public Methods
+    SobolByteTables(int nDimensions, Allocator alloc);
+
+    PBRT_CPU_GPU
+    int NDimensions() const { return nDimensions; }
+
+    PBRT_CPU_GPU
+    uint32_t SampleBits32(int64_t a, int dimension) const {
+        // Equivalent to _SobolSampleBits32()_, but handles a byte of _a_ at a time
+        DCHECK_LT(dimension, nDimensions);
+        const uint32_t *t = &tables[size_t(dimension) * NIndexBytes * 256];
+        uint32_t v = 0;
+        for (; a != 0; a >>= 8, t += 256)
+            v ^= t[a & 0xff];
+        return v;
+    }
+
+    template <typename R>
+    PBRT_CPU_GPU float SampleFloat(int64_t a, int dimension, R randomizer) const {
+        uint32_t v = randomizer(SampleBits32(a, dimension));
+        return std::min(v * 0x1p-32f /* 1/2^32 */, FloatOneMinusEpsilon);
+    }
+
+    std::string ToString() const;
+
+  private:
+    // SobolByteTables Private Members
+    static constexpr int NIndexBytes = (SobolMatrixSize + 7) / 8;
+    int nDimensions;
+    // XOR of the generator matrix columns for each value of each index byte
+    pstd::vector<uint32_t> tables;
+};
+
 // CranleyPattersonRotator Definition
 struct CranleyPattersonRotator {
     PBRT_CPU_GPU
@@ -283,6 +283,27 @@ T MIPMap::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
             (lod - ilod) * EWA<T>(ilod + 1, st, dst0, dst1));
 }
 
+bool MIPMap::PointTexel(const Point2f &st, Vector2f dst0, Vector2f dst1, int *level,
+                        Point2i *p) const {
+    CHECK(options.filter == FilterFunction::Point);
+    // Find the level and texel that _Lookup()_ returns for point filtering
+    Float width = 2 * std::max({std::abs(dst0[0]), std::abs(dst0[1]),
+                                std::abs(dst1[0]), std::abs(dst1[1])});
+    Float l = Levels() - 1 + Log2(std::max<Float>(width, 1e-8));
+    if (l >= Levels() - 1) {
+        *level = Levels() - 1;
+        *p = Point2i(0, 0);
+    } else {
+        *level = std::max(0, int(std::floor(l)));
+        Point2i resolution = LevelResolution(*level);
+        *p = Point2i(std::round(st[0] * resolution[0] - 0.5f),
+                     std::round(st[1] * resolution[1] - 0.5f));
+    }
+
+    // Apply the wrap mode; texels outside a black-wrapped image return false
+    return RemapPixelCoords(p, LevelResolution(*level), wrapMode);
+}
+
 template <typename T>
 T MIPMap::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     if (level >= Levels())
@@ -65,11 +65,14 @@ class MIPMap {
 
     const RGBColorSpace *GetRGBColorSpace() const { return colorSpace; }
 
+    template <typename T>
+    T Texel(int level, Point2i st) const;
+    bool PointTexel(const Point2f &st, Vector2f dst0, Vector2f dst1, int *level,
+                    Point2i *p) const;
+
     std::string ToString() const;
 
   private:
-    template <typename T>
-    T Texel(int level, Point2i st) const;
     template <typename T>
     T Bilerp(int level, Point2f st) const;
     template <typename T>
@@ -81,6 +84,11 @@ class MIPMap {
     MIPMapFilterOptions options;
 };
 
+template <>
+Float MIPMap::Texel(int level, Point2i st) const;
+template <>
+RGB MIPMap::Texel(int level, Point2i st) const;
+
 }  // namespace pbrt
 
 #endif  // PBRT_UTIL_MIPMAP_H
@@ -7,6 +7,8 @@
 #include <pbrt/util/check.h>
 #include <pbrt/util/print.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <list>
 #include <thread>
@@ -238,28 +240,112 @@ class ParallelForLoop1D : public ParallelJob {
 class ParallelForLoop2D : public ParallelJob {
   public:
     ParallelForLoop2D(const Bounds2i &extent, int chunkSize,
-                      std::function<void(Bounds2i)> func)
+                      pstd::span<const Point2i> tiles, std::function<void(Bounds2i)> func)
         : func(std::move(func)),
           extent(extent),
-          nextStart(extent.pMin),
-          chunkSize(chunkSize) {}
+          chunkSize(chunkSize),
+          nTiles((extent.Diagonal().x + chunkSize - 1) / chunkSize,
+                 (extent.Diagonal().y + chunkSize - 1) / chunkSize),
+          tiles(tiles) {
+        CHECK(tiles.empty() || tiles.size() == size_t(nTiles.x) * size_t(nTiles.y));
+    }
 
-    bool HaveWork() const { return nextStart.y < extent.pMax.y; }
+    bool HaveWork() const { return nextTile < nTiles.x * nTiles.y; }
     void RunStep(std::unique_lock<std::mutex> *lock);
 
     std::string ToString() const {
-        return StringPrintf("[ ParallelForLoop2D extent: %s nextStart: %s "
-                            "chunkSize: %d ]",
-                            extent, nextStart, chunkSize);
+        return StringPrintf("[ ParallelForLoop2D extent: %s chunkSize: %d nTiles: %s "
+                            "nextTile: %d ]",
+                            extent, chunkSize, nTiles, nextTile);
     }
 
   private:
     std::function<void(Bounds2i)> func;
     const Bounds2i extent;
-    Point2i nextStart;
     int chunkSize;
+    Point2i nTiles;
+    // Tile coordinates in the order they're handed out; empty for scanline order
+    pstd::span<const Point2i> tiles;
+    int nextTile = 0;
 };
 
+// Returns the point with index _d_ along the Hilbert curve over an $n \times n$
+// grid, where _n_ is a power of two
+static Point2i HilbertPoint(int64_t d, int n) {
+    int x = 0, y = 0;
+    for (int s = 1; s < n; s *= 2) {
+        int rx = 1 & (d / 2), ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            pstd::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+    }
+    return Point2i(x, y);
+}
+
+std::vector<Point2i> TileSequence(const Bounds2i &extent, int tileSize,
+                                  TileOrder order) {
+    CHECK_GT(tileSize, 0);
+    Point2i nTiles((extent.Diagonal().x + tileSize - 1) / tileSize,
+                   (extent.Diagonal().y + tileSize - 1) / tileSize);
+    std::vector<Point2i> tiles;
+    if (extent.IsEmpty())
+        return tiles;
+    tiles.reserve(size_t(nTiles.x) * size_t(nTiles.y));
+    if (order == TileOrder::Scanline) {
+        for (int y = 0; y < nTiles.y; ++y)
+            for (int x = 0; x < nTiles.x; ++x)
+                tiles.push_back(Point2i(x, y));
+    } else if (order == TileOrder::Hilbert) {
+        // Walk a Hilbert curve over the enclosing power-of-two grid and keep
+        // the tiles that are inside the image
+        int n = RoundUpPow2(std::max(nTiles.x, nTiles.y));
+        for (int64_t d = 0; d < int64_t(n) * int64_t(n);) {
+            Point2i p = HilbertPoint(d, n);
+            if (p.x < nTiles.x && p.y < nTiles.y) {
+                tiles.push_back(p);
+                ++d;
+                continue;
+            }
+            // Each run of $4^k$ curve indices starting at a multiple of $4^k$
+            // covers an aligned $2^k \times 2^k$ block of cells, so skip the
+            // largest such run that starts at _d_ and is outside the image
+            int64_t skip = 1;
+            for (int side = 2; side <= n && d % (4 * skip) == 0; side *= 2) {
+                if ((p.x & ~(side - 1)) < nTiles.x && (p.y & ~(side - 1)) < nTiles.y)
+                    break;
+                skip *= 4;
+            }
+            d += skip;
+        }
+    } else {
+        CHECK(order == TileOrder::Spiral);
+        // Sort tiles by square ring around the image center and then by angle
+        for (int y = 0; y < nTiles.y; ++y)
+            for (int x = 0; x < nTiles.x; ++x)
+                tiles.push_back(Point2i(x, y));
+        Point2f center(0.5f * (nTiles.x - 1), 0.5f * (nTiles.y - 1));
+        auto ring = [&](Point2i p) {
+            return std::max(std::abs(p.x - center.x), std::abs(p.y - center.y));
+        };
+        std::stable_sort(tiles.begin(), tiles.end(), [&](Point2i a, Point2i b) {
+            Float ra = ring(a), rb = ring(b);
+            if (ra != rb)
+                return ra < rb;
+            return std::atan2(a.y - center.y, a.x - center.x) <
+                   std::atan2(b.y - center.y, b.x - center.x);
+        });
+    }
+    CHECK_EQ(tiles.size(), size_t(nTiles.x) * size_t(nTiles.y));
+    return tiles;
+}
+
 // ParallelForLoop1D Method Definitions
 void ParallelForLoop1D::RunStep(std::unique_lock<std::mutex> *lock) {
     // Find the set of loop iterations to run next
@@ -280,16 +366,15 @@ void ParallelForLoop1D::RunStep(std::unique_lock<std::mutex> *lock) {
 
 void ParallelForLoop2D::RunStep(std::unique_lock<std::mutex> *lock) {
     // Compute extent for this step
-    Point2i end = nextStart + Vector2i(chunkSize, chunkSize);
-    Bounds2i b = Intersect(Bounds2i(nextStart, end), extent);
+    Point2i tile = tiles.empty() ? Point2i(nextTile % nTiles.x, nextTile / nTiles.x)
+                                 : tiles[nextTile];
+    Point2i start = extent.pMin + chunkSize * Vector2i(tile);
+    Bounds2i b = Intersect(Bounds2i(start, start + Vector2i(chunkSize, chunkSize)),
+                           extent);
     CHECK(!b.IsEmpty());
 
     // Advance to be ready for the next extent.
-    nextStart.x += chunkSize;
-    if (nextStart.x >= extent.pMax.x) {
-        nextStart.x = extent.pMin.x;
-        nextStart.y += chunkSize;
-    }
+    ++nextTile;
 
     if (!HaveWork())
         threadPool->RemoveFromJobList(this);
@@ -323,6 +408,15 @@ int MaxThreadIndex() {
     return threadPool ? (1 + threadPool->size()) : 1;
 }
 
+int ParallelTileSize(const Bounds2i &extent) {
+    // Want at least 8 tiles per thread, subject to not too big and not too
+    // small.
+    // TODO: should we do non-square?
+    return Clamp(int(std::sqrt(extent.Diagonal().x * extent.Diagonal().y /
+                               (8 * RunningThreads()))),
+                 1, 32);
+}
+
 void ParallelFor2D(const Bounds2i &extent, std::function<void(Bounds2i)> func) {
     CHECK(threadPool);
 
@@ -333,14 +427,32 @@ void ParallelFor2D(const Bounds2i &extent, std::function<void(Bounds2i)> func) {
         return;
     }
 
-    // Want at least 8 tiles per thread, subject to not too big and not too
-    // small.
-    // TODO: should we do non-square?
-    int tileSize = Clamp(int(std::sqrt(extent.Diagonal().x * extent.Diagonal().y /
-                                       (8 * RunningThreads()))),
-                         1, 32);
+    ParallelFor2D(extent, ParallelTileSize(extent), TileOrder::Scanline,
+                  std::move(func));
+}
+
+void ParallelFor2D(const Bounds2i &extent, int tileSize, TileOrder order,
+                   std::function<void(Bounds2i)> func) {
+    CHECK(threadPool);
+    CHECK_GT(tileSize, 0);
+    if (extent.IsEmpty())
+        return;
 
-    ParallelForLoop2D loop(extent, tileSize, std::move(func));
+    std::vector<Point2i> tiles;
+    if (order != TileOrder::Scanline)
+        tiles = TileSequence(extent, tileSize, order);
+    ParallelFor2D(extent, tileSize, tiles, std::move(func));
+}
+
+void ParallelFor2D(const Bounds2i &extent, int tileSize,
+                   pstd::span<const Point2i> tiles, std::function<void(Bounds2i)> func) {
+    CHECK(threadPool);
+    CHECK_GT(tileSize, 0);
+    if (extent.IsEmpty())
+        return;
+
+    // Create and enqueue _ParallelJob_ for this loop
+    ParallelForLoop2D loop(extent, tileSize, tiles, std::move(func));
     std::unique_lock<std::mutex> lock = threadPool->AddToJobList(&loop);
 
     // Help out with parallel loop iterations in the current thread
@@ -348,6 +460,31 @@ void ParallelFor2D(const Bounds2i &extent, std::function<void(Bounds2i)> func) {
         threadPool->WorkOrWait(&lock);
 }
 
+// TileOrder Function Definitions
+std::string ToString(TileOrder order) {
+    switch (order) {
+    case TileOrder::Scanline:
+        return "scanline";
+    case TileOrder::Hilbert:
+        return "hilbert";
+    case TileOrder::Spiral:
+        return "spiral";
+    default:
+        LOG_FATAL("Unhandled TileOrder");
+        return {};
+    }
+}
+
+pstd::optional<TileOrder> ParseTileOrder(const std::string &name) {
+    if (name == "scanline")
+        return TileOrder::Scanline;
+    else if (name == "hilbert")
+        return TileOrder::Hilbert;
+    else if (name == "spiral")
+        return TileOrder::Spiral;
+    return {};
+}
+
 ///////////////////////////////////////////////////////////////////////////
 
 int AvailableCores() {
@@ -8,6 +8,7 @@
 #include <pbrt/pbrt.h>
 
 #include <pbrt/util/float.h>
+#include <pbrt/util/pstd.h>
 #include <pbrt/util/vecmath.h>
 
 #include <atomic>
@@ -17,6 +18,7 @@
 #include <initializer_list>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace pbrt {
 
@@ -158,8 +160,24 @@ class Barrier {
     int numToBlock, numToExit;
 };
 
+// TileOrder Definition
+enum class TileOrder { Scanline, Hilbert, Spiral };
+
+std::string ToString(TileOrder order);
+pstd::optional<TileOrder> ParseTileOrder(const std::string &name);
+
 void ParallelFor(int64_t start, int64_t end, std::function<void(int64_t, int64_t)> func);
 void ParallelFor2D(const Bounds2i &extent, std::function<void(Bounds2i)> func);
+void ParallelFor2D(const Bounds2i &extent, int tileSize, TileOrder order,
+                   std::function<void(Bounds2i)> func);
+// Returns the coordinates of the _tileSize_ tiles that cover _extent_ in the
+// given order; loops over the same tiles may reuse it with the following
+// ParallelFor2D() variant rather than recomputing it
+std::vector<Point2i> TileSequence(const Bounds2i &extent, int tileSize,
+                                  TileOrder order);
+void ParallelFor2D(const Bounds2i &extent, int tileSize,
+                   pstd::span<const Point2i> tiles, std::function<void(Bounds2i)> func);
+int ParallelTileSize(const Bounds2i &extent);
 
 // Parallel Inline Functions
 inline void ParallelFor(int64_t start, int64_t end, std::function<void(int64_t)> func) {
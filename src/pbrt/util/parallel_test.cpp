@@ -6,6 +6,7 @@
 #include <pbrt/pbrt.h>
 #include <pbrt/util/parallel.h>
 #include <atomic>
+#include <vector>
 
 using namespace pbrt;
 
@@ -44,3 +45,49 @@ TEST(Parallel, ForEachThread) {
     ForEachThread([&count] { --count; });
     EXPECT_EQ(0, count);
 }
+
+TEST(Parallel, TileOrders) {
+    for (TileOrder order : {TileOrder::Scanline, TileOrder::Hilbert, TileOrder::Spiral})
+        for (int tileSize : {1, 3, 8, 64}) {
+            Bounds2i extent({-3, 5}, {37, 24});
+            std::vector<std::atomic<int>> counts(extent.Area());
+            ParallelFor2D(extent, tileSize, order, [&](Bounds2i b) {
+                EXPECT_TRUE(Inside(b.pMin, extent));
+                EXPECT_LE(b.Diagonal().x, tileSize);
+                EXPECT_LE(b.Diagonal().y, tileSize);
+                for (Point2i p : b)
+                    ++counts[(p.y - extent.pMin.y) * extent.Diagonal().x +
+                             (p.x - extent.pMin.x)];
+            });
+
+            // Every pixel should be visited exactly once
+            for (const std::atomic<int> &c : counts)
+                EXPECT_EQ(1, c) << ToString(order) << ", tile size " << tileSize;
+        }
+}
+
+TEST(Parallel, HilbertTileSequence) {
+    for (Point2i nTiles : {Point2i(1, 1), Point2i(8, 8), Point2i(5, 3), Point2i(1, 37),
+                           Point2i(100, 2), Point2i(33, 65)}) {
+        // Compare to the tiles inside the image along the curve over the
+        // enclosing power-of-two grid; the sequence skips blocks of the curve
+        // that are outside of the image
+        Bounds2i extent(Point2i(0, 0), Point2i(3 * nTiles.x, 3 * nTiles.y));
+        std::vector<Point2i> tiles = TileSequence(extent, 3, TileOrder::Hilbert);
+        std::vector<Point2i> expected;
+        std::vector<Point2i> all = TileSequence(
+            Bounds2i(Point2i(0, 0), Point2i(RoundUpPow2(std::max(nTiles.x, nTiles.y)),
+                                            RoundUpPow2(std::max(nTiles.x, nTiles.y)))),
+            1, TileOrder::Hilbert);
+        for (Point2i p : all) {
+            if (p.x < nTiles.x && p.y < nTiles.y)
+                expected.push_back(p);
+        }
+        EXPECT_EQ(expected, tiles) << nTiles;
+
+        // Successive tiles of a square power-of-two grid are adjacent
+        for (size_t i = 1; i < all.size(); ++i)
+            EXPECT_EQ(1, std::abs(all[i].x - all[i - 1].x) +
+                             std::abs(all[i].y - all[i - 1].y));
+    }
+}
@@ -25,12 +25,25 @@
 #include <string>
 #include <vector>
 
+// Use SSE/AVX for _SampledSpectrum_ arithmetic on the CPU
+#if !defined(PBRT_IS_GPU_CODE) && !defined(PBRT_FLOAT_AS_DOUBLE) && \
+    (defined(__SSE__) || defined(_M_X64))
+#define PBRT_SAMPLED_SPECTRUM_SIMD
+#include <immintrin.h>
+#endif
+
 namespace pbrt {
 
 // Spectrum Constants
 constexpr Float Lambda_min = 360, Lambda_max = 830;
 
+#ifdef PBRT_NSPECTRUM_SAMPLES
+static constexpr int NSpectrumSamples = PBRT_NSPECTRUM_SAMPLES;
+#else
 static constexpr int NSpectrumSamples = 4;
+#endif
+static_assert(NSpectrumSamples == 4 || NSpectrumSamples == 8 || NSpectrumSamples == 16,
+              "NSpectrumSamples must be 4, 8, or 16");
 
 static constexpr Float CIE_Y_integral = 106.856895;
 static constexpr Float K_m = 683;
@@ -76,6 +89,48 @@ DenselySampledSpectrum D(Float temperature, Allocator alloc);
 }  // namespace Spectra
 Float SpectrumToPhotometric(SpectrumHandle s);
 
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+namespace detail {
+
+enum class SIMDOp { Add, Sub, Mul, Div };
+
+// Applies _op_ to the _n_ values in _a_ and _b_ eight or four at a time, storing
+// the results in _a_
+template <SIMDOp op, int n>
+inline void SIMDApply(float *a, const float *b) {
+    static_assert(n % 4 == 0, "SIMD operations require a multiple of four values");
+    int i = 0;
+#ifdef __AVX__
+    for (; i + 8 <= n; i += 8) {
+        __m256 va = _mm256_loadu_ps(a + i), vb = _mm256_loadu_ps(b + i);
+        if constexpr (op == SIMDOp::Add)
+            va = _mm256_add_ps(va, vb);
+        else if constexpr (op == SIMDOp::Sub)
+            va = _mm256_sub_ps(va, vb);
+        else if constexpr (op == SIMDOp::Mul)
+            va = _mm256_mul_ps(va, vb);
+        else
+            va = _mm256_div_ps(va, vb);
+        _mm256_storeu_ps(a + i, va);
+    }
+#endif
+    for (; i < n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+        if constexpr (op == SIMDOp::Add)
+            va = _mm_add_ps(va, vb);
+        else if constexpr (op == SIMDOp::Sub)
+            va = _mm_sub_ps(va, vb);
+        else if constexpr (op == SIMDOp::Mul)
+            va = _mm_mul_ps(va, vb);
+        else
+            va = _mm_div_ps(va, vb);
+        _mm_storeu_ps(a + i, va);
+    }
+}
+
+}  // namespace detail
+#endif  // PBRT_SAMPLED_SPECTRUM_SIMD
+
 // SampledSpectrum Definition
 class SampledSpectrum {
   public:
@@ -88,8 +143,12 @@ class SampledSpectrum {
 
     PBRT_CPU_GPU
     SampledSpectrum &operator-=(const SampledSpectrum &s) {
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+        simdApply<detail::SIMDOp::Sub>(s);
+#else
         for (int i = 0; i < NSpectrumSamples; ++i)
             values[i] -= s.values[i];
+#endif
         return *this;
     }
     PBRT_CPU_GPU
@@ -100,16 +159,18 @@ class SampledSpectrum {
     PBRT_CPU_GPU
     friend SampledSpectrum operator-(Float a, const SampledSpectrum &s) {
         DCHECK(!std::isnan(a));
-        SampledSpectrum ret;
-        for (int i = 0; i < NSpectrumSamples; ++i)
-            ret.values[i] = a - s.values[i];
-        return ret;
+        SampledSpectrum ret(a);
+        return ret -= s;
     }
 
     PBRT_CPU_GPU
     SampledSpectrum &operator*=(const SampledSpectrum &s) {
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+        simdApply<detail::SIMDOp::Mul>(s);
+#else
         for (int i = 0; i < NSpectrumSamples; ++i)
             values[i] *= s.values[i];
+#endif
         return *this;
     }
     PBRT_CPU_GPU
@@ -121,15 +182,17 @@ class SampledSpectrum {
     SampledSpectrum operator*(Float a) const {
         DCHECK(!std::isnan(a));
         SampledSpectrum ret = *this;
-        for (int i = 0; i < NSpectrumSamples; ++i)
-            ret.values[i] *= a;
-        return ret;
+        return ret *= a;
     }
     PBRT_CPU_GPU
     SampledSpectrum &operator*=(Float a) {
         DCHECK(!std::isnan(a));
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+        simdApply<detail::SIMDOp::Mul>(SampledSpectrum(a));
+#else
         for (int i = 0; i < NSpectrumSamples; ++i)
             values[i] *= a;
+#endif
         return *this;
     }
     PBRT_CPU_GPU
@@ -137,10 +200,16 @@ class SampledSpectrum {
 
     PBRT_CPU_GPU
     SampledSpectrum &operator/=(const SampledSpectrum &s) {
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+        for (int i = 0; i < NSpectrumSamples; ++i)
+            DCHECK_NE(0, s.values[i]);
+        simdApply<detail::SIMDOp::Div>(s);
+#else
         for (int i = 0; i < NSpectrumSamples; ++i) {
             DCHECK_NE(0, s.values[i]);
             values[i] /= s.values[i];
         }
+#endif
         return *this;
     }
     PBRT_CPU_GPU
@@ -152,8 +221,12 @@ class SampledSpectrum {
     SampledSpectrum &operator/=(Float a) {
         DCHECK_NE(a, 0);
         DCHECK(!std::isnan(a));
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+        simdApply<detail::SIMDOp::Div>(SampledSpectrum(a));
+#else
         for (int i = 0; i < NSpectrumSamples; ++i)
             values[i] /= a;
+#endif
         return *this;
     }
     PBRT_CPU_GPU
@@ -222,8 +295,12 @@ class SampledSpectrum {
 
     PBRT_CPU_GPU
     SampledSpectrum &operator+=(const SampledSpectrum &s) {
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+        simdApply<detail::SIMDOp::Add>(s);
+#else
         for (int i = 0; i < NSpectrumSamples; ++i)
             values[i] += s.values[i];
+#endif
         return *this;
     }
 
@@ -251,6 +328,14 @@ class SampledSpectrum {
 
   private:
     friend class SOA<SampledSpectrum>;
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+    // SampledSpectrum Private Methods
+    template <detail::SIMDOp op>
+    void simdApply(const SampledSpectrum &s) {
+        detail::SIMDApply<op, NSpectrumSamples>(values.data(), s.values.data());
+    }
+#endif  // PBRT_SAMPLED_SPECTRUM_SIMD
+
     // SampledSpectrum Private Members
     pstd::array<Float, NSpectrumSamples> values;
 };
@@ -454,6 +539,11 @@ class PiecewiseLinearSpectrum {
     PBRT_CPU_GPU
     Float operator()(Float lambda) const;
 
+    PBRT_CPU_GPU
+    pstd::span<const Float> Lambdas() const { return lambdas; }
+    PBRT_CPU_GPU
+    pstd::span<const Float> Values() const { return values; }
+
     std::string ToString() const;
     std::string ParameterType() const;
     std::string ParameterString() const;
@@ -8,11 +8,14 @@
 
 #include <pbrt/util/color.h>
 #include <pbrt/util/colorspace.h>
+#include <pbrt/util/progressreporter.h>
 #include <pbrt/util/rng.h>
 #include <pbrt/util/sampling.h>
 #include <pbrt/util/spectrum.h>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 using namespace pbrt;
 
@@ -157,3 +160,93 @@ TEST(Spectrum, SamplingPdfXYZ) {
     EXPECT_LT(std::abs((impInt - unifInt) / unifInt), 1e-3)
         << impInt << " vs. " << unifInt;
 }
+
+TEST(SampledSpectrum, OperatorsMatchScalar) {
+    RNG rng;
+    auto random = [&]() { return Lerp(rng.Uniform<Float>(), -10.f, 10.f); };
+    for (int iter = 0; iter < 1000; ++iter) {
+        SampledSpectrum a, b;
+        for (int i = 0; i < NSpectrumSamples; ++i) {
+            a[i] = random();
+            // Keep divisors away from zero
+            b[i] = std::copysign(.1f + std::abs(random()), random());
+        }
+        Float f = std::copysign(.1f + std::abs(random()), random());
+
+        SampledSpectrum sum = a + b, diff = a - b, prod = a * b, quot = a / b;
+        SampledSpectrum scaled = a * f, fScaled = f * a, divided = a / f;
+        SampledSpectrum fDiff = f - a;
+        for (int i = 0; i < NSpectrumSamples; ++i) {
+            EXPECT_EQ(a[i] + b[i], sum[i]);
+            EXPECT_EQ(a[i] - b[i], diff[i]);
+            EXPECT_EQ(a[i] * b[i], prod[i]);
+            EXPECT_EQ(a[i] / b[i], quot[i]);
+            EXPECT_EQ(a[i] * f, scaled[i]);
+            EXPECT_EQ(f * a[i], fScaled[i]);
+            EXPECT_EQ(a[i] / f, divided[i]);
+            EXPECT_EQ(f - a[i], fDiff[i]);
+        }
+    }
+}
+
+// Reports the variance and cost of single-path estimates of the luminance of
+// a fluorescent light reflected by a green surface with this build's number
+// of wavelength samples. More wavelengths per path reduce variance at the cost
+// of more spectral work per path.
+TEST(SampledSpectrum, DISABLED_WavelengthCountTiming) {
+    SpectrumHandle light = GetNamedSpectrum("stdillum-F4");
+    RGBReflectanceSpectrum reflectance(*RGBColorSpace::sRGB, RGB(.2f, .6f, .3f));
+    RNG rng;
+    VarianceEstimator<double> estimate;
+    int n = 4000000;
+    Timer timer;
+    for (int i = 0; i < n; ++i) {
+        SampledWavelengths lambda = SampledWavelengths::SampleXYZ(rng.Uniform<Float>());
+        SampledSpectrum L = light.Sample(lambda) * reflectance.Sample(lambda);
+        estimate.Add(L.y(lambda));
+    }
+    double ns = 1e9 * timer.ElapsedSeconds() / n;
+    fprintf(stderr,
+            "%d wavelengths: mean %f, variance %f, %.1f ns/path, "
+            "variance x time %f\n",
+            NSpectrumSamples, estimate.Mean(), estimate.Variance(), ns,
+            estimate.Variance() * ns);
+}
+
+#ifdef PBRT_SAMPLED_SPECTRUM_SIMD
+// Checks _detail::SIMDApply()_ with _n_ values against scalar arithmetic
+template <int n>
+static void CheckSIMDApply(RNG &rng) {
+    for (int iter = 0; iter < 1000; ++iter) {
+        float a[n], b[n];
+        for (int i = 0; i < n; ++i) {
+            a[i] = Lerp(rng.Uniform<Float>(), -10.f, 10.f);
+            b[i] = std::copysign(.1f + 10 * rng.Uniform<Float>(), a[i] - 1);
+        }
+        float sum[n], diff[n], prod[n], quot[n];
+        std::copy(a, a + n, sum);
+        std::copy(a, a + n, diff);
+        std::copy(a, a + n, prod);
+        std::copy(a, a + n, quot);
+        detail::SIMDApply<detail::SIMDOp::Add, n>(sum, b);
+        detail::SIMDApply<detail::SIMDOp::Sub, n>(diff, b);
+        detail::SIMDApply<detail::SIMDOp::Mul, n>(prod, b);
+        detail::SIMDApply<detail::SIMDOp::Div, n>(quot, b);
+        for (int i = 0; i < n; ++i) {
+            EXPECT_EQ(a[i] + b[i], sum[i]) << n;
+            EXPECT_EQ(a[i] - b[i], diff[i]) << n;
+            EXPECT_EQ(a[i] * b[i], prod[i]) << n;
+            EXPECT_EQ(a[i] / b[i], quot[i]) << n;
+        }
+    }
+}
+
+TEST(SampledSpectrum, SIMDMatchesScalar) {
+    // Check all of the supported values of _NSpectrumSamples_, not just the
+    // one pbrt was built with
+    RNG rng;
+    CheckSIMDApply<4>(rng);
+    CheckSIMDApply<8>(rng);
+    CheckSIMDApply<16>(rng);
+}
+#endif  // PBRT_SAMPLED_SPECTRUM_SIMD
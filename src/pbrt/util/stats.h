@@ -129,18 +129,16 @@ class PixelStatsAccumulator {
     });
 
 #define STAT_FLOAT_DISTRIBUTION(title, var)                                             \
-    static thread_local StatCounter<double> var##sum;                                   \
+    static thread_local double var##sum;                                                \
     static thread_local int64_t var##count;                                             \
-    static thread_local StatCounter<double> var##min(                                   \
-        std::numeric_limits<double>::max());                                            \
-    static thread_local StatCounter<double> var##max(                                   \
-        std::numeric_limits<double>::lowest());                                         \
+    static thread_local double var##min(std::numeric_limits<double>::max());            \
+    static thread_local double var##max(std::numeric_limits<double>::lowest());         \
     static StatRegisterer STATS_REG##var([](StatsAccumulator &accum) {                  \
         accum.ReportFloatDistribution(title, var##sum, var##count, var##min, var##max); \
         var##sum = 0;                                                                   \
         var##count = 0;                                                                 \
-        var##min = StatCounter<double>(std::numeric_limits<double>::max());             \
-        var##max = StatCounter<double>(std::numeric_limits<double>::lowest());          \
+        var##min = std::numeric_limits<double>::max();                                  \
+        var##max = std::numeric_limits<double>::lowest();                               \
     });
 
 #define STAT_PERCENT(title, numVar, denomVar)                             \
@@ -1132,6 +1132,19 @@ Bounds3f AnimatedTransform::MotionBounds(const Bounds3f &b) const {
     return bounds;
 }
 
+Bounds3f AnimatedTransform::MotionBounds(const Bounds3f &b, Float time0,
+                                         Float time1) const {
+    // Clamp the time interval to the transformation's time range
+    time0 = Clamp(time0, startTime, endTime);
+    time1 = Clamp(time1, startTime, endTime);
+    if (!actuallyAnimated || time1 <= time0)
+        return Interpolate(time0)(b);
+
+    // Bound motion over $[t_0,t_1]$ using the transformations at its endpoints
+    AnimatedTransform interval(Interpolate(time0), time0, Interpolate(time1), time1);
+    return interval.MotionBounds(b);
+}
+
 Bounds3f AnimatedTransform::BoundPointMotion(const Point3f &p) const {
     if (!actuallyAnimated)
         return Bounds3f(startTransform(p));
@@ -34,6 +34,13 @@ class Transform {
                 std::abs(lc2 - 1) > 1e-3f);
     }
 
+    PBRT_CPU_GPU
+    bool IsAffine() const {
+        return m[3][0] == 0 && m[3][1] == 0 && m[3][2] == 0 && m[3][3] == 1 &&
+               mInv[3][0] == 0 && mInv[3][1] == 0 && mInv[3][2] == 0 &&
+               mInv[3][3] == 1;
+    }
+
     PBRT_CPU_GPU
     inline Ray ApplyInverse(const Ray &r, Float *tMax = nullptr) const;
     PBRT_CPU_GPU
@@ -486,6 +493,8 @@ class AnimatedTransform {
 
     PBRT_CPU_GPU
     Bounds3f MotionBounds(const Bounds3f &b) const;
+    PBRT_CPU_GPU
+    Bounds3f MotionBounds(const Bounds3f &b, Float time0, Float time1) const;
 
     PBRT_CPU_GPU
     Bounds3f BoundPointMotion(const Point3f &p) const;
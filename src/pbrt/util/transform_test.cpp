@@ -70,3 +70,36 @@ TEST(AnimatedTransform, Randoms) {
         }
     }
 }
+
+TEST(AnimatedTransform, IntervalMotionBounds) {
+    RNG rng;
+    auto r = [&rng]() { return -10. + 20. * rng.Uniform<Float>(); };
+
+    for (int i = 0; i < 100; ++i) {
+        AnimatedTransform at(RandomTransform(rng), 0., RandomTransform(rng), 1.);
+        Bounds3f bounds(Point3f(r(), r(), r()), Point3f(r(), r(), r()));
+        Bounds3f motionBounds = at.MotionBounds(bounds);
+
+        // Bound the motion over a random subinterval of the time range
+        Float t0 = rng.Uniform<Float>(), t1 = rng.Uniform<Float>();
+        if (t0 > t1)
+            pstd::swap(t0, t1);
+        Bounds3f intervalBounds = at.MotionBounds(bounds, t0, t1);
+
+        // Allow for round-off error from decomposing the interpolated
+        // transformations at the interval's endpoints.
+        Vector3f slop = (Float)1e-3 * motionBounds.Diagonal();
+        for (int c = 0; c < 3; ++c) {
+            EXPECT_GE(intervalBounds.pMin[c] + slop[c], motionBounds.pMin[c]);
+            EXPECT_LE(intervalBounds.pMax[c] - slop[c], motionBounds.pMax[c]);
+        }
+
+        for (int j = 0; j <= 10; ++j) {
+            Bounds3f tb = at.Interpolate(Lerp(j / 10.f, t0, t1))(bounds);
+            for (int c = 0; c < 3; ++c) {
+                EXPECT_GE(tb.pMin[c] + slop[c], intervalBounds.pMin[c]);
+                EXPECT_LE(tb.pMax[c] - slop[c], intervalBounds.pMax[c]);
+            }
+        }
+    }
+}